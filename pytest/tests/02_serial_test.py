@@ -57,6 +57,24 @@ def test_serial_api_read(workbench, slot, test_progress):
     time.sleep(5)
 
 
+def test_serial_api_summary(workbench, slot, test_progress):
+    """Test the SUMMARY command (daily summary taken on demand)."""
+
+    test_progress("Waiting for serial readiness")
+    # wait between tests for serial communication
+    time.sleep(3)
+
+    test_progress("Requesting the daily summary")
+    result = workbench.serial_write(slot=slot, data="\nSUMMARY\n", pattern="Daily summary: ", timeout=15)
+    assert result.get("matched")
+
+    full_output = "\n".join(result.get("output", []))
+    assert "readings: " in full_output
+    assert "missed heartbeats: " in full_output
+    status = result.get("line").split("Daily summary: ")[-1].strip()
+    assert status in ("normal", "warning", "critical", "offline")
+
+
 def test_serial_api_get_config(workbench, slot, test_progress):
     """Test the GET_CONFIG command."""
 
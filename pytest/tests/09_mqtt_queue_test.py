@@ -0,0 +1,128 @@
+import pytest
+import time
+import json
+
+
+def get_status(workbench, esp_ip):
+    resp = workbench.http_get(f"http://{esp_ip}/status", timeout=5)
+    assert resp.status_code == 200
+    return resp.json()
+
+
+def test_mqtt_queue_replay_after_broker_outage(workbench, slot, wifi_network, test_progress):
+    """
+    Test if readings taken while the broker is down are queued and replayed
+    with their original timestamp once the broker is back.
+    """
+    test_progress("Phase 1: Setup WiFi and MQTT")
+    workbench.mqtt_start()
+    time.sleep(2)
+
+    config = {
+        "wifiSSID": wifi_network.get("ssid"),
+        "wifiPassword": wifi_network.get("password"),
+        "wifiTimeout": 120,
+        "mqttServer": wifi_network.get("ap_ip"),
+        "mqttPort": 1883,
+        "mqttTopic": "/test/topic",
+        "interval": 10
+    }
+
+    result = workbench.serial_write(slot=slot, data=f"\nSET_CONFIG {json.dumps(config)}\n", pattern="Config saved successfully.", timeout=15)
+    assert result.get("matched")
+
+    result = workbench.serial_monitor(slot=slot, pattern="MQTT-broker... ok", timeout=25)
+    assert result.get("matched"), "MQTT failed to connect initially"
+
+    time.sleep(5)
+    status = workbench.ap_status()
+    stations = status.get("stations", [])
+    assert len(stations) > 0, "No stations connected to AP"
+    esp_ip = stations[0].get("ip")
+
+    data = get_status(workbench, esp_ip)
+    assert data.get("mqttConnected") is True
+    assert "mqttQueued" in data and "mqttDropped" in data and "mqttDrainRate" in data
+    dropped_before = data.get("mqttDropped")
+
+    test_progress("Phase 2: Kill the broker and take readings")
+    workbench.mqtt_stop()
+    queued = 0
+    for i in range(6):
+        workbench.serial_write(slot=slot, data="\nREAD\n")
+        time.sleep(15)
+        queued = get_status(workbench, esp_ip).get("mqttQueued", 0)
+        print(f"Readings queued after {i + 1} reads: {queued}")
+        if queued >= 2:
+            break
+
+    if queued == 0:
+        workbench.mqtt_start()
+        pytest.skip("No valid readings (sensor not in range), nothing to queue")
+
+    test_progress("Phase 3: Restart the broker and wait for the replay")
+    workbench.mqtt_start()
+    time.sleep(2)
+    workbench.mqtt_clear_messages()
+    workbench.mqtt_subscribe(config["mqttTopic"])
+
+    result = workbench.serial_monitor(slot=slot, pattern="readings replayed in", timeout=40)
+    assert result.get("matched"), "Queued readings were not replayed after the broker restart"
+
+    test_progress("Phase 4: Verify the replayed readings")
+    replayed = []
+    for i in range(5):
+        messages = workbench.mqtt_get_messages(topic=config["mqttTopic"])
+        replayed = [json.loads(m.get("payload", "{}")) for m in messages]
+        replayed = [m for m in replayed if m.get("queued") is True]
+        if len(replayed) >= queued:
+            break
+        time.sleep(2)
+
+    assert len(replayed) >= queued, f"Expected {queued} replayed readings, got {len(replayed)}"
+    times = [m.get("time") for m in replayed]
+    assert times == sorted(times), "Replayed readings are out of order"
+    assert all("pH" in m for m in replayed)
+
+    data = get_status(workbench, esp_ip)
+    assert data.get("mqttQueued") == 0
+    assert data.get("mqttDropped") == dropped_before
+    assert data.get("mqttDrainRate") > 0
+
+
+def test_mqtt_queue_offline(workbench, slot, wifi_network, test_progress):
+    """
+    Test if readings taken in OFFLINE (standby) mode are queued and listed in STATUS.
+    """
+    test_progress("Phase 1: Setup WiFi and MQTT")
+    workbench.mqtt_start()
+    time.sleep(2)
+
+    config = {
+        "wifiSSID": wifi_network.get("ssid"),
+        "wifiPassword": wifi_network.get("password"),
+        "wifiTimeout": 120,
+        "mqttServer": wifi_network.get("ap_ip"),
+        "mqttPort": 1883,
+        "mqttTopic": "/test/topic",
+        "interval": 10
+    }
+
+    result = workbench.serial_write(slot=slot, data=f"\nSET_CONFIG {json.dumps(config)}\n", pattern="MQTT-broker... ok", timeout=30)
+    assert result.get("matched")
+
+    test_progress("Phase 2: Enter OFFLINE mode and take a reading")
+    result = workbench.serial_write(slot=slot, data="\nOFFLINE\n", pattern="Entering Standby", timeout=15)
+    assert result.get("matched")
+
+    workbench.serial_write(slot=slot, data="\nREAD\n")
+    time.sleep(20)
+
+    test_progress("Phase 3: Verify the queue in STATUS")
+    result = workbench.serial_write(slot=slot, data="\nSTATUS\n", pattern='"mqttQueued"', timeout=15)
+    assert result.get("matched")
+    data = json.loads(result.get("line"))
+    if data.get("type", 0) == 0:
+        pytest.skip("No valid reading (sensor not in range), nothing to queue")
+    assert data.get("mqttConnected") is False
+    assert data.get("mqttQueued") > 0, "Reading taken in standby was not queued"
@@ -0,0 +1,77 @@
+import pytest
+import time
+
+
+def header(resp, name):
+    for key, value in resp.headers.items():
+        if key.lower() == name.lower():
+            return value
+    return None
+
+
+def test_http_status_etag(workbench, slot, wifi_connection, test_progress):
+    """
+    Test the cached /status and /config.json:
+    1. Responses carry an ETag.
+    2. A request with the current ETag in If-None-Match gets 304 without a body.
+    """
+    esp_ip = wifi_connection.get("ip")
+    time.sleep(5)  # Give web server time to start
+
+    for url in (f"http://{esp_ip}/status", f"http://{esp_ip}/config.json"):
+        test_progress(f"Revalidating {url}")
+        resp = workbench.http_get(url, timeout=10)
+        assert resp.status_code == 200
+        etag = header(resp, "ETag")
+        assert etag and etag.startswith('"'), f"no ETag on {url}"
+
+        resp = workbench.http_get(url, headers={"If-None-Match": etag}, timeout=10)
+        assert resp.status_code in (200, 304), f"unexpected status {resp.status_code}"
+        if resp.status_code == 304:
+            assert len(resp.text) == 0, "304 with a body"
+        else:
+            # /status may have been rebuilt in between (max age), the ETag then changed
+            assert header(resp, "ETag") != etag, "200 with an unchanged ETag"
+
+    resp = workbench.http_get(f"http://{esp_ip}/config.json", timeout=10)
+    etag = header(resp, "ETag")
+    resp = workbench.http_get(f"http://{esp_ip}/config.json", headers={"If-None-Match": f'W/{etag}'}, timeout=10)
+    assert resp.status_code == 304, "config.json not answered 304"
+
+
+def test_http_status_dashboards(workbench, slot, wifi_connection, test_progress):
+    """
+    Measure /status with several dashboards polling and revalidating:
+    requests per second, share of 304 answers and heap before and after.
+    """
+    esp_ip = wifi_connection.get("ip")
+    url = f"http://{esp_ip}/status"
+    time.sleep(5)
+
+    before = workbench.http_get(url, timeout=10).json()
+    dashboards = 4
+    etags = [None] * dashboards
+    counts = {200: 0, 304: 0}
+
+    test_progress(f"Polling /status as {dashboards} dashboards")
+    start = time.time()
+    requests = 0
+    while time.time() - start < 30:
+        for d in range(dashboards):
+            headers = {"If-None-Match": etags[d]} if etags[d] else None
+            resp = workbench.http_get(url, headers=headers, timeout=10)
+            assert resp.status_code in counts, f"unexpected status {resp.status_code}"
+            counts[resp.status_code] += 1
+            if resp.status_code == 200:
+                etags[d] = header(resp, "ETag")
+            requests += 1
+    elapsed = time.time() - start
+
+    after = workbench.http_get(url, timeout=10).json()
+    print(f"{requests} requests in {elapsed:.1f} s: {requests / elapsed:.1f} requests/s, "
+          f"{counts[304]} answered 304, builds {after['httpBuilds'] - before['httpBuilds']}, "
+          f"heapFree {before['heapFree']} -> {after['heapFree']}")
+
+    assert counts[304] > 0, "no request was answered 304"
+    assert after["httpNotModified"] - before["httpNotModified"] >= counts[304]
+    assert after["httpBuilds"] - before["httpBuilds"] < requests, "every request rebuilt the status"
@@ -0,0 +1,47 @@
+import pytest
+import time
+
+
+def parse(text):
+    """Parses the Prometheus text format into {series: value}, series as written (name and labels)."""
+    samples = {}
+    for line in text.splitlines():
+        if not line or line.startswith("#"):
+            continue
+        series, value = line.rsplit(" ", 1)
+        samples[series] = float(value)
+    return samples
+
+
+def test_metrics_exposition(workbench, slot, wifi_connection, test_progress):
+    """
+    Test the /metrics endpoint:
+    1. Served as Prometheus text with HELP and TYPE of every family.
+    2. Histogram buckets are cumulative and +Inf equals _count.
+    3. A /status request is counted in the histogram of its route.
+    """
+    esp_ip = wifi_connection.get("ip")
+    url = f"http://{esp_ip}/metrics"
+    time.sleep(5)  # Give web server time to start
+
+    test_progress("Scraping /metrics")
+    resp = workbench.http_get(url, timeout=10)
+    assert resp.status_code == 200
+    assert "# TYPE yc01_ble_read_duration_seconds histogram" in resp.text
+    assert "# TYPE yc01_heap_free_bytes gauge" in resp.text
+    before = parse(resp.text)
+    assert before["yc01_heap_free_bytes"] > 0
+    assert before["yc01_heap_largest_free_block_bytes"] <= before["yc01_heap_free_bytes"]
+
+    for name in ("yc01_ble_read_duration_seconds", "yc01_mqtt_publish_duration_seconds"):
+        buckets = [v for k, v in before.items() if k.startswith(name + "_bucket")]
+        assert buckets == sorted(buckets), f"{name} buckets not cumulative"
+        assert before[name + '_bucket{le="+Inf"}'] == before[name + "_count"]
+
+    test_progress("Counting a /status request")
+    workbench.http_get(f"http://{esp_ip}/status", timeout=10)
+    after = parse(workbench.http_get(url, timeout=10).text)
+    key = 'yc01_http_request_duration_seconds_count{route="status"}'
+    assert after[key] >= before[key] + 1
+    mean_us = after['yc01_http_request_duration_seconds_sum{route="status"}'] / after[key] * 1e6
+    print(f"/status handler: {after[key]:.0f} requests, {mean_us:.0f} us mean")
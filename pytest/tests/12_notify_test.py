@@ -0,0 +1,59 @@
+import pytest
+import time
+import json
+
+
+def get_status(workbench, esp_ip):
+    resp = workbench.http_get(f"http://{esp_ip}/status", timeout=5)
+    assert resp.status_code == 200
+    return resp.json()
+
+
+def test_notify_delivery_does_not_block_loop(workbench, slot, wifi_network, test_progress):
+    """
+    Test that a notification delivery runs beside the loop:
+    1. The webhook is an unreachable address (TEST-NET-1), so each delivery
+       waits for the full connect timeout (3 s).
+    2. /status keeps answering while the delivery is in progress.
+    3. loopMaxUs does not grow to the connect timeout.
+    """
+    test_progress("Phase 1: Configure WiFi and an unreachable webhook")
+    config = {
+        "wifiSSID": wifi_network.get("ssid"),
+        "wifiPassword": wifi_network.get("password"),
+        "notifyUrl": "http://192.0.2.1/hook",
+    }
+    result = workbench.serial_write(slot=slot, data=f"\nSET_CONFIG {json.dumps(config)}\n", pattern="Config saved successfully.", timeout=15)
+    assert result.get("matched")
+    station = workbench.wait_for_station(timeout=45)
+    esp_ip = station.get("ip")
+    assert esp_ip, "Could not get ESP IP address"
+    time.sleep(5)  # Give web server time to start
+
+    data = get_status(workbench, esp_ip)
+    assert "notifyQueued" in data and "notifyFailed" in data
+    failed_before = data.get("notifyFailed")
+    loop_before = data.get("loopMaxUs")
+
+    test_progress("Phase 2: Queue the daily summary and poll /status during the delivery")
+    workbench.serial_write(slot=slot, data="\nSUMMARY\n", pattern="Daily summary: ", timeout=15)
+    answered = 0
+    start = time.time()
+    while time.time() - start < 6:
+        data = get_status(workbench, esp_ip)
+        answered += 1
+        time.sleep(0.5)
+    print(f"/status answered {answered} times during the delivery")
+    assert answered >= 6
+
+    test_progress("Phase 3: Check the failed delivery and the loop time")
+    for i in range(10):  # status fields are refreshed every 5 s
+        data = get_status(workbench, esp_ip)
+        if data.get("notifyFailed") > failed_before:
+            break
+        time.sleep(2)
+    assert data.get("notifyFailed") >= failed_before + 1, "Delivery to the unreachable webhook did not fail"
+    assert data.get("notifyQueued") >= 1, "The summary must stay queued for the retry"
+    print(f"loopMaxUs before {loop_before}, after the delivery {data.get('loopMaxUs')}")
+    # loopMaxUs is the maximum since boot: the delivery must not raise it to the connect timeout
+    assert data.get("loopMaxUs") <= max(loop_before, 999999), "loop() blocked during the delivery"
@@ -3,6 +3,14 @@
 
 #include "config.h"
 #include "BLE-YC01.h"
+#include "gattCache.h"
+#include "metrics.h"
+
+#if defined(CONFIG_NIMBLE_CPP_IDF)
+#include "host/ble_gatt.h"
+#else
+#include "nimble/nimble/host/include/host/ble_gatt.h"
+#endif
 
 
 // BLE device configuration
@@ -10,215 +18,789 @@ std::string targetName = "BLE-YC01";
 NimBLEUUID serviceUUID("0000ff01-0000-1000-8000-00805f9b34fb");
 NimBLEUUID charUUID("0000ff02-0000-1000-8000-00805f9b34fb");
 
+// frames with a checksum mismatch, counted from the scan callback and the worker task
+static MetricsCounter checksumErrors;
 
-bool compareBLEAddress(const NimBLEAddress& address, const char* targetAddress) {
-    std::string addr1 = address.toString();
-    std::string addr2 = targetAddress;
 
-    // convert to lower case
-    std::transform(addr1.begin(), addr1.end(), addr1.begin(), ::tolower);
-    std::transform(addr2.begin(), addr2.end(), addr2.begin(), ::tolower);
+uint64_t bleAddressKey(const NimBLEAddress& address) {
+    return bleAddressKey((uint64_t)address, address.getType());
+}
 
-    return addr1 == addr2;
+NimBLEAddress bleAddressFromKey(uint64_t key) {
+    uint8_t type = bleAddressType(key);
+    return NimBLEAddress(bleAddressValue(key), type == BLE_ADDRESS_TYPE_ANY ? BLE_ADDR_PUBLIC : type);
 }
 
-bool compareBLEAddress(const NimBLEAddress& address, const String& targetAddress) {
-    return compareBLEAddress(address, targetAddress.c_str());
+/**
+ * @brief Copies a model name into a fixed buffer (truncated, always terminated)
+ * @param dst Output buffer of YC01_MODEL_LENGTH bytes
+ * @param src Name, not necessarily terminated
+ * @param length Length of the name
+ */
+static void copyModel(char dst[YC01_MODEL_LENGTH], const char* src, size_t length) {
+    if (length > YC01_MODEL_LENGTH - 1) length = YC01_MODEL_LENGTH - 1;
+    memcpy(dst, src, length);
+    dst[length] = '\0';
 }
 
+
+#define CONNECT_TIMEOUT 5000     // connection timeout in ms (NimBLE default: 30 s)
+#define CONNECT_MIN_TIMEOUT 1000 // shortest connect attempt worth starting in ms
+#define HANDLE_READ_TIMEOUT 2000 // timeout for a read by cached handle in ms
+#define READ_RESERVE 1000        // budget kept for the read when connecting in ms
+#define DISCOVERY_RESERVE 3000   // budget needed to start a service discovery in ms
+#define READ_ATTEMPTS 3          // connection attempts per read
+#define BACKOFF_BASE 200         // delay before the first retry in ms, doubled per attempt
+#define BACKOFF_MAX 2000         // longest delay between attempts in ms
+#define MAX_VALUE_LENGTH 64      // buffer size for a characteristic value
+
+/**
+ * @brief State of the read by handle, static so that a late callback after a
+ *        timeout cannot write into a stale stack frame.
+ */
+static struct {
+    SemaphoreHandle_t done;
+    volatile uint32_t seq;
+    int status;
+    uint8_t value[MAX_VALUE_LENGTH];
+    size_t length;
+} handleRead = { nullptr, 0, 0, {0}, 0 };
+
 /**
- * @brief Helper function to convert 2 bytes to int16 (big endian)
- * @param data Data array
- * @param idx Starting index
- * @return 16-bit integer
+ * @brief NimBLE host callback of ble_gattc_read()
  */
-static int16_t toInt16(uint8_t const data[], int idx) {
-    return ((uint16_t)data[idx] << 8) | (uint16_t)data[idx + 1];
+static int onHandleRead(uint16_t connHandle, const struct ble_gatt_error *error, struct ble_gatt_attr *attr, void *arg) {
+    if ((uint32_t)(uintptr_t)arg != handleRead.seq) {
+        return 0; // answer to a read that already timed out
+    }
+    handleRead.status = error->status;
+    if (error->status == 0 && attr) {
+        size_t length = OS_MBUF_PKTLEN(attr->om);
+        if (length > sizeof(handleRead.value)) length = sizeof(handleRead.value);
+        os_mbuf_copydata(attr->om, 0, length, handleRead.value);
+        handleRead.length = length;
+    }
+    xSemaphoreGive(handleRead.done);
+    return 0;
+}
+
+/**
+ * @brief Reads an attribute by handle without service discovery
+ * @param client Connected client
+ * @param handle Attribute handle
+ * @param value Output buffer
+ * @param maxLength Size of the output buffer
+ * @param length Number of bytes read
+ * @param timeoutMs Time to wait for the answer in ms
+ * @return true on success
+ */
+static bool readByHandle(NimBLEClient* client, uint16_t handle, uint8_t value[], size_t maxLength, size_t* length, uint32_t timeoutMs) {
+    if (!handleRead.done) {
+        handleRead.done = xSemaphoreCreateBinary();
+        if (!handleRead.done) return false;
+    }
+    xSemaphoreTake(handleRead.done, 0); // drop a late give of a timed out read
+    handleRead.seq++;
+    handleRead.status = BLE_HS_ETIMEOUT;
+    handleRead.length = 0;
+
+    if (ble_gattc_read(client->getConnHandle(), handle, onHandleRead, (void*)(uintptr_t)handleRead.seq) != 0) {
+        return false;
+    }
+    if (xSemaphoreTake(handleRead.done, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+        handleRead.seq++; // invalidate the pending callback
+        return false;
+    }
+    if (handleRead.status != 0) {
+        return false;
+    }
+
+    *length = handleRead.length < maxLength ? handleRead.length : maxLength;
+    memcpy(value, handleRead.value, *length);
+    return true;
 }
 
-static uint8_t decodedData[60]; // Buffer for decoded data
 
 /**
- * @brief Decodes the proprietary BLE data from the sensor
- * @param data Pointer to raw data
- * @param length Length of data
- * @return Pointer to decoded data or NULL on error
+ * @brief Gets the time left until a deadline
+ * @param deadlineMs Deadline (millis)
+ * @return Time left in ms, 0 if the deadline passed
  */
-static uint8_t* decodeData(uint8_t const data[], int length) {
-    if (length < 2 || length > 60) {
-        return NULL; // Invalid data length
+static uint32_t remainingMs(uint32_t deadlineMs) {
+    int32_t left = (int32_t)(deadlineMs - millis());
+    return left > 0 ? left : 0;
+}
+
+/**
+ * @brief Gets the connect timeout that leaves time for the read
+ * @param deadlineMs Deadline of the read
+ * @return Timeout in ms, 0 if no attempt fits into the budget
+ */
+static uint32_t connectTimeout(uint32_t deadlineMs) {
+    uint32_t left = remainingMs(deadlineMs);
+    if (left < CONNECT_MIN_TIMEOUT + READ_RESERVE) return 0;
+    left -= READ_RESERVE;
+    return left < CONNECT_TIMEOUT ? left : CONNECT_TIMEOUT;
+}
+
+/**
+ * @brief Waits before the next connection attempt
+ *
+ * Exponential backoff with jitter, so sensors that failed together do not
+ * retry in lockstep. Does not wait if the budget would not cover another attempt.
+ * @param attempt Number of attempts made so far
+ * @param deadlineMs Deadline of the read
+ * @param result Read result, accounts the waiting time
+ * @return false if the budget is exhausted
+ */
+static bool backoff(uint8_t attempt, uint32_t deadlineMs, readResult_t& result) {
+    uint32_t cap = BACKOFF_BASE << (attempt > 1 ? attempt - 1 : 0);
+    if (cap > BACKOFF_MAX) cap = BACKOFF_MAX;
+    uint32_t wait = cap / 2 + random(cap / 2 + 1);
+    if (remainingMs(deadlineMs) < wait + CONNECT_MIN_TIMEOUT + READ_RESERVE) {
+        result.budgetExhausted = true;
+        return false;
+    }
+    delay(wait);
+    result.backoffMs += wait;
+    return true;
+}
+
+const char* readPhaseName(readPhase_t phase) {
+    switch (phase) {
+        case READ_PHASE_NONE:     return "none";
+        case READ_PHASE_CONNECT:  return "connect";
+        case READ_PHASE_DISCOVER: return "discover";
+        case READ_PHASE_READ:     return "read";
+        case READ_PHASE_DECODE:   return "decode";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Decodes a raw frame into sensor readings
+ * @param value Raw (encoded) frame
+ * @param rssi Signal strength to store with the readings
+ * @param readings Output readings
+ * @param log false to suppress error messages (e.g. for foreign advertisements)
+ * @return true if the frame was valid
+ */
+static bool decodeReadings(yc01Span_t value, int16_t rssi, sensorReadings_t& readings, bool log = true) {
+    // decoded into a local buffer, reentrant (called from the scan callback and the loop)
+    yc01Error_t error = yc01Parse(value, readings);
+    if (error != YC01_OK) {
+        if (error == YC01_ERR_CHECKSUM) checksumErrors.add();
+        if (log) DEBUG_printf("Failed to decode data: %s\n", yc01ErrorName(error));
+        return false;
     }
 
-    uint8_t tmp, hibit0, lobit0, hibit1, lobit1;
-    tmp=data[length-1];
-    for(int i=length-1;i>0;i--)
-    {
-        hibit1 =( tmp&0x55) << 1;
-        lobit1 = (tmp&0xAA) >> 1;
-        tmp=data[i-1];
-        hibit0 = (tmp&0x55) << 1;
-        lobit0 = (tmp&0xAA) >> 1;
+    time_t now;
+    time(&now);
+    readings.time = now; // Current time in seconds
+    readings.rssi = rssi;
+    return true;
+}
+
+bool decodeAdvertisedFrame(const uint8_t data[], size_t length, bool isManufacturerData, sensorReadings_t& readings) {
+    if (isManufacturerData) {
+        // only the company identifier of the sensor firmware (little endian)
+        if (length < 2 || (data[0] | data[1] << 8) != YC01_COMPANY_ID) return false;
+        data += 2;
+        length -= 2;
+    }
+    if (length != YC01_FRAME_LENGTH) {
+        return false; // not a sensor frame, avoid decoder noise for foreign payloads
+    }
+    // a frame without sensor type is no reading, even if the 8 bit checksum happens to match
+    return decodeReadings({data, length}, 0, readings, false) && readings.type != 0;
+}
+
+// Single consumer of scanEvents, owner of scanDevices and foundDevices: the BLE
+// worker task while a scan runs (isScanning()), the loop after the worker posted
+// the scan result (getFoundDevices() and the getters). The result queue hands
+// them over; never drain the ring from a second task at the same time.
+static uint64_t foundDevices[SCAN_MAX_DEVICES]; // address keys of ScanDeviceSet::found(), in order
+static ScanEventRing scanEvents;    // written by the scan callback (NimBLE host task), read by the consumer
+static ScanDeviceSet scanDevices;   // owned by the consumer
+static advDecoder_t advDecoder = decodeAdvertisedFrame;
+static std::atomic<bool> scanningActive{false};
+static uint64_t expectedDevices[SCAN_MAX_DEVICES]; // written by the loop before the scan starts
+static size_t expectedCount = 0;
+static uint32_t scanStartMs = 0;
+
+/**
+ * @brief Checks if an address key is one of the expected devices
+ */
+static bool isExpected(uint64_t key) {
+    return bleAddressFind(expectedDevices, expectedCount, key) >= 0;
+}
 
-        decodedData[i] = ~(hibit1|lobit0);
-        tmp = ~(hibit0|lobit1);
-        decodedData[i-1] = tmp;
+/**
+ * @brief Checks if the current scan has seen all expected devices (consumer side)
+ */
+static bool foundExpected() {
+    if (expectedCount == 0) return false;
+    for (size_t i = 0; i < expectedCount; i++) {
+        const scanDevice_t* device = scanDevices.find(expectedDevices[i]);
+        if (!device || !scanDevices.seenInScan(*device)) return false;
     }
-    return decodedData;
+    return true;
 }
 
 /**
- * @brief Simple XOR checksum calculation
- * @param data Data pointer
- * @param length Data length
- * @return Checksum result
+ * @brief Moves the pending scan events into the device set (consumer side)
  */
-static uint8_t checksum(const uint8_t* data, int length)		
-{		
-    uint8_t i = 0;	
-    uint8_t chksum = 0;	
-    for(i = 0; i < length; i ++)	
-        chksum = chksum ^ data[i];
-    return chksum;	
+static void drainScanEvents() {
+    scanEvent_t event;
+    while (scanEvents.pop(event)) {
+        size_t found = scanDevices.foundCount();
+        const scanDevice_t* device = scanDevices.update(event);
+        if (device && scanDevices.foundCount() > found) {
+            foundDevices[found] = event.address;
+            char addr[BLE_ADDRESS_STR_LENGTH];
+            DEBUG_print("Found device: "); DEBUG_print(device->model);
+            DEBUG_print(" ("); DEBUG_print(bleAddressFormat(event.address, addr)); DEBUG_print(")");
+            DEBUG_println(event.broadcast ? " with broadcast data" : "");
+        }
+    }
 }
 
+// the sensor service ff01 as 128 bit UUID, little endian as in advertisements;
+// the 16 and 32 bit forms are its bytes 12..13 and 12..15
+static const uint8_t SENSOR_SERVICE_UUID_LE[16] = {
+    0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x01, 0xff, 0x00, 0x00
+};
 
-static std::vector<NimBLEAddress> foundDevices;
-static bool scanningActive = false;
+/**
+ * @brief Checks if the UUID of a service data field is the sensor service
+ * @param uuid UUID as advertised (little endian)
+ * @param length Length of the UUID: 2, 4 or 16
+ */
+static bool isSensorServiceData(const uint8_t uuid[], size_t length) {
+    if (length == 16) return memcmp(uuid, SENSOR_SERVICE_UUID_LE, 16) == 0;
+    return memcmp(uuid, SENSOR_SERVICE_UUID_LE + 12, length) == 0;
+}
+
+// advertising data types (Bluetooth Core Supplement, part A, 1.1 ff.)
+#define AD_TYPE_NAME_SHORT 0x08
+#define AD_TYPE_NAME_COMPLETE 0x09
+#define AD_TYPE_SERVICE_DATA16 0x16
+#define AD_TYPE_SERVICE_DATA32 0x20
+#define AD_TYPE_SERVICE_DATA128 0x21
+#define AD_TYPE_MANUFACTURER_DATA 0xFF
 
 class MyScanCallbacks : public NimBLEScanCallbacks {
-    void onResult(const NimBLEAdvertisedDevice *device) {
-        if (device->isAdvertisingService(serviceUUID)) {
-            bool alreadyFound = false;
-            for (const auto& addr : foundDevices) {
-                if (addr == device->getAddress()) {
-                    alreadyFound = true;
-                    break;
-                }
+    /**
+     * @brief Runs the decoder hook on manufacturer data and sensor service data of an advertisement
+     *
+     * Walks the raw payload instead of using the NimBLE getters, which return
+     * each field as a heap allocated std::string.
+     * @param payload Raw advertisement (and scan response) payload
+     * @param readings Output readings
+     * @param model Output device name (empty if not advertised)
+     * @return true if one of the payloads held a valid frame
+     */
+    bool decodeAdvertisement(yc01Span_t payload, sensorReadings_t& readings, char model[YC01_MODEL_LENGTH]) {
+        bool valid = false;
+        model[0] = '\0';
+        size_t pos = 0;
+        while (pos + 1 < payload.length) {
+            size_t length = payload.data[pos];
+            if (length == 0 || pos + 1 + length > payload.length) break;
+            uint8_t type = payload.data[pos + 1];
+            const uint8_t* data = &payload.data[pos + 2];
+            size_t dataLength = length - 1;
+            pos += 1 + length;
+
+            if (type == AD_TYPE_NAME_COMPLETE || (type == AD_TYPE_NAME_SHORT && !model[0])) {
+                copyModel(model, (const char*)data, dataLength);
+                continue;
             }
-            if (!alreadyFound) {
-                DEBUG_print("Found device: "); DEBUG_print(device->getName().c_str());
-                DEBUG_print(" ("); DEBUG_print(device->getAddress().toString().c_str()); DEBUG_println(")");
-                foundDevices.push_back(device->getAddress());
+            if (valid || !advDecoder) continue;
+            if (type == AD_TYPE_MANUFACTURER_DATA) {
+                valid = advDecoder(data, dataLength, true, readings);
+            } else {
+                // service data starts with the UUID, only that of the sensor service is decoded
+                size_t uuidLength = type == AD_TYPE_SERVICE_DATA16 ? 2 : type == AD_TYPE_SERVICE_DATA32 ? 4 : type == AD_TYPE_SERVICE_DATA128 ? 16 : 0;
+                if (uuidLength && dataLength >= uuidLength && isSensorServiceData(data, uuidLength)) {
+                    valid = advDecoder(data + uuidLength, dataLength - uuidLength, false, readings);
+                }
             }
         }
+        return valid;
+    }
+
+    void onResult(const NimBLEAdvertisedDevice *device) {
+        // runs on the NimBLE host task: decode, filter and hand over, O(1) per advertisement
+        scanEvent_t event;
+        event.address = bleAddressKey(device->getAddress());
+        if (!isExpected(event.address) && !device->isAdvertisingService(serviceUUID)) {
+            return; // not a sensor, its payload is not decoded (no foreign frames, no checksum errors)
+        }
+        const std::vector<uint8_t>& payload = device->getPayload();
+        event.broadcast = decodeAdvertisement({payload.data(), payload.size()}, event.readings, event.model);
+        event.timeMs = millis();
+        event.rssi = device->getRSSI();
+        event.readings.rssi = event.rssi;
+        scanEvents.push(event);
     }
 
     void onScanEnd(const NimBLEScanResults &results, int reason) {
-        scanningActive = false;
+        scanningActive.store(false, std::memory_order_release);
         DEBUG_println("Scan complete.");
     }
 };
 
 static MyScanCallbacks scanCallbacks;
 
-bool BLE_YC01::startScan(uint32_t duration) {
-    if (scanningActive) return false;
+bool BLE_YC01::startScan(const scanParams_t& params) {
+    if (scanningActive.load(std::memory_order_acquire)) return false;
     
-    foundDevices.clear();
-    scanningActive = true;
+    scanEvents.discard();
+    scanDevices.beginScan();
+    scanningActive.store(true, std::memory_order_release);
     
     NimBLEDevice::init("");
     NimBLEScan *pScan = NimBLEDevice::getScan();
     pScan->setScanCallbacks(&scanCallbacks);
-    pScan->setInterval(45);
-    pScan->setWindow(15);
-    pScan->setActiveScan(true);
+    pScan->setInterval(params.intervalMs);
+    pScan->setWindow(params.windowMs);
+    pScan->setActiveScan(params.active);
+    pScan->setFilterPolicy(params.acceptListOnly ? BLE_HCI_SCAN_FILT_USE_WL : BLE_HCI_SCAN_FILT_NO_WL);
     
-    if (!pScan->start(duration)) { // duration is in seconds, async by default in NimBLE 2.x
-        scanningActive = false;
+    scanStartMs = millis();
+    if (!pScan->start(params.durationMs)) { // duration is in ms, async by default in NimBLE 2.x
+        scanningActive.store(false, std::memory_order_release);
         return false;
     }
     return true;
 }
 
+void BLE_YC01::setExpectedDevices(const uint64_t list[], size_t count) {
+    if (scanningActive.load(std::memory_order_acquire)) return;
+    expectedCount = count < SCAN_MAX_DEVICES ? count : SCAN_MAX_DEVICES;
+    memcpy(expectedDevices, list, expectedCount * sizeof(uint64_t));
+}
+
+bool BLE_YC01::setAcceptList(const uint64_t list[], size_t count) {
+    NimBLEDevice::init("");
+
+    // drop entries that are not in the list (backwards, removing shifts the indices)
+    for (size_t i = NimBLEDevice::getWhiteListCount(); i-- > 0; ) {
+        NimBLEAddress entry = NimBLEDevice::getWhiteListAddress(i);
+        if (bleAddressFind(list, count, bleAddressKey(entry)) < 0 && !NimBLEDevice::whiteListRemove(entry)) return false;
+    }
+    for (size_t j = 0; j < count; j++) {
+        NimBLEAddress address = bleAddressFromKey(list[j]);
+        if (!NimBLEDevice::onWhiteList(address) && !NimBLEDevice::whiteListAdd(address)) return false;
+    }
+    return true;
+}
+
 bool BLE_YC01::isScanning() {
-    return scanningActive;
+    // read the flag first: once it is cleared, all events of the scan are in the ring
+    bool active = scanningActive.load(std::memory_order_acquire);
+    drainScanEvents();
+    if (active && foundExpected()) {
+        // all sensors seen, release the radio early
+        NimBLEDevice::getScan()->stop();
+        scanningActive.store(false, std::memory_order_release);
+        drainScanEvents(); // no callbacks after stop() returned
+        DEBUG_printf("Scan stopped early after %u ms\n", (unsigned)(millis() - scanStartMs));
+        active = false;
+    }
+    return active;
 }
 
-std::vector<NimBLEAddress> BLE_YC01::getFoundDevices() {
+const uint64_t* BLE_YC01::getFoundDevices(size_t& count) {
+    drainScanEvents();
+    count = scanDevices.foundCount();
     return foundDevices;
 }
 
+bool BLE_YC01::getAdvertisedReadings(uint64_t addr, sensorReadings_t& readings, const char*& model) {
+    const scanDevice_t* device = scanDevices.find(addr);
+    if (!device || !scanDevices.seenInScan(*device) || !device->broadcast) {
+        return false;
+    }
+    readings = device->readings;
+    model = device->model;
+    return true;
+}
+
+bool BLE_YC01::getScanStats(uint64_t addr, scanDevice_t& stats) {
+    const scanDevice_t* device = scanDevices.find(addr);
+    if (!device) {
+        return false;
+    }
+    stats = *device;
+    return true;
+}
+
+uint32_t BLE_YC01::getChecksumErrors() {
+    return checksumErrors.value();
+}
+
+bool BLE_YC01::getDiscoveryDelay(uint64_t addr, uint32_t& delayMs) {
+    const scanDevice_t* device = scanDevices.find(addr);
+    if (!device || !scanDevices.seenInScan(*device)) {
+        return false;
+    }
+    delayMs = device->firstSeenMs - scanStartMs;
+    return true;
+}
+
+uint32_t BLE_YC01::getDroppedScanEvents() {
+    return scanEvents.dropped();
+}
+
+void BLE_YC01::setAdvertisementDecoder(advDecoder_t decoder) {
+    advDecoder = decoder;
+}
+
 BLE_YC01::BLE_YC01(NimBLEAddress const& addr, String const& name) {
     this->address = addr;
     this->name = name;
-    sensorType = "";
+    sensorType[0] = '\0';
     memset(&readings, 0, sizeof(readings)); // Initialize readings
 }
 
-bool BLE_YC01::readData() {
-    NimBLEClient *client = NimBLEDevice::createClient();
-    if (!client) { // Make sure the client was created
+BLE_YC01::BLE_YC01() : BLE_YC01(NimBLEAddress(), "") {
+}
+
+BLE_YC01::~BLE_YC01() {
+    disconnect();
+}
+
+void BLE_YC01::setAddress(NimBLEAddress const& addr) {
+    if (addr == this->address) return;
+    disconnect();
+    this->address = addr;
+}
+
+sensorReadings_t BLE_YC01::getReadings() const {
+    portENTER_CRITICAL(&lock);
+    sensorReadings_t copy = readings;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+void BLE_YC01::setPersistent(bool persistent) {
+    if (!persistent) disconnect();
+    this->persistent = persistent;
+}
+
+bool BLE_YC01::isConnected() const {
+    return client && client->isConnected();
+}
+
+void BLE_YC01::disconnect() {
+    if (client) {
+        NimBLEDevice::deleteClient(client); // disconnects an open link
+        client = nullptr;
+    }
+    dataChar = nullptr;
+    notifying = false;
+    freshData = false;
+}
+
+bleLinkStatus_t BLE_YC01::getLinkStatus() const {
+    bleLinkStatus_t status;
+    status.lastRead = lastRead;
+    status.connectToDataMs = connectToDataMs;
+    status.cachedRead = cachedRead;
+    status.connected = isConnected();
+    status.notifying = isNotifying();
+    status.sampleRate = getSampleRate();
+    status.reconnects = reconnectCount;
+    return status;
+}
+
+float BLE_YC01::getSampleRate() const {
+    if (linkSamples < 2 || lastSampleMs == firstSampleMs) return 0;
+    return (linkSamples - 1) * 60000.0f / (lastSampleMs - firstSampleMs);
+}
+
+NimBLERemoteCharacteristic* BLE_YC01::discover(NimBLEClient* client) {
+    this->sensorType[0] = '\0';
+    NimBLERemoteService* service;
+    service = client->getService("1800");
+    if (service) {
+        NimBLERemoteCharacteristic* nameChar = service->getCharacteristic("2A00");
+        if (nameChar && nameChar->canRead()) {
+            NimBLEAttValue model = nameChar->readValue();
+            copyModel(this->sensorType, (const char*)model.data(), model.length());
+        }
+    }
+
+    // Check if the sensor service was found
+    service = client->getService(serviceUUID);
+    if ( !service ) {
+        DEBUG_println("Sensor service not found");
+        return nullptr;
+    }
+    return service->getCharacteristic(charUUID);
+}
+
+NimBLERemoteCharacteristic* BLE_YC01::discover(NimBLEClient* client, uint32_t deadlineMs, readResult_t& result) {
+    if (remainingMs(deadlineMs) < DISCOVERY_RESERVE) {
+        // service discovery has no timeout of its own, do not start it late
+        result.failedPhase = READ_PHASE_DISCOVER;
+        result.budgetExhausted = true;
+        return nullptr;
+    }
+    uint32_t startMs = millis();
+    NimBLERemoteCharacteristic* characteristic = discover(client);
+    result.discoverMs += millis() - startMs;
+    if (!characteristic) {
+        result.failedPhase = READ_PHASE_DISCOVER;
+    }
+    return characteristic;
+}
+
+bool BLE_YC01::readValue(NimBLEClient* client, uint16_t handle, uint32_t deadlineMs, readResult_t& result) {
+    uint32_t timeoutMs = remainingMs(deadlineMs);
+    if (timeoutMs > HANDLE_READ_TIMEOUT) timeoutMs = HANDLE_READ_TIMEOUT;
+    if (timeoutMs == 0) {
+        result.failedPhase = READ_PHASE_READ;
+        result.budgetExhausted = true;
         return false;
     }
 
-    // connect to the device
-    bool result = true;
-    uint8_t retryCount = 0;
-    do
-    {
-        if ( client->connect(this->address) ) {
-            this->sensorType = "";
-            NimBLERemoteService* service;
-            service = client->getService("1800");
-            if (service) {
-                NimBLERemoteCharacteristic* nameChar = service->getCharacteristic("2A00");
-                if (nameChar && nameChar->canRead()) {
-                    this->sensorType = nameChar->readValue();
-                }
+    uint8_t value[MAX_VALUE_LENGTH];
+    size_t length = 0;
+    uint32_t startMs = millis();
+    bool read = readByHandle(client, handle, value, sizeof(value), &length, timeoutMs);
+    result.readMs += millis() - startMs;
+    if (!read) {
+        result.failedPhase = READ_PHASE_READ;
+        return false;
+    }
+    if (!processValue({value, length}, client->getRssi())) {
+        result.failedPhase = READ_PHASE_DECODE;
+        return false;
+    }
+    return true;
+}
+
+bool BLE_YC01::readCached(NimBLEClient* client, uint32_t deadlineMs, readResult_t& result) {
+    gattCacheEntry_t entry;
+    uint32_t startMs = millis();
+    bool found = gattCacheLoad(this->address, entry);
+    result.discoverMs += millis() - startMs;
+    if (!found) {
+        return false;
+    }
+
+    if (readValue(client, entry.dataHandle, deadlineMs, result)) {
+        copyModel(this->sensorType, entry.model, strnlen(entry.model, sizeof(entry.model)));
+        return true;
+    }
+    if (result.budgetExhausted) {
+        return false; // out of time, says nothing about the handle
+    }
+
+    // sensor firmware changed or handle invalid -> discover again
+    DEBUG_println("Cached GATT handle failed, rediscovering");
+    gattCacheErase(this->address);
+    return false;
+}
+
+void BLE_YC01::recordConnectToData(uint32_t durationMs, bool cached) {
+    connectToDataMs = durationMs;
+    cachedRead = cached;
+    uint32_t& average = cached ? avgCachedMs : avgDiscoveryMs;
+    average = average ? (average * 3 + durationMs) / 4 : durationMs;
+    DEBUG_print("connect to data: "); DEBUG_print(durationMs);
+    DEBUG_println(cached ? " ms (cached handles)" : " ms (service discovery)");
+}
+
+bool BLE_YC01::processValue(yc01Span_t value, int16_t rssi) {
+    struct sensorReadings_t readings;
+    if ( !decodeReadings(value, rssi, readings) ) {
+        return false;
+    }
+
+    // Store the readings, the notification callback runs on the NimBLE host task
+    uint32_t nowMs = millis();
+    portENTER_CRITICAL(&lock);
+    this->readings = readings;
+    if (linkSamples == 0) firstSampleMs = nowMs;
+    lastSampleMs = nowMs;
+    linkSamples++;
+    sampleCount++;
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
+
+static NimBLEClient* readClient = nullptr; // client shared by connect-per-read
+
+readResult_t BLE_YC01::readData(uint32_t budgetMs) {
+    readResult_t result;
+    memset(&result, 0, sizeof(result));
+    uint32_t startMs = millis();
+    uint32_t deadlineMs = startMs + budgetMs;
+
+    if (persistent) {
+        readPersistent(deadlineMs, result);
+    } else {
+        readOnce(deadlineMs, result);
+    }
+    if (result.ok) {
+        result.failedPhase = READ_PHASE_NONE;
+    }
+
+    result.totalMs = millis() - startMs;
+    lastRead = result;
+    if (!result.ok) {
+        DEBUG_printf("Read failed in phase %s", readPhaseName(result.failedPhase));
+        DEBUG_printf(" after %u attempts", result.attempts);
+        DEBUG_println(result.budgetExhausted ? " (budget exhausted)" : "");
+    }
+    return result;
+}
+
+bool BLE_YC01::readLink(NimBLEClient* client, uint32_t deadlineMs, readResult_t& result) {
+    uint32_t connectedAt = millis();
+
+    // go straight to the cached handle, discover only if there is none or it failed
+    bool cached = readCached(client, deadlineMs, result);
+    bool ok = cached;
+    if ( !ok && !result.budgetExhausted ) {
+        NimBLERemoteCharacteristic *pCharacteristic = discover(client, deadlineMs, result);
+        if ( pCharacteristic ) {
+            ok = readValue(client, pCharacteristic->getHandle(), deadlineMs, result);
+            if ( ok ) {
+                gattCacheStore(this->address, pCharacteristic->getHandle(), this->sensorType);
             }
+        }
+    }
+    if ( ok ) {
+        recordConnectToData(millis() - connectedAt, cached);
+    }
+    return ok;
+}
 
-            // Check if the sensor service was found
-            service = client->getService(serviceUUID);
-            if ( service ) {
-                NimBLERemoteCharacteristic *pCharacteristic = service->getCharacteristic(charUUID);
-                if ( pCharacteristic ) {
-
-                    // Read the raw value
-                    std::string value = pCharacteristic->readValue();
-                    int length = value.length();
-
-                    // Decode the data
-                    uint8_t *data = decodeData((uint8_t*)value.data(), length);
-                    if ( data )
-                    {
-                        uint8_t chksum = checksum(data, length-1);
-                        if (chksum != data[length-1]) {
-                            DEBUG_println("Checksum mismatch!");
-                            result = false;
-                        } else {
-                            struct sensorReadings_t readings;
-                            time_t now;
-                            time(&now);
-                            readings.time = now; // Current time in seconds
-                            readings.rssi = client->getRssi();
-                            readings.type = data[2];
-                            readings.pH = toInt16(data, 3) / 100.0; // pH value
-                            readings.ec = toInt16(data, 5); // EC value in mV
-                            readings.salt = toInt16(data, 5) * 0.55; // Salt value in g/L
-                            readings.tds = toInt16(data, 7); // TDS value in mg/L
-                            readings.orp = toInt16(data, 9); // ORP value in mV
-                            readings.cl = toInt16(data, 11) / 10.0; // Chlorine value in mg/L
-                            readings.temp = toInt16(data, 13) / 10.0; // Temperature value in °C
-                            readings.bat = toInt16(data, 15); // Battery value in mV
-                            this->readings = readings; // Store the readings
-                        }
-                    } else {
-                        DEBUG_println("Failed to decode data");
-                        result = false;
-                    }
-                }
+bool BLE_YC01::connectAttempt(NimBLEClient* client, uint32_t deadlineMs, readResult_t& result) {
+    if ( result.attempts >= READ_ATTEMPTS ) {
+        return false;
+    }
+    if ( result.attempts > 0 && !backoff(result.attempts, deadlineMs, result) ) {
+        return false;
+    }
+    uint32_t timeoutMs = connectTimeout(deadlineMs);
+    if ( timeoutMs == 0 ) {
+        if ( result.failedPhase == READ_PHASE_NONE ) result.failedPhase = READ_PHASE_CONNECT;
+        result.budgetExhausted = true;
+        return false;
+    }
+
+    result.attempts++;
+    client->setConnectTimeout(timeoutMs);
+    uint32_t startMs = millis();
+    bool connected = client->connect(this->address);
+    result.connectMs += millis() - startMs;
+    if ( !connected ) {
+        DEBUG_println("Failed to connect to device");
+        result.failedPhase = READ_PHASE_CONNECT;
+    }
+    return true;
+}
+
+void BLE_YC01::readOnce(uint32_t deadlineMs, readResult_t& result) {
+    // the client is shared by all connect-per-read sensors and kept, so a read does not allocate
+    if (!readClient) {
+        readClient = NimBLEDevice::createClient();
+        if (!readClient) { // Make sure the client was created
+            result.failedPhase = READ_PHASE_CONNECT;
+            return;
+        }
+    }
+    NimBLEClient *client = readClient;
+
+    while ( connectAttempt(client, deadlineMs, result) ) {
+        if ( !client->isConnected() ) {
+            continue;
+        }
+        linkSamples = 0;
+        result.ok = readLink(client, deadlineMs, result);
+        client->disconnect();
+        if ( result.ok || result.budgetExhausted ) {
+            break;
+        }
+    }
+
+    if (client->isConnected()) {
+        client->disconnect();
+    }
+}
+
+void BLE_YC01::readPersistent(uint32_t deadlineMs, readResult_t& result) {
+    if (!client) {
+        // keep one client free for connect-per-read of the remaining sensors
+        if (NimBLEDevice::getCreatedClientCount() - (readClient ? 1 : 0) >= CONFIG_BT_NIMBLE_MAX_CONNECTIONS - 1) {
+            DEBUG_println("No free link for persistent mode, reading once");
+            readOnce(deadlineMs, result);
+            return;
+        }
+        client = NimBLEDevice::createClient();
+        if (!client) {
+            result.failedPhase = READ_PHASE_CONNECT;
+            return;
+        }
+    }
+
+    uint32_t connectedAt = 0; // set if the link is established by this call
+    while ( !client->isConnected() ) {
+        dataChar = nullptr;
+        notifying = false;
+        freshData = false;
+        if ( !connectAttempt(client, deadlineMs, result) ) {
+            return;
+        }
+        if ( !client->isConnected() ) {
+            continue;
+        }
+        connectedAt = millis();
+        if (wasConnected) {
+            reconnectCount++;
+            DEBUG_print("BLE link re-established, reconnects: "); DEBUG_println(reconnectCount);
+        }
+        wasConnected = true;
+        linkSamples = 0;
+
+        // notifications are dispatched to discovered characteristics only, so a new link always discovers
+        dataChar = discover(client, deadlineMs, result);
+        if ( !dataChar ) {
+            client->disconnect();
+            if ( result.budgetExhausted ) {
+                return;
             }
-        } else {
-            // failed to connect
-            DEBUG_println("Failed to connect to device");
-            result = false;
+            continue;
         }
-    
-        retryCount++;
-    } while ( !result && retryCount < 3 );
+        gattCacheStore(this->address, dataChar->getHandle(), this->sensorType);
 
-    NimBLEDevice::deleteClient(client);            
+        // prefer pushed data, fall back to polling if the sensor cannot notify
+        if ( dataChar->canNotify() || dataChar->canIndicate() ) {
+            notifying = dataChar->subscribe(dataChar->canNotify(),
+                [this](NimBLERemoteCharacteristic* characteristic, uint8_t* data, size_t length, bool isNotify) {
+                    if (processValue({data, length}, client ? client->getRssi() : 0)) {
+                        freshData = true;
+                    }
+                });
+            DEBUG_println(notifying ? "Subscribed to sensor notifications" : "Subscribe failed, polling");
+        }
+    }
 
-    return result;
+    if ( notifying && freshData ) {
+        freshData = false;
+        result.ok = true;
+        return;
+    }
+
+    // no notification since the last call -> poll into a fixed buffer
+    result.ok = readValue(client, dataChar->getHandle(), deadlineMs, result);
+    if ( result.ok && connectedAt ) {
+        recordConnectToData(millis() - connectedAt, false);
+    }
 }
@@ -2,39 +2,97 @@
 #include <Arduino.h>
 #include <NimBLEDevice.h>
 
+#include "yc01Codec.h"
+#include "scanTable.h"
+#include "scanPolicy.h"
+#include "bleAddress.h"
+
+/**
+ * @brief Decoder hook for sensor data broadcast in advertisements
+ * @param data Payload of the advertisement field
+ * @param length Length of the payload
+ * @param isManufacturerData true: manufacturer data (starts with the company id), false: service data of the ff01 service (after the UUID)
+ * @param readings Output readings (rssi is filled in by the caller)
+ * @return true if the payload held a valid frame
+ */
+typedef bool (*advDecoder_t)(const uint8_t data[], size_t length, bool isManufacturerData, sensorReadings_t& readings);
+
+#define YC01_COMPANY_ID 0xFFFF    /**< Company id of broadcast frames (SIG reserved id for devices without an assigned one) */
+
+/**
+ * @brief Default advertisement decoder.
+ *
+ * Accepts an encoded 17-byte frame (same format as characteristic ff02) with
+ * a sensor type as manufacturer data after YC01_COMPANY_ID or as service data
+ * of the ff01 service. Only called for devices that advertise the ff01
+ * service or are expected.
+ */
+bool decodeAdvertisedFrame(const uint8_t data[], size_t length, bool isManufacturerData, sensorReadings_t& readings);
+
+#define BLE_READ_BUDGET 15000     /**< Default time budget of one sensor read in ms */
+
+/**
+ * @brief Phase of a sensor read
+ */
+enum readPhase_t : uint8_t {
+    READ_PHASE_NONE,        /**< No failure */
+    READ_PHASE_CONNECT,     /**< Connection establishment */
+    READ_PHASE_DISCOVER,    /**< Handle lookup in the GATT cache or service discovery */
+    READ_PHASE_READ,        /**< Read of the data characteristic */
+    READ_PHASE_DECODE,      /**< Decoding of the value */
+};
+
+/**
+ * @brief Outcome and timing of one sensor read
+ */
+struct readResult_t
+{
+    bool ok;                /**< Valid data was read */
+    readPhase_t failedPhase; /**< Phase of the last failure, READ_PHASE_NONE on success */
+    bool budgetExhausted;   /**< Gave up because the rest of the budget could not cover the next step */
+    uint8_t attempts;       /**< Connection attempts */
+    uint32_t connectMs;     /**< Time spent connecting (all attempts) */
+    uint32_t discoverMs;    /**< Time spent on handle lookup and service discovery */
+    uint32_t readMs;        /**< Time spent reading the characteristic */
+    uint32_t backoffMs;     /**< Time spent waiting between attempts */
+    uint32_t totalMs;       /**< Duration of the whole read */
+};
+
 /**
- * @brief Structure to hold sensor readings from BLE-YC01
+ * @brief Snapshot of the link state of a sensor, taken while no read is running
  */
-struct sensorReadings_t
+struct bleLinkStatus_t
 {
-    uint8_t type;       /**< Sensor type identifier */
-    time_t time;        /**< Timestamp of the reading */
-    int16_t rssi;       /**< BLE signal strength (RSSI) */
-    float pH;           /**< pH value (0-14) */
-    float ec;           /**< Electrical Conductivity in mV */
-    float salt;         /**< Salinity in g/L */
-    float tds;          /**< Total Dissolved Solids in mg/L */
-    float orp;          /**< Oxidation-Reduction Potential in mV */
-    float cl;           /**< Residual Chlorine in mg/L */
-    float temp;         /**< Temperature in °C */
-    float bat;          /**< Battery voltage in mV */
+    readResult_t lastRead;      /**< Result of the last readData() */
+    uint32_t connectToDataMs;   /**< Connection to valid data of the last read in ms */
+    bool cachedRead;            /**< Last read used cached handles */
+    bool connected;             /**< Persistent link open */
+    bool notifying;             /**< Persistent link receives notifications */
+    float sampleRate;           /**< Samples per minute on the persistent link */
+    uint32_t reconnects;        /**< Re-established persistent links */
 };
 
 /**
- * @brief Compares a NimBLEAddress with a string representation
- * @param address The NimBLEAddress to compare
- * @param targetAddress The string representation (e.g., "AA:BB:CC:DD:EE:FF")
- * @return true if addresses match, false otherwise
+ * @brief Gets a readable name of a read phase
+ * @param phase Read phase
+ * @return Name, e.g. "connect"
+ */
+const char* readPhaseName(readPhase_t phase);
+
+/**
+ * @brief Converts an address into a key (see bleAddress.h)
+ * @param address The address
+ * @return Key with the address type
  */
-bool compareBLEAddress(const NimBLEAddress& address, const char* targetAddress);
+uint64_t bleAddressKey(const NimBLEAddress& address);
 
 /**
- * @brief Compares a NimBLEAddress with a String representation
- * @param address The NimBLEAddress to compare
- * @param targetAddress The String representation
- * @return true if addresses match, false otherwise
+ * @brief Converts a key into an address
+ * @param key Key, BLE_ADDRESS_TYPE_ANY becomes a public address
+ * @return The address
  */
-bool compareBLEAddress(const NimBLEAddress& address, const String& targetAddress);
+NimBLEAddress bleAddressFromKey(uint64_t key);
+
 /**
  * @brief Class to handle communication with BLE-YC01 sensor
  */
@@ -42,10 +100,32 @@ class BLE_YC01 {
 public:
     /**
      * @brief Starts an asynchronous scan for available BLE-YC01 devices.
-     * @param duration Scan duration in seconds.
+     * @param params Duration, interval, window and type of the scan (see ScanPolicy);
+     *               acceptListOnly: the controller only reports devices on the accept list (see setAcceptList)
      * @return true if scan started successfully.
      */
-    static bool startScan(uint32_t duration = 3);
+    static bool startScan(const scanParams_t& params);
+
+    /**
+     * @brief Sets the devices the next scan looks for
+     *
+     * The scan stops as soon as all of them were seen. They are reported even
+     * if the service UUID is not in the advertisement (passive scans get no
+     * scan response). Must not be called while scanning.
+     * @param list Address keys, an empty list scans for the full duration
+     * @param count Number of addresses (at most SCAN_MAX_DEVICES)
+     */
+    static void setExpectedDevices(const uint64_t list[], size_t count);
+
+    /**
+     * @brief Sets the controller filter accept list to exactly the given addresses
+     *
+     * Must not be called while scanning or connecting.
+     * @param list Address keys
+     * @param count Number of addresses
+     * @return true if the list was applied
+     */
+    static bool setAcceptList(const uint64_t list[], size_t count);
 
     /**
      * @brief Checks if a scan is currently running.
@@ -55,9 +135,54 @@ public:
 
     /**
      * @brief Gets the addresses of found devices after a scan is complete.
-     * @return A vector of NimBLEAddress.
+     * @param count Output number of found devices
+     * @return Array of address keys, valid until the next scan starts
+     */
+    static const uint64_t* getFoundDevices(size_t& count);
+
+    /**
+     * @brief Gets readings a device broadcast during the last scan, so no
+     *        GATT connection is needed.
+     * @param addr Address key of the device (see bleAddressMatch)
+     * @param readings Output readings
+     * @param model Output device name from the advertisement, valid until the next scan starts
+     * @return true if the device broadcast a valid frame
+     */
+    static bool getAdvertisedReadings(uint64_t addr, sensorReadings_t& readings, const char*& model);
+
+    /**
+     * @brief Gets the scan statistics of a device (RSSI min/max/mean, last seen)
+     * @param addr Address key of the device (see bleAddressMatch)
+     * @param stats Output statistics
+     * @return true if the device was seen by a scan since boot
+     */
+    static bool getScanStats(uint64_t addr, scanDevice_t& stats);
+
+    /**
+     * @brief Gets the number of frames rejected for a checksum mismatch since boot (advertisements and reads)
+     * @return uint32_t
+     */
+    static uint32_t getChecksumErrors();
+
+    /**
+     * @brief Gets the time from the start of the last scan to the first advertisement of a device
+     * @param addr Address key of the device (see bleAddressMatch)
+     * @param delayMs Output delay in ms
+     * @return true if the device was seen by the last scan
      */
-    static std::vector<NimBLEAddress> getFoundDevices();
+    static bool getDiscoveryDelay(uint64_t addr, uint32_t& delayMs);
+
+    /**
+     * @brief Gets the number of advertisements dropped because the scan event ring was full
+     * @return Dropped event count
+     */
+    static uint32_t getDroppedScanEvents();
+
+    /**
+     * @brief Replaces the decoder hook for advertisement payloads
+     * @param decoder Decoder function, nullptr disables the fast path
+     */
+    static void setAdvertisementDecoder(advDecoder_t decoder);
 
     /**
      * @brief Constructor for BLE_YC01
@@ -67,6 +192,25 @@ public:
      */
     BLE_YC01(NimBLEAddress const& addr, String const& name = "");
 
+    /**
+     * @brief Constructor for a sensor whose address is set later (see setAddress)
+     */
+    BLE_YC01();
+
+    /**
+     * @brief Destructor, releases a persistent client
+     */
+    ~BLE_YC01();
+
+    BLE_YC01(BLE_YC01 const&) = delete;
+    BLE_YC01& operator=(BLE_YC01 const&) = delete;
+
+    /**
+     * @brief Sets the BLE address of the sensor, drops an open link to another address
+     * @param addr The BLE address of the sensor
+     */
+    void setAddress(NimBLEAddress const& addr);
+
     /**
      * @brief Gets the BLE address of the sensor
      * @return NimBLEAddress
@@ -87,25 +231,222 @@ public:
 
     /**
      * @brief Gets the sensor model type string
-     * @return String sensor type
+     * @return Sensor type, empty if unknown
      */
-    String getSensorType() const { return sensorType; }
+    const char* getSensorType() const { return sensorType; }
 
     /**
      * @brief Gets the latest sensor readings
      * @return sensorReadings_t structure
      */
-    sensorReadings_t getReadings() const { return readings; }
+    sensorReadings_t getReadings() const;
 
     /**
      * @brief Connects to the sensor and reads the current data
-     * @return true if data was read successfully, false otherwise
+     *
+     * In persistent mode the connection is kept open between calls. If the
+     * sensor notified new data since the last call, those readings are
+     * returned without a GATT read, otherwise the characteristic is polled.
+     *
+     * The budget bounds the whole read: connect attempts get a timeout that
+     * leaves time for the read, retries back off with jitter, and a step that
+     * no longer fits into the rest of the budget is not started. Pass less
+     * than the task watchdog timeout.
+     * @param budgetMs Total time budget in ms
+     * @return Outcome, failed phase and time per phase
+     */
+    readResult_t readData(uint32_t budgetMs = BLE_READ_BUDGET);
+
+    /**
+     * @brief Gets the result of the last readData() call
+     * @return Read result
      */
-    bool readData();
+    const readResult_t& getLastRead() const { return lastRead; }
+
+    /**
+     * @brief Takes a snapshot of the link state for reporting from another task
+     * @return Link status
+     */
+    bleLinkStatus_t getLinkStatus() const;
+
+    /**
+     * @brief Enables or disables the persistent connection mode
+     *
+     * In persistent mode the client stays connected and subscribes to
+     * notifications/indications on the data characteristic if the sensor
+     * supports them. At most CONFIG_BT_NIMBLE_MAX_CONNECTIONS - 1 links are
+     * kept open (one client stays free for connect-per-read); further sensors
+     * fall back to connect-per-read.
+     * @param persistent true to keep the connection open
+     */
+    void setPersistent(bool persistent);
+
+    /**
+     * @brief Checks if the persistent connection mode is enabled
+     * @return true if persistent
+     */
+    bool isPersistent() const { return persistent; }
+
+    /**
+     * @brief Checks if a persistent link to the sensor is open
+     * @return true if connected
+     */
+    bool isConnected() const;
+
+    /**
+     * @brief Checks if the open link receives notifications/indications
+     * @return true if subscribed
+     */
+    bool isNotifying() const { return notifying && isConnected(); }
+
+    /**
+     * @brief Closes a persistent link and releases the client
+     */
+    void disconnect();
+
+    /**
+     * @brief Gets the number of times a persistent link had to be re-established
+     * @return Reconnect count
+     */
+    uint32_t getReconnectCount() const { return reconnectCount; }
+
+    /**
+     * @brief Gets the number of valid samples received (reads and notifications)
+     * @return Sample count
+     */
+    uint32_t getSampleCount() const { return sampleCount; }
+
+    /**
+     * @brief Gets the sample rate achieved on the current link
+     * @return Samples per minute, 0 if less than two samples were received
+     */
+    float getSampleRate() const;
+
+    /**
+     * @brief Gets the time from connection to valid data of the last read
+     * @return Duration in ms
+     */
+    uint32_t getConnectToDataMs() const { return connectToDataMs; }
+
+    /**
+     * @brief Checks if the last read used cached attribute handles
+     * @return true if service discovery was skipped
+     */
+    bool wasCachedRead() const { return cachedRead; }
+
+    /**
+     * @brief Gets the running average of the time from connection to valid data
+     * @param cached true: reads via cached handles, false: reads with service discovery
+     * @return Average duration in ms, 0 if no such read happened yet
+     */
+    uint32_t getAvgConnectToDataMs(bool cached) const { return cached ? avgCachedMs : avgDiscoveryMs; }
 
 protected:
+    /**
+     * @brief Reads the model name and looks up the data characteristic
+     * @param client Connected client
+     * @return Data characteristic or nullptr if not found
+     */
+    NimBLERemoteCharacteristic* discover(NimBLEClient* client);
+
+    /**
+     * @brief Runs discover() if the budget allows it and accounts its time
+     * @param client Connected client
+     * @param deadlineMs Deadline of the read
+     * @param result Read result
+     * @return Data characteristic or nullptr
+     */
+    NimBLERemoteCharacteristic* discover(NimBLEClient* client, uint32_t deadlineMs, readResult_t& result);
+
+    /**
+     * @brief Reads and decodes the data characteristic by handle
+     * @param client Connected client
+     * @param handle Attribute handle
+     * @param deadlineMs Deadline of the read
+     * @param result Read result
+     * @return true if valid data was read
+     */
+    bool readValue(NimBLEClient* client, uint16_t handle, uint32_t deadlineMs, readResult_t& result);
+
+    /**
+     * @brief Reads the data characteristic via the handle cached in NVS
+     *
+     * Skips service discovery. A failed cached read erases the entry, so the
+     * caller falls back to discovery which stores fresh handles.
+     * @param client Connected client
+     * @param deadlineMs Deadline of the read
+     * @param result Read result
+     * @return true if valid data was read
+     */
+    bool readCached(NimBLEClient* client, uint32_t deadlineMs, readResult_t& result);
+
+    /**
+     * @brief Reads the data on an open connect-per-read link (cached handle first)
+     * @param client Connected client
+     * @param deadlineMs Deadline of the read
+     * @param result Read result
+     * @return true if valid data was read
+     */
+    bool readLink(NimBLEClient* client, uint32_t deadlineMs, readResult_t& result);
+
+    /**
+     * @brief Makes one connection attempt, after a backoff if it is a retry
+     * @param client Client to connect
+     * @param deadlineMs Deadline of the read
+     * @param result Read result
+     * @return false if no attempt was made (attempts used up or budget exhausted)
+     */
+    bool connectAttempt(NimBLEClient* client, uint32_t deadlineMs, readResult_t& result);
+
+    /**
+     * @brief readData() implementation of connect-per-read
+     * @param deadlineMs Deadline of the read
+     * @param result Read result
+     */
+    void readOnce(uint32_t deadlineMs, readResult_t& result);
+
+    /**
+     * @brief Records the time from connection to valid data
+     * @param durationMs Duration in ms
+     * @param cached true if cached handles were used
+     */
+    void recordConnectToData(uint32_t durationMs, bool cached);
+
+    /**
+     * @brief Decodes a raw value and stores the readings
+     * @param value Raw characteristic value
+     * @param rssi Signal strength of the link
+     * @return true if the value was valid
+     */
+    bool processValue(yc01Span_t value, int16_t rssi);
+
+    /**
+     * @brief readData() implementation of the persistent mode
+     * @param deadlineMs Deadline of the read
+     * @param result Read result
+     */
+    void readPersistent(uint32_t deadlineMs, readResult_t& result);
+
     NimBLEAddress address; /**< Address of the BLE device */
-    String sensorType;     /**< Model name/type of the sensor */
+    char sensorType[YC01_MODEL_LENGTH]; /**< Model name/type of the sensor */
     String name;           /**< Custom name for the sensor */
     sensorReadings_t readings; /**< Last read sensor data */
+
+    bool persistent = false;        /**< Keep the connection open between reads */
+    NimBLEClient* client = nullptr; /**< Client of the persistent link */
+    NimBLERemoteCharacteristic* dataChar = nullptr; /**< Data characteristic of the persistent link */
+    bool notifying = false;         /**< Subscribed to notifications/indications */
+    volatile bool freshData = false; /**< Notification received since the last readData() */
+    bool wasConnected = false;      /**< A persistent link was established before */
+    uint32_t reconnectCount = 0;    /**< Number of re-established links */
+    uint32_t sampleCount = 0;       /**< Number of valid samples */
+    uint32_t linkSamples = 0;       /**< Number of valid samples on the current link */
+    uint32_t firstSampleMs = 0;     /**< Timestamp of the first sample on the current link */
+    uint32_t lastSampleMs = 0;      /**< Timestamp of the last sample */
+    uint32_t connectToDataMs = 0;   /**< Connection to valid data of the last read in ms */
+    bool cachedRead = false;        /**< Last read used cached handles */
+    uint32_t avgCachedMs = 0;       /**< Average connection to data with cached handles in ms */
+    uint32_t avgDiscoveryMs = 0;    /**< Average connection to data with service discovery in ms */
+    readResult_t lastRead = {};     /**< Result of the last readData() */
+    mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED; /**< Guards readings against the notification callback */
 };
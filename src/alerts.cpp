@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "alerts.h"
+
+
+/**
+ * @brief Names of the quantities, as in /status and the ROADMAP payload
+ */
+static const struct {
+    const char* name;       /**< Field name */
+    const char* label;      /**< Text of the alert */
+} quantityNames[YC01_QUANTITIES] = {
+    { "pH", "pH" },
+    { "ec", "EC" },
+    { "tds", "TDS" },
+    { "orp", "ORP" },
+    { "cl", "Chlorine" },
+    { "temp", "Temperature" },
+    { "bat", "Battery" },
+};
+
+bool alertParseQuantity(const char* name, yc01Quantity_t& quantity) {
+    for (size_t q = 0; q < YC01_QUANTITIES; q++) {
+        if (strcmp(name, quantityNames[q].name) == 0) {
+            quantity = (yc01Quantity_t)q;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* alertQuantityName(yc01Quantity_t quantity) {
+    return quantity < YC01_QUANTITIES ? quantityNames[quantity].name : "";
+}
+
+const char* alertLevelName(alertLevel_t level) {
+    switch (level) {
+        case ALERT_LOW:  return "low";
+        case ALERT_HIGH: return "high";
+        default:         return "normal";
+    }
+}
+
+int16_t alertToRaw(yc01Quantity_t quantity, float value) {
+    double raw = round(value * (double)YC01_FIELDS[quantity].scale);
+    if (raw < INT16_MIN) return INT16_MIN;
+    if (raw > INT16_MAX) return INT16_MAX;
+    return (int16_t)raw;
+}
+
+size_t alertText(yc01Quantity_t quantity, alertLevel_t level, char out[], size_t length) {
+    const char* label = quantity < YC01_QUANTITIES ? quantityNames[quantity].label : "";
+    int used;
+    if (level == ALERT_NORMAL) {
+        used = snprintf(out, length, "Recovered: %s back in range", label);
+    } else {
+        used = snprintf(out, length, "Alert: %s too %s", label, level == ALERT_LOW ? "low" : "high");
+    }
+    return (size_t)used < length ? used : length - 1;
+}
+
+/**
+ * @brief Formats a limit, null if the rule has none
+ */
+static int formatLimit(char out[], size_t length, yc01Quantity_t quantity, int16_t raw, bool none) {
+    if (none) return snprintf(out, length, "null");
+    return snprintf(out, length, "%g", yc01Value(quantity, raw));
+}
+
+size_t alertFormat(const alertEvent_t& event, const alertRule_t& rule, char out[], size_t length) {
+    char text[ALERT_TEXT_LENGTH], min[16], max[16];
+    alertText(rule.quantity, event.level, text, sizeof(text));
+    formatLimit(min, sizeof(min), rule.quantity, rule.min, rule.min == ALERT_NO_MIN);
+    formatLimit(max, sizeof(max), rule.quantity, rule.max, rule.max == ALERT_NO_MAX);
+    int used = snprintf(out, length,
+        "{\"alert\":%s,\"type\":\"%s\",\"level\":\"%s\",\"value\":%g,\"min\":%s,\"max\":%s,\"time\":%u,\"sensor\":%u,\"text\":\"%s\"}",
+        event.level != ALERT_NORMAL ? "true" : "false", alertQuantityName(rule.quantity), alertLevelName(event.level),
+        yc01Value(rule.quantity, event.value), min, max, (unsigned)event.time, (unsigned)event.sensor, text);
+    return (size_t)used < length ? used : length - 1;
+}
+
+
+void AlertEngine::begin(const alertRule_t ruleTable[], size_t count) {
+    ruleCount = count < ALERT_MAX_RULES ? count : ALERT_MAX_RULES;
+    memcpy(rules, ruleTable, ruleCount * sizeof(alertRule_t));
+    memset(states, 0, sizeof(states));
+}
+
+size_t AlertEngine::evaluate(uint8_t sensor, const sensorReadings_t& readings, alertEvent_t events[], size_t maxEvents) {
+    if (sensor >= ALERT_MAX_SENSORS || !readings.type) return 0;
+    size_t eventCount = 0;
+    alertState_t* state = states[sensor];
+    for (size_t r = 0; r < ruleCount; r++, state++) {
+        const alertRule_t& rule = rules[r];
+        int32_t value = readings.raw[rule.quantity];
+        state->value = value;
+
+        // level the value points to, an active alert needs the hysteresis to clear
+        int32_t low = rule.min, high = rule.max;
+        if (state->level == ALERT_LOW) low += rule.hysteresis;
+        if (state->level == ALERT_HIGH) high -= rule.hysteresis;
+        alertLevel_t target = ALERT_NORMAL;
+        if (rule.min != ALERT_NO_MIN && value < low) target = ALERT_LOW;
+        else if (rule.max != ALERT_NO_MAX && value > high) target = ALERT_HIGH;
+
+        if (target == state->level) {
+            state->count = 0;
+            continue;
+        }
+        if (target != state->pending || state->count == 0) {
+            state->pending = target;
+            state->count = 0;
+        }
+        if (++state->count < rule.debounce) continue;
+
+        // debounced: change the level
+        if (eventCount < maxEvents) {
+            alertEvent_t& event = events[eventCount++];
+            event.time = (uint32_t)readings.time;
+            event.sensor = sensor;
+            event.rule = r;
+            event.level = target;
+            event.previous = state->level;
+            event.value = value;
+        }
+        state->level = target;
+        state->count = 0;
+        state->since = (uint32_t)readings.time;
+    }
+    return eventCount;
+}
+
+size_t AlertEngine::active(uint8_t sensor) const {
+    size_t count = 0;
+    for (size_t r = 0; sensor < ALERT_MAX_SENSORS && r < ruleCount; r++) {
+        count += states[sensor][r].level != ALERT_NORMAL;
+    }
+    return count;
+}
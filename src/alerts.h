@@ -0,0 +1,158 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "yc01Codec.h"
+
+/*
+ * Threshold alerts on the readings of all sensors.
+ *
+ * A flat table of rules (quantity, min/max limit, hysteresis, debounce)
+ * is evaluated on every reading: one comparison per rule against the raw
+ * fixed-point value, no allocation, cost independent of the history. A
+ * limit is crossed when the value is outside [min, max]; it is only
+ * cleared once the value is back inside by the hysteresis. A change of the
+ * level needs debounce consecutive readings, so a noisy sensor near a
+ * limit does not flood the broker.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define ALERT_MAX_RULES 16              /**< Rules of the table */
+#define ALERT_MAX_SENSORS 8             /**< Sensors with alert state (MAX_SENSORS) */
+#define ALERT_NO_MIN INT16_MIN          /**< Rule without lower limit */
+#define ALERT_NO_MAX INT16_MAX          /**< Rule without upper limit */
+#define ALERT_TEXT_LENGTH 48            /**< Buffer size of an alert text */
+#define ALERT_LINE_LENGTH 192           /**< Buffer size of a formatted event */
+
+/**
+ * @brief Level of a rule
+ */
+enum alertLevel_t : uint8_t
+{
+    ALERT_NORMAL = 0,
+    ALERT_LOW,
+    ALERT_HIGH
+};
+
+/**
+ * @brief One rule, limits in the fixed point of the quantity (see YC01_FIELDS)
+ */
+struct alertRule_t
+{
+    yc01Quantity_t quantity;
+    uint8_t debounce;       /**< Consecutive readings needed to change the level (1: immediately) */
+    int16_t min;            /**< Lower limit, ALERT_NO_MIN if none */
+    int16_t max;            /**< Upper limit, ALERT_NO_MAX if none */
+    int16_t hysteresis;     /**< Distance inside the limits needed to clear an alert */
+};
+
+/**
+ * @brief State of one rule for one sensor
+ */
+struct alertState_t
+{
+    alertLevel_t level;     /**< Current level */
+    alertLevel_t pending;   /**< Level the last readings point to */
+    uint8_t count;          /**< Consecutive readings at the pending level */
+    uint8_t reserved;
+    int16_t value;          /**< Last raw value */
+    uint32_t since;         /**< Time of the last level change (UTC seconds) */
+};
+
+/**
+ * @brief Level change of a rule (alert or recovery)
+ */
+struct alertEvent_t
+{
+    uint32_t time;          /**< Time of the reading */
+    uint8_t sensor;         /**< Sensor index */
+    uint8_t rule;           /**< Index in the rule table */
+    alertLevel_t level;     /**< New level, ALERT_NORMAL is a recovery */
+    alertLevel_t previous;  /**< Level before */
+    int16_t value;          /**< Raw value of the reading */
+};
+
+/**
+ * @brief Parses a quantity name as in /status ("pH", "ec", "tds", "orp", "cl", "temp", "bat")
+ * @return true if known
+ */
+bool alertParseQuantity(const char* name, yc01Quantity_t& quantity);
+
+/**
+ * @brief Gets the name of a quantity as in /status
+ */
+const char* alertQuantityName(yc01Quantity_t quantity);
+
+/**
+ * @brief Gets the name of a level ("normal", "low", "high")
+ */
+const char* alertLevelName(alertLevel_t level);
+
+/**
+ * @brief Converts a physical value into the fixed point of a quantity (rounded, clamped to int16)
+ */
+int16_t alertToRaw(yc01Quantity_t quantity, float value);
+
+/**
+ * @brief Formats the human readable text of a level ("Alert: Temperature too low")
+ * @return Length of the text
+ */
+size_t alertText(yc01Quantity_t quantity, alertLevel_t level, char out[], size_t length);
+
+/**
+ * @brief Formats an event as JSON object (MQTT payload)
+ * @param event Event
+ * @param rule Rule of the event
+ * @param out Output buffer
+ * @param length Size of the buffer
+ * @return Length of the text
+ */
+size_t alertFormat(const alertEvent_t& event, const alertRule_t& rule, char out[], size_t length);
+
+/**
+ * @brief Evaluates the rule table on the readings of all sensors
+ */
+class AlertEngine {
+public:
+    /**
+     * @brief Sets the rules and clears the state of all sensors
+     * @param rules Rule table, copied
+     * @param count Number of rules (clamped to ALERT_MAX_RULES)
+     */
+    void begin(const alertRule_t rules[], size_t count);
+
+    /**
+     * @brief Evaluates all rules on a reading (loop side)
+     * @param sensor Sensor index (< ALERT_MAX_SENSORS)
+     * @param readings Valid readings (type != 0)
+     * @param events Output events
+     * @param maxEvents Size of events
+     * @return Number of events
+     */
+    size_t evaluate(uint8_t sensor, const sensorReadings_t& readings, alertEvent_t events[], size_t maxEvents);
+
+    /**
+     * @brief Gets the number of rules
+     */
+    size_t size() const { return ruleCount; }
+
+    /**
+     * @brief Gets a rule
+     */
+    const alertRule_t& rule(size_t index) const { return rules[index]; }
+
+    /**
+     * @brief Gets the state of a rule of a sensor
+     */
+    const alertState_t& state(uint8_t sensor, size_t index) const { return states[sensor][index]; }
+
+    /**
+     * @brief Gets the number of rules of a sensor not at ALERT_NORMAL
+     */
+    size_t active(uint8_t sensor) const;
+
+protected:
+    alertRule_t rules[ALERT_MAX_RULES];
+    size_t ruleCount = 0;
+    alertState_t states[ALERT_MAX_SENSORS][ALERT_MAX_RULES];
+};
@@ -0,0 +1,51 @@
+#include <stdio.h>
+
+#include "bleAddress.h"
+
+
+/**
+ * @brief Converts a hex digit, -1 if it is none
+ */
+static inline int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool bleAddressParse(const char* str, uint8_t type, uint64_t& key) {
+    key = BLE_ADDRESS_NONE;
+    if (!str) return false;
+
+    uint64_t value = 0;
+    for (int i = 0; i < 6; i++) {
+        int hi = hexDigit(str[i * 3]);
+        int lo = hi < 0 ? -1 : hexDigit(str[i * 3 + 1]);
+        if (lo < 0) return false;
+        char sep = str[i * 3 + 2];
+        if (i < 5 ? (sep != ':' && sep != '-') : sep != '\0') return false;
+        value = (value << 8) | (uint64_t)(hi << 4 | lo);
+    }
+    if (value == 0) return false;
+    key = bleAddressKey(value, type);
+    return true;
+}
+
+const char* bleAddressFormat(uint64_t key, char out[BLE_ADDRESS_STR_LENGTH]) {
+    uint64_t value = bleAddressValue(key);
+    if (value == 0) {
+        out[0] = '\0';
+        return out;
+    }
+    snprintf(out, BLE_ADDRESS_STR_LENGTH, "%02x:%02x:%02x:%02x:%02x:%02x",
+        (unsigned)(value >> 40) & 0xFF, (unsigned)(value >> 32) & 0xFF, (unsigned)(value >> 24) & 0xFF,
+        (unsigned)(value >> 16) & 0xFF, (unsigned)(value >> 8) & 0xFF, (unsigned)value & 0xFF);
+    return out;
+}
+
+int bleAddressFind(const uint64_t list[], size_t count, uint64_t key) {
+    for (size_t i = 0; i < count; i++) {
+        if (bleAddressMatch(list[i], key)) return i;
+    }
+    return -1;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * BLE addresses as packed integer keys.
+ *
+ * A key holds the 48-bit address in bits 0..47 and the address type in bits
+ * 48..55 (the layout of the scan device set). Configured addresses are parsed
+ * once into keys, so matching is an integer compare instead of formatting and
+ * comparing strings per advertiser. Key 0 means "no address".
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define BLE_ADDRESS_STR_LENGTH 18   /**< Buffer size of a formatted address incl. terminator */
+#define BLE_ADDRESS_NONE 0ull       /**< Key of an unset address */
+#define BLE_ADDRESS_TYPE_ANY 0xFF   /**< Type unknown (configured address), matches any type */
+#define BLE_ADDRESS_VALUE_MASK 0xFFFFFFFFFFFFull
+
+/**
+ * @brief Builds a key from a 48-bit address and its type
+ * @param value Address, most significant byte first as in "aa:bb:cc:dd:ee:ff"
+ * @param type Address type (public, random, ...) or BLE_ADDRESS_TYPE_ANY
+ * @return Key
+ */
+inline uint64_t bleAddressKey(uint64_t value, uint8_t type) {
+    return (value & BLE_ADDRESS_VALUE_MASK) | ((uint64_t)type << 48);
+}
+
+/**
+ * @brief Gets the 48-bit address of a key
+ */
+inline uint64_t bleAddressValue(uint64_t key) {
+    return key & BLE_ADDRESS_VALUE_MASK;
+}
+
+/**
+ * @brief Gets the address type of a key
+ */
+inline uint8_t bleAddressType(uint64_t key) {
+    return (uint8_t)(key >> 48);
+}
+
+/**
+ * @brief Checks if two keys denote the same device
+ *
+ * The types must be equal unless one of them is BLE_ADDRESS_TYPE_ANY.
+ * @param a Key
+ * @param b Key
+ * @return true if they match (never for BLE_ADDRESS_NONE)
+ */
+inline bool bleAddressMatch(uint64_t a, uint64_t b) {
+    if (bleAddressValue(a) != bleAddressValue(b) || bleAddressValue(a) == 0) return false;
+    uint8_t typeA = bleAddressType(a);
+    uint8_t typeB = bleAddressType(b);
+    return typeA == typeB || typeA == BLE_ADDRESS_TYPE_ANY || typeB == BLE_ADDRESS_TYPE_ANY;
+}
+
+/**
+ * @brief Parses "aa:bb:cc:dd:ee:ff" (case insensitive, ':' or '-' separated)
+ * @param str Address string
+ * @param type Address type of the key
+ * @param key Output key, BLE_ADDRESS_NONE if str is empty or invalid
+ * @return true if str is a valid address
+ */
+bool bleAddressParse(const char* str, uint8_t type, uint64_t& key);
+
+/**
+ * @brief Formats the address of a key as "aa:bb:cc:dd:ee:ff"
+ * @param key Key
+ * @param out Output buffer
+ * @return out, an empty string for BLE_ADDRESS_NONE
+ */
+const char* bleAddressFormat(uint64_t key, char out[BLE_ADDRESS_STR_LENGTH]);
+
+/**
+ * @brief Finds a key in a list
+ * @param list Keys
+ * @param count Number of keys
+ * @param key Key to look for (see bleAddressMatch)
+ * @return Index or -1 if not found
+ */
+int bleAddressFind(const uint64_t list[], size_t count, uint64_t key);
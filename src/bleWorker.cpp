@@ -0,0 +1,106 @@
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include "esp_task_wdt.h"
+
+#include "config.h"
+#include "bleWorker.h"
+#include "sensorRegistry.h"
+
+#ifndef CONFIG_BT_NIMBLE_PINNED_TO_CORE
+#define CONFIG_BT_NIMBLE_PINNED_TO_CORE 0
+#endif
+
+#define SCAN_POLL_INTERVAL 20   // poll interval while a scan runs in ms
+#define WORKER_IDLE_WAIT 1000   // queue wait between watchdog resets in ms
+
+static QueueHandle_t commandQueue = nullptr;
+static QueueHandle_t resultQueue = nullptr;
+static TaskHandle_t workerTask = nullptr;
+
+/**
+ * @brief Runs a discovery scan until it ended
+ */
+static void runScan(const bleCommand_t& command, bleResult_t& result) {
+    if (!BLE_YC01::startScan(command.scan)) {
+        DEBUG_println("Failed to start BLE scan");
+        return;
+    }
+    while (BLE_YC01::isScanning()) {
+        esp_task_wdt_reset();
+        vTaskDelay(pdMS_TO_TICKS(SCAN_POLL_INTERVAL));
+    }
+    result.ok = true;
+}
+
+/**
+ * @brief Reads a sensor of the registry
+ */
+static void runRead(const bleCommand_t& command, bleResult_t& result) {
+    BLE_YC01& device = sensorRegistryGet(command.idx).device;
+    if (command.type == BLE_CMD_READ_ADDRESS) {
+        device.setAddress(bleAddressFromKey(command.address));
+    }
+    result.ok = device.readData(command.budgetMs).ok;
+    result.address = bleAddressKey(device.getAddress());
+    if (result.ok) {
+        result.readings = device.getReadings();
+        strlcpy(result.model, device.getSensorType(), sizeof(result.model));
+    }
+    result.link = device.getLinkStatus();
+}
+
+/**
+ * @brief Worker task: executes commands in order and posts their results
+ */
+static void workerLoop(void* arg) {
+    esp_task_wdt_add(NULL); // a hung scan or read resets the device
+    bleCommand_t command;
+    for (;;) {
+        esp_task_wdt_reset();
+        if (xQueueReceive(commandQueue, &command, pdMS_TO_TICKS(WORKER_IDLE_WAIT)) != pdTRUE) {
+            continue;
+        }
+
+        bleResult_t result = {};
+        result.type = command.type;
+        result.idx = command.idx;
+        uint32_t startMs = millis();
+        if (command.type == BLE_CMD_SCAN) {
+            runScan(command, result);
+        } else {
+            runRead(command, result);
+        }
+        result.durationMs = millis() - startMs;
+
+        // the loop waits for every result, the queue cannot stay full
+        while (xQueueSend(resultQueue, &result, pdMS_TO_TICKS(WORKER_IDLE_WAIT)) != pdTRUE) {
+            esp_task_wdt_reset();
+        }
+    }
+}
+
+bool bleWorkerBegin() {
+    if (workerTask) return true;
+    commandQueue = xQueueCreate(BLE_WORKER_QUEUE_LENGTH, sizeof(bleCommand_t));
+    resultQueue = xQueueCreate(BLE_WORKER_QUEUE_LENGTH, sizeof(bleResult_t));
+    if (!commandQueue || !resultQueue) {
+        return false;
+    }
+    // same core as the NimBLE host, the loop task keeps the other core
+    return xTaskCreatePinnedToCore(workerLoop, "bleWorker", BLE_WORKER_STACK, nullptr, 1, &workerTask,
+        CONFIG_BT_NIMBLE_PINNED_TO_CORE) == pdPASS;
+}
+
+bool bleWorkerSend(const bleCommand_t& command) {
+    if (!commandQueue) return false;
+    return xQueueSend(commandQueue, &command, 0) == pdTRUE;
+}
+
+bool bleWorkerReceive(bleResult_t& result) {
+    if (!resultQueue) return false;
+    return xQueueReceive(resultQueue, &result, 0) == pdTRUE;
+}
+
+uint32_t bleWorkerStackFree() {
+    return workerTask ? uxTaskGetStackHighWaterMark(workerTask) : 0;
+}
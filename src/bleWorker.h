@@ -0,0 +1,82 @@
+#pragma once
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+#include "BLE-YC01.h"
+
+/*
+ * BLE acquisition in a dedicated FreeRTOS task.
+ *
+ * Scans and sensor reads block for seconds. They run in a worker task pinned
+ * to the core of the NimBLE host, so loop() keeps serving the serial API,
+ * the web server and MQTT. The loop posts commands into a queue and polls
+ * the result queue; while a command is outstanding the worker owns the BLE
+ * objects (scan set, sensor devices), the loop touches them again only after
+ * the result arrived.
+ */
+
+#define BLE_WORKER_STACK 8192       /**< Stack size of the worker task in bytes */
+#define BLE_WORKER_QUEUE_LENGTH 4   /**< Entries of the command and the result queue */
+
+/**
+ * @brief Request to the worker
+ */
+enum bleCommandType_t : uint8_t
+{
+    BLE_CMD_SCAN = 0,       /**< Discovery scan, completes when the scan ended */
+    BLE_CMD_READ,           /**< Read a sensor at its current address (open persistent link) */
+    BLE_CMD_READ_ADDRESS    /**< Set the address of a sensor and read it */
+};
+
+/**
+ * @brief Command queue entry
+ */
+struct bleCommand_t
+{
+    bleCommandType_t type;  /**< Command */
+    uint8_t idx;            /**< Sensor index in the registry (read commands) */
+    uint64_t address;       /**< Sensor address key (BLE_CMD_READ_ADDRESS) */
+    scanParams_t scan;      /**< Scan parameters (BLE_CMD_SCAN) */
+    uint32_t budgetMs;      /**< Time budget of a read in ms */
+};
+
+/**
+ * @brief Result queue entry
+ */
+struct bleResult_t
+{
+    bleCommandType_t type;  /**< Command this is the result of */
+    uint8_t idx;            /**< Sensor index (read commands) */
+    bool ok;                /**< Scan ran / data was read */
+    uint32_t durationMs;    /**< Time the worker spent on the command */
+    uint64_t address;       /**< Address key the sensor was read from */
+    sensorReadings_t readings; /**< Readings (ok read commands) */
+    char model[YC01_MODEL_LENGTH]; /**< Sensor model (read commands) */
+    bleLinkStatus_t link;   /**< Link state of the sensor after the read */
+};
+
+/**
+ * @brief Creates the queues and starts the worker task
+ * @return true if the worker runs
+ */
+bool bleWorkerBegin();
+
+/**
+ * @brief Posts a command to the worker without blocking
+ * @param command Command
+ * @return false if the queue is full or the worker is not running
+ */
+bool bleWorkerSend(const bleCommand_t& command);
+
+/**
+ * @brief Takes a result from the worker without blocking
+ * @param result Output result
+ * @return true if a result was available
+ */
+bool bleWorkerReceive(bleResult_t& result);
+
+/**
+ * @brief Gets the free stack of the worker task
+ * @return Stack high water mark in bytes, 0 if the worker is not running
+ */
+uint32_t bleWorkerStackFree();
@@ -1,6 +1,8 @@
 #pragma once
 #include <Arduino.h>
 
+#include "alerts.h"
+
 
 /*
  * Debug
@@ -21,6 +23,15 @@
 /*
  * config structure
  */
+#define MAX_SENSORS 8 // maximum number of BLE-YC01 sensors served by one gateway
+
+typedef struct {
+  String bleAddress;  // empty: adopt the first sensor found that is not bound to another entry
+  uint64_t addressKey; // bleAddress parsed once at config load (see bleAddress.h), 0 if empty or invalid
+  String name;
+  uint16_t interval;  // read interval in seconds (0: use config.interval)
+} sensorConfig_t;
+
 typedef struct {
 // WiFi configuration
   String portalSSID;
@@ -36,10 +47,26 @@ typedef struct {
   String mqttTopic;
   String mqttUser;
   String mqttPassword;
+  bool mqttRollups;                     // publish closed hourly/daily rollups to "<mqttTopic>[/<sensor>]/rollup"
 // BLE-YC01 configurations
   uint16_t interval;
   String name;
   String bleAddress;
+  bool blePersistent;                   // keep BLE links open and use notifications instead of connect-per-read
+  uint8_t sensorCount;                  // number of entries in sensors (1 .. MAX_SENSORS)
+  sensorConfig_t sensors[MAX_SENSORS];  // sensor registry, defaults to one entry built from name/bleAddress/interval
+// threshold alerts
+  uint8_t alertCount;                   // number of entries in alerts (0: no alerts)
+  alertRule_t alerts[ALERT_MAX_RULES];  // rules evaluated on every reading of every sensor (see alerts.h)
+// notifications: daily summary and alert events by email or webhook (see notify.h)
+  String notifyUrl;                     // "smtp[s]://host[:port]" or "http[s]://host[:port]/path", empty: disabled
+  String notifyUser;                    // SMTP AUTH LOGIN or HTTP basic auth, empty: none
+  String notifyPassword;
+  String notifyFrom;                    // SMTP sender
+  String notifyTo;                      // SMTP recipients, comma separated
+  uint8_t summaryHour;                  // local hour of the daily summary (0 .. 23, other: no summary)
+  int16_t utcOffset;                    // offset of the local time in minutes
+  uint16_t heartbeat;                   // minutes without a reading until a sensor counts as offline
 
 } config_t;
 extern config_t config;
@@ -54,6 +81,21 @@ void requestReboot(String reason, uint32_t delayMs = 1000);
 
 
 #include <ArduinoJson.h>
+
+/**
+ * @brief Writes an alert rule as in config.json, limits in the units of /status
+ * @param rule Rule
+ * @param alert Output object
+ */
+inline void alertRuleToJson(const alertRule_t& rule, JsonObject alert)
+{
+    alert["type"] = alertQuantityName(rule.quantity);
+    if (rule.min != ALERT_NO_MIN) alert["min"] = yc01Value(rule.quantity, rule.min);
+    if (rule.max != ALERT_NO_MAX) alert["max"] = yc01Value(rule.quantity, rule.max);
+    alert["hysteresis"] = yc01Value(rule.quantity, rule.hysteresis);
+    alert["debounce"] = rule.debounce;
+}
+
 template <
     typename TDestination,
     detail::enable_if_t<!detail::is_pointer<TDestination>::value, int> = 0>
@@ -87,10 +129,42 @@ void serializeConfig(TDestination& destination, bool pretty = false)
     #else
     doc["mqttPassword"]   = "***";
     #endif
+    doc["mqttRollups"]    = config.mqttRollups;
 
     // BLE
     doc["bleAddress"]     = config.bleAddress;
+    doc["blePersistent"]  = config.blePersistent;
+    if (config.sensorCount > 1) {
+        JsonArray sensors = doc["sensors"].to<JsonArray>();
+        for (uint8_t i = 0; i < config.sensorCount; i++) {
+            JsonObject sensor = sensors.add<JsonObject>();
+            sensor["bleAddress"] = config.sensors[i].bleAddress;
+            sensor["name"]       = config.sensors[i].name;
+            sensor["interval"]   = config.sensors[i].interval;
+        }
+    }
+
+    // notifications
+    doc["notifyUrl"]      = config.notifyUrl;
+    doc["notifyUser"]     = config.notifyUser;
+    #if DEBUG_SECURITY
+    doc["notifyPassword"] = config.notifyPassword;
+    #else
+    doc["notifyPassword"] = "***";
+    #endif
+    doc["notifyFrom"]     = config.notifyFrom;
+    doc["notifyTo"]       = config.notifyTo;
+    doc["summaryHour"]    = config.summaryHour;
+    doc["utcOffset"]      = config.utcOffset;
+    doc["heartbeat"]      = config.heartbeat;
 
+    // alerts
+    if (config.alertCount) {
+        JsonArray alerts = doc["alerts"].to<JsonArray>();
+        for (uint8_t i = 0; i < config.alertCount; i++) {
+            alertRuleToJson(config.alerts[i], alerts.add<JsonObject>());
+        }
+    }
 
     if (pretty)
         serializeJsonPretty(doc, destination);
@@ -0,0 +1,123 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <NimBLEDevice.h>
+
+#include "config.h"
+#include "gattCache.h"
+
+
+#define GATT_CACHE_NAMESPACE "gattcache"
+#define GATT_CACHE_RAM_ENTRIES 8 // entries mirrored in RAM, opening NVS allocates
+
+/**
+ * @brief RAM mirror of the entries used since boot, so steady-state reads skip NVS
+ */
+static struct {
+    uint64_t address;
+    gattCacheEntry_t entry;
+} ramCache[GATT_CACHE_RAM_ENTRIES];
+static size_t ramCount = 0;
+static size_t ramNext = 0; // next slot to replace when full
+
+/**
+ * @brief Finds the RAM mirror of a sensor
+ * @return Entry or nullptr if not mirrored
+ */
+static gattCacheEntry_t* ramFind(uint64_t address) {
+    for (size_t i = 0; i < ramCount; i++) {
+        if (ramCache[i].address == address) return &ramCache[i].entry;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Mirrors an entry in RAM, replaces the oldest entry if full
+ */
+static void ramPut(uint64_t address, const gattCacheEntry_t& entry) {
+    gattCacheEntry_t* cached = ramFind(address);
+    if (!cached) {
+        size_t i = ramCount < GATT_CACHE_RAM_ENTRIES ? ramCount++ : ramNext++ % GATT_CACHE_RAM_ENTRIES;
+        ramCache[i].address = address;
+        cached = &ramCache[i].entry;
+    }
+    *cached = entry;
+}
+
+/**
+ * @brief Drops the RAM mirror of a sensor
+ */
+static void ramErase(uint64_t address) {
+    for (size_t i = 0; i < ramCount; i++) {
+        if (ramCache[i].address == address) {
+            ramCache[i] = ramCache[--ramCount];
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Builds the NVS key of a sensor (12 hex digits, NVS keys are limited to 15 characters)
+ */
+static void cacheKey(const NimBLEAddress& address, char key[13]) {
+    snprintf(key, 13, "%012llx", (unsigned long long)(uint64_t)address);
+}
+
+bool gattCacheLoad(const NimBLEAddress& address, gattCacheEntry_t& entry) {
+    const gattCacheEntry_t* cached = ramFind((uint64_t)address);
+    if (cached) {
+        entry = *cached;
+        return true;
+    }
+
+    char key[13];
+    cacheKey(address, key);
+
+    Preferences prefs;
+    if (!prefs.begin(GATT_CACHE_NAMESPACE, true)) {
+        return false; // namespace does not exist yet
+    }
+    size_t length = prefs.getBytesLength(key) == sizeof(entry) ? prefs.getBytes(key, &entry, sizeof(entry)) : 0;
+    prefs.end();
+
+    if (length != sizeof(entry) || entry.version != GATT_CACHE_VERSION || entry.dataHandle == 0) {
+        return false;
+    }
+    entry.model[GATT_CACHE_MODEL_LEN - 1] = '\0';
+    ramPut((uint64_t)address, entry);
+    return true;
+}
+
+void gattCacheStore(const NimBLEAddress& address, uint16_t dataHandle, const char* model) {
+    gattCacheEntry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.version = GATT_CACHE_VERSION;
+    entry.dataHandle = dataHandle;
+    strncpy(entry.model, model, GATT_CACHE_MODEL_LEN - 1);
+
+    // avoid flash writes if nothing changed
+    gattCacheEntry_t stored;
+    if (gattCacheLoad(address, stored) && memcmp(&stored, &entry, sizeof(entry)) == 0) {
+        return;
+    }
+
+    char key[13];
+    cacheKey(address, key);
+    Preferences prefs;
+    if (prefs.begin(GATT_CACHE_NAMESPACE, false)) {
+        prefs.putBytes(key, &entry, sizeof(entry));
+        prefs.end();
+        ramPut((uint64_t)address, entry);
+        DEBUG_print("GATT handles cached for "); DEBUG_println(key);
+    }
+}
+
+void gattCacheErase(const NimBLEAddress& address) {
+    ramErase((uint64_t)address);
+    char key[13];
+    cacheKey(address, key);
+    Preferences prefs;
+    if (prefs.begin(GATT_CACHE_NAMESPACE, false)) {
+        prefs.remove(key);
+        prefs.end();
+    }
+}
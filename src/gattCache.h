@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+#include "yc01Codec.h"
+
+#define GATT_CACHE_VERSION 1                    /**< Layout version of gattCacheEntry_t, bump on change */
+#define GATT_CACHE_MODEL_LEN YC01_MODEL_LENGTH  /**< Maximum length of the cached model string incl. terminator (records of another size are ignored) */
+
+/**
+ * @brief Attribute handles and model string of one sensor, persisted in NVS
+ */
+struct gattCacheEntry_t
+{
+    uint8_t version;                    /**< GATT_CACHE_VERSION */
+    uint16_t dataHandle;                /**< Value handle of the data characteristic (ff02) */
+    char model[GATT_CACHE_MODEL_LEN];   /**< Device name read from 2A00 */
+};
+
+/**
+ * @brief Loads the cached attribute handles of a sensor
+ * @param address Sensor address
+ * @param entry Output entry
+ * @return true if a valid entry was found
+ */
+bool gattCacheLoad(const NimBLEAddress& address, gattCacheEntry_t& entry);
+
+/**
+ * @brief Stores the attribute handles of a sensor (only written if changed)
+ * @param address Sensor address
+ * @param dataHandle Value handle of the data characteristic
+ * @param model Device name
+ */
+void gattCacheStore(const NimBLEAddress& address, uint16_t dataHandle, const char* model);
+
+/**
+ * @brief Removes the cached entry of a sensor, e.g. after a failed cached read
+ * @param address Sensor address
+ */
+void gattCacheErase(const NimBLEAddress& address);
@@ -0,0 +1,181 @@
+#include <math.h>
+
+#include "jsonWriter.h"
+
+
+JsonWriter::JsonWriter(char buffer[], size_t length) : out(buffer), size(length) {
+    if (size) out[0] = 0;
+}
+
+void JsonWriter::put(char c) {
+    if (used + 1 < size) {
+        out[used] = c;
+        out[used + 1] = 0;
+    }
+    used++;
+}
+
+void JsonWriter::raw(const char* text) {
+    while (*text) put(*text++);
+}
+
+void JsonWriter::separator() {
+    if (comma) put(',');
+    comma = true;
+}
+
+void JsonWriter::name(const char* key) {
+    separator();
+    put('"');
+    raw(key);
+    put('"');
+    put(':');
+}
+
+void JsonWriter::beginObject(const char* key) {
+    if (key) name(key);
+    else separator();
+    put('{');
+    comma = false;
+}
+
+void JsonWriter::endObject() {
+    put('}');
+    comma = true;
+}
+
+void JsonWriter::beginArray(const char* key) {
+    if (key) name(key);
+    else separator();
+    put('[');
+    comma = false;
+}
+
+void JsonWriter::endArray() {
+    put(']');
+    comma = true;
+}
+
+void JsonWriter::string(const char* value) {
+    if (!value) return raw("null");
+    put('"');
+    for (; *value; value++) {
+        // the escapes of ArduinoJson, other control characters are written as they are
+        switch (*value) {
+            case '"':  raw("\\\""); break;
+            case '\\': raw("\\\\"); break;
+            case '\b': raw("\\b"); break;
+            case '\f': raw("\\f"); break;
+            case '\n': raw("\\n"); break;
+            case '\r': raw("\\r"); break;
+            case '\t': raw("\\t"); break;
+            default:   put(*value);
+        }
+    }
+    put('"');
+}
+
+void JsonWriter::boolean(bool value) {
+    raw(value ? "true" : "false");
+}
+
+void JsonWriter::digits(uint32_t value) {
+    char text[10];
+    size_t n = 0;
+    do {
+        text[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n) put(text[--n]);
+}
+
+void JsonWriter::integer(unsigned long long value) {
+    if (value <= 0xFFFFFFFFull) return digits((uint32_t)value);
+    // 64-bit: the upper part first, the lower nine digits zero padded
+    integer(value / 1000000000ull);
+    uint32_t low = (uint32_t)(value % 1000000000ull);
+    for (uint32_t scale = 100000000; scale > 1 && low < scale; scale /= 10) put('0');
+    digits(low);
+}
+
+void JsonWriter::integer(long long value) {
+    if (value < 0) {
+        put('-');
+        return integer((unsigned long long)0 - (unsigned long long)value);
+    }
+    integer((unsigned long long)value);
+}
+
+void JsonWriter::number(double value, int8_t decimalPlaces) {
+    // decomposition as ArduinoJson's decomposeFloat(), so the text is the same
+    static const double positivePowers[] = { 1e1, 1e2, 1e4, 1e8, 1e16, 1e32, 1e64, 1e128, 1e256 };
+    static const double negativePowers[] = { 1e-1, 1e-2, 1e-4, 1e-8, 1e-16, 1e-32, 1e-64, 1e-128, 1e-256 };
+    if (isnan(value) || isinf(value)) return raw("null");
+    if (value < 0.0) {
+        put('-');
+        value = -value;
+    }
+
+    // exponent notation from 1e7 and up to 1e-5
+    int16_t exponent = 0;
+    int index = 8;
+    int bit = 1 << index;
+    if (value >= 1e7) {
+        for (; index >= 0; index--) {
+            if (value >= positivePowers[index]) {
+                value *= negativePowers[index];
+                exponent = (int16_t)(exponent + bit);
+            }
+            bit >>= 1;
+        }
+    }
+    if (value > 0 && value <= 1e-5) {
+        for (; index >= 0; index--) {
+            if (value < negativePowers[index] * 10) {
+                value *= positivePowers[index];
+                exponent = (int16_t)(exponent - bit);
+            }
+            bit >>= 1;
+        }
+    }
+
+    // the integral digits count against the decimal places
+    uint32_t maxDecimal = 1;
+    for (int8_t i = 0; i < decimalPlaces; i++) maxDecimal *= 10;
+    uint32_t integral = (uint32_t)value;
+    for (uint32_t tmp = integral; tmp >= 10; tmp /= 10) {
+        maxDecimal /= 10;
+        decimalPlaces--;
+    }
+    double remainder = (value - (double)integral) * (double)maxDecimal;
+    uint32_t decimal = (uint32_t)remainder;
+    remainder = remainder - (double)decimal;
+    decimal += (uint32_t)(remainder * 2);
+    if (decimal >= maxDecimal) {
+        decimal = 0;
+        integral++;
+        if (exponent && integral >= 10) {
+            exponent++;
+            integral = 1;
+        }
+    }
+    while (decimal % 10 == 0 && decimalPlaces > 0) {
+        decimal /= 10;
+        decimalPlaces--;
+    }
+
+    digits(integral);
+    if (decimalPlaces) {
+        char text[10];
+        for (int8_t i = decimalPlaces - 1; i >= 0; i--) {
+            text[i] = (char)('0' + decimal % 10);
+            decimal /= 10;
+        }
+        put('.');
+        for (int8_t i = 0; i < decimalPlaces; i++) put(text[i]);
+    }
+    if (exponent) {
+        put('e');
+        integer((long long)exponent);
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Bounded JSON writer for the status and MQTT payloads.
+ *
+ * Writes compact JSON into a caller buffer, without heap and without a
+ * document tree, in the format serializeJson() of ArduinoJson 7 produces:
+ * members in call order, floats with up to 7 significant digits, doubles
+ * with up to 10 (a double that is exactly a float is written as float, as
+ * ArduinoJson stores it), exponent notation from 1e7 and up to 1e-5, NaN
+ * and infinity as null, and the same string escapes. The length is
+ * counted on past the end of the buffer, so an overflow is detected and
+ * the exact size needed is known.
+ *
+ * The JSON_*_LENGTH bounds and the constexpr helpers give the longest text
+ * of a value, so the buffer size of a payload can be computed from its
+ * schema at compile time.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define JSON_BOOL_LENGTH 5          /**< "false" */
+#define JSON_INT_LENGTH 11          /**< 32-bit signed, "-2147483648" */
+#define JSON_UINT_LENGTH 10         /**< 32-bit unsigned, "4294967295" */
+#define JSON_INT64_LENGTH 20        /**< 64-bit, "-9223372036854775808" */
+#define JSON_FLOAT_LENGTH 13        /**< float, "-1.234567e-38" */
+#define JSON_DOUBLE_LENGTH 17       /**< double, "-1.234567891e-308" */
+
+/**
+ * @brief Gets the length of a literal at compile time
+ */
+constexpr size_t jsonTextLength(const char* text) {
+    return *text ? 1 + jsonTextLength(text + 1) : 0;
+}
+
+/**
+ * @brief Gets the longest JSON string of up to chars characters of any content (every character escaped)
+ */
+constexpr size_t jsonStringLength(size_t chars) {
+    return 2 + 2 * chars;
+}
+
+/**
+ * @brief Gets the longest JSON string of up to chars characters that need no escape (names, generated texts)
+ */
+constexpr size_t jsonQuotedLength(size_t chars) {
+    return 2 + chars;
+}
+
+/**
+ * @brief Gets the longest member of an object: separator, quoted key, colon and value
+ * @param key Key (no escapes)
+ * @param value Longest text of the value
+ */
+constexpr size_t jsonMemberLength(const char* key, size_t value) {
+    return 1 + jsonQuotedLength(jsonTextLength(key)) + 1 + value;
+}
+
+/**
+ * @brief Compact JSON into a fixed buffer
+ */
+class JsonWriter {
+public:
+    /**
+     * @brief Starts an empty text
+     * @param out Output buffer, always terminated
+     * @param size Size of the buffer
+     */
+    JsonWriter(char out[], size_t size);
+
+    /**
+     * @brief Opens an object, as member if a key is given (else top level or array element)
+     */
+    void beginObject(const char* key = nullptr);
+    void endObject();
+
+    /**
+     * @brief Opens an array, as member if a key is given (else top level or array element)
+     */
+    void beginArray(const char* key = nullptr);
+    void endArray();
+
+    /**
+     * @brief Writes a member of the open object
+     * @param key Key (written as it is, no escapes)
+     * @param value Value, a null string is written as null
+     */
+    void member(const char* key, const char* value) { name(key); string(value); }
+    void member(const char* key, bool value) { name(key); boolean(value); }
+    void member(const char* key, int value) { name(key); integer(value); }
+    void member(const char* key, unsigned value) { name(key); integer(value); }
+    void member(const char* key, long value) { name(key); integer(value); }
+    void member(const char* key, unsigned long value) { name(key); integer(value); }
+    void member(const char* key, long long value) { name(key); integer(value); }
+    void member(const char* key, unsigned long long value) { name(key); integer(value); }
+    void member(const char* key, float value) { name(key); number(value, 6); }
+    void member(const char* key, double value) { name(key); number(value, (float)value == value ? 6 : 9); }
+
+    /**
+     * @brief Gets the length of the whole text, also if it did not fit
+     */
+    size_t length() const { return used; }
+
+    /**
+     * @brief Checks if the text was cut at the end of the buffer
+     */
+    bool overflowed() const { return used >= size; }
+
+    /**
+     * @brief Gets the text (cut if overflowed)
+     */
+    const char* c_str() const { return out; }
+
+protected:
+    void put(char c);
+    void raw(const char* text);
+    void separator();
+    void name(const char* key);
+    void string(const char* value);
+    void boolean(bool value);
+    void integer(long long value);
+    void integer(unsigned long long value);
+    void integer(int value) { integer((long long)value); }
+    void integer(unsigned value) { integer((unsigned long long)value); }
+    void integer(long value) { integer((long long)value); }
+    void integer(unsigned long value) { integer((unsigned long long)value); }
+    void number(double value, int8_t decimalPlaces);
+    void digits(uint32_t value);
+
+    char* out;
+    size_t size;
+    size_t used = 0;
+    bool comma = false;         /**< A value precedes at this level */
+};
@@ -0,0 +1,51 @@
+#include "livePush.h"
+
+
+void LivePush::changed(size_t slot, uint32_t nowMs) {
+    if (slot >= LIVE_PUSH_SLOTS) return;
+    slot_t& s = slots[slot];
+    if (!s.pending) {
+        // the latency counts from the first change of a coalesced burst
+        s.pending = true;
+        s.changedMs = nowMs;
+    }
+}
+
+void LivePush::changedAll(uint32_t nowMs) {
+    for (size_t i = 0; i < LIVE_PUSH_SLOTS; i++) changed(i, nowMs);
+}
+
+int LivePush::next(size_t count, size_t subscribers, uint32_t nowMs, uint32_t minGapMs, uint32_t heartbeatMs) {
+    if (count > LIVE_PUSH_SLOTS) count = LIVE_PUSH_SLOTS;
+    if (!subscribers) {
+        // nobody listens: nothing to build, a new subscriber gets everything anyway
+        for (size_t i = 0; i < LIVE_PUSH_SLOTS; i++) slots[i].pending = false;
+        return -1;
+    }
+    for (size_t n = 0; n < count; n++) {
+        size_t i = (cursor + n) % count;
+        const slot_t& s = slots[i];
+        uint32_t age = nowMs - s.pushedMs;
+        bool due = s.pending ? (!s.pushed || age >= minGapMs) : (heartbeatMs && (!s.pushed || age >= heartbeatMs));
+        if (due) {
+            cursor = (i + 1) % count;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void LivePush::sent(size_t slot, size_t subscribers, size_t length, uint32_t nowMs) {
+    if (slot >= LIVE_PUSH_SLOTS) return;
+    slot_t& s = slots[slot];
+    if (s.pending) {
+        lastLatencyMs = nowMs - s.changedMs;
+        if (lastLatencyMs > maxLatencyMs) maxLatencyMs = lastLatencyMs;
+    }
+    s.pending = false;
+    s.pushed = true;
+    s.pushedMs = nowMs;
+    pushCount++;
+    messageCount += subscribers;
+    byteCount += subscribers * length;
+}
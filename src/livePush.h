@@ -0,0 +1,96 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Scheduling of the live status pushed to the dashboards (WebSocket /live).
+ *
+ * A reading or a state change marks the status of its sensor as changed.
+ * The loop asks for the next slot due, builds its status once and sends
+ * the same text to every subscriber. Changes within the minimum gap of a
+ * slot are coalesced into one push; without any change a slot is pushed
+ * again after the heartbeat interval, which refreshes the fast-changing
+ * fields (time, RSSI, heap). With no subscribers nothing is built, changes
+ * are dropped. The delay from the first change to its push is recorded.
+ * Sending itself, the queues of the clients and dropping slow clients are
+ * up to the caller, this class holds no locks.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define LIVE_PUSH_SLOTS 8               /**< Pushed status per sensor (MAX_SENSORS) */
+
+/**
+ * @brief Pending changes, push times and counters of the live status
+ */
+class LivePush {
+public:
+    /**
+     * @brief Marks the status of a slot as changed
+     * @param slot Slot (sensor index)
+     * @param nowMs Current time in ms (millis())
+     */
+    void changed(size_t slot, uint32_t nowMs);
+
+    /**
+     * @brief Marks the status of all slots as changed (connectivity, standby, a new subscriber)
+     */
+    void changedAll(uint32_t nowMs);
+
+    /**
+     * @brief Gets the next slot to push
+     * @param slots Slots in use (sensor count)
+     * @param subscribers Connected subscribers, 0 drops pending changes
+     * @param nowMs Current time in ms (millis())
+     * @param minGapMs Minimum time between two pushes of a slot
+     * @param heartbeatMs Time after which a slot is pushed without a change, 0: never
+     * @return Slot, -1 if none is due
+     */
+    int next(size_t slots, size_t subscribers, uint32_t nowMs, uint32_t minGapMs, uint32_t heartbeatMs);
+
+    /**
+     * @brief Records a push
+     * @param slot Slot
+     * @param subscribers Subscribers the text was queued for
+     * @param length Length of the text
+     * @param nowMs Current time in ms (millis())
+     */
+    void sent(size_t slot, size_t subscribers, size_t length, uint32_t nowMs);
+
+    /**
+     * @brief Counts subscribers dropped because their queue was full
+     */
+    void dropped(size_t subscribers) { droppedCount += subscribers; }
+
+    /**
+     * @brief Checks if a change of the slot waits for its push
+     */
+    bool pending(size_t slot) const { return slot < LIVE_PUSH_SLOTS && slots[slot].pending; }
+
+    uint32_t pushes() const { return pushCount; }             /**< Texts built and sent */
+    uint32_t messages() const { return messageCount; }        /**< Texts queued, one per subscriber */
+    uint32_t bytes() const { return byteCount; }              /**< Bytes queued */
+    uint32_t drops() const { return droppedCount; }           /**< Subscribers dropped as too slow */
+    uint32_t latencyMs() const { return lastLatencyMs; }      /**< Delay of the last push after its change */
+    uint32_t latencyMaxMs() const { return maxLatencyMs; }    /**< Longest delay since boot */
+
+protected:
+    /**
+     * @brief Push state of one slot
+     */
+    struct slot_t
+    {
+        bool pending;                       /**< Changed since the last push */
+        bool pushed;                        /**< Pushed at least once */
+        uint32_t changedMs;                 /**< Time of the first change not pushed */
+        uint32_t pushedMs;                  /**< Time of the last push */
+    };
+
+    slot_t slots[LIVE_PUSH_SLOTS] = {};
+    size_t cursor = 0;                      /**< Slot checked first, round robin */
+    uint32_t pushCount = 0;
+    uint32_t messageCount = 0;
+    uint32_t byteCount = 0;
+    uint32_t droppedCount = 0;
+    uint32_t lastLatencyMs = 0;
+    uint32_t maxLatencyMs = 0;
+};
@@ -8,22 +8,149 @@
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include <Ticker.h>
+#include <memory>
+#include <atomic>
 
 #include "captivePortal.h"
 #include "webUtils.h"
 
 #include "BLE-YC01.h"
+#include "sensorRegistry.h"
+#include "bleWorker.h"
+#include "readingHistory.h"
+#include "readingLogFs.h"
+#include "readingExport.h"
+#include "rollups.h"
+#include "trends.h"
+#include "mqttQueue.h"
+#include "notify.h"
+#include "notifyWorker.h"
+#include "alerts.h"
+#include "jsonWriter.h"
+#include "livePush.h"
+#include "metrics.h"
 
 #include "config.h"
 
 
 // general configuration
 config_t config;
-#define BUFFER_SIZE 512
-static char statusJsonBuffer[BUFFER_SIZE];
+
+// size of the status JSON (updateStatusJson): every member at its longest, strings up to these lengths
+#define STATUS_NAME_LENGTH 32 // sensor name, WiFi SSID
+#define STATUS_HOST_LENGTH 64 // MQTT server
+#define STATUS_TEXT_LENGTH 24 // fixed texts: read status, read phase, reset reason
+constexpr size_t STATUS_ALERT_SIZE = 1 + 2
+  + jsonMemberLength("type", jsonQuotedLength(4))
+  + jsonMemberLength("level", jsonQuotedLength(6))
+  + jsonMemberLength("value", JSON_FLOAT_LENGTH)
+  + jsonMemberLength("since", JSON_UINT_LENGTH)
+  + jsonMemberLength("text", jsonQuotedLength(ALERT_TEXT_LENGTH - 1));
+constexpr size_t STATUS_TREND_SIZE = jsonMemberLength("temp", 2
+  + jsonMemberLength("mean", JSON_FLOAT_LENGTH)
+  + jsonMemberLength("sd", JSON_FLOAT_LENGTH)
+  + jsonMemberLength("slope", JSON_FLOAT_LENGTH));
+constexpr size_t STATUS_JSON_SIZE = 2 + 1
+  + jsonMemberLength("time", JSON_INT64_LENGTH)
+  + jsonMemberLength("name", jsonStringLength(STATUS_NAME_LENGTH))
+  + jsonMemberLength("status", jsonQuotedLength(STATUS_TEXT_LENGTH))
+  + jsonMemberLength("bleAddress", jsonQuotedLength(BLE_ADDRESS_STR_LENGTH - 1))
+  + jsonMemberLength("sensorType", jsonStringLength(YC01_MODEL_LENGTH - 1))
+  + jsonMemberLength("sensor", JSON_UINT_LENGTH)
+  + jsonMemberLength("type", JSON_UINT_LENGTH)
+  + jsonMemberLength("pH", JSON_FLOAT_LENGTH) + jsonMemberLength("ec", JSON_FLOAT_LENGTH)
+  + jsonMemberLength("salt", JSON_FLOAT_LENGTH) + jsonMemberLength("tds", JSON_FLOAT_LENGTH)
+  + jsonMemberLength("orp", JSON_FLOAT_LENGTH) + jsonMemberLength("cl", JSON_FLOAT_LENGTH)
+  + jsonMemberLength("temp", JSON_FLOAT_LENGTH) + jsonMemberLength("bat", JSON_FLOAT_LENGTH)
+  + jsonMemberLength("bleRSSI", JSON_INT_LENGTH)
+  + jsonMemberLength("bleConnectToData", JSON_UINT_LENGTH)
+  + jsonMemberLength("bleCachedRead", JSON_BOOL_LENGTH)
+  + jsonMemberLength("bleRssiMin", JSON_INT_LENGTH) + jsonMemberLength("bleRssiMax", JSON_INT_LENGTH)
+  + jsonMemberLength("bleRssiMean", JSON_INT_LENGTH) + jsonMemberLength("bleLastSeen", JSON_UINT_LENGTH)
+  + jsonMemberLength("bleReadFailed", jsonQuotedLength(STATUS_TEXT_LENGTH))
+  + jsonMemberLength("bleAttempts", JSON_UINT_LENGTH) + jsonMemberLength("bleConnectMs", JSON_UINT_LENGTH)
+  + jsonMemberLength("bleDiscoverMs", JSON_UINT_LENGTH) + jsonMemberLength("bleReadMs", JSON_UINT_LENGTH)
+  + jsonMemberLength("bleBackoffMs", JSON_UINT_LENGTH)
+  + jsonMemberLength("alerts", 2 + ALERT_MAX_RULES * STATUS_ALERT_SIZE)
+  + jsonMemberLength("trends", 2 + YC01_QUANTITIES * STATUS_TREND_SIZE)
+  + jsonMemberLength("trendSamples", JSON_UINT_LENGTH)
+  + jsonMemberLength("bleDirect", JSON_BOOL_LENGTH)
+  + jsonMemberLength("bleCycleMs", JSON_UINT_LENGTH) + jsonMemberLength("bleRadioMs", JSON_UINT_LENGTH)
+  + jsonMemberLength("bleConnected", JSON_BOOL_LENGTH) + jsonMemberLength("bleNotify", JSON_BOOL_LENGTH)
+  + jsonMemberLength("bleSampleRate", JSON_FLOAT_LENGTH) + jsonMemberLength("bleReconnects", JSON_UINT_LENGTH)
+  + jsonMemberLength("wifiSSID", jsonStringLength(STATUS_NAME_LENGTH))
+  + jsonMemberLength("wifiRSSI", JSON_INT_LENGTH)
+  + jsonMemberLength("wifiIP", jsonQuotedLength(15))
+  + jsonMemberLength("mqttServer", jsonStringLength(STATUS_HOST_LENGTH))
+  + jsonMemberLength("mqttConnected", JSON_BOOL_LENGTH)
+  + jsonMemberLength("mqttQueued", JSON_UINT_LENGTH) + jsonMemberLength("mqttDropped", JSON_UINT_LENGTH)
+  + jsonMemberLength("mqttDrainRate", JSON_FLOAT_LENGTH)
+  + jsonMemberLength("notifyQueued", JSON_UINT_LENGTH) + jsonMemberLength("notifySent", JSON_UINT_LENGTH)
+  + jsonMemberLength("notifyFailed", JSON_UINT_LENGTH) + jsonMemberLength("summaryNext", JSON_UINT_LENGTH)
+  + jsonMemberLength("isStandby", JSON_BOOL_LENGTH)
+  + jsonMemberLength("resetReason", jsonQuotedLength(STATUS_TEXT_LENGTH))
+  + jsonMemberLength("loopMaxUs", JSON_UINT_LENGTH) + jsonMemberLength("heapFree", JSON_UINT_LENGTH)
+  + jsonMemberLength("historyCount", JSON_UINT_LENGTH)
+  + jsonMemberLength("httpRequests", JSON_UINT_LENGTH) + jsonMemberLength("httpNotModified", JSON_UINT_LENGTH)
+  + jsonMemberLength("httpBuilds", JSON_UINT_LENGTH)
+  + jsonMemberLength("liveClients", JSON_UINT_LENGTH) + jsonMemberLength("livePushes", JSON_UINT_LENGTH)
+  + jsonMemberLength("liveDropped", JSON_UINT_LENGTH) + jsonMemberLength("liveLatencyMs", JSON_UINT_LENGTH)
+  + jsonMemberLength("liveFanoutUs", JSON_UINT_LENGTH);
+static char statusJsonBuffer[STATUS_JSON_SIZE]; // loop only: the web server task gets copies (response cache, /live queue)
+#define STATUS_MAX_AGE 5000 // ms a cached /status may be old (WiFi RSSI, heap, times), state changes rebuild it at once
+static std::atomic<uint32_t> statusWanted{0}; // sensors whose /status was requested out of date, rebuilt by statusLoop()
+static_assert(MAX_SENSORS <= RESPONSE_SLOT_CONFIG, "response cache too small for MAX_SENSORS");
+
+// live status pushed to the dashboards (WebSocket /live), see liveLoop()
+#define LIVE_MAX_CLIENTS 10   // dashboards connected at once, the oldest is closed beyond
+#define LIVE_MIN_GAP 1000     // ms between two pushes of a sensor, a burst of changes is one push
+#define LIVE_HEARTBEAT 30000  // ms after which the status is pushed without a change (time, RSSI, heap)
+static_assert(MAX_SENSORS <= LIVE_PUSH_SLOTS, "live push too small for MAX_SENSORS");
+static AsyncWebSocket liveSocket("/live");
+static LivePush livePush;
+static volatile bool liveJoined = false;       // a dashboard connected, the loop pushes every sensor
+static uint32_t liveFanoutMaxUs = 0;           // longest build and fan-out of a push in us
 #define LED_PIN 2
-static uint32_t lastScan = 0;
+#define WDT_TIMEOUT 20 // task watchdog timeout in seconds
+#define READ_BUDGET 15000 // time budget of one sensor read in ms, below the watchdog timeout
+static_assert(READ_BUDGET < WDT_TIMEOUT * 1000, "sensor read must finish before the watchdog fires");
 String resetReason;
+static volatile bool forgetRequested = false; // SCAN command pending, applied by the BLE state machine
+static volatile bool readAllRequested = false; // SCAN/READ command pending, applied by the BLE state machine
+static uint32_t loopMaxUs = 0;                // longest loop() iteration since boot in us
+static ReadingHistory readingHistory;         // readings of all sensors, served by /history
+static FSLogFiles logFiles(LittleFS);
+static ReadingLog readingLog;                 // readings of all sensors on flash
+static volatile bool logFlushRequested = false; // reboot pending, write the batched readings
+static volatile bool exportFlushRequested = false; // export pending, write the batched readings first
+static Rollups rollups;                       // hourly/daily statistics of all sensors, served by /rollups
+static uint32_t rollupSavedHour = 0;          // hour of the last rollup save
+static AlertEngine alertEngine;               // threshold alerts of all sensors (config.alerts)
+static bool alertResync[MAX_SENSORS];         // an alert event of the sensor was not published
+static_assert(MAX_SENSORS <= ALERT_MAX_SENSORS, "alert engine too small for MAX_SENSORS");
+static Trends trends;                         // EWMA and slope of all measurements, in /status and MQTT
+static_assert(MAX_SENSORS <= TREND_MAX_SENSORS, "trends too small for MAX_SENSORS");
+
+/**
+ * @brief Reads all sensors right away (READ command).
+ *
+ * Web and serial commands only request it, the BLE state machine applies it
+ * while the BLE worker is idle: the read scheduler belongs to the loop.
+ */
+void requestReadAll() {
+  readAllRequested = true;
+}
+
+/**
+ * @brief Releases adopted addresses and reads all sensors right away (SCAN command).
+ *
+ * Web and serial commands only request it, the BLE state machine applies it
+ * while the BLE worker is idle.
+ */
+void requestForget() {
+  forgetRequested = true;
+  readAllRequested = true;
+}
 
 // wifi
 bool isCaptive = false;
@@ -37,52 +164,264 @@ static uint32_t lastWifiRetry = 0; // timestamp for periodic WiFi reconnection a
 WiFiClient wifiClient;
 WiFiClientSecure secureClient;
 PubSubClient mqttClient;
-
-// sensor state
-static sensorReadings_t lastReadings = {0};
-static String lastStatus = "init";
-static String lastBleAddress = "";
-static String lastSensorType = "unknown";
+#define MQTT_DRAIN_INTERVAL 100       // ms between two replayed batches of queued readings
+static MqttQueue mqttQueue;           // readings not published yet, replayed by mqttDrain()
+static uint32_t mqttDrainStart = 0;   // timestamp when the current replay started, 0 if idle
+static uint32_t mqttDrainSent = 0;    // readings replayed since mqttDrainStart
+static float mqttDrainRate = 0;       // readings per second of the current or last replay
+
+// operational telemetry served by /metrics, recorded lock-free from the loop and the web server task
+static const uint32_t BLE_READ_BOUNDS[] = { 250, 500, 1000, 2000, 3000, 5000, 8000, 12000, 15000 };      // ms
+static const uint32_t MQTT_CONNECT_BOUNDS[] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 };           // ms
+static const uint32_t MQTT_PUBLISH_BOUNDS[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000 };  // us
+static const uint32_t HTTP_BOUNDS[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000 };         // us
+enum httpRoute_t { HTTP_ROUTE_STATUS, HTTP_ROUTE_CMD, HTTP_ROUTE_HISTORY, HTTP_ROUTE_ROLLUPS, HTTP_ROUTE_EXPORT, HTTP_ROUTE_METRICS, HTTP_ROUTES };
+static const char* const HTTP_ROUTE_NAMES[HTTP_ROUTES] = { "status", "cmd", "history", "rollups", "export", "metrics" };
+static const char* const RESULT_NAMES[] = { "ok", "failed" };
+static MetricsHistogram bleReadMs(BLE_READ_BOUNDS);         // duration of a connection based read
+static MetricsHistogram mqttConnectMs(MQTT_CONNECT_BOUNDS); // duration of a broker connect
+static MetricsHistogram mqttPublishUs(MQTT_PUBLISH_BOUNDS); // duration of a publish
+static MetricsHistogram httpUs[HTTP_ROUTES] = {             // duration of the request handler per route
+  {HTTP_BOUNDS}, {HTTP_BOUNDS}, {HTTP_BOUNDS}, {HTTP_BOUNDS}, {HTTP_BOUNDS}, {HTTP_BOUNDS}
+};
+static MetricsCounter bleReads[2];        // connection based reads, ok and failed
+static MetricsCounter bleRetries;         // connection attempts after the first of a read
+static MetricsCounter mqttConnects[2];    // broker connects, ok and failed
+static MetricsCounter mqttPublishes[2];   // messages published, ok and failed
+static std::atomic<uint32_t> loopLagUs{0}; // longest loop() iteration since the last scrape
+
+// notifications (daily summary and alert events by email or webhook), delivered by the notify worker
+static_assert(NOTIFY_BUDGET + 2 * NOTIFY_TIMEOUT < WDT_TIMEOUT * 1000, "delivery must finish before the watchdog fires");
+static DailySummary dailySummary;     // summary of the running day, taken at config.summaryHour
+static NotifyQueue notifyQueue;       // summaries and alert events not delivered yet
+static notifyTarget_t notifyTarget;   // parsed config.notifyUrl, scheme NOTIFY_NONE if disabled
+static_assert(MAX_SENSORS <= SUMMARY_MAX_SENSORS, "daily summary too small for MAX_SENSORS");
 
 /**
  * @brief Updates the status JSON buffer with current system information and last sensor readings.
+ *
+ * Written with JsonWriter into the fixed buffer, no heap. If names longer
+ * than the STATUS_*_LENGTH limits do not fit, the buffer holds a short
+ * error object with the size needed instead of a cut text.
+ * @param sensorIdx Index of the sensor in the registry
+ * @return false if the status did not fit
  */
-void updateStatusJson() {
-  JsonDocument doc;
+bool updateStatusJson(size_t sensorIdx = 0) {
   time_t now;
   time(&now);
+  const sensorSlot_t& sensor = sensorRegistryGet(sensorIdx);
+  const sensorReadings_t& readings = sensor.readings;
+  JsonWriter json(statusJsonBuffer, sizeof(statusJsonBuffer));
+
+  json.beginObject();
+  json.member("time", now);
+  json.member("name", sensor.name.isEmpty() ? config.name.c_str() : sensor.name.c_str());
+  json.member("status", sensor.status);
+  char addr[BLE_ADDRESS_STR_LENGTH];
+  json.member("bleAddress", bleAddressFormat(sensor.addressKey, addr));
+  json.member("sensorType", sensor.sensorType);
+  if (sensorRegistryCount() > 1) {
+    json.member("sensor", sensorIdx);
+  }
 
-  doc["time"] = now;
-  doc["name"] = config.name;
-  doc["status"] = lastStatus;
-  doc["bleAddress"] = lastBleAddress;
-  doc["sensorType"] = lastSensorType;
-
-  if (lastReadings.type) {
-    doc["type"] = lastReadings.type;
-    doc["pH"] = lastReadings.pH;
-    doc["ec"] = lastReadings.ec;
-    doc["salt"] = lastReadings.salt;
-    doc["tds"] = lastReadings.tds;
-    doc["orp"] = lastReadings.orp;
-    doc["cl"] = lastReadings.cl;
-    doc["temp"] = lastReadings.temp;
-    doc["bat"] = lastReadings.bat;
-    doc["bleRSSI"] = lastReadings.rssi;
+  if (readings.type) {
+    json.member("type", readings.type);
+    json.member("pH", readings.pH());
+    json.member("ec", readings.ec());
+    json.member("salt", readings.salt());
+    json.member("tds", readings.tds());
+    json.member("orp", readings.orp());
+    json.member("cl", readings.cl());
+    json.member("temp", readings.temp());
+    json.member("bat", readings.bat());
+    json.member("bleRSSI", readings.rssi);
+    json.member("bleConnectToData", sensor.link.connectToDataMs);
+    json.member("bleCachedRead", sensor.link.cachedRead);
   } else {
-    doc["type"] = 0;
+    json.member("type", 0);
+  }
+  if (sensor.hasScanStats) {
+    // advertisement statistics of the discovery scans
+    const scanDevice_t& scan = sensor.scanStats;
+    json.member("bleRssiMin", scan.rssiMin);
+    json.member("bleRssiMax", scan.rssiMax);
+    json.member("bleRssiMean", scan.rssiMean());
+    json.member("bleLastSeen", (millis() - scan.lastSeenMs) / 1000);
+  }
+  const readResult_t& read = sensor.link.lastRead;
+  if (read.attempts) {
+    // timing of the last connection based read
+    json.member("bleReadFailed", readPhaseName(read.failedPhase));
+    json.member("bleAttempts", read.attempts);
+    json.member("bleConnectMs", read.connectMs);
+    json.member("bleDiscoverMs", read.discoverMs);
+    json.member("bleReadMs", read.readMs);
+    json.member("bleBackoffMs", read.backoffMs);
+  }
+  if (alertEngine.size()) {
+    // rules of the sensor outside their limits
+    json.beginArray("alerts");
+    for (size_t r = 0; r < alertEngine.size(); r++) {
+      const alertState_t& state = alertEngine.state(sensorIdx, r);
+      if (state.level == ALERT_NORMAL) continue;
+      const alertRule_t& rule = alertEngine.rule(r);
+      char text[ALERT_TEXT_LENGTH];
+      alertText(rule.quantity, state.level, text, sizeof(text));
+      json.beginObject();
+      json.member("type", alertQuantityName(rule.quantity));
+      json.member("level", alertLevelName(state.level));
+      json.member("value", yc01Value(rule.quantity, state.value));
+      json.member("since", state.since);
+      json.member("text", text);
+      json.endObject();
+    }
+    json.endArray();
+  }
+  trendStats_t trendStats[YC01_QUANTITIES];
+  if (trends.get(sensorIdx, trendStats)) {
+    // streaming estimators: mean and sd weighted over the last hour, slope per hour over the last readings
+    json.beginObject("trends");
+    for (size_t q = 0; q < YC01_QUANTITIES; q++) {
+      float step = 0.01f / YC01_FIELDS[q].scale;
+      json.beginObject(alertQuantityName((yc01Quantity_t)q));
+      json.member("mean", roundf(trendStats[q].mean / step) * step);
+      json.member("sd", roundf(trendStats[q].sd / step) * step);
+      json.member("slope", roundf(trendStats[q].slope / step) * step);
+      json.endObject();
+    }
+    json.endObject();
+    json.member("trendSamples", trendStats[0].samples);
+  }
+  json.member("bleDirect", sensor.direct);
+  json.member("bleCycleMs", sensor.cycleMs);
+  json.member("bleRadioMs", sensor.radioMs);
+  if (config.blePersistent) {
+    // persistent link statistics
+    json.member("bleConnected", sensor.link.connected);
+    json.member("bleNotify", sensor.link.notifying);
+    json.member("bleSampleRate", sensor.link.sampleRate);
+    json.member("bleReconnects", sensor.link.reconnects);
   }
 
   // WiFi and MQTT information
-  doc["wifiSSID"] = isCaptive ? config.portalSSID : (isStandby ? "Standby (Offline)" : config.wifiSSID);
-  doc["wifiRSSI"] = (isCaptive || isStandby) ? 0 : WiFi.RSSI();
-  doc["wifiIP"] = isCaptive ? WiFi.softAPIP().toString() : (isStandby ? "0.0.0.0" : WiFi.localIP().toString());
-  doc["mqttServer"] = config.mqttServer;
-  doc["mqttConnected"] = mqttClient.connected();
-  doc["isStandby"] = isStandby;
-  doc["resetReason"] = resetReason;
+  json.member("wifiSSID", isCaptive ? config.portalSSID.c_str() : (isStandby ? "Standby (Offline)" : config.wifiSSID.c_str()));
+  json.member("wifiRSSI", (isCaptive || isStandby) ? 0 : WiFi.RSSI());
+  char ip[16];
+  IPAddress address = isCaptive ? WiFi.softAPIP() : (isStandby ? IPAddress(0, 0, 0, 0) : WiFi.localIP());
+  snprintf(ip, sizeof(ip), "%u.%u.%u.%u", address[0], address[1], address[2], address[3]);
+  json.member("wifiIP", ip);
+  json.member("mqttServer", config.mqttServer.c_str());
+  json.member("mqttConnected", mqttClient.connected());
+  json.member("mqttQueued", mqttQueue.size());
+  json.member("mqttDropped", mqttQueue.dropped());
+  json.member("mqttDrainRate", mqttDrainRate);
+  if (notifyTarget.scheme != NOTIFY_NONE) {
+    json.member("notifyQueued", notifyQueue.size());
+    json.member("notifySent", notifyQueue.sent());
+    json.member("notifyFailed", notifyQueue.failed());
+    json.member("summaryNext", dailySummary.next());
+  }
+  json.member("isStandby", isStandby);
+  json.member("resetReason", resetReason.c_str());
+  json.member("loopMaxUs", loopMaxUs);
+  json.member("heapFree", ESP.getFreeHeap());
+  json.member("historyCount", readingHistory.size());
+  const ResponseCache& cache = responseCacheStats();
+  json.member("httpRequests", cache.requests());
+  json.member("httpNotModified", cache.hits());
+  json.member("httpBuilds", cache.builds());
+  json.member("liveClients", liveSocket.count());
+  json.member("livePushes", livePush.pushes());
+  json.member("liveDropped", livePush.drops());
+  json.member("liveLatencyMs", livePush.latencyMaxMs());
+  json.member("liveFanoutUs", liveFanoutMaxUs);
+  json.endObject();
+
+  bool fits = !json.overflowed();
+  size_t length = json.length();
+  if (!fits) {
+    // valid JSON for all consumers instead of a cut text
+    Serial.print("Status JSON too long: "); Serial.print(length);
+    Serial.print(" of "); Serial.print(sizeof(statusJsonBuffer) - 1); Serial.println(" bytes");
+    JsonWriter error(statusJsonBuffer, sizeof(statusJsonBuffer));
+    error.beginObject();
+    error.member("time", now);
+    error.member("status", "status too long");
+    error.member("statusLength", length);
+    error.endObject();
+    length = error.length();
+  }
+  responseCacheStore(sensorIdx, statusJsonBuffer, length);
+  return fits;
+}
+
+/**
+ * @brief Marks the status of all sensors as changed (connectivity, standby).
+ *
+ * The cached /status is rebuilt once it is requested again, the dashboards
+ * on /live get a push.
+ */
+void statusChanged() {
+  responseCacheInvalidate();
+  livePush.changedAll(millis());
+}
 
-  serializeJson(doc, statusJsonBuffer, BUFFER_SIZE);
+/**
+ * @brief Rebuilds the cached /status of the sensors requested while out of date.
+ *
+ * The /status handler runs on the web server task and only serves the
+ * cached body; building it there would race with the loop, which writes
+ * statusJsonBuffer for MQTT and /live. A request that finds its body out of
+ * date gets the previous one, the next request the rebuilt one.
+ */
+void statusLoop() {
+  uint32_t wanted = statusWanted.exchange(0);
+  for (size_t i = 0; wanted && i < sensorRegistryCount(); i++) {
+    if ((wanted & (1u << i)) && !responseCacheFresh(i, STATUS_MAX_AGE)) {
+      updateStatusJson(i);
+    }
+  }
+}
+
+/**
+ * @brief Pushes the status of a changed sensor to the dashboards on /live.
+ *
+ * The status is built once on the loop, which owns statusJsonBuffer, and
+ * textAll() copies it into one message queued for every client, so later
+ * builds do not touch messages still being sent.
+ * A client that does not read fast enough fills its queue
+ * (WS_MAX_QUEUED_MESSAGES) and is closed by the web server, its dashboard
+ * reconnects and falls back to polling meanwhile.
+ */
+void liveLoop() {
+  static uint32_t lastCleanup = 0;
+  uint32_t nowMs = millis();
+  if (nowMs - lastCleanup >= 1000) {
+    // free closed clients, close the oldest beyond the limit
+    lastCleanup = nowMs;
+    liveSocket.cleanupClients(LIVE_MAX_CLIENTS);
+  }
+  if (liveJoined) {
+    liveJoined = false;
+    livePush.changedAll(nowMs);
+  }
+
+  size_t clients = liveSocket.count();
+  int slot = livePush.next(sensorRegistryCount(), clients, nowMs, LIVE_MIN_GAP, LIVE_HEARTBEAT);
+  if (slot < 0) {
+    return;
+  }
+  uint32_t start = micros();
+  updateStatusJson(slot);
+  size_t length = strlen(statusJsonBuffer);
+  if (liveSocket.textAll(statusJsonBuffer, length) != AsyncWebSocket::ENQUEUED) {
+    // queue of a slow client full, it was closed
+    size_t connected = liveSocket.count();
+    livePush.dropped(clients > connected ? clients - connected : 1);
+  }
+  livePush.sent(slot, clients, length, nowMs);
+  uint32_t fanoutUs = micros() - start;
+  if (fanoutUs > liveFanoutMaxUs) liveFanoutMaxUs = fanoutUs;
 }
 
 /**
@@ -120,6 +459,9 @@ void requestReboot(String reason, uint32_t delayMs) {
   Serial.print("Reboot requested. Reason: ");
   Serial.println(reason);
   Serial.flush();
+
+  // the loop writes the batched readings before the restart
+  logFlushRequested = true;
   
   // MQTT cleanup
   if (mqttClient.connected()) {
@@ -133,6 +475,34 @@ void requestReboot(String reason, uint32_t delayMs) {
   });
 }
 
+/**
+ * @brief Connects to the MQTT broker, timed and counted for /metrics.
+ * @return true if connected
+ */
+bool mqttConnect() {
+  uint32_t start = millis();
+  mqttClient.setServer(config.mqttServer.c_str(), config.mqttPort);
+  bool connected = mqttClient.connect("BLE-YC01", config.mqttUser.c_str(), config.mqttPassword.c_str());
+  mqttConnectMs.record(millis() - start);
+  mqttConnects[connected ? 0 : 1].add();
+  return connected;
+}
+
+/**
+ * @brief Publishes a message, timed and counted for /metrics.
+ * @param topic Topic
+ * @param payload Payload
+ * @param retained true to retain the message on the broker
+ * @return true if the broker accepted the message
+ */
+bool mqttPublish(const char* topic, const char* payload, bool retained = false) {
+  uint32_t start = micros();
+  bool published = mqttClient.publish(topic, payload, retained);
+  mqttPublishUs.record(micros() - start);
+  mqttPublishes[published ? 0 : 1].add();
+  return published;
+}
+
 /**
  * @brief Handles the MQTT client loop.
  * 
@@ -152,9 +522,9 @@ void mqttLoop() {
       if ( uptime - lastMqttRetry > 10 ) {
         lastMqttRetry = uptime;
         DEBUG_print("connecting to MQTT-broker... ");
-        mqttClient.setServer(config.mqttServer.c_str(), config.mqttPort);
-        if ( mqttClient.connect("BLE-YC01", config.mqttUser.c_str(), config.mqttPassword.c_str()) ) {
+        if ( mqttConnect() ) {
           mqttClient.loop();
+          statusChanged();
           DEBUG_println("ok");
         } else {
           DEBUG_print("error, rc=");
@@ -166,8 +536,260 @@ void mqttLoop() {
     // Disconnect if we are no longer in a state where MQTT should be active
     DEBUG_println("MQTT deactivated (WiFi lost, Standby or Captive Portal), disconnecting...");
     mqttClient.disconnect();
+    statusChanged();
   }
 }
+
+/**
+ * @brief Gets the MQTT topic of a sensor.
+ *
+ * With a single sensor this is the configured topic, with several sensors
+ * "<mqttTopic>/<sensor index>".
+ * @param sensorIdx Index of the sensor in the registry
+ * @return String
+ */
+String mqttSensorTopic(size_t sensorIdx) {
+  String topic = config.mqttTopic;
+  if (sensorRegistryCount() > 1) {
+    topic += "/" + String(sensorIdx);
+  }
+  return topic;
+}
+
+/**
+ * @brief Publishes the status JSON of a sensor via MQTT (see mqttSensorTopic).
+ * @param sensorIdx Index of the sensor in the registry
+ * @return true if the broker accepted the message
+ */
+bool publishStatus(size_t sensorIdx) {
+  if ( !config.mqttPort || isCaptive || isStandby || !WiFi.isConnected() ) {
+    return false;
+  }
+
+  if ( !mqttClient.connected() ) {
+    DEBUG_print("connecting to MQTT-broker... ");
+    if ( mqttConnect() ) {
+      mqttClient.loop();
+      DEBUG_println("ok");
+      updateStatusJson(sensorIdx); // update buffer with "connected" status
+    } else {
+      DEBUG_print("error, rc=");
+      DEBUG_println(mqttClient.state());
+    }
+  }
+  if ( !mqttClient.connected() ) {
+    return false;
+  }
+  bool published = mqttPublish(mqttSensorTopic(sensorIdx).c_str(), statusJsonBuffer);
+  mqttClient.loop();
+  return published;
+}
+
+/**
+ * @brief Publishes the bucket of a sensor closed last via MQTT.
+ *
+ * The topic is the status topic of the sensor (see mqttSensorTopic) followed
+ * by "/rollup/hour" or "/rollup/day". Called after publishStatus, which
+ * connects to the broker.
+ * @param sensorIdx Index of the sensor in the registry
+ * @param tier Rollup tier
+ */
+void publishRollup(size_t sensorIdx, rollupTier_t tier) {
+  rollupBucket_t bucket;
+  if ( !mqttClient.connected() || !rollups.get(sensorIdx, tier, rollups.closed(sensorIdx, tier), bucket) ) {
+    return;
+  }
+
+  char payload[ROLLUP_LINE_LENGTH];
+  rollupFormat(bucket, payload, sizeof(payload));
+  String topic = mqttSensorTopic(sensorIdx);
+  topic += "/rollup/";
+  topic += rollupTierName(tier);
+  mqttPublish(topic.c_str(), payload);
+  mqttClient.loop();
+}
+
+/**
+ * @brief Publishes an alert or recovery event via MQTT.
+ *
+ * The topic is the status topic of the sensor (see mqttSensorTopic) followed
+ * by "/alert/<type>", e.g. "/alert/temp". The message is retained, so a
+ * client subscribing later sees the current level of every rule.
+ * @param event Event
+ * @return true if the broker accepted the message
+ */
+bool publishAlert(const alertEvent_t& event) {
+  if ( !mqttClient.connected() ) {
+    return false;
+  }
+  const alertRule_t& rule = alertEngine.rule(event.rule);
+  char payload[ALERT_LINE_LENGTH];
+  alertFormat(event, rule, payload, sizeof(payload));
+  String topic = mqttSensorTopic(event.sensor);
+  topic += "/alert/";
+  topic += alertQuantityName(rule.quantity);
+  bool published = mqttPublish(topic.c_str(), payload, true);
+  mqttClient.loop();
+  return published;
+}
+
+/**
+ * @brief Republishes the current level of every rule of a sensor.
+ *
+ * Used after an event could not be published (standby, broker
+ * unreachable), so the retained alert topics match the state again.
+ * @param sensorIdx Index of the sensor in the registry
+ * @return true if all messages were accepted
+ */
+bool publishAlertState(uint8_t sensorIdx) {
+  for (size_t r = 0; r < alertEngine.size(); r++) {
+    const alertState_t& state = alertEngine.state(sensorIdx, r);
+    alertEvent_t event = {state.since, sensorIdx, (uint8_t)r, state.level, state.level, state.value};
+    if ( !publishAlert(event) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Fills the sensor names of the notifications, indexed by sensor.
+ * @param names Output, MAX_SENSORS entries
+ */
+static void notifyNames(const char* names[]) {
+  for (size_t i = 0; i < MAX_SENSORS; i++) {
+    if (i >= sensorRegistryCount()) {
+      names[i] = "";
+    } else {
+      const sensorSlot_t& sensor = sensorRegistryGet(i);
+      names[i] = sensor.name.isEmpty() ? config.name.c_str() : sensor.name.c_str();
+    }
+  }
+}
+
+/**
+ * @brief Takes the daily summary and queues it for delivery.
+ * @param now End of the summary period (UTC seconds)
+ * @param print Print the summary on the serial console
+ */
+static void queueSummary(uint32_t now, bool print) {
+  static summaryReport_t report;
+  dailySummary.take(now, report);
+  if (print) {
+    static char text[NOTIFY_BODY_LENGTH];
+    const char* names[MAX_SENSORS];
+    notifyNames(names);
+    summaryFormatText(report, names, text, sizeof(text));
+    Serial.println(text);
+  }
+  if (notifyTarget.scheme != NOTIFY_NONE) {
+    notifyQueue.pushSummary(report, millis());
+  }
+  Serial.print("Daily summary: "); Serial.println(summaryStatusName(summaryOverall(report)));
+}
+
+/**
+ * @brief Takes the daily summary when due and hands the queued notifications to the notify worker.
+ *
+ * Everything queued goes out as one email or POST. The loop only formats the
+ * batch and posts it; the worker task connects and sends it, and the loop
+ * applies the outcome once it arrives. A failure is retried with a growing
+ * backoff (see NotifyQueue).
+ */
+void notifyLoop() {
+  time_t now;
+  time(&now);
+  if (dailySummary.due(now)) {
+    queueSummary(now, false);
+  }
+
+  notifyResult_t result;
+  if (notifyWorkerReceive(result)) {
+    notifyQueue.finish(millis(), result.ok);
+    if (result.ok) {
+      Serial.print("Notification delivered in "); Serial.print(result.durationMs); Serial.println(" ms");
+    } else {
+      Serial.print("Notification failed after "); Serial.print(result.durationMs); Serial.print(" ms: ");
+      Serial.print(result.reply);
+      Serial.print(", retry in "); Serial.print(notifyQueue.retryMs() / 1000); Serial.println(" s");
+    }
+  }
+  if (notifyTarget.scheme == NOTIFY_NONE || isCaptive || isStandby || !WiFi.isConnected() || !notifyQueue.due(millis())) {
+    return;
+  }
+
+  const char* names[MAX_SENSORS];
+  notifyNames(names);
+  const char* device = config.name.isEmpty() ? "BLE-YC01" : config.name.c_str();
+  notifyJob_t job;
+  job.length = notifyQueue.take(millis(), notifyTarget.scheme == NOTIFY_HTTP, device, names);
+  job.subject = notifyQueue.batchSubject();
+  job.body = notifyQueue.batchBody();
+  if (!notifyWorkerSend(job)) {
+    notifyQueue.finish(millis(), false); // worker not running, retried with the backoff
+  }
+}
+
+/**
+ * @brief Queues a reading that could not be published.
+ * @param record Reading with its original timestamp
+ */
+void mqttEnqueue(const historyRecord_t& record) {
+  if ( !mqttQueue.push(record) ) {
+    Serial.println(F("MQTT queue write failed, reading dropped"));
+  }
+  DEBUG_print("MQTT queue: "); DEBUG_print(mqttQueue.size()); DEBUG_println(" readings");
+}
+
+/**
+ * @brief Replays queued readings while the broker is connected.
+ *
+ * Every MQTT_DRAIN_INTERVAL at most MQTT_QUEUE_BATCH readings are published
+ * to the topic of their sensor, as /history record with the original
+ * timestamp and "queued":true, so a long backlog does not starve the loop.
+ * A batch stops at the first message PubSubClient does not accept (TCP
+ * buffer full or connection lost); the rest is retried with the next batch.
+ */
+void mqttDrain() {
+  static uint32_t lastDrain = 0;
+  if ( mqttQueue.empty() || !mqttClient.connected() || millis() - lastDrain < MQTT_DRAIN_INTERVAL ) {
+    return;
+  }
+  lastDrain = millis();
+  if ( !mqttDrainStart ) {
+    mqttDrainStart = millis();
+    mqttDrainSent = 0;
+    Serial.print("MQTT queue: replaying "); Serial.print(mqttQueue.size()); Serial.println(" readings");
+  }
+
+  historyRecord_t records[MQTT_QUEUE_BATCH];
+  size_t count = mqttQueue.peek(records, MQTT_QUEUE_BATCH);
+  size_t sent = 0;
+  char payload[HISTORY_LINE_LENGTH + 16];
+  while ( sent < count ) {
+    size_t length = historyFormat(records[sent], HISTORY_FIELD_ALL, HISTORY_FORMAT_JSON, payload, HISTORY_LINE_LENGTH);
+    strcpy(payload + length - 1, ",\"queued\":true}");
+    if ( !mqttPublish(mqttSensorTopic(records[sent].sensor).c_str(), payload) ) {
+      break;
+    }
+    sent++;
+  }
+  mqttClient.loop();
+  mqttQueue.pop(sent);
+  if ( !mqttQueue.commit() ) {
+    Serial.println(F("MQTT queue: failed to save position"));
+  }
+
+  mqttDrainSent += sent;
+  uint32_t elapsed = millis() - mqttDrainStart;
+  mqttDrainRate = elapsed ? mqttDrainSent * 1000.0f / elapsed : 0;
+  if ( mqttQueue.empty() ) {
+    Serial.print("MQTT queue: "); Serial.print(mqttDrainSent); Serial.print(" readings replayed in ");
+    Serial.print(elapsed); Serial.print(" ms, "); Serial.print(mqttDrainRate, 1); Serial.println(" readings/s");
+    mqttDrainStart = 0;
+  }
+}
+
 /**
  * @brief HTTP GET handler for commands via /cmd endpoint.
  * @param request Pointer to AsyncWebServerRequest
@@ -190,15 +812,191 @@ void handleCmd(AsyncWebServerRequest *request)
     requestReboot("Web Command"); 
   } else if (param == "scan" && val) {
     // re-scan
-    config.bleAddress = ""; // reset address to force re-scan
-    lastScan = -config.interval; // reset last scan time
+    requestForget(); // release adopted addresses to force re-scan
   } else if (param == "read" && val) {
-    lastScan = -config.interval; // reset last scan time
+    requestReadAll();
   }
 
   request->send(200, "text/plain", "");
 }
 
+/**
+ * @brief HTTP GET handler for the reading history via /history endpoint.
+ *
+ * Parameters (all optional): from, to (UTC seconds, inclusive), fields
+ * (comma separated names as in /status), sensor (registry index).
+ * The records are streamed in chunks, the response is never held in memory.
+ * @param request Pointer to AsyncWebServerRequest
+ */
+void handleHistory(AsyncWebServerRequest *request)
+{
+  uint32_t from = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), NULL, 10) : 0;
+  uint32_t to = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), NULL, 10) : UINT32_MAX;
+  uint16_t fields = historyParseFields(request->hasParam("fields") ? request->getParam("fields")->value().c_str() : "");
+  int sensor = request->hasParam("sensor") ? request->getParam("sensor")->value().toInt() : -1;
+  if (!fields) {
+    request->send(400, "text/plain", "Bad Request: Unknown field");
+    return;
+  }
+  if (sensor >= (int)sensorRegistryCount()) {
+    request->send(404, "text/plain", "Unknown sensor");
+    return;
+  }
+
+  // the query lives as long as the response
+  std::shared_ptr<HistoryQuery> query = std::make_shared<HistoryQuery>(readingHistory, from, to, fields, sensor);
+  request->send(request->beginChunkedResponse("application/json", [query](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+    return query->read(buffer, maxLen);
+  }));
+}
+
+/**
+ * @brief HTTP GET handler for the export of the reading log via /export endpoint.
+ *
+ * Parameters (all optional): format ("csv" or "ndjson", default "csv"), and
+ * from, to, fields, sensor as for /history. The loop first writes the
+ * readings batched in RAM, then the log is streamed from flash in chunks.
+ * The chunks are filled on the web server task while the loop appends, so
+ * the query only uses the reader side of ReadingLog (see readingLog.h).
+ * Throughput and the lowest free heap seen are printed when it is complete.
+ * @param request Pointer to AsyncWebServerRequest
+ */
+void handleExport(AsyncWebServerRequest *request)
+{
+  exportFormat_t format = EXPORT_CSV;
+  if (request->hasParam("format") && !exportParseFormat(request->getParam("format")->value().c_str(), format)) {
+    request->send(400, "text/plain", "Bad Request: Unknown format");
+    return;
+  }
+  uint32_t from = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), NULL, 10) : 0;
+  uint32_t to = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), NULL, 10) : UINT32_MAX;
+  uint16_t fields = historyParseFields(request->hasParam("fields") ? request->getParam("fields")->value().c_str() : "");
+  int sensor = request->hasParam("sensor") ? request->getParam("sensor")->value().toInt() : -1;
+  if (!fields) {
+    request->send(400, "text/plain", "Bad Request: Unknown field");
+    return;
+  }
+  if (sensor >= (int)sensorRegistryCount()) {
+    request->send(404, "text/plain", "Unknown sensor");
+    return;
+  }
+
+  exportFlushRequested = true;
+  std::shared_ptr<ExportQuery> query = std::make_shared<ExportQuery>(readingLog, format, from, to, fields, sensor);
+  uint32_t startMs = millis();
+  uint32_t minHeap = ESP.getFreeHeap();
+  request->send(request->beginChunkedResponse(exportContentType(format), [query, startMs, minHeap](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+    if (exportFlushRequested) return RESPONSE_TRY_AGAIN; // the loop is still writing the batch
+    size_t length = query->read(buffer, maxLen);
+    uint32_t heap = ESP.getFreeHeap();
+    if (heap < minHeap) minHeap = heap;
+    if (length) return length;
+    if (!query->done()) return RESPONSE_TRY_AGAIN; // nothing matched in this chunk
+    uint32_t ms = millis() - startMs;
+    DEBUG_print("export: "); DEBUG_print(query->records()); DEBUG_print(" records, "); DEBUG_print(query->bytes());
+    DEBUG_print(" bytes in "); DEBUG_print(ms); DEBUG_print(" ms, "); DEBUG_print(query->bytes() * 1000 / (ms ? ms : 1));
+    DEBUG_print(" bytes/s, min free heap: "); DEBUG_println(minHeap);
+    return 0;
+  }));
+}
+
+/**
+ * @brief HTTP GET handler for the hourly/daily rollups via /rollups endpoint.
+ *
+ * Parameters (all optional): sensor (registry index, default 0), tier
+ * ("hour" or "day", default "hour"). The buckets are streamed oldest first.
+ * @param request Pointer to AsyncWebServerRequest
+ */
+void handleRollups(AsyncWebServerRequest *request)
+{
+  size_t sensor = request->hasParam("sensor") ? request->getParam("sensor")->value().toInt() : 0;
+  rollupTier_t tier = ROLLUP_HOUR;
+  if (request->hasParam("tier") && !rollupParseTier(request->getParam("tier")->value().c_str(), tier)) {
+    request->send(400, "text/plain", "Bad Request: Unknown tier");
+    return;
+  }
+  if (sensor >= sensorRegistryCount()) {
+    request->send(404, "text/plain", "Unknown sensor");
+    return;
+  }
+
+  std::shared_ptr<RollupQuery> query = std::make_shared<RollupQuery>(rollups, sensor, tier);
+  request->send(request->beginChunkedResponse("application/json", [query](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+    return query->read(buffer, maxLen);
+  }));
+}
+
+// metric families of /metrics, values are read while the response is streamed
+static const metricFamily_t METRIC_FAMILIES[] = {
+  { "yc01_ble_read_duration_seconds", "Duration of a connection based sensor read.", METRIC_HISTOGRAM, 1000,
+    nullptr, nullptr, 1, nullptr, &bleReadMs },
+  { "yc01_ble_reads_total", "Connection based sensor reads by result.", METRIC_COUNTER, 1,
+    "result", RESULT_NAMES, 2, [](size_t s) { return bleReads[s].value(); }, nullptr },
+  { "yc01_ble_read_retries_total", "Connection attempts after the first of a read.", METRIC_COUNTER, 1,
+    nullptr, nullptr, 1, [](size_t) { return bleRetries.value(); }, nullptr },
+  { "yc01_ble_checksum_errors_total", "Sensor frames rejected for a checksum mismatch.", METRIC_COUNTER, 1,
+    nullptr, nullptr, 1, [](size_t) { return BLE_YC01::getChecksumErrors(); }, nullptr },
+  { "yc01_mqtt_connect_duration_seconds", "Duration of a connect to the MQTT broker.", METRIC_HISTOGRAM, 1000,
+    nullptr, nullptr, 1, nullptr, &mqttConnectMs },
+  { "yc01_mqtt_connects_total", "Connects to the MQTT broker by result.", METRIC_COUNTER, 1,
+    "result", RESULT_NAMES, 2, [](size_t s) { return mqttConnects[s].value(); }, nullptr },
+  { "yc01_mqtt_publish_duration_seconds", "Duration of an MQTT publish.", METRIC_HISTOGRAM, 1000000,
+    nullptr, nullptr, 1, nullptr, &mqttPublishUs },
+  { "yc01_mqtt_publishes_total", "MQTT messages by result.", METRIC_COUNTER, 1,
+    "result", RESULT_NAMES, 2, [](size_t s) { return mqttPublishes[s].value(); }, nullptr },
+  { "yc01_http_request_duration_seconds", "Duration of the request handler by route, streamed bodies not included.", METRIC_HISTOGRAM, 1000000,
+    "route", HTTP_ROUTE_NAMES, HTTP_ROUTES, nullptr, httpUs },
+  { "yc01_heap_free_bytes", "Free heap.", METRIC_GAUGE, 1,
+    nullptr, nullptr, 1, [](size_t) { return ESP.getFreeHeap(); }, nullptr },
+  { "yc01_heap_largest_free_block_bytes", "Largest block that can be allocated.", METRIC_GAUGE, 1,
+    nullptr, nullptr, 1, [](size_t) { return ESP.getMaxAllocHeap(); }, nullptr },
+  { "yc01_loop_lag_seconds", "Longest loop() iteration since the last scrape.", METRIC_GAUGE, 1000000,
+    nullptr, nullptr, 1, [](size_t) { return loopLagUs.exchange(0, std::memory_order_relaxed); }, nullptr },
+};
+
+/**
+ * @brief HTTP GET handler for the telemetry via /metrics endpoint (Prometheus text format).
+ *
+ * The exposition is generated line by line while the response is sent.
+ * @param request Pointer to AsyncWebServerRequest
+ */
+void handleMetrics(AsyncWebServerRequest *request)
+{
+  std::shared_ptr<MetricsQuery> query = std::make_shared<MetricsQuery>(METRIC_FAMILIES, sizeof(METRIC_FAMILIES) / sizeof(METRIC_FAMILIES[0]));
+  request->send(request->beginChunkedResponse("text/plain; version=0.0.4", [query](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+    return query->read(buffer, maxLen);
+  }));
+}
+
+/**
+ * @brief Wraps a request handler, its duration is recorded per route for /metrics.
+ * @param route Route
+ * @param handler Request handler
+ * @return ArRequestHandlerFunction
+ */
+ArRequestHandlerFunction timedHandler(httpRoute_t route, ArRequestHandlerFunction handler)
+{
+  return [route, handler](AsyncWebServerRequest *request) {
+    uint32_t start = micros();
+    handler(request);
+    httpUs[route].record(micros() - start);
+  };
+}
+
+/**
+ * @brief Saves the rollups, at most once per hour unless forced.
+ * @param force Save even if already saved this hour (before a reboot)
+ */
+static void saveRollups(bool force) {
+  uint32_t hour = rollups.lastTime() / 3600;
+  if (!force && hour == rollupSavedHour) return;
+  if (rollups.save(logFiles)) {
+    rollupSavedHour = hour;
+  } else {
+    Serial.println(F("Failed to save rollups"));
+  }
+}
+
 /**
  * @brief Reads the configuration from LittleFS (config.json).
  */
@@ -222,9 +1020,73 @@ void readConfig()
   config.mqttTopic = doc["mqttTopic"] | "/esp32/sensor/ble-yc01";
   config.mqttUser = doc["mqttUser"] | "";
   config.mqttPassword = doc["mqttPassword"] | "";
+  config.mqttRollups = doc["mqttRollups"] | false;
   config.interval = doc["interval"] | 900;
   config.name = doc["name"] | "";
   config.bleAddress = doc["bleAddress"] | "";
+  config.blePersistent = doc["blePersistent"] | false;
+  config.notifyUrl = doc["notifyUrl"] | "";
+  config.notifyUser = doc["notifyUser"] | "";
+  config.notifyPassword = doc["notifyPassword"] | "";
+  config.notifyFrom = doc["notifyFrom"] | "";
+  config.notifyTo = doc["notifyTo"] | "";
+  config.summaryHour = doc["summaryHour"] | 9;
+  config.utcOffset = doc["utcOffset"] | 0;
+  config.heartbeat = doc["heartbeat"] | 60;
+
+  // sensor registry: either the "sensors" array or a single entry from the fields above
+  JsonArrayConst sensors = doc["sensors"].as<JsonArrayConst>();
+  config.sensorCount = 0;
+  for (JsonObjectConst sensor : sensors) {
+    if (config.sensorCount >= MAX_SENSORS) {
+      Serial.println(F("Too many sensors configured, ignoring the rest"));
+      break;
+    }
+    sensorConfig_t& entry = config.sensors[config.sensorCount++];
+    entry.bleAddress = sensor["bleAddress"] | "";
+    entry.name = sensor["name"] | "";
+    entry.interval = sensor["interval"] | 0;
+  }
+  if (config.sensorCount == 1) {
+    // a single entry is equivalent to the plain fields
+    if (!config.sensors[0].bleAddress.isEmpty()) config.bleAddress = config.sensors[0].bleAddress;
+    if (!config.sensors[0].name.isEmpty()) config.name = config.sensors[0].name;
+    if (config.sensors[0].interval) config.interval = config.sensors[0].interval;
+  }
+  if (config.sensorCount <= 1) {
+    config.sensorCount = 1;
+    config.sensors[0].bleAddress = config.bleAddress;
+    config.sensors[0].name = config.name;
+    config.sensors[0].interval = config.interval;
+  }
+  // threshold alerts, limits in the units of /status
+  JsonArrayConst alerts = doc["alerts"].as<JsonArrayConst>();
+  config.alertCount = 0;
+  for (JsonObjectConst alert : alerts) {
+    yc01Quantity_t quantity;
+    if (config.alertCount >= ALERT_MAX_RULES) {
+      Serial.println(F("Too many alerts configured, ignoring the rest"));
+      break;
+    }
+    if (!alertParseQuantity(alert["type"] | "", quantity)) {
+      Serial.print(F("Unknown alert type ignored: ")); Serial.println(alert["type"] | "");
+      continue;
+    }
+    alertRule_t& rule = config.alerts[config.alertCount++];
+    rule.quantity = quantity;
+    rule.min = alert["min"].isNull() ? ALERT_NO_MIN : alertToRaw(quantity, alert["min"].as<float>());
+    rule.max = alert["max"].isNull() ? ALERT_NO_MAX : alertToRaw(quantity, alert["max"].as<float>());
+    rule.hysteresis = alertToRaw(quantity, alert["hysteresis"] | 0.0f);
+    rule.debounce = alert["debounce"] | 1;
+  }
+
+  // parse the addresses once, matching compares the keys
+  for (uint8_t i = 0; i < config.sensorCount; i++) {
+    sensorConfig_t& entry = config.sensors[i];
+    if (!bleAddressParse(entry.bleAddress.c_str(), BLE_ADDRESS_TYPE_ANY, entry.addressKey) && !entry.bleAddress.isEmpty()) {
+      Serial.print(F("Invalid BLE address ignored: ")); Serial.println(entry.bleAddress);
+    }
+  }
   file.close();
 
 
@@ -249,9 +1111,35 @@ void readConfig()
   #else
     DEBUG_println("  mqttPassword: ***");
   #endif  
+  DEBUG_print("  mqttRollups: "); DEBUG_println(config.mqttRollups);
   DEBUG_print("  interval: "); DEBUG_println(config.interval);
   DEBUG_print("  name: "); DEBUG_println(config.name);
   DEBUG_print("  address: "); DEBUG_println(config.bleAddress);
+  DEBUG_print("  blePersistent: "); DEBUG_println(config.blePersistent);
+  DEBUG_print("  notifyUrl: "); DEBUG_println(config.notifyUrl);
+  DEBUG_print("  notifyUser: "); DEBUG_println(config.notifyUser);
+  #if DEBUG_SECURITY
+    DEBUG_print("  notifyPassword: "); DEBUG_println(config.notifyPassword);
+  #else
+    DEBUG_println("  notifyPassword: ***");
+  #endif
+  DEBUG_print("  notifyFrom: "); DEBUG_println(config.notifyFrom);
+  DEBUG_print("  notifyTo: "); DEBUG_println(config.notifyTo);
+  DEBUG_print("  summaryHour: "); DEBUG_println(config.summaryHour);
+  DEBUG_print("  utcOffset: "); DEBUG_println(config.utcOffset);
+  DEBUG_print("  heartbeat: "); DEBUG_println(config.heartbeat);
+  for (uint8_t i = 0; config.sensorCount > 1 && i < config.sensorCount; i++) {
+    DEBUG_print("  sensor "); DEBUG_print(i); DEBUG_print(": ");
+    DEBUG_print(config.sensors[i].name); DEBUG_print(" ("); DEBUG_print(config.sensors[i].bleAddress);
+    DEBUG_print(") interval: "); DEBUG_println(config.sensors[i].interval);
+  }
+  for (uint8_t i = 0; i < config.alertCount; i++) {
+    String alert;
+    JsonDocument alertDoc;
+    alertRuleToJson(config.alerts[i], alertDoc.to<JsonObject>());
+    serializeJson(alertDoc, alert);
+    DEBUG_print("  alert: "); DEBUG_println(alert);
+  }
   DEBUG_println("");
 }
 
@@ -274,9 +1162,34 @@ void saveConfig() {
   doc["mqttTopic"]      = config.mqttTopic;
   doc["mqttUser"]       = config.mqttUser;
   doc["mqttPassword"]   = config.mqttPassword;
+  doc["mqttRollups"]    = config.mqttRollups;
   doc["interval"]       = config.interval;
   doc["name"]           = config.name;
   doc["bleAddress"]           = config.bleAddress;
+  doc["blePersistent"]  = config.blePersistent;
+  doc["notifyUrl"]      = config.notifyUrl;
+  doc["notifyUser"]     = config.notifyUser;
+  doc["notifyPassword"] = config.notifyPassword;
+  doc["notifyFrom"]     = config.notifyFrom;
+  doc["notifyTo"]       = config.notifyTo;
+  doc["summaryHour"]    = config.summaryHour;
+  doc["utcOffset"]      = config.utcOffset;
+  doc["heartbeat"]      = config.heartbeat;
+  if (config.sensorCount > 1) {
+    JsonArray sensors = doc["sensors"].to<JsonArray>();
+    for (uint8_t i = 0; i < config.sensorCount; i++) {
+      JsonObject sensor = sensors.add<JsonObject>();
+      sensor["bleAddress"] = config.sensors[i].bleAddress;
+      sensor["name"]       = config.sensors[i].name;
+      sensor["interval"]   = config.sensors[i].interval;
+    }
+  }
+  if (config.alertCount) {
+    JsonArray alerts = doc["alerts"].to<JsonArray>();
+    for (uint8_t i = 0; i < config.alertCount; i++) {
+      alertRuleToJson(config.alerts[i], alerts.add<JsonObject>());
+    }
+  }
 
   // write config file
   File file = LittleFS.open("/config.json", "w");
@@ -288,6 +1201,7 @@ void saveConfig() {
     Serial.println(F("Failed to write config to file"));
   }
   file.close();
+  responseCacheInvalidate();
 }
 
 
@@ -327,6 +1241,56 @@ void setup()
 
   // read config
   readConfig();
+  alertEngine.begin(config.alerts, config.alertCount);
+  if (notifyParseTarget(config.notifyUrl.c_str(), config.notifyUser.c_str(), config.notifyPassword.c_str(),
+      config.notifyFrom.c_str(), config.notifyTo.c_str(), notifyTarget)) {
+    Serial.print("Notifications to "); Serial.println(notifyTarget.host);
+  } else if (!config.notifyUrl.isEmpty()) {
+    Serial.println(F("Invalid notifyUrl (or notifyFrom/notifyTo missing), notifications disabled"));
+  }
+  dailySummary.begin(config.sensorCount, config.summaryHour, config.utcOffset, config.heartbeat * 60);
+  notifyQueue.begin(config.utcOffset);
+
+  // recover the reading log, its newest segment refills the history
+  if (readingLog.begin(logFiles, [](const historyRecord_t& record) { readingHistory.append(record); })) {
+    const logRecovery_t& recovery = readingLog.recovery();
+    Serial.print("Reading log: segment "); Serial.print(recovery.sequence);
+    Serial.print(", "); Serial.print(recovery.records);
+    Serial.println(recovery.torn ? " records, torn tail sealed" : " records");
+  } else {
+    Serial.println(F("init reading log error"));
+  }
+
+  // restore the rollups and add the readings of the history not saved with them
+  rollups.begin(config.sensorCount);
+  bool rollupsLoaded = rollups.load(logFiles);
+  uint32_t replayed = 0;
+  for (uint32_t seq = readingHistory.lowerBound(rollups.lastTime() + 1); seq != readingHistory.end(); seq++) {
+    historyRecord_t record;
+    if (readingHistory.get(seq, record)) {
+      rollups.add(record);
+      replayed++;
+    }
+  }
+  rollupSavedHour = rollups.lastTime() / 3600;
+  Serial.print(rollupsLoaded ? "Rollups restored, " : "Rollups empty, ");
+  Serial.print(replayed); Serial.println(" readings replayed");
+
+  // the trends start from the history, older readings have faded out of the EWMA anyway
+  trends.begin();
+  for (uint32_t seq = readingHistory.begin(); seq != readingHistory.end(); seq++) {
+    historyRecord_t record;
+    if (readingHistory.get(seq, record)) {
+      trends.add(record);
+    }
+  }
+
+  // readings not published before the reboot are replayed once the broker is connected
+  if (!mqttQueue.begin(logFiles)) {
+    Serial.println(F("init MQTT queue error"));
+  }
+  Serial.print("MQTT queue: "); Serial.print(mqttQueue.size());
+  Serial.print(" readings, "); Serial.print(mqttQueue.dropped()); Serial.println(" dropped");
 
   // get reset reason
   resetReason = getResetReasonName(esp_reset_reason());
@@ -338,11 +1302,28 @@ void setup()
   // configure web server
   DEBUG_println("starting web server...");
   webServerInit(webServer, isCaptive);
-  webServer.on("/cmd", HTTP_GET, handleCmd);
-  webServer.on("/status", HTTP_GET, [](AsyncWebServerRequest *request) {
-      updateStatusJson();
-      request->send(200, "application/json", statusJsonBuffer); 
+  webServer.on("/cmd", HTTP_GET, timedHandler(HTTP_ROUTE_CMD, handleCmd));
+  webServer.on("/history", HTTP_GET, timedHandler(HTTP_ROUTE_HISTORY, handleHistory));
+  webServer.on("/rollups", HTTP_GET, timedHandler(HTTP_ROUTE_ROLLUPS, handleRollups));
+  webServer.on("/export", HTTP_GET, timedHandler(HTTP_ROUTE_EXPORT, handleExport));
+  webServer.on("/metrics", HTTP_GET, timedHandler(HTTP_ROUTE_METRICS, handleMetrics));
+  webServer.on("/status", HTTP_GET, timedHandler(HTTP_ROUTE_STATUS, [](AsyncWebServerRequest *request) {
+      size_t sensorIdx = request->hasParam("sensor") ? request->getParam("sensor")->value().toInt() : 0;
+      if (sensorIdx >= sensorRegistryCount()) {
+        request->send(404, "text/plain", "Unknown sensor");
+        return;
+      }
+      if (!responseCacheFresh(sensorIdx, STATUS_MAX_AGE)) {
+        statusWanted.fetch_or(1u << sensorIdx); // built by the loop only, see statusLoop()
+      }
+      sendCachedResponse(request, sensorIdx, "application/json");
+  }));
+  liveSocket.onEvent([](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+      if (type == WS_EVT_CONNECT) {
+        liveJoined = true; // the loop pushes the current status
+      }
   });
+  webServer.addHandler(&liveSocket);
   webServer.begin();
 
   // NTP setup
@@ -365,21 +1346,31 @@ void setup()
       DEBUG_println("using insecure MQTT connection");
       mqttClient.setClient(wifiClient);
     }
-    mqttClient.setBufferSize(BUFFER_SIZE + MQTT_MAX_HEADER_SIZE + 10);
+    mqttClient.setBufferSize(STATUS_JSON_SIZE + MQTT_MAX_HEADER_SIZE + 10);
   }
 
-  // reset BLE scan
-  lastScan = -config.interval;
+  // build sensor registry, all sensors are due immediately
+  sensorRegistryInit(millis());
+  for (size_t i = 0; i < sensorRegistryCount(); i++) {
+    updateStatusJson(i); // first /status of every sensor
+  }
 
-  // configure status LED
-  pinMode(LED_PIN, OUTPUT);
+  // start watchdog, before the BLE worker subscribes to it
+  esp_task_wdt_init(WDT_TIMEOUT, true);
+  esp_task_wdt_add(NULL);
 
+  if (!bleWorkerBegin()) {
+    Serial.println("Failed to start BLE worker");
+  }
+  if (notifyTarget.scheme != NOTIFY_NONE && !notifyWorkerBegin(notifyTarget)) {
+    Serial.println("Failed to start notify worker");
+  }
 
-  // start watchdog
-  esp_task_wdt_init(20, true); // 20 seconds
-  esp_task_wdt_add(NULL);
+  // configure status LED
+  pinMode(LED_PIN, OUTPUT);
 
-  Serial.println("init complete");
+  Serial.print("init complete, free heap: ");
+  Serial.println(ESP.getFreeHeap());
 
 }
 
@@ -392,6 +1383,7 @@ void setup()
  * - SCAN: Forces a re-scan for BLE devices.
  * - READ: Forces an immediate BLE read.
  * - STATUS: Prints the current status JSON to Serial.
+ * - SUMMARY: Takes the daily summary now, prints it and queues it for delivery.
  * - SET_CONFIG: Receives a new config.json via Serial.
  */
 void handleSerialApi() {
@@ -420,18 +1412,24 @@ void handleSerialApi() {
         delay(50);
         WiFi.mode(WIFI_OFF);
         isStandby = true;
+        statusChanged();
         lastWifiRetry = millis()/1000;
         mqttLoop();
       } else if (cmd == "SCAN") {
         Serial.println("Forcing re-scan...\n");
-        config.bleAddress = "";
-        lastScan = millis()/1000 - config.interval;
+        requestForget();
       } else if (cmd == "READ") {
         Serial.println("Forcing immediate read...\n");
-        lastScan = millis()/1000 - config.interval;
+        requestReadAll();
       } else if (cmd == "STATUS") {
-        updateStatusJson();
-        Serial.println(statusJsonBuffer);
+        for (size_t i = 0; i < sensorRegistryCount(); i++) {
+          updateStatusJson(i);
+          Serial.println(statusJsonBuffer);
+        }
+      } else if (cmd == "SUMMARY") {
+        time_t now;
+        time(&now);
+        queueSummary(now, true);
       } else if (cmd == "SET_CONFIG") {
         if (arg.length() == 0) {
           Serial.println("Usage: SET_CONFIG <json>");
@@ -444,6 +1442,7 @@ void handleSerialApi() {
               // Only update passwords if not masked
               if (doc["wifiPassword"] == "***") doc["wifiPassword"] = config.wifiPassword;
               if (doc["mqttPassword"] == "***") doc["mqttPassword"] = config.mqttPassword;
+              if (doc["notifyPassword"] == "***") doc["notifyPassword"] = config.notifyPassword;
               
               if (serializeJson(doc, file) > 0) {
                 file.close();
@@ -470,7 +1469,7 @@ void handleSerialApi() {
       } else {
         Serial.print("Unknown command: ");
         Serial.println(cmd);
-        Serial.println("Available commands: RESET, OFFLINE, SCAN, READ, STATUS, SET_CONFIG, GET_CONFIG\n");
+        Serial.println("Available commands: RESET, OFFLINE, SCAN, READ, STATUS, SUMMARY, SET_CONFIG, GET_CONFIG\n");
       }
       Serial.flush();
     } else if (c != '\r') {
@@ -488,10 +1487,118 @@ enum BLEState {
   BLE_IDLE,
   BLE_START_SCAN,
   BLE_SCANNING,
-  BLE_PROCESS_RESULTS
+  BLE_PROCESS_RESULTS,
+  BLE_NEXT_SENSOR,
+  BLE_READING
 };
 
 static BLEState bleState = BLE_IDLE;
+static uint32_t cycleStart = 0;     // timestamp when the current read cycle started
+static uint32_t scanMs = 0;         // duration of the discovery scan of this cycle
+static bool scanned = false;        // this cycle ran a discovery scan
+static scanParams_t scanParams;     // parameters of the discovery scan of this cycle
+static uint8_t batch[MAX_SENSORS];  // sensors read in this cycle
+static size_t batchSize = 0;
+static size_t batchPos = 0;         // sensor of the batch being read
+static const uint64_t* foundList = nullptr; // address keys of the devices found by the scan
+static size_t foundCount = 0;
+static uint32_t readStart = 0;      // timestamp when the read of the current sensor started
+static int readMatch = -1;          // index of the current sensor in foundList, -1 if not found
+static bool readDirect = false;     // the current sensor is read without scan
+
+/**
+ * @brief Finishes the read of the current sensor of the batch: updates the registry, schedule and status
+ * @param readings Readings, type 0 if the read failed
+ * @param model Sensor model
+ * @param address Address key the sensor was read from
+ */
+static void finishRead(const sensorReadings_t& readings, const char* model, uint64_t address) {
+  uint8_t idx = batch[batchPos];
+  sensorSlot_t& sensor = sensorRegistryGet(idx);
+  uint8_t closedTiers = 0;
+  historyRecord_t record;
+  bool recorded = false;
+  alertEvent_t alerts[ALERT_MAX_RULES];
+  size_t alertCount = 0;
+
+  if ( readings.type ) {
+    Serial.println("Data decoded successfully:");
+    sensor.status = "data read successfully";
+    sensorRegistryResolved(idx, address);
+    strlcpy(sensor.sensorType, model, sizeof(sensor.sensorType));
+    sensor.readings = readings;
+    if (historyRecordFrom(idx, readings, record)) {
+      recorded = true;
+      readingHistory.append(record);
+      readingLog.append(record, millis());
+      closedTiers = rollups.add(record);
+      trends.add(record);
+      dailySummary.add(record);
+    }
+    alertCount = alertEngine.evaluate(idx, readings, alerts, ALERT_MAX_RULES);
+    for (size_t i = 0; i < alertCount; i++) {
+      char text[ALERT_TEXT_LENGTH];
+      alertText(alertEngine.rule(alerts[i].rule).quantity, alerts[i].level, text, sizeof(text));
+      Serial.println(text);
+      dailySummary.addAlert(alerts[i]);
+      if (notifyTarget.scheme != NOTIFY_NONE) {
+        notifyQueue.pushAlert(alerts[i], alertEngine.rule(alerts[i].rule), millis());
+      }
+    }
+  } else if (readDirect) {
+    // sensor moved or changed its address -> scan for it right away
+    Serial.println("Direct connect failed, scanning");
+    sensorRegistryFailed(idx);
+    sensorScheduler().trigger(idx, millis());
+    return;
+  } else {
+    sensor.status = foundCount == 0 ? "no devices found" : "no matching device found";
+    sensorRegistryFailed(idx);
+    strlcpy(sensor.sensorType, "unknown", sizeof(sensor.sensorType));
+    sensor.readings.type = 0;
+    Serial.println(sensor.status);
+  }
+
+  // radio time per reading: own connect/read plus an equal share of the scan
+  sensor.direct = readDirect;
+  sensor.cycleMs = millis() - cycleStart;
+  sensor.radioMs = (millis() - readStart) + scanMs / batchSize;
+  DEBUG_print("cycle: "); DEBUG_print(sensor.cycleMs); DEBUG_print(" ms, radio: "); DEBUG_print(sensor.radioMs);
+  DEBUG_println(readDirect ? " ms (direct)" : (scanned ? " ms (scan)" : " ms (linked)"));
+
+  // the worker is idle, snapshot the scan statistics for the status
+  sensor.hasScanStats = BLE_YC01::getScanStats(address, sensor.scanStats);
+
+  sensorScheduler().complete(idx, millis(), millis() - readStart);
+
+  updateStatusJson(idx);
+  DEBUG_println(statusJsonBuffer);
+  livePush.changed(idx, millis());
+  if (recorded && config.mqttPort && !mqttQueue.empty()) {
+    // older readings wait for their replay, keep the order
+    mqttEnqueue(record);
+  } else if (!publishStatus(idx) && recorded && config.mqttPort) {
+    // standby, captive portal or broker unreachable
+    mqttEnqueue(record);
+  }
+
+  // alert and recovery events, the retained topics are resynced once the broker is back
+  if (alertResync[idx] && mqttClient.connected()) {
+    alertResync[idx] = !publishAlertState(idx);
+  } else {
+    for (size_t i = 0; i < alertCount; i++) {
+      if (!publishAlert(alerts[i])) alertResync[idx] = true;
+    }
+  }
+
+  // an hour (day) ended: publish its summary and keep the rollups on flash
+  if (closedTiers) {
+    for (uint8_t t = 0; config.mqttRollups && t < ROLLUP_TIERS; t++) {
+      if (closedTiers & (1 << t)) publishRollup(idx, (rollupTier_t)t);
+    }
+    saveRollups(false);
+  }
+}
 
 /**
  * @brief Standard Arduino loop function.
@@ -500,6 +1607,7 @@ static BLEState bleState = BLE_IDLE;
  */
 void loop()
 {
+  uint32_t loopStart = micros();
   time_t now;
   time(&now);
   uint32_t uptime = millis()/1000; // get current timestamp in seconds
@@ -513,7 +1621,23 @@ void loop()
   // handle network tasks
   captivePortalLoop();
   mqttLoop();
+  mqttDrain();
   webUtilsLoop();
+  statusLoop();
+  liveLoop();
+  notifyLoop();
+
+  // write batched readings to flash
+  if (logFlushRequested) {
+    logFlushRequested = false;
+    readingLog.flush();
+    saveRollups(true);
+  } else if (exportFlushRequested) {
+    readingLog.flush();
+    exportFlushRequested = false;
+  } else {
+    readingLog.flushDue(millis());
+  }
 
   // Handle WiFi and Standby
   if ( !isCaptive ) {
@@ -529,6 +1653,7 @@ void loop()
       if ( WiFi.isConnected() ) {
         DEBUG_println("Standby: WiFi reconnected!");
         isStandby = false;
+        statusChanged();
         diconnectedAt = 0;
       }
     } else if ( !WiFi.isConnected() ) {
@@ -543,6 +1668,7 @@ void loop()
           delay(50);
           WiFi.mode(WIFI_OFF);
           isStandby = true;
+          statusChanged();
           lastWifiRetry = uptime;
         }
       }
@@ -551,99 +1677,150 @@ void loop()
     }
   }
     
-  // BLE State Machine
+  // BLE State Machine, scans and reads run in the BLE worker task
   switch (bleState) {
     case BLE_IDLE:
-      if ((uptime - lastScan) > config.interval) {
-        bleState = BLE_START_SCAN;
+      if (forgetRequested) {
+        forgetRequested = false;
+        sensorRegistryForget();
+      }
+      if (readAllRequested) {
+        readAllRequested = false;
+        sensorScheduler().triggerAll(millis());
+      }
+      if (sensorScheduler().nextDue(millis()) >= 0) {
+        cycleStart = millis();
+        scanMs = 0;
+        scanned = false;
+
+        // linked sensors and sensors with a known address need no discovery scan
+        batchSize = sensorScheduler().collectBatch(millis(), 0, batch, MAX_SENSORS);
+        bleState = sensorRegistryPlanScan(batch, batchSize, scanParams) ? BLE_START_SCAN : BLE_PROCESS_RESULTS;
       }
       break;
 
-    case BLE_START_SCAN:
-      Serial.println("Scanning for BLE devices (async)...");
+    case BLE_START_SCAN: {
+      Serial.print(scanParams.acceptListOnly ? "Scanning for known BLE devices (async, " : "Scanning for BLE devices (async, ");
+      Serial.print(scanParams.durationMs);
+      Serial.println(scanParams.active ? " ms active)..." : " ms passive)...");
       digitalWrite(LED_PIN, HIGH);
-      if (BLE_YC01::startScan(3)) {
-        bleState = BLE_SCANNING;
-      } else {
-        DEBUG_println("Failed to start BLE scan");
-        lastScan = uptime; // Delay retry
-        bleState = BLE_IDLE;
+      bleCommand_t command = {};
+      command.type = BLE_CMD_SCAN;
+      command.scan = scanParams;
+      bleState = bleWorkerSend(command) ? BLE_SCANNING : BLE_IDLE;
+      if (bleState == BLE_IDLE) {
+        DEBUG_println("BLE worker not available");
         digitalWrite(LED_PIN, LOW);
       }
       break;
+    }
 
-    case BLE_SCANNING:
-      if (!BLE_YC01::isScanning()) {
+    case BLE_SCANNING: {
+      bleResult_t result;
+      if (!bleWorkerReceive(result)) break;
+      if (result.ok) {
+        scanMs = result.durationMs;
+        scanned = true;
         bleState = BLE_PROCESS_RESULTS;
+      } else {
+        // delay retry by one interval for every sensor that is due
+        int idx;
+        while ((idx = sensorScheduler().nextDue(millis())) >= 0) {
+          sensorScheduler().defer(idx, millis() + sensorScheduler().slot(idx).intervalMs);
+        }
+        bleState = BLE_IDLE;
+        digitalWrite(LED_PIN, LOW);
       }
       break;
+    }
 
-    case BLE_PROCESS_RESULTS: {
-      auto list = BLE_YC01::getFoundDevices();
-      bool found = false;
-
-      for (const auto& addr : list) {
-        esp_task_wdt_reset();
-        Serial.print("Read device: ");
-        Serial.println(addr.toString().c_str());
-        
-        if ( config.bleAddress.isEmpty() || compareBLEAddress(addr, config.bleAddress) ) {
-          BLE_YC01 device(addr, config.name);
-          sensorReadings_t readings = {0};
-          if ( device.readData() ) {
-            readings = device.getReadings();
-          }
-          
-          if ( readings.type ) {
-            Serial.println("Data decoded successfully:");
-            lastStatus = "data read successfully";
-            lastBleAddress = device.getAddress().toString().c_str();
-            lastSensorType = device.getSensorType();
-            lastReadings = readings;
-            found = true;
-          }
-          break; 
+    case BLE_PROCESS_RESULTS:
+      foundList = BLE_YC01::getFoundDevices(foundCount);
+      if (!scanned) foundCount = 0; // results of an earlier scan
+
+      // read all sensors that are due (or fall due while this batch runs) in deadline order
+      batchSize = sensorScheduler().collectBatch(millis(), 0, batch, MAX_SENSORS);
+      batchPos = 0;
+      digitalWrite(LED_PIN, HIGH);
+      bleState = BLE_NEXT_SENSOR;
+      break;
+
+    case BLE_NEXT_SENSOR: {
+      if (batchPos >= batchSize) {
+        digitalWrite(LED_PIN, LOW);
+        bleState = BLE_IDLE;
+        break;
+      }
+      uint8_t idx = batch[batchPos];
+      sensorSlot_t& sensor = sensorRegistryGet(idx);
+      BLE_YC01& device = sensor.device;
+      readStart = millis();
+
+      // prefer a device found by the scan, connect to the known address otherwise
+      bool linked = device.isConnected();
+      readMatch = -1;
+      readDirect = false;
+      if (!linked) {
+        readMatch = sensorRegistryMatch(idx, foundList, foundCount);
+        readDirect = readMatch < 0 && sensorRegistryDirect(idx);
+        if (scanned && !readDirect) {
+          sensorRegistryScanned(idx, readMatch >= 0 ? &foundList[readMatch] : nullptr, scanParams);
         }
       }
-
-      if (!found) {
-        lastStatus = list.empty() ? "no devices found" : "no matching device found";
-        lastBleAddress = config.bleAddress;
-        lastSensorType = "unknown";
-        lastReadings.type = 0;
-        Serial.println(lastStatus);
+      if (!linked && readMatch < 0 && !readDirect) {
+        sensorReadings_t none = {0};
+        finishRead(none, "", sensor.addressKey);
+        batchPos++;
+        break;
       }
 
-      updateStatusJson();
-      DEBUG_println(statusJsonBuffer);
-
-      // MQTT Publishing
-      if ( config.mqttPort && !isCaptive && !isStandby && WiFi.isConnected() ) {
-        if ( !mqttClient.connected() ) {
-          DEBUG_print("connecting to MQTT-broker... ");
-          mqttClient.setServer(config.mqttServer.c_str(), config.mqttPort);
-          if ( mqttClient.connect("BLE-YC01", config.mqttUser.c_str(), config.mqttPassword.c_str()) ) {
-            mqttClient.loop();
-            DEBUG_println("ok");
-            updateStatusJson(); // update buffer with "connected" status
-          } else {
-            DEBUG_print("error, rc=");
-            DEBUG_println(mqttClient.state());
-          }
-        }
-        if ( mqttClient.connected() ) {
-          mqttClient.publish(config.mqttTopic.c_str(), statusJsonBuffer);
-          mqttClient.loop();
-        }
+      bleCommand_t command = {};
+      command.type = linked ? BLE_CMD_READ : BLE_CMD_READ_ADDRESS;
+      command.idx = idx;
+      command.address = linked ? bleAddressKey(device.getAddress()) : (readMatch >= 0 ? foundList[readMatch] : sensor.addressKey);
+      command.budgetMs = READ_BUDGET;
+      char addr[BLE_ADDRESS_STR_LENGTH];
+      bleAddressFormat(command.address, addr);
+      Serial.print(readDirect ? "Connect directly: " : "Read device: ");
+      Serial.println(addr);
+
+      // sensors broadcasting their data need no connection
+      sensorReadings_t readings = {0};
+      const char* model = device.getSensorType();
+      if ( readMatch >= 0 && BLE_YC01::getAdvertisedReadings(command.address, readings, model) ) {
+        DEBUG_println("Using broadcast data");
+        finishRead(readings, model, command.address);
+        batchPos++;
+      } else if ( bleWorkerSend(command) ) {
+        bleState = BLE_READING;
+      } else {
+        DEBUG_println("BLE worker not available");
+        finishRead(readings, model, command.address);
+        batchPos++;
       }
+      break;
+    }
 
-      lastScan = uptime;
-      digitalWrite(LED_PIN, LOW);
-      bleState = BLE_IDLE;
+    case BLE_READING: {
+      bleResult_t result;
+      if (!bleWorkerReceive(result)) break;
+      sensorRegistryGet(result.idx).link = result.link;
+      if (!result.ok) result.readings.type = 0;
+      bleReadMs.record(result.link.lastRead.totalMs);
+      bleReads[result.ok ? 0 : 1].add();
+      if (result.link.lastRead.attempts > 1) bleRetries.add(result.link.lastRead.attempts - 1);
+      finishRead(result.readings, result.model, result.address);
+      batchPos++;
+      bleState = BLE_NEXT_SENSOR;
       break;
     }
   }
 
+  // worst case loop iteration (without the delay below)
+  uint32_t loopUs = micros() - loopStart;
+  if (loopUs > loopMaxUs) loopMaxUs = loopUs;
+  if (loopUs > loopLagUs.load(std::memory_order_relaxed)) loopLagUs.store(loopUs, std::memory_order_relaxed);
+
   // wait
   delay(10); // Reduced delay for better responsiveness
 }
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "metrics.h"
+
+
+MetricsHistogram::MetricsHistogram(const uint32_t* bounds, size_t count)
+    : bounds(bounds), boundCount(count < METRICS_MAX_BUCKETS ? count : METRICS_MAX_BUCKETS) {
+    for (size_t i = 0; i <= METRICS_MAX_BUCKETS; i++) buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void MetricsHistogram::record(uint32_t value) {
+    size_t i = 0;
+    while (i < boundCount && value > bounds[i]) i++;
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    sampleCount.fetch_add(1, std::memory_order_relaxed);
+    sampleSum.fetch_add(value, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the length snprintf wrote, cut to the buffer
+ */
+static size_t clampLength(int length, size_t size) {
+    if (length < 0 || !size) return 0;
+    return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+size_t metricsFormatValue(uint32_t value, uint32_t scale, char* out, size_t size) {
+    if (scale <= 1) return clampLength(snprintf(out, size, "%u", (unsigned)value), size);
+    uint32_t integral = value / scale;
+    uint32_t fraction = value % scale;
+    int digits = 0;
+    for (uint32_t s = scale; s > 1; s /= 10) digits++;
+    while (fraction && fraction % 10 == 0) {
+        fraction /= 10;
+        digits--;
+    }
+    if (!fraction) return clampLength(snprintf(out, size, "%u", (unsigned)integral), size);
+    return clampLength(snprintf(out, size, "%u.%0*u", (unsigned)integral, digits, (unsigned)fraction), size);
+}
+
+MetricsQuery::MetricsQuery(const metricFamily_t* families, size_t count) : families(families), familyCount(count) {}
+
+size_t MetricsQuery::read(uint8_t* out, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        if (linePos == lineLength) {
+            if (finished || !nextLine()) {
+                finished = true;
+                break;
+            }
+            linePos = 0;
+        }
+        // a line may be split across chunks
+        size_t n = lineLength - linePos;
+        if (n > size - written) n = size - written;
+        memcpy(out + written, line + linePos, n);
+        linePos += n;
+        written += n;
+    }
+    byteCount += written;
+    return written;
+}
+
+void MetricsQuery::labelSet(char* out, size_t size, const char* le) {
+    const metricFamily_t& f = families[family];
+    if (f.label && le) snprintf(out, size, "{%s=\"%s\",le=\"%s\"}", f.label, f.labels[series], le);
+    else if (f.label) snprintf(out, size, "{%s=\"%s\"}", f.label, f.labels[series]);
+    else if (le) snprintf(out, size, "{le=\"%s\"}", le);
+    else out[0] = 0;
+}
+
+bool MetricsQuery::nextLine() {
+    static const char* const TYPE_NAMES[] = { "counter", "gauge", "histogram" };
+    while (family < familyCount) {
+        const metricFamily_t& f = families[family];
+        char labels[80];
+        char value[16];
+        int length;
+        if (step == 0) {
+            length = snprintf(line, sizeof(line), "# HELP %s %s\n", f.name, f.help);
+        } else if (step == 1) {
+            length = snprintf(line, sizeof(line), "# TYPE %s %s\n", f.name, TYPE_NAMES[f.type]);
+        } else if (series >= f.series) {
+            family++;
+            series = 0;
+            step = 0;
+            continue;
+        } else if (f.type != METRIC_HISTOGRAM) {
+            // counter or gauge: one line per series
+            labelSet(labels, sizeof(labels), nullptr);
+            metricsFormatValue(f.value(series), f.scale, value, sizeof(value));
+            length = snprintf(line, sizeof(line), "%s%s %s\n", f.name, labels, value);
+            series++;
+            lineLength = clampLength(length, sizeof(line));
+            return true;
+        } else {
+            // histogram: cumulative buckets, sum and count of each series
+            const MetricsHistogram& h = f.histograms[series];
+            size_t bucket = step - 2;
+            if (bucket <= h.size()) {
+                if (bucket == 0) cumulative = 0;
+                cumulative += h.bucket(bucket);
+                char le[16];
+                if (bucket < h.size()) metricsFormatValue(h.bound(bucket), f.scale, le, sizeof(le));
+                else strcpy(le, "+Inf");
+                labelSet(labels, sizeof(labels), le);
+                length = snprintf(line, sizeof(line), "%s_bucket%s %u\n", f.name, labels, (unsigned)cumulative);
+            } else if (bucket == h.size() + 1) {
+                labelSet(labels, sizeof(labels), nullptr);
+                metricsFormatValue(h.sum(), f.scale, value, sizeof(value));
+                length = snprintf(line, sizeof(line), "%s_sum%s %s\n", f.name, labels, value);
+            } else {
+                labelSet(labels, sizeof(labels), nullptr);
+                length = snprintf(line, sizeof(line), "%s_count%s %u\n", f.name, labels, (unsigned)cumulative);
+                series++;
+                step = 2;
+                lineLength = clampLength(length, sizeof(line));
+                return true;
+            }
+        }
+        step++;
+        lineLength = clampLength(length, sizeof(line));
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/*
+ * Operational telemetry in the Prometheus text exposition format (/metrics).
+ *
+ * Counters and fixed-bucket histograms are recorded with relaxed atomic
+ * adds, lock-free on the ESP32 and the host, from any task. A histogram
+ * sample is a scan over at most METRICS_MAX_BUCKETS bounds and three adds,
+ * cheap enough to stay enabled in production. Values are integers in the
+ * unit of their source (ms, us, bytes) and are scaled to the base unit
+ * (seconds) when written. Counters and sums are 32 bit; a wrap reads as a
+ * counter reset to Prometheus.
+ * The exposition is pulled chunk by chunk by the web server and generated
+ * one line at a time, so memory use does not depend on the number of
+ * series. A scrape is no snapshot: a sample recorded meanwhile may show up
+ * in a later bucket only, _count is the sum of the buckets written.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define METRICS_MAX_BUCKETS 10      /**< Bounds of a histogram, +Inf comes on top */
+#define METRICS_LINE_LENGTH 192     /**< Buffer size of one exposition line */
+
+/**
+ * @brief Monotonic counter
+ */
+class MetricsCounter {
+public:
+    void add(uint32_t n = 1) { count.fetch_add(n, std::memory_order_relaxed); }
+    uint32_t value() const { return count.load(std::memory_order_relaxed); }
+
+protected:
+    std::atomic<uint32_t> count{0};
+};
+
+/**
+ * @brief Histogram with fixed buckets
+ */
+class MetricsHistogram {
+public:
+    /**
+     * @brief Creates an empty histogram
+     * @param bounds Upper bounds of the buckets (le), ascending, in the unit of the samples; kept by reference
+     * @param count Number of bounds (at most METRICS_MAX_BUCKETS)
+     */
+    MetricsHistogram(const uint32_t* bounds, size_t count);
+    template <size_t N>
+    MetricsHistogram(const uint32_t (&bounds)[N]) : MetricsHistogram(bounds, N) {}
+
+    /**
+     * @brief Records a sample
+     */
+    void record(uint32_t value);
+
+    size_t size() const { return boundCount; }                /**< Number of bounds */
+    uint32_t bound(size_t i) const { return bounds[i]; }      /**< Upper bound of bucket i */
+
+    /**
+     * @brief Gets the samples of one bucket (not cumulative), i == size() for +Inf
+     */
+    uint32_t bucket(size_t i) const { return buckets[i].load(std::memory_order_relaxed); }
+
+    uint32_t samples() const { return sampleCount.load(std::memory_order_relaxed); } /**< Samples recorded */
+    uint32_t sum() const { return sampleSum.load(std::memory_order_relaxed); }       /**< Sum of the samples */
+
+protected:
+    const uint32_t* bounds;
+    size_t boundCount;
+    std::atomic<uint32_t> buckets[METRICS_MAX_BUCKETS + 1];
+    std::atomic<uint32_t> sampleCount{0};
+    std::atomic<uint32_t> sampleSum{0};
+};
+
+/**
+ * @brief Type of a metric family
+ */
+enum metricType_t : uint8_t
+{
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+};
+
+/**
+ * @brief Description of a metric family and where its values come from
+ */
+struct metricFamily_t
+{
+    const char* name;               /**< Metric name incl. unit suffix (_seconds, _bytes, _total) */
+    const char* help;               /**< HELP text */
+    metricType_t type;
+    uint32_t scale;                 /**< Source units per base unit: 1, 1000 (ms), 1000000 (us) */
+    const char* label;              /**< Label name, nullptr for a single series */
+    const char* const* labels;      /**< Label value of each series */
+    size_t series;                  /**< Number of series */
+    uint32_t (*value)(size_t series);       /**< Counter and gauge: value of a series, read at scrape time */
+    const MetricsHistogram* histograms;     /**< Histogram: one per series */
+};
+
+/**
+ * @brief Writes a value in source units in the base unit (value / scale, no float, trailing zeros removed)
+ * @return Length written (without terminator)
+ */
+size_t metricsFormatValue(uint32_t value, uint32_t scale, char* out, size_t size);
+
+/**
+ * @brief Streams the exposition of a list of metric families
+ */
+class MetricsQuery {
+public:
+    /**
+     * @brief Prepares a scrape, no value is read before the first chunk
+     * @param families Metric families
+     * @param count Number of families
+     */
+    MetricsQuery(const metricFamily_t* families, size_t count);
+
+    /**
+     * @brief Writes the next part of the exposition
+     * @param out Output buffer
+     * @param size Size of the buffer
+     * @return Bytes written, 0 once done
+     */
+    size_t read(uint8_t* out, size_t size);
+
+    bool done() const { return finished && linePos == lineLength; }    /**< All lines written */
+    uint32_t bytes() const { return byteCount; }                        /**< Bytes written so far */
+
+protected:
+    /**
+     * @brief Formats the next line into line
+     * @return false after the last line
+     */
+    bool nextLine();
+    void labelSet(char* out, size_t size, const char* le);
+
+    const metricFamily_t* families;
+    size_t familyCount;
+    size_t family = 0;              /**< Family being written */
+    size_t series = 0;              /**< Series of the family being written */
+    size_t step = 0;                /**< Line of the family header (0, 1) or of the series */
+    uint32_t cumulative = 0;        /**< Histogram: buckets of the series written so far */
+    bool finished = false;
+    char line[METRICS_LINE_LENGTH];
+    size_t lineLength = 0;
+    size_t linePos = 0;
+    uint32_t byteCount = 0;
+};
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "mqttQueue.h"
+
+
+/**
+ * @brief Checks the CRC of a stored record
+ */
+static inline bool recordValid(const logRecord_t& entry) {
+    return logCrc32(&entry.record, sizeof(entry.record)) == entry.crc;
+}
+
+const char* MqttQueue::segmentPath(uint32_t sequence, char path[LOG_PATH_LENGTH]) {
+    snprintf(path, LOG_PATH_LENGTH, MQTT_QUEUE_DIR "/seg%u.bin", (unsigned)(sequence % MQTT_QUEUE_SEGMENTS));
+    return path;
+}
+
+uint32_t MqttQueue::records(uint32_t sequence) const {
+    if (!stored || sequence < firstSeq || sequence > tailSeq) return 0;
+    return segmentRecords[sequence % MQTT_QUEUE_SEGMENTS];
+}
+
+void MqttQueue::drop(uint32_t sequence) {
+    if (headSeq > sequence) return;
+    uint32_t total = records(sequence);
+    uint32_t lost = total > headIndex ? total - headIndex : 0;
+    droppedCount += lost;
+    queued -= lost;
+    headSeq = sequence + 1;
+    headIndex = 0;
+    dirty = true;
+}
+
+bool MqttQueue::clear(uint32_t sequence) {
+    char path[LOG_PATH_LENGTH];
+    bool removed = true;
+    for (uint32_t slot = 0; slot < MQTT_QUEUE_SEGMENTS; slot++) {
+        removed = files->remove(segmentPath(slot, path)) && removed;
+    }
+    stored = false;
+    sealed = false;
+    firstSeq = tailSeq = headSeq = sequence;
+    headIndex = 0;
+    memset(segmentRecords, 0, sizeof(segmentRecords));
+    queued = 0;
+    return removed;
+}
+
+bool MqttQueue::startSegment(uint32_t sequence) {
+    // the slot of the oldest segment is reused, its unsent readings are lost
+    if (stored && sequence >= firstSeq + MQTT_QUEUE_SEGMENTS) {
+        drop(firstSeq);
+        firstSeq++;
+    }
+    char path[LOG_PATH_LENGTH];
+    segmentPath(sequence, path);
+    logSegmentHeader_t header;
+    header.magic = MQTT_QUEUE_MAGIC;
+    header.sequence = sequence;
+    header.crc = logCrc32(&header, offsetof(logSegmentHeader_t, crc));
+    if (!files->remove(path) || !files->append(path, (const uint8_t*)&header, sizeof(header))) {
+        return false;
+    }
+    segmentRecords[sequence % MQTT_QUEUE_SEGMENTS] = 0;
+    if (!stored) {
+        firstSeq = headSeq = sequence;
+        headIndex = 0;
+    }
+    tailSeq = sequence;
+    stored = true;
+    sealed = false;
+    return true;
+}
+
+bool MqttQueue::begin(LogFiles& queueFiles) {
+    files = &queueFiles;
+    stored = false;
+    sealed = false;
+    dirty = false;
+    sentCount = 0;
+    cursorSave = 0;
+    droppedCount = 0;
+    memset(segmentRecords, 0, sizeof(segmentRecords));
+
+    // segments: the headers tell the order, the file sizes the record counts
+    char path[LOG_PATH_LENGTH];
+    bool partial[MQTT_QUEUE_SEGMENTS] = {};
+    uint32_t first = 0, tail = 0;
+    for (uint32_t slot = 0; slot < MQTT_QUEUE_SEGMENTS; slot++) {
+        logSegmentHeader_t header;
+        segmentPath(slot, path);
+        size_t size = files->size(path);
+        if (!size) continue;
+        if (files->read(path, 0, (uint8_t*)&header, sizeof(header)) != sizeof(header) || header.magic != MQTT_QUEUE_MAGIC ||
+            header.crc != logCrc32(&header, offsetof(logSegmentHeader_t, crc)) || header.sequence % MQTT_QUEUE_SEGMENTS != slot) {
+            files->remove(path);
+            continue;
+        }
+        size_t count = (size - sizeof(header)) / sizeof(logRecord_t);
+        segmentRecords[slot] = count < MQTT_QUEUE_SEGMENT_RECORDS ? count : MQTT_QUEUE_SEGMENT_RECORDS;
+        partial[slot] = (size - sizeof(header)) % sizeof(logRecord_t) != 0;
+        if (!first || header.sequence < first) first = header.sequence;
+        if (header.sequence > tail) tail = header.sequence;
+    }
+
+    // the newest valid cursor
+    const char* paths[] = {MQTT_QUEUE_CURSOR_A, MQTT_QUEUE_CURSOR_B};
+    cursor_t cursor = {};
+    bool found = false;
+    for (const char* cursorPath : paths) {
+        cursor_t saved;
+        if (files->read(cursorPath, 0, (uint8_t*)&saved, sizeof(saved)) != sizeof(saved) || saved.magic != MQTT_QUEUE_MAGIC ||
+            saved.crc != logCrc32(&saved, offsetof(cursor_t, crc))) continue;
+        if (found && saved.save < cursor.save) continue;
+        cursor = saved;
+        found = true;
+    }
+    if (found) {
+        cursorSave = cursor.save;
+        droppedCount = cursor.dropped;
+    }
+
+    if (!tail) {
+        // empty queue, new segments continue after the saved head
+        clear(found ? cursor.sequence + (cursor.index ? 1 : 0) : 1);
+        return true;
+    }
+    if (found && cursor.sequence > tail) {
+        // drained, the power was lost while removing the files
+        return clear(cursor.sequence);
+    }
+    stored = true;
+    firstSeq = first;
+    tailSeq = tail;
+    headSeq = first;
+    headIndex = 0;
+    if (found && cursor.sequence >= first) {
+        headSeq = cursor.sequence;
+        headIndex = cursor.index < records(headSeq) ? cursor.index : records(headSeq);
+    }
+
+    // a torn or corrupted last record would hide the records appended behind it, seal the tail instead
+    uint32_t last = records(tailSeq);
+    if (partial[tailSeq % MQTT_QUEUE_SEGMENTS]) {
+        sealed = true;
+    } else if (last) {
+        logRecord_t entry;
+        size_t offset = sizeof(logSegmentHeader_t) + (last - 1) * sizeof(logRecord_t);
+        sealed = files->read(segmentPath(tailSeq, path), offset, (uint8_t*)&entry, sizeof(entry)) != sizeof(entry) || !recordValid(entry);
+    }
+
+    uint32_t total = 0;
+    for (uint32_t seq = headSeq; seq <= tailSeq; seq++) {
+        total += records(seq) - (seq == headSeq ? headIndex : 0);
+    }
+    queued = total;
+    return true;
+}
+
+bool MqttQueue::push(const historyRecord_t& record) {
+    if (!files) return false;
+    if (!stored || sealed || records(tailSeq) >= MQTT_QUEUE_SEGMENT_RECORDS) {
+        if (!startSegment(stored ? tailSeq + 1 : tailSeq)) {
+            droppedCount++;
+            return false;
+        }
+    }
+    logRecord_t entry;
+    entry.record = record;
+    entry.crc = logCrc32(&record, sizeof(record));
+    char path[LOG_PATH_LENGTH];
+    if (!files->append(segmentPath(tailSeq, path), (const uint8_t*)&entry, sizeof(entry))) {
+        // the segment may end in a partial record now, continue in a new one
+        sealed = true;
+        droppedCount++;
+        return false;
+    }
+    segmentRecords[tailSeq % MQTT_QUEUE_SEGMENTS]++;
+    queued++;
+    // a dropped segment moved the head
+    return !dirty || commit();
+}
+
+size_t MqttQueue::peek(historyRecord_t records[], size_t count) {
+    if (count > MQTT_QUEUE_BATCH) count = MQTT_QUEUE_BATCH;
+    char path[LOG_PATH_LENGTH];
+    while (stored && count && queued) {
+        uint32_t total = this->records(headSeq);
+        if (headIndex >= total) {
+            if (headSeq >= tailSeq) break;
+            headSeq++;
+            headIndex = 0;
+            dirty = true;
+            continue;
+        }
+        size_t wanted = total - headIndex < count ? total - headIndex : count;
+        size_t offset = sizeof(logSegmentHeader_t) + headIndex * sizeof(logRecord_t);
+        size_t length = files->read(segmentPath(headSeq, path), offset, (uint8_t*)entries, wanted * sizeof(logRecord_t));
+        size_t valid = 0;
+        while (valid < length / sizeof(logRecord_t) && recordValid(entries[valid])) {
+            records[valid] = entries[valid].record;
+            valid++;
+        }
+        if (valid) return valid;
+
+        // unreadable record: the rest of the segment is lost
+        uint32_t lost = total - headIndex;
+        droppedCount += lost;
+        queued -= lost;
+        headIndex = total;
+        dirty = true;
+        if (headSeq == tailSeq) sealed = true;
+    }
+    return 0;
+}
+
+void MqttQueue::pop(size_t count) {
+    uint32_t total = records(headSeq);
+    if (count > total - headIndex) count = total - headIndex;
+    if (!count) return;
+    headIndex += count;
+    sentCount += count;
+    queued -= count;
+    dirty = true;
+}
+
+bool MqttQueue::commit() {
+    if (!files) return false;
+    if (!dirty) return true;
+    // an emptied queue saves a head past the tail before its files are removed
+    bool emptied = stored && queued == 0;
+    cursor_t cursor;
+    cursor.magic = MQTT_QUEUE_MAGIC;
+    cursor.save = ++cursorSave;
+    cursor.sequence = emptied ? tailSeq + 1 : headSeq;
+    cursor.index = emptied ? 0 : headIndex;
+    cursor.dropped = droppedCount;
+    cursor.crc = logCrc32(&cursor, offsetof(cursor_t, crc));
+
+    // overwrite the older file, the newer one stays valid until this is complete
+    const char* path = (cursor.save & 1) ? MQTT_QUEUE_CURSOR_B : MQTT_QUEUE_CURSOR_A;
+    if (!files->remove(path) || !files->append(path, (const uint8_t*)&cursor, sizeof(cursor))) {
+        return false;
+    }
+    dirty = false;
+    return !emptied || clear(cursor.sequence);
+}
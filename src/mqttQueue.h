@@ -0,0 +1,144 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "readingLog.h"
+
+/*
+ * Persistent store-and-forward queue of readings that could not be
+ * published via MQTT (standby, captive portal, broker unreachable).
+ *
+ * Readings are appended to a ring of MQTT_QUEUE_SEGMENTS segment files in
+ * the format of the reading log (header, records with CRC32), one file
+ * commit per reading, so a queued reading survives a power loss. The read
+ * position (head) is saved to two alternating cursor files after every
+ * replayed batch; a reboot re-sends at most one batch (at-least-once). When
+ * the ring is full the oldest segment is dropped and its unsent readings
+ * are counted. An emptied queue removes its files.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define MQTT_QUEUE_DIR "/mqttq"                 /**< Directory of the queue files */
+#define MQTT_QUEUE_SEGMENTS 4                   /**< Segment files in the ring */
+#define MQTT_QUEUE_SEGMENT_RECORDS 128          /**< Records per segment, 512 readings in total */
+#define MQTT_QUEUE_BATCH 8                      /**< Most records returned by one peek() */
+#define MQTT_QUEUE_MAGIC 0x31514359             /**< "YCQ1", segment and cursor magic */
+#define MQTT_QUEUE_CURSOR_A MQTT_QUEUE_DIR "/head0.bin"
+#define MQTT_QUEUE_CURSOR_B MQTT_QUEUE_DIR "/head1.bin"
+
+/**
+ * @brief Bounded persistent FIFO of readings
+ *
+ * Single user (the loop); size() and dropped() may be read from other tasks.
+ */
+class MqttQueue {
+public:
+    /**
+     * @brief Finds the stored segments and the saved head
+     * @param files File access
+     * @return false if the files of a queue drained before a power loss cannot be removed
+     */
+    bool begin(LogFiles& files);
+
+    /**
+     * @brief Appends a reading, drops the oldest segment if the queue is full
+     * @param record Reading with its original timestamp
+     * @return false if the write failed (the reading is counted as dropped)
+     */
+    bool push(const historyRecord_t& record);
+
+    /**
+     * @brief Reads the oldest queued readings without removing them
+     * @param records Output records, oldest first
+     * @param count Records wanted (at most MQTT_QUEUE_BATCH)
+     * @return Records read, 0 if the queue is empty
+     */
+    size_t peek(historyRecord_t records[], size_t count);
+
+    /**
+     * @brief Removes readings returned by peek() (in RAM, see commit())
+     * @param count Readings to remove
+     */
+    void pop(size_t count);
+
+    /**
+     * @brief Saves the head, removes the files of an emptied queue
+     * @return false if a write failed
+     */
+    bool commit();
+
+    /**
+     * @brief Gets the number of queued readings
+     */
+    uint32_t size() const { return queued.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Checks if no reading is queued
+     */
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief Gets the number of readings dropped (queue full, write or CRC errors), kept across reboots
+     */
+    uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Gets the number of readings removed by pop() since boot
+     */
+    uint32_t sent() const { return sentCount; }
+
+    /**
+     * @brief Builds the path of the file holding a segment
+     */
+    static const char* segmentPath(uint32_t sequence, char path[LOG_PATH_LENGTH]);
+
+protected:
+    /**
+     * @brief Saved read position
+     */
+    struct cursor_t
+    {
+        uint32_t magic;         /**< MQTT_QUEUE_MAGIC */
+        uint32_t save;          /**< Running number of the save, the highest wins */
+        uint32_t sequence;      /**< Segment of the head */
+        uint32_t index;         /**< Record index of the head in its segment */
+        uint32_t dropped;       /**< Dropped readings */
+        uint32_t crc;           /**< CRC32 of the fields above */
+    };
+
+    /**
+     * @brief Gets the records stored in a segment
+     */
+    uint32_t records(uint32_t sequence) const;
+
+    /**
+     * @brief Replaces the oldest segment file by a new tail segment
+     */
+    bool startSegment(uint32_t sequence);
+
+    /**
+     * @brief Counts the unsent records of the oldest segment as dropped and moves the head past it
+     */
+    void drop(uint32_t sequence);
+
+    /**
+     * @brief Removes all segment files, the queue continues with sequence
+     */
+    bool clear(uint32_t sequence);
+
+    LogFiles* files = nullptr;
+    bool stored = false;            /**< Segment files firstSeq .. tailSeq exist */
+    bool sealed = false;            /**< The tail must not be appended to (torn or failed write) */
+    uint32_t firstSeq = 1;
+    uint32_t tailSeq = 1;
+    uint16_t segmentRecords[MQTT_QUEUE_SEGMENTS] = {};   /**< Records per segment, by sequence % MQTT_QUEUE_SEGMENTS */
+    uint32_t headSeq = 1;
+    uint32_t headIndex = 0;
+    bool dirty = false;             /**< The head moved since the last save */
+    uint32_t cursorSave = 0;
+    uint32_t sentCount = 0;
+    std::atomic<uint32_t> queued{0};
+    std::atomic<uint32_t> droppedCount{0};
+    logRecord_t entries[MQTT_QUEUE_BATCH];
+};
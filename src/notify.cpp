@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "notify.h"
+
+
+/**
+ * @brief Copies a string, cut at the buffer size
+ */
+static void copy(char out[], size_t length, const char* text, size_t count = (size_t)-1) {
+    size_t n = strlen(text);
+    if (count < n) n = count;
+    if (n >= length) n = length - 1;
+    memcpy(out, text, n);
+    out[n] = 0;
+}
+
+bool notifyParseTarget(const char* url, const char* user, const char* password, const char* from, const char* to,
+    notifyTarget_t& target) {
+    memset(&target, 0, sizeof(target));
+    static const struct {
+        const char* prefix;
+        notifyScheme_t scheme;
+        bool tls;
+        uint16_t port;
+    } schemes[] = {
+        { "smtp://", NOTIFY_SMTP, false, 25 },
+        { "smtps://", NOTIFY_SMTP, true, 465 },
+        { "http://", NOTIFY_HTTP, false, 80 },
+        { "https://", NOTIFY_HTTP, true, 443 },
+    };
+    const char* rest = nullptr;
+    for (const auto& scheme : schemes) {
+        size_t n = strlen(scheme.prefix);
+        if (strncmp(url, scheme.prefix, n) == 0) {
+            target.scheme = scheme.scheme;
+            target.tls = scheme.tls;
+            target.port = scheme.port;
+            rest = url + n;
+            break;
+        }
+    }
+    if (!rest) return false;
+
+    // host[:port][/path]
+    const char* path = strchr(rest, '/');
+    const char* end = path ? path : rest + strlen(rest);
+    const char* colon = (const char*)memchr(rest, ':', end - rest);
+    copy(target.host, sizeof(target.host), rest, (colon ? colon : end) - rest);
+    if (colon) {
+        long port = strtol(colon + 1, nullptr, 10);
+        if (port <= 0 || port > 65535) target.scheme = NOTIFY_NONE;
+        target.port = (uint16_t)port;
+    }
+    copy(target.path, sizeof(target.path), path ? path : "/");
+    copy(target.user, sizeof(target.user), user);
+    copy(target.password, sizeof(target.password), password);
+    copy(target.from, sizeof(target.from), from);
+    copy(target.to, sizeof(target.to), to);
+    if (!target.host[0]) target.scheme = NOTIFY_NONE;
+    if (target.scheme == NOTIFY_SMTP && (!target.from[0] || !target.to[0])) target.scheme = NOTIFY_NONE;
+    return target.scheme != NOTIFY_NONE;
+}
+
+size_t notifyBase64(const char* in, size_t length, char out[], size_t outLength) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t used = (length + 2) / 3 * 4;
+    if (used >= outLength) return 0;
+    char* o = out;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t v = (uint8_t)in[i] << 16;
+        if (i + 1 < length) v |= (uint8_t)in[i + 1] << 8;
+        if (i + 2 < length) v |= (uint8_t)in[i + 2];
+        *o++ = alphabet[(v >> 18) & 63];
+        *o++ = alphabet[(v >> 12) & 63];
+        *o++ = i + 1 < length ? alphabet[(v >> 6) & 63] : '=';
+        *o++ = i + 2 < length ? alphabet[v & 63] : '=';
+    }
+    *o = 0;
+    return used;
+}
+
+
+int SmtpSink::reply() {
+    // multi-line replies continue with "250-", the last line is "250 "
+    do {
+        if (stream.readLine(line, sizeof(line)) < 3) return -1;
+    } while (line[3] == '-');
+    return atoi(line);
+}
+
+bool SmtpSink::command(const char* text, int expected, int alternative) {
+    if (text && (!stream.write(text, strlen(text)) || !stream.write("\r\n", 2))) return false;
+    int code = reply();
+    return code == expected || (alternative && code == alternative);
+}
+
+bool SmtpSink::writeBody(const char* body, size_t length) {
+    // lines starting with a dot get a second one (RFC 5321 4.5.2)
+    size_t start = 0;
+    for (size_t i = 0; i <= length; i++) {
+        if (i < length && body[i] != '\n') continue;
+        size_t end = i < length ? i + 1 : i;
+        if (body[start] == '.' && start < end && !stream.write(".", 1)) return false;
+        if (end > start && !stream.write(body + start, end - start)) return false;
+        start = end;
+    }
+    return length == 0 || body[length - 1] == '\n' || stream.write("\r\n", 2);
+}
+
+bool SmtpSink::send(const char* subject, const char* body, size_t length) {
+    char text[NOTIFY_LINE_LENGTH];
+    if (!stream.connect(target.host, target.port, target.tls)) {
+        copy(line, sizeof(line), "connect failed");
+        return false;
+    }
+    bool ok = command(nullptr, 220);
+    const char* domain = strchr(target.from, '@');
+    snprintf(text, sizeof(text), "EHLO %s", domain ? domain + 1 : "localhost");
+    ok = ok && command(text, 250);
+    if (ok && target.user[0]) {
+        ok = command("AUTH LOGIN", 334);
+        ok = ok && notifyBase64(target.user, strlen(target.user), text, sizeof(text)) && command(text, 334);
+        ok = ok && notifyBase64(target.password, strlen(target.password), text, sizeof(text)) && command(text, 235);
+    }
+    snprintf(text, sizeof(text), "MAIL FROM:<%s>", target.from);
+    ok = ok && command(text, 250);
+
+    // one RCPT per recipient
+    for (const char* to = target.to; ok && *to; ) {
+        while (*to == ' ' || *to == ',') to++;
+        size_t n = strcspn(to, ", ");
+        if (!n) break;
+        snprintf(text, sizeof(text), "RCPT TO:<%.*s>", (int)n, to);
+        ok = command(text, 250, 251);
+        to += n;
+    }
+    ok = ok && command("DATA", 354);
+    if (ok) {
+        char header[NOTIFY_LINE_LENGTH + NOTIFY_SUBJECT_LENGTH];
+        snprintf(header, sizeof(header), "From: %s\r\nTo: %s\r\nSubject: %s\r\nMIME-Version: 1.0\r\n"
+            "Content-Type: text/plain; charset=utf-8\r\n\r\n", target.from, target.to, subject);
+        ok = stream.write(header, strlen(header)) && writeBody(body, length) && command(".", 250);
+    }
+    if (ok) command("QUIT", 221);
+    stream.stop();
+    return ok;
+}
+
+
+bool WebhookSink::send(const char* subject, const char* body, size_t length) {
+    if (!stream.connect(target.host, target.port, target.tls)) {
+        copy(line, sizeof(line), "connect failed");
+        return false;
+    }
+    // the subject as in the email, for receivers that route or title by it
+    char header[NOTIFY_LINE_LENGTH * 2 + NOTIFY_SUBJECT_LENGTH];
+    int used = snprintf(header, sizeof(header), "POST %s HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\n"
+        "Content-Length: %u\r\nX-Subject: %s\r\nConnection: close\r\n", target.path, target.host, (unsigned)length, subject);
+    if (target.user[0]) {
+        char credentials[sizeof(target.user) + sizeof(target.password)];
+        char encoded[sizeof(credentials) * 4 / 3 + 4];
+        snprintf(credentials, sizeof(credentials), "%s:%s", target.user, target.password);
+        notifyBase64(credentials, strlen(credentials), encoded, sizeof(encoded));
+        used += snprintf(header + used, sizeof(header) - used, "Authorization: Basic %s\r\n", encoded);
+    }
+    used += snprintf(header + used, sizeof(header) - used, "\r\n");
+
+    // "HTTP/1.1 200 OK", any 2xx is accepted
+    bool ok = (size_t)used < sizeof(header) && stream.write(header, used) && stream.write(body, length)
+        && stream.readLine(line, sizeof(line)) > 12 && strncmp(line, "HTTP/1.", 7) == 0;
+    int status = ok ? atoi(line + 9) : 0;
+    stream.stop();
+    return status >= 200 && status < 300;
+}
+
+
+void NotifyQueue::begin(int16_t offset) {
+    alertHead = 0;
+    alertCount = 0;
+    hasSummary = false;
+    utcOffset = offset;
+    readyMs = 0;
+    backoff = 0;
+    sentCount = 0;
+    failedCount = 0;
+    droppedCount = 0;
+    busy = false;
+    takenAlerts = 0;
+    takenSummary = false;
+}
+
+void NotifyQueue::pushAlert(const alertEvent_t& event, const alertRule_t& rule, uint32_t nowMs) {
+    if (empty() && !backoff) readyMs = nowMs + NOTIFY_BATCH_DELAY;
+    if (alertCount == NOTIFY_MAX_ALERTS) {
+        alertHead = (alertHead + 1) % NOTIFY_MAX_ALERTS;
+        alertCount--;
+        droppedCount++;
+        if (takenAlerts) takenAlerts--; // it is in the batch in flight, but no longer queued
+    }
+    notifyAlert_t& alert = alerts[(alertHead + alertCount++) % NOTIFY_MAX_ALERTS];
+    alert.event = event;
+    alert.rule = rule;
+}
+
+void NotifyQueue::pushSummary(const summaryReport_t& report, uint32_t nowMs) {
+    if (hasSummary && !takenSummary) droppedCount++;
+    summary = report;
+    hasSummary = true;
+    takenSummary = false; // the new one is not in a batch in flight
+    if (!backoff) readyMs = nowMs;
+}
+
+bool NotifyQueue::due(uint32_t nowMs) const {
+    return !busy && !empty() && (int32_t)(nowMs - readyMs) >= 0;
+}
+
+size_t NotifyQueue::format(bool json, const char* device, const char* const names[], char subjectOut[], char out[], size_t length) const {
+    size_t used = 0;
+    out[0] = 0;
+
+    // subject: the summary state, a single alert, or the number of alerts
+    if (hasSummary) {
+        snprintf(subjectOut, NOTIFY_SUBJECT_LENGTH, "%s: daily summary, %s", device, summaryStatusName(summaryOverall(summary)));
+    } else if (alertCount == 1) {
+        char text[ALERT_TEXT_LENGTH];
+        const notifyAlert_t& alert = alerts[alertHead];
+        alertText(alert.rule.quantity, alert.event.level, text, sizeof(text));
+        snprintf(subjectOut, NOTIFY_SUBJECT_LENGTH, "%s: %s", names[alert.event.sensor], text);
+    } else {
+        snprintf(subjectOut, NOTIFY_SUBJECT_LENGTH, "%s: %u alert events", device, (unsigned)alertCount);
+    }
+
+    if (json) {
+        used += snprintf(out + used, length - used, "{\"device\":\"%s\"", device);
+        if (hasSummary && used < length) {
+            used += snprintf(out + used, length - used, ",\"summary\":");
+            if (used < length) used += summaryFormatJson(summary, names, out + used, length - used);
+        }
+        if (used < length) used += snprintf(out + used, length - used, ",\"alerts\":[");
+        for (size_t i = 0; i < alertCount && used < length; i++) {
+            const notifyAlert_t& alert = alerts[(alertHead + i) % NOTIFY_MAX_ALERTS];
+            if (i) used += snprintf(out + used, length - used, ",");
+            if (used < length) used += alertFormat(alert.event, alert.rule, out + used, length - used);
+        }
+        if (used < length) used += snprintf(out + used, length - used, "]}");
+    } else {
+        if (hasSummary) used += summaryFormatText(summary, names, out, length);
+        if (alertCount && used < length) used += snprintf(out + used, length - used, "%sAlert events:\r\n", used ? "\r\n" : "");
+        for (size_t i = 0; i < alertCount && used < length; i++) {
+            const notifyAlert_t& alert = alerts[(alertHead + i) % NOTIFY_MAX_ALERTS];
+            char time[24], text[ALERT_TEXT_LENGTH];
+            summaryFormatTime(alert.event.time, utcOffset, time, sizeof(time));
+            alertText(alert.rule.quantity, alert.event.level, text, sizeof(text));
+            used += snprintf(out + used, length - used, "  %s %s: %s (%g)\r\n", time, names[alert.event.sensor], text,
+                yc01Value(alert.rule.quantity, alert.event.value));
+        }
+    }
+    return used < length ? used : length - 1;
+}
+
+size_t NotifyQueue::take(uint32_t nowMs, bool json, const char* device, const char* const names[]) {
+    if (!due(nowMs)) return 0;
+    busy = true;
+    takenAlerts = alertCount;
+    takenSummary = hasSummary;
+    return format(json, device, names, subject, body, sizeof(body));
+}
+
+bool NotifyQueue::process(uint32_t nowMs, NotifySink& sink, const char* device, const char* const names[]) {
+    size_t length = take(nowMs, sink.json(), device, names);
+    if (!busy) return false;
+    finish(nowMs, sink.send(subject, body, length));
+    return true;
+}
+
+void NotifyQueue::finish(uint32_t nowMs, bool ok) {
+    if (!busy) return;
+    busy = false;
+    if (ok) {
+        // messages queued during the delivery stay for the next batch
+        alertHead = (alertHead + takenAlerts) % NOTIFY_MAX_ALERTS;
+        alertCount -= takenAlerts;
+        if (takenSummary) hasSummary = false;
+        if (hasSummary) {
+            readyMs = nowMs;
+        } else if (alertCount) {
+            readyMs = nowMs + NOTIFY_BATCH_DELAY;
+        }
+        backoff = 0;
+        sentCount++;
+    } else {
+        backoff = backoff ? (backoff * 2 < NOTIFY_RETRY_MAX ? backoff * 2 : NOTIFY_RETRY_MAX) : NOTIFY_RETRY_MIN;
+        readyMs = nowMs + backoff;
+        failedCount++;
+    }
+}
@@ -0,0 +1,277 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "alerts.h"
+#include "summary.h"
+
+/*
+ * Delivery of the daily summary and of alert events by email or webhook.
+ *
+ * NotifyQueue keeps what is still to be sent in RAM: the alert events of a
+ * bounded ring and the latest summary. A delivery sends all of it as one
+ * batch (one email, one POST). Alerts wait NOTIFY_BATCH_DELAY for more of a
+ * burst, a summary goes out at once. A failed delivery is retried with an
+ * exponential backoff; nothing is lost but the oldest alerts of a full ring
+ * and a summary replaced by the next one, both counted.
+ * A delivery blocks for seconds, so on the device it runs on another task:
+ * the loop takes the batch (take()), the task sends it and the loop applies
+ * the outcome (finish()). process() does all three in one call.
+ *
+ * The sinks speak SMTP (SmtpSink) and HTTP POST (WebhookSink) over a
+ * NotifyStream, the transport the caller provides: a WiFi client on the
+ * device, a scripted stand-in server in the host tests.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define NOTIFY_MAX_ALERTS 16            /**< Alert events kept until delivered */
+#define NOTIFY_BODY_LENGTH 4096         /**< Buffer size of a message */
+#define NOTIFY_SUBJECT_LENGTH 96        /**< Buffer size of a subject */
+#define NOTIFY_BATCH_DELAY 60000        /**< ms an alert waits for others of a burst */
+#define NOTIFY_RETRY_MIN 60000          /**< ms before the first retry */
+#define NOTIFY_RETRY_MAX 3600000        /**< ms limit of the retry backoff */
+#define NOTIFY_LINE_LENGTH 256          /**< Buffer size of a protocol line */
+
+/**
+ * @brief Protocol of a target
+ */
+enum notifyScheme_t : uint8_t
+{
+    NOTIFY_NONE = 0,    /**< Delivery disabled */
+    NOTIFY_SMTP,        /**< Email via SMTP ("smtp://", "smtps://" for TLS) */
+    NOTIFY_HTTP         /**< JSON POST to a webhook ("http://", "https://" for TLS) */
+};
+
+/**
+ * @brief Where and how to deliver
+ */
+struct notifyTarget_t
+{
+    notifyScheme_t scheme;
+    bool tls;
+    uint16_t port;
+    char host[64];
+    char path[96];          /**< Webhook path, "/" if none */
+    char user[64];          /**< SMTP AUTH LOGIN or HTTP basic auth, empty: none */
+    char password[64];
+    char from[64];          /**< SMTP sender */
+    char to[128];           /**< SMTP recipients, comma separated */
+};
+
+/**
+ * @brief Parses a target URL ("smtp://host:587", "https://host/hook") and sets the credentials
+ * @param url URL, empty disables delivery
+ * @param user User, empty: no authentication
+ * @param password Password
+ * @param from SMTP sender
+ * @param to SMTP recipients, comma separated
+ * @param target Output
+ * @return false if the URL is empty or not understood (scheme NOTIFY_NONE)
+ */
+bool notifyParseTarget(const char* url, const char* user, const char* password, const char* from, const char* to,
+    notifyTarget_t& target);
+
+/**
+ * @brief Encodes base64 (SMTP AUTH LOGIN, HTTP basic auth)
+ * @return Length of the text, 0 if the buffer is too small
+ */
+size_t notifyBase64(const char* in, size_t length, char out[], size_t outLength);
+
+/**
+ * @brief Byte stream to a server
+ */
+class NotifyStream {
+public:
+    virtual ~NotifyStream() {}
+
+    /**
+     * @brief Opens the connection
+     */
+    virtual bool connect(const char* host, uint16_t port, bool tls) = 0;
+
+    /**
+     * @brief Writes all bytes
+     * @return false on error
+     */
+    virtual bool write(const char* data, size_t length) = 0;
+
+    /**
+     * @brief Reads a line, without the line end
+     * @return Length of the line, -1 on timeout or closed connection
+     */
+    virtual int readLine(char line[], size_t length) = 0;
+
+    /**
+     * @brief Closes the connection
+     */
+    virtual void stop() = 0;
+};
+
+/**
+ * @brief Delivers one message
+ */
+class NotifySink {
+public:
+    virtual ~NotifySink() {}
+
+    /**
+     * @brief Gets the body format the sink expects (true: JSON, false: plain text)
+     */
+    virtual bool json() const = 0;
+
+    /**
+     * @brief Delivers a message
+     * @param subject Subject (email)
+     * @param body Body
+     * @param length Length of the body
+     * @return true if the server accepted it
+     */
+    virtual bool send(const char* subject, const char* body, size_t length) = 0;
+};
+
+/**
+ * @brief Email via SMTP, optional AUTH LOGIN
+ */
+class SmtpSink : public NotifySink {
+public:
+    SmtpSink(NotifyStream& stream, const notifyTarget_t& target) : stream(stream), target(target) {}
+    bool json() const override { return false; }
+    bool send(const char* subject, const char* body, size_t length) override;
+
+    /**
+     * @brief Gets the last reply line of the server (diagnosis)
+     */
+    const char* lastReply() const { return line; }
+
+protected:
+    int reply();
+    bool command(const char* text, int expected, int alternative = 0);
+    bool writeBody(const char* body, size_t length);
+
+    NotifyStream& stream;
+    const notifyTarget_t& target;
+    char line[NOTIFY_LINE_LENGTH] = "";
+};
+
+/**
+ * @brief JSON POST to a webhook, optional basic auth
+ */
+class WebhookSink : public NotifySink {
+public:
+    WebhookSink(NotifyStream& stream, const notifyTarget_t& target) : stream(stream), target(target) {}
+    bool json() const override { return true; }
+    bool send(const char* subject, const char* body, size_t length) override;
+
+    /**
+     * @brief Gets the status line of the last response (diagnosis)
+     */
+    const char* lastReply() const { return line; }
+
+protected:
+    NotifyStream& stream;
+    const notifyTarget_t& target;
+    char line[NOTIFY_LINE_LENGTH] = "";
+};
+
+/**
+ * @brief Alert event with its rule, as queued
+ */
+struct notifyAlert_t
+{
+    alertEvent_t event;
+    alertRule_t rule;
+};
+
+/**
+ * @brief Messages not delivered yet, with batching and retry
+ */
+class NotifyQueue {
+public:
+    /**
+     * @brief Clears the queue
+     * @param utcOffset Offset of the local time in minutes (alert times)
+     */
+    void begin(int16_t utcOffset);
+
+    /**
+     * @brief Queues an alert event, the oldest is dropped if the ring is full
+     * @param nowMs Current time in ms (millis())
+     */
+    void pushAlert(const alertEvent_t& event, const alertRule_t& rule, uint32_t nowMs);
+
+    /**
+     * @brief Queues a summary, replaces one not delivered yet
+     * @param nowMs Current time in ms (millis())
+     */
+    void pushSummary(const summaryReport_t& report, uint32_t nowMs);
+
+    /**
+     * @brief Checks if a delivery is due (batch delay and retry backoff passed, none in flight)
+     */
+    bool due(uint32_t nowMs) const;
+
+    /**
+     * @brief Formats all queued messages as one batch for a delivery, if due
+     *
+     * The batch stays queued until finish(). Messages queued meanwhile are
+     * not part of it, and batchSubject()/batchBody() do not change.
+     * @param nowMs Current time in ms (millis())
+     * @param json Body format of the sink
+     * @param device Device name (subject)
+     * @param names Sensor names, indexed by sensor
+     * @return Length of the body, 0 if no delivery is due
+     */
+    size_t take(uint32_t nowMs, bool json, const char* device, const char* const names[]);
+
+    /**
+     * @brief Applies the outcome of the delivery of the taken batch
+     * @param nowMs Current time in ms (millis())
+     * @param ok true if the server accepted it
+     */
+    void finish(uint32_t nowMs, bool ok);
+
+    const char* batchSubject() const { return subject; }  /**< Subject of the taken batch */
+    const char* batchBody() const { return body; }        /**< Body of the taken batch */
+    bool inFlight() const { return busy; }                /**< A batch is taken and not finished */
+
+    /**
+     * @brief Delivers all queued messages as one batch if due (take(), send, finish())
+     * @param nowMs Current time in ms (millis())
+     * @param sink Sink
+     * @param device Device name (subject)
+     * @param names Sensor names, indexed by sensor
+     * @return true if a delivery was attempted
+     */
+    bool process(uint32_t nowMs, NotifySink& sink, const char* device, const char* const names[]);
+
+    /**
+     * @brief Formats the batch as the sink expects it
+     * @return Length of the body
+     */
+    size_t format(bool json, const char* device, const char* const names[], char subject[], char body[], size_t length) const;
+
+    size_t size() const { return alertCount + (hasSummary ? 1 : 0); }
+    bool empty() const { return size() == 0; }
+    uint32_t sent() const { return sentCount; }           /**< Batches delivered */
+    uint32_t failed() const { return failedCount; }       /**< Delivery attempts failed */
+    uint32_t dropped() const { return droppedCount; }     /**< Alerts and summaries lost */
+    uint32_t retryMs() const { return backoff; }          /**< Current retry backoff, 0 after a success */
+
+protected:
+    notifyAlert_t alerts[NOTIFY_MAX_ALERTS];
+    size_t alertHead = 0;               /**< Oldest alert */
+    size_t alertCount = 0;
+    summaryReport_t summary;
+    bool hasSummary = false;
+    int16_t utcOffset = 0;
+    uint32_t readyMs = 0;               /**< Earliest time of the next delivery */
+    uint32_t backoff = 0;               /**< Wait after the last failure, 0: none */
+    uint32_t sentCount = 0;
+    uint32_t failedCount = 0;
+    uint32_t droppedCount = 0;
+    bool busy = false;                  /**< A batch is taken */
+    size_t takenAlerts = 0;             /**< Alerts of the taken batch, the oldest ones */
+    bool takenSummary = false;          /**< The taken batch holds the queued summary */
+    char subject[NOTIFY_SUBJECT_LENGTH];
+    char body[NOTIFY_BODY_LENGTH];
+};
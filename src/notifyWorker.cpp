@@ -0,0 +1,118 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include "esp_task_wdt.h"
+
+#include "notifyWorker.h"
+
+#define WORKER_IDLE_WAIT 1000   // queue wait between watchdog resets in ms
+
+static QueueHandle_t jobQueue = nullptr;
+static QueueHandle_t resultQueue = nullptr;
+static TaskHandle_t workerTask = nullptr;
+static WiFiClient notifyClient;
+static WiFiClientSecure notifySecureClient;
+
+/**
+ * @brief NotifyStream over a WiFi client; a delivery ends at the latest NOTIFY_BUDGET after its connect.
+ */
+class ClientStream : public NotifyStream {
+public:
+    bool connect(const char* host, uint16_t port, bool tls) override {
+        deadline = millis() + NOTIFY_BUDGET;
+        if (tls) {
+            notifySecureClient.setInsecure();
+            notifySecureClient.setHandshakeTimeout(NOTIFY_TIMEOUT / 1000);
+            client = &notifySecureClient;
+            return notifySecureClient.connect(host, port, NOTIFY_TIMEOUT);
+        }
+        client = &notifyClient;
+        return notifyClient.connect(host, port, NOTIFY_TIMEOUT);
+    }
+
+    bool write(const char* data, size_t length) override {
+        return client->write((const uint8_t*)data, length) == length;
+    }
+
+    int readLine(char line[], size_t length) override {
+        size_t used = 0;
+        line[0] = 0;
+        while ((int32_t)(millis() - deadline) < 0) {
+            if (!client->available()) {
+                if (!client->connected()) break;
+                esp_task_wdt_reset();
+                delay(1);
+                continue;
+            }
+            char c = client->read();
+            if (c == '\n') return used;
+            if (c != '\r' && used + 1 < length) {
+                line[used++] = c;
+                line[used] = 0;
+            }
+        }
+        return -1;
+    }
+
+    void stop() override {
+        client->stop();
+    }
+
+private:
+    Client* client = &notifyClient;
+    uint32_t deadline = 0;
+};
+
+/**
+ * @brief Worker task: delivers the posted batches one at a time and posts their outcome
+ */
+static void workerLoop(void* arg) {
+    const notifyTarget_t& target = *(const notifyTarget_t*)arg;
+    static ClientStream stream;
+    static SmtpSink smtpSink(stream, target);
+    static WebhookSink webhookSink(stream, target);
+    NotifySink& sink = target.scheme == NOTIFY_SMTP ? (NotifySink&)smtpSink : (NotifySink&)webhookSink;
+
+    esp_task_wdt_add(NULL); // a hung connection resets the device
+    notifyJob_t job;
+    for (;;) {
+        esp_task_wdt_reset();
+        if (xQueueReceive(jobQueue, &job, pdMS_TO_TICKS(WORKER_IDLE_WAIT)) != pdTRUE) {
+            continue;
+        }
+
+        notifyResult_t result = {};
+        uint32_t startMs = millis();
+        result.ok = sink.send(job.subject, job.body, job.length);
+        result.durationMs = millis() - startMs;
+        strlcpy(result.reply, target.scheme == NOTIFY_SMTP ? smtpSink.lastReply() : webhookSink.lastReply(),
+            sizeof(result.reply));
+
+        // the loop waits for every result, the queue cannot stay full
+        while (xQueueSend(resultQueue, &result, pdMS_TO_TICKS(WORKER_IDLE_WAIT)) != pdTRUE) {
+            esp_task_wdt_reset();
+        }
+    }
+}
+
+bool notifyWorkerBegin(const notifyTarget_t& target) {
+    if (workerTask) return true;
+    jobQueue = xQueueCreate(1, sizeof(notifyJob_t));
+    resultQueue = xQueueCreate(1, sizeof(notifyResult_t));
+    if (!jobQueue || !resultQueue) {
+        return false;
+    }
+    // a TLS handshake takes seconds of CPU, keep it off the loop core
+    return xTaskCreatePinnedToCore(workerLoop, "notifyWorker", NOTIFY_WORKER_STACK, (void*)&target,
+        NOTIFY_WORKER_PRIORITY, &workerTask, NOTIFY_WORKER_CORE) == pdPASS;
+}
+
+bool notifyWorkerSend(const notifyJob_t& job) {
+    if (!jobQueue) return false;
+    return xQueueSend(jobQueue, &job, 0) == pdTRUE;
+}
+
+bool notifyWorkerReceive(notifyResult_t& result) {
+    if (!resultQueue) return false;
+    return xQueueReceive(resultQueue, &result, 0) == pdTRUE;
+}
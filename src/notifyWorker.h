@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+
+#include "notify.h"
+
+/*
+ * Delivery of notifications in a dedicated FreeRTOS task.
+ *
+ * An SMTP or webhook delivery connects, may run a TLS handshake and waits
+ * for the replies of the server: up to NOTIFY_BUDGET plus the connect, which
+ * must not stall loop(). The loop takes a batch from the NotifyQueue and
+ * posts it; the worker delivers it over a WiFi client and posts the outcome,
+ * which the loop applies with NotifyQueue::finish(). The queues hand over
+ * ownership: while a batch is in flight the worker reads its subject and
+ * body, the loop does not touch them (NotifyQueue::inFlight()). The target
+ * is parsed once at boot and not changed afterwards.
+ */
+
+#define NOTIFY_TIMEOUT 3000         /**< ms to connect to the SMTP server or webhook */
+#define NOTIFY_BUDGET 10000         /**< ms a delivery may take after its connect */
+#define NOTIFY_WORKER_STACK 8192    /**< Stack size of the worker task in bytes (TLS handshake) */
+#define NOTIFY_WORKER_PRIORITY 1    /**< Lowest application priority, as the loop */
+#define NOTIFY_WORKER_CORE 0        /**< Core of the WiFi stack, the loop runs on the other one */
+
+/**
+ * @brief Batch to deliver, owned by the worker until its result is posted
+ */
+struct notifyJob_t
+{
+    const char* subject;    /**< Subject (NotifyQueue::batchSubject()) */
+    const char* body;       /**< Body (NotifyQueue::batchBody()) */
+    size_t length;          /**< Length of the body */
+};
+
+/**
+ * @brief Outcome of a delivery
+ */
+struct notifyResult_t
+{
+    bool ok;                /**< The server accepted the batch */
+    uint32_t durationMs;    /**< Time the worker spent on the delivery */
+    char reply[NOTIFY_LINE_LENGTH]; /**< Last reply line of the server (diagnosis) */
+};
+
+/**
+ * @brief Creates the queues and starts the worker task
+ * @param target Delivery target, must outlive the worker
+ * @return true if the worker runs
+ */
+bool notifyWorkerBegin(const notifyTarget_t& target);
+
+/**
+ * @brief Posts a batch to the worker without blocking
+ * @param job Batch
+ * @return false if a delivery is in progress or the worker is not running
+ */
+bool notifyWorkerSend(const notifyJob_t& job);
+
+/**
+ * @brief Takes the outcome of a delivery without blocking
+ * @param result Output result
+ * @return true if a delivery has finished
+ */
+bool notifyWorkerReceive(notifyResult_t& result);
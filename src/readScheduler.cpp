@@ -0,0 +1,92 @@
+#include <string.h>
+
+#include "readScheduler.h"
+
+
+/**
+ * @brief Wrap-around safe "a is before or at b" for millis() timestamps
+ */
+static inline bool timeReached(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) <= 0;
+}
+
+void ReadScheduler::begin(size_t count, uint32_t nowMs) {
+    slotCount = count > SCHEDULER_MAX_SLOTS ? SCHEDULER_MAX_SLOTS : count;
+    memset(slots, 0, sizeof(slots));
+    for (size_t i = 0; i < slotCount; i++) {
+        slots[i].deadlineMs = nowMs;
+        slots[i].readCostMs = SCHEDULER_DEFAULT_READ_COST;
+    }
+}
+
+void ReadScheduler::setInterval(size_t idx, uint32_t intervalMs) {
+    if (idx >= slotCount) return;
+    slots[idx].intervalMs = intervalMs;
+}
+
+int ReadScheduler::nextDue(uint32_t nowMs) const {
+    int best = -1;
+    for (size_t i = 0; i < slotCount; i++) {
+        if (!timeReached(slots[i].deadlineMs, nowMs)) continue;
+        if (best < 0 || (int32_t)(slots[i].deadlineMs - slots[best].deadlineMs) < 0) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+size_t ReadScheduler::collectBatch(uint32_t nowMs, uint32_t scanCostMs, uint8_t out[], size_t maxOut) const {
+    // order all slots by deadline (insertion sort, at most SCHEDULER_MAX_SLOTS entries)
+    uint8_t order[SCHEDULER_MAX_SLOTS];
+    for (size_t i = 0; i < slotCount; i++) {
+        size_t j = i;
+        while (j > 0 && (int32_t)(slots[i].deadlineMs - slots[order[j - 1]].deadlineMs) < 0) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    // greedily extend the batch while the next deadline expires before the batch is done
+    size_t n = 0;
+    uint32_t batchEnd = nowMs + scanCostMs;
+    for (size_t i = 0; i < slotCount && n < maxOut; i++) {
+        const scheduleSlot_t& s = slots[order[i]];
+        if (n > 0 && !timeReached(s.deadlineMs, batchEnd)) break;
+        if (n == 0 && !timeReached(s.deadlineMs, nowMs)) break;
+        out[n++] = order[i];
+        batchEnd += s.readCostMs;
+    }
+    return n;
+}
+
+void ReadScheduler::complete(size_t idx, uint32_t nowMs, uint32_t durationMs) {
+    if (idx >= slotCount) return;
+    scheduleSlot_t& s = slots[idx];
+
+    // running estimate of the read cost (EWMA, alpha = 1/4)
+    s.readCostMs = (s.readCostMs * 3 + durationMs) / 4;
+    s.lastLatencyMs = timeReached(s.deadlineMs, nowMs) ? nowMs - s.deadlineMs : 0;
+
+    s.deadlineMs += s.intervalMs;
+    if (timeReached(s.deadlineMs, nowMs)) {
+        // fell more than one interval behind -> restart phase
+        s.deadlineMs = nowMs + s.intervalMs;
+    }
+}
+
+void ReadScheduler::defer(size_t idx, uint32_t deadlineMs) {
+    if (idx >= slotCount) return;
+    slots[idx].deadlineMs = deadlineMs;
+}
+
+void ReadScheduler::trigger(size_t idx, uint32_t nowMs) {
+    if (idx >= slotCount) return;
+    slots[idx].deadlineMs = nowMs;
+}
+
+void ReadScheduler::triggerAll(uint32_t nowMs) {
+    for (size_t i = 0; i < slotCount; i++) {
+        slots[i].deadlineMs = nowMs;
+    }
+}
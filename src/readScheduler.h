@@ -0,0 +1,121 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Earliest-deadline-first read scheduler for the sensor registry.
+ *
+ * This module is plain C++ (no Arduino / NimBLE dependencies) so it can be
+ * simulated on the host (see test/native/test_read_scheduler).
+ * All times are millisecond timestamps as returned by millis(); comparisons
+ * are wrap-around safe.
+ */
+
+#define SCHEDULER_MAX_SLOTS 8               /**< Maximum number of scheduled sensors */
+#define SCHEDULER_DEFAULT_READ_COST 2500    /**< Initial estimate for one connect+read in ms */
+
+/**
+ * @brief Scheduling state of one sensor
+ */
+struct scheduleSlot_t
+{
+    uint32_t intervalMs;    /**< Read interval in ms */
+    uint32_t deadlineMs;    /**< Timestamp at which the next read is due */
+    uint32_t readCostMs;    /**< Running estimate of one connect+read in ms */
+    uint32_t lastLatencyMs; /**< Delay between deadline and completion of the last read */
+};
+
+/**
+ * @brief Schedules sensor reads by earliest deadline and coalesces reads
+ *        that fall due while a batch is running into that batch.
+ *
+ * One BLE scan discovers all sensors in range, so every sensor whose deadline
+ * expires before the batch would finish anyway is read within the same radio
+ * session instead of paying for its own scan.
+ */
+class ReadScheduler {
+public:
+    /**
+     * @brief Resets the scheduler.
+     * @param count Number of slots in use (clamped to SCHEDULER_MAX_SLOTS)
+     * @param nowMs Current timestamp; all slots are due immediately
+     */
+    void begin(size_t count, uint32_t nowMs);
+
+    /**
+     * @brief Gets the number of slots in use
+     * @return Slot count
+     */
+    size_t count() const { return slotCount; }
+
+    /**
+     * @brief Sets the read interval of a slot
+     * @param idx Slot index
+     * @param intervalMs Interval in ms
+     */
+    void setInterval(size_t idx, uint32_t intervalMs);
+
+    /**
+     * @brief Gets the scheduling state of a slot
+     * @param idx Slot index
+     * @return Slot state
+     */
+    const scheduleSlot_t& slot(size_t idx) const { return slots[idx]; }
+
+    /**
+     * @brief Gets the slot with the earliest deadline that has already expired.
+     * @param nowMs Current timestamp
+     * @return Slot index or -1 if no slot is due
+     */
+    int nextDue(uint32_t nowMs) const;
+
+    /**
+     * @brief Collects the slots to be served by one scan, ordered by deadline.
+     *
+     * A slot joins the batch if its deadline expires before the batch is
+     * expected to finish (scan cost plus the read costs of all slots already
+     * in the batch).
+     * @param nowMs Current timestamp
+     * @param scanCostMs Expected duration of the discovery scan in ms
+     * @param out Output array of slot indices
+     * @param maxOut Capacity of the output array
+     * @return Number of slot indices written to out
+     */
+    size_t collectBatch(uint32_t nowMs, uint32_t scanCostMs, uint8_t out[], size_t maxOut) const;
+
+    /**
+     * @brief Records a finished read and schedules the next deadline.
+     *
+     * The next deadline keeps the phase of the slot (deadline + interval), so
+     * short delays do not accumulate drift. If the slot fell more than one
+     * interval behind, it is rescheduled relative to now.
+     * @param idx Slot index
+     * @param nowMs Completion timestamp
+     * @param durationMs Duration of the read in ms
+     */
+    void complete(size_t idx, uint32_t nowMs, uint32_t durationMs);
+
+    /**
+     * @brief Moves the deadline of a slot without recording a read.
+     * @param idx Slot index
+     * @param deadlineMs New deadline
+     */
+    void defer(size_t idx, uint32_t deadlineMs);
+
+    /**
+     * @brief Makes a slot due immediately.
+     * @param idx Slot index
+     * @param nowMs Current timestamp
+     */
+    void trigger(size_t idx, uint32_t nowMs);
+
+    /**
+     * @brief Makes all slots due immediately.
+     * @param nowMs Current timestamp
+     */
+    void triggerAll(uint32_t nowMs);
+
+protected:
+    scheduleSlot_t slots[SCHEDULER_MAX_SLOTS];
+    size_t slotCount = 0;
+};
@@ -0,0 +1,107 @@
+#include <string.h>
+
+#include "readingExport.h"
+
+
+bool exportParseFormat(const char* name, exportFormat_t& format) {
+    if (strcmp(name, "csv") == 0) {
+        format = EXPORT_CSV;
+    } else if (strcmp(name, "ndjson") == 0) {
+        format = EXPORT_NDJSON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* exportContentType(exportFormat_t format) {
+    return format == EXPORT_CSV ? "text/csv" : "application/x-ndjson";
+}
+
+
+ExportQuery::ExportQuery(ReadingLog& log, exportFormat_t format, uint32_t from, uint32_t to, uint16_t fields, int sensor)
+    : log(log), format(format), from(from), to(to), fields(fields), sensor(sensor) {
+}
+
+void ExportQuery::seek() {
+    // the first record of each segment bounds its time range
+    logExtent_t extent = log.extent();
+    sequence = extent.firstSeq;
+    for (uint32_t seq = extent.tailSeq; seq > extent.firstSeq; seq--) {
+        if (log.read(seq, 0, block, 1) == 1 && block[0].record.time <= from) {
+            sequence = seq;
+            break;
+        }
+    }
+    index = 0;
+}
+
+bool ExportQuery::fetch() {
+    for (;;) {
+        logExtent_t extent = log.extent();
+        if (sequence < extent.firstSeq) {
+            // rotated away while exporting
+            sequence = extent.firstSeq;
+            index = 0;
+        }
+        blockCount = log.read(sequence, index, block, LOG_BATCH_RECORDS);
+        blockPos = 0;
+        fetches++;
+        if (blockCount) {
+            index += blockCount;
+            return true;
+        }
+        // end of the segment or a corrupted record: continue with the next one
+        if (sequence >= extent.tailSeq) return false;
+        sequence++;
+        index = 0;
+    }
+}
+
+bool ExportQuery::next() {
+    if (finished) return false;
+    if (!started) {
+        started = true;
+        seek();
+        if (format == EXPORT_CSV) {
+            lineLength = historyFormatHeader(fields, line, sizeof(line) - 1);
+            line[lineLength++] = '\n';
+            linePos = 0;
+            return true;
+        }
+    }
+    for (;;) {
+        if (blockPos >= blockCount) {
+            if (fetches >= EXPORT_FETCHES_PER_READ) return false; // continue with the next chunk
+            if (!fetch()) {
+                finished = true;
+                return false;
+            }
+        }
+        const historyRecord_t& record = block[blockPos++].record;
+        if (record.time < from || record.time > to) continue;
+        if (sensor >= 0 && record.sensor != sensor) continue;
+
+        historyFormat_t recordFormat = format == EXPORT_CSV ? HISTORY_FORMAT_CSV : HISTORY_FORMAT_JSON;
+        lineLength = historyFormat(record, fields, recordFormat, line, sizeof(line) - 1);
+        line[lineLength++] = '\n';
+        linePos = 0;
+        recordCount++;
+        return true;
+    }
+}
+
+size_t ExportQuery::read(uint8_t buffer[], size_t maxLength) {
+    size_t written = 0;
+    fetches = 0;
+    while (written < maxLength) {
+        if (linePos >= lineLength && !next()) break;
+        size_t length = lineLength - linePos;
+        if (length > maxLength - written) length = maxLength - written;
+        memcpy(buffer + written, line + linePos, length);
+        linePos += length;
+        written += length;
+    }
+    byteCount += written;
+    return written;
+}
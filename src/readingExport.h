@@ -0,0 +1,121 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "readingHistory.h"
+#include "readingLog.h"
+
+/*
+ * Export of the readings stored in the reading log as CSV or NDJSON.
+ *
+ * The export is pulled chunk by chunk by the web server: records are read
+ * from flash in blocks of LOG_BATCH_RECORDS and formatted one line at a
+ * time into the chunk buffer, so memory use does not depend on the size of
+ * the export. Segments rotated away during a long export are skipped.
+ * The export runs on the web server task while the loop appends to the log;
+ * it only uses the reader side of ReadingLog (extent(), read()).
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define EXPORT_FETCHES_PER_READ 4   /**< Block reads per chunk, keeps the web task short when few records match */
+
+/**
+ * @brief Export format
+ */
+enum exportFormat_t : uint8_t
+{
+    EXPORT_CSV,     /**< Header line and one row per reading */
+    EXPORT_NDJSON   /**< One JSON object per line */
+};
+
+/**
+ * @brief Parses a format name ("csv", "ndjson")
+ * @return true if known
+ */
+bool exportParseFormat(const char* name, exportFormat_t& format);
+
+/**
+ * @brief Gets the content type of a format
+ */
+const char* exportContentType(exportFormat_t format);
+
+/**
+ * @brief Streams the stored readings of a time range, oldest first
+ */
+class ExportQuery {
+public:
+    /**
+     * @brief Prepares an export, the log is not read before the first chunk
+     * @param log Reading log
+     * @param format Output format
+     * @param from First timestamp (inclusive)
+     * @param to Last timestamp (inclusive)
+     * @param fields Field mask (historyField_t)
+     * @param sensor Sensor index, -1 for all sensors
+     */
+    ExportQuery(ReadingLog& log, exportFormat_t format, uint32_t from, uint32_t to, uint16_t fields, int sensor);
+
+    /**
+     * @brief Writes the next part of the export
+     *
+     * Reads at most EXPORT_FETCHES_PER_READ blocks, so it may return 0
+     * before the export is complete (see done()).
+     * @param buffer Output buffer
+     * @param maxLength Size of the buffer
+     * @return Bytes written
+     */
+    size_t read(uint8_t buffer[], size_t maxLength);
+
+    /**
+     * @brief Checks if the export is complete
+     */
+    bool done() const { return finished && linePos >= lineLength; }
+
+    /**
+     * @brief Gets the number of readings exported so far
+     */
+    uint32_t records() const { return recordCount; }
+
+    /**
+     * @brief Gets the number of bytes exported so far
+     */
+    size_t bytes() const { return byteCount; }
+
+protected:
+    /**
+     * @brief Finds the newest segment starting at or before from
+     */
+    void seek();
+
+    /**
+     * @brief Reads the next block of records
+     * @return false at the end of the log
+     */
+    bool fetch();
+
+    /**
+     * @brief Formats the next matching record (or the CSV header) into line
+     * @return false if the export is complete or the fetch limit is reached
+     */
+    bool next();
+
+    ReadingLog& log;
+    exportFormat_t format;
+    uint32_t from;
+    uint32_t to;
+    uint16_t fields;
+    int sensor;
+    bool started = false;
+    bool finished = false;
+    uint32_t sequence = 0;      /**< Segment of the next block */
+    uint32_t index = 0;         /**< Record index of the next block */
+    size_t fetches = 0;         /**< Block reads in the current read() */
+    logRecord_t block[LOG_BATCH_RECORDS];
+    size_t blockCount = 0;
+    size_t blockPos = 0;
+    char line[HISTORY_LINE_LENGTH];
+    size_t lineLength = 0;
+    size_t linePos = 0;         /**< Bytes of line already sent */
+    uint32_t recordCount = 0;
+    size_t byteCount = 0;
+};
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "readingHistory.h"
+
+
+/**
+ * @brief Measurement field of a record: name (as in /status), mask bit, raw value, decimals
+ */
+struct historyFieldInfo_t
+{
+    const char* name;
+    uint16_t flag;
+    yc01Quantity_t quantity;
+    int decimals;
+};
+
+static const historyFieldInfo_t historyFields[] = {
+    {"pH",   HISTORY_FIELD_PH,   YC01_PH,   2},
+    {"ec",   HISTORY_FIELD_EC,   YC01_EC,   0},
+    {"salt", HISTORY_FIELD_SALT, YC01_EC,   2}, // derived from EC
+    {"tds",  HISTORY_FIELD_TDS,  YC01_TDS,  0},
+    {"orp",  HISTORY_FIELD_ORP,  YC01_ORP,  0},
+    {"cl",   HISTORY_FIELD_CL,   YC01_CL,   2},
+    {"temp", HISTORY_FIELD_TEMP, YC01_TEMP, 1},
+    {"bat",  HISTORY_FIELD_BAT,  YC01_BAT,  0},
+};
+
+uint16_t historyParseFields(const char* list) {
+    if (!list || !*list) return HISTORY_FIELD_ALL;
+    uint16_t mask = 0;
+    while (*list) {
+        const char* end = strchr(list, ',');
+        size_t length = end ? (size_t)(end - list) : strlen(list);
+        uint16_t flag = 0;
+        if (length == 7 && strncmp(list, "bleRSSI", 7) == 0) {
+            flag = HISTORY_FIELD_RSSI;
+        }
+        for (const historyFieldInfo_t& field : historyFields) {
+            if (strlen(field.name) == length && strncmp(list, field.name, length) == 0) flag = field.flag;
+        }
+        if (!flag) return 0; // unknown name
+        mask |= flag;
+        list += length;
+        if (*list == ',') list++;
+    }
+    return mask;
+}
+
+size_t historyFormat(const historyRecord_t& record, uint16_t fields, historyFormat_t format, char out[], size_t length) {
+    bool csv = format == HISTORY_FORMAT_CSV;
+    int used = snprintf(out, length, csv ? "%u,%u" : "{\"time\":%u,\"sensor\":%u", (unsigned)record.time, (unsigned)record.sensor);
+    for (const historyFieldInfo_t& field : historyFields) {
+        if (!(fields & field.flag) || (size_t)used >= length) continue;
+        int16_t raw = record.raw[field.quantity];
+        float value = field.flag == HISTORY_FIELD_SALT ? yc01Salt(raw) : yc01Value(field.quantity, raw);
+        if (csv) {
+            used += snprintf(out + used, length - used, ",%.*f", field.decimals, value);
+        } else {
+            used += snprintf(out + used, length - used, ",\"%s\":%.*f", field.name, field.decimals, value);
+        }
+    }
+    if ((fields & HISTORY_FIELD_RSSI) && (size_t)used < length) {
+        used += snprintf(out + used, length - used, csv ? ",%d" : ",\"bleRSSI\":%d", record.rssi);
+    }
+    if (!csv && (size_t)used < length) {
+        used += snprintf(out + used, length - used, "}");
+    }
+    return (size_t)used < length ? used : length - 1;
+}
+
+size_t historyFormatHeader(uint16_t fields, char out[], size_t length) {
+    int used = snprintf(out, length, "time,sensor");
+    for (const historyFieldInfo_t& field : historyFields) {
+        if ((fields & field.flag) && (size_t)used < length) {
+            used += snprintf(out + used, length - used, ",%s", field.name);
+        }
+    }
+    if ((fields & HISTORY_FIELD_RSSI) && (size_t)used < length) {
+        used += snprintf(out + used, length - used, ",bleRSSI");
+    }
+    return (size_t)used < length ? used : length - 1;
+}
+
+
+bool historyRecordFrom(uint8_t sensor, const sensorReadings_t& readings, historyRecord_t& record) {
+    if (!readings.type || readings.time < HISTORY_MIN_TIME) return false;
+    record.time = (uint32_t)readings.time;
+    record.sensor = sensor;
+    record.type = readings.type;
+    record.rssi = readings.rssi;
+    memcpy(record.raw, readings.raw, sizeof(record.raw));
+    record.reserved = 0;
+    return true;
+}
+
+
+void ReadingHistory::clear() {
+    head.store(0, std::memory_order_release);
+    lastTime = 0;
+}
+
+void ReadingHistory::append(const historyRecord_t& record) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    // the slot of h still holds record h - HISTORY_CAPACITY: readers that see the
+    // new data below also see head == h and discard their copy
+    std::atomic_thread_fence(std::memory_order_release);
+    historyRecord_t& slot = records[h & (HISTORY_CAPACITY - 1)];
+    slot = record;
+    if (slot.time < lastTime) slot.time = lastTime;
+    lastTime = slot.time;
+    head.store(h + 1, std::memory_order_release); // publish the record
+}
+
+bool ReadingHistory::append(uint8_t sensor, const sensorReadings_t& readings) {
+    historyRecord_t record;
+    if (!historyRecordFrom(sensor, readings, record)) return false;
+    append(record);
+    return true;
+}
+
+uint32_t ReadingHistory::begin() const {
+    // the oldest slot is the next one to be overwritten, it is not readable
+    uint32_t h = end();
+    return h >= HISTORY_CAPACITY ? h - (HISTORY_CAPACITY - 1) : 0;
+}
+
+bool ReadingHistory::get(uint32_t seq, historyRecord_t& record) const {
+    if (end() - seq - 1 >= HISTORY_CAPACITY - 1) return false; // not written yet or overwritten
+    record = records[seq & (HISTORY_CAPACITY - 1)];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // valid if the writer did not start on the slot while copying
+    return head.load(std::memory_order_relaxed) - seq < HISTORY_CAPACITY;
+}
+
+uint32_t ReadingHistory::lowerBound(uint32_t time) const {
+    uint32_t lo = begin();
+    uint32_t hi = end();
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        historyRecord_t record;
+        if (!get(mid, record) || record.time < time) {
+            lo = mid + 1; // overwritten records are older than any stored one
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+
+HistoryQuery::HistoryQuery(const ReadingHistory& history, uint32_t from, uint32_t to, uint16_t fields, int sensor)
+    : history(history), seq(history.lowerBound(from)), to(to), fields(fields), sensor(sensor) {
+}
+
+bool HistoryQuery::next() {
+    if (closed) return false;
+    historyRecord_t record;
+    uint32_t oldest = history.begin();
+    if ((int32_t)(seq - oldest) < 0) seq = oldest; // fell behind the writer
+    for (uint32_t end = history.end(); seq != end; seq++) {
+        if (!history.get(seq, record)) continue;
+        if (record.time > to) break;
+        if (sensor >= 0 && record.sensor != sensor) continue;
+
+        seq++;
+        size_t prefix = snprintf(line, sizeof(line), "%s", first ? "[\n" : ",\n");
+        lineLength = prefix + historyFormat(record, fields, HISTORY_FORMAT_JSON, line + prefix, sizeof(line) - prefix);
+        linePos = 0;
+        first = false;
+        return true;
+    }
+    lineLength = snprintf(line, sizeof(line), "%s]\n", first ? "[" : "\n");
+    linePos = 0;
+    closed = true;
+    return true;
+}
+
+size_t HistoryQuery::read(uint8_t buffer[], size_t maxLength) {
+    size_t written = 0;
+    while (written < maxLength) {
+        if (linePos >= lineLength && !next()) break;
+        size_t length = lineLength - linePos;
+        if (length > maxLength - written) length = maxLength - written;
+        memcpy(buffer + written, line + linePos, length);
+        linePos += length;
+        written += length;
+    }
+    return written;
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "yc01Codec.h"
+
+/*
+ * In-RAM time series of the readings of all sensors.
+ *
+ * A fixed-capacity ring of fixed-size records, ordered by timestamp, so a
+ * time range is found by binary search. The loop appends (single writer),
+ * web requests read concurrently: records are addressed by a running
+ * sequence number and a reader checks after each copy that the record was
+ * not overwritten meanwhile (as a seqlock), so neither side takes a lock.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define HISTORY_CAPACITY 512            /**< Records kept in RAM (power of two) */
+#define HISTORY_MIN_TIME 1577836800     /**< Readings before 2020-01-01 (clock not set yet) are not stored */
+#define HISTORY_LINE_LENGTH 256         /**< Buffer size of one formatted record */
+
+static_assert((HISTORY_CAPACITY & (HISTORY_CAPACITY - 1)) == 0, "HISTORY_CAPACITY must be a power of two");
+
+/**
+ * @brief One stored reading, packed fixed point as received (24 bytes)
+ */
+struct historyRecord_t
+{
+    uint32_t time;      /**< Timestamp (UTC seconds) */
+    uint8_t sensor;     /**< Sensor index in the registry */
+    uint8_t type;       /**< Sensor type identifier */
+    int16_t rssi;       /**< BLE signal strength */
+    int16_t raw[YC01_QUANTITIES];   /**< Measurements, fixed point (see YC01_FIELDS) */
+    uint16_t reserved;  /**< Zero, keeps the CRC of a stored record free of padding */
+};
+
+static_assert(sizeof(historyRecord_t) == 24, "unexpected history record size");
+
+/**
+ * @brief Selectable measurement fields of a history query
+ */
+enum historyField_t : uint16_t
+{
+    HISTORY_FIELD_PH    = 1 << 0,
+    HISTORY_FIELD_EC    = 1 << 1,
+    HISTORY_FIELD_SALT  = 1 << 2,
+    HISTORY_FIELD_TDS   = 1 << 3,
+    HISTORY_FIELD_ORP   = 1 << 4,
+    HISTORY_FIELD_CL    = 1 << 5,
+    HISTORY_FIELD_TEMP  = 1 << 6,
+    HISTORY_FIELD_BAT   = 1 << 7,
+    HISTORY_FIELD_RSSI  = 1 << 8,
+    HISTORY_FIELD_ALL   = 0x1FF
+};
+
+/**
+ * @brief Builds the record of a reading
+ * @param sensor Sensor index
+ * @param readings Readings with timestamp
+ * @param record Output record
+ * @return false if the reading is invalid or its clock was not set
+ */
+bool historyRecordFrom(uint8_t sensor, const sensorReadings_t& readings, historyRecord_t& record);
+
+/**
+ * @brief Parses a comma separated field list ("pH,orp,temp", names as in /status)
+ * @param list Field names, empty or nullptr for all fields
+ * @return Field mask, 0 if a name is unknown
+ */
+uint16_t historyParseFields(const char* list);
+
+/**
+ * @brief Output format of a record
+ */
+enum historyFormat_t : uint8_t
+{
+    HISTORY_FORMAT_JSON,    /**< JSON object, as in /history */
+    HISTORY_FORMAT_CSV      /**< CSV row, columns as historyFormatHeader() */
+};
+
+/**
+ * @brief Formats a record
+ * @param record Record
+ * @param fields Field mask (historyField_t)
+ * @param format Output format
+ * @param out Output buffer
+ * @param length Size of the buffer
+ * @return Length of the text (without line break)
+ */
+size_t historyFormat(const historyRecord_t& record, uint16_t fields, historyFormat_t format, char out[], size_t length);
+
+/**
+ * @brief Formats the CSV header line of a field mask
+ * @return Length of the text (without line break)
+ */
+size_t historyFormatHeader(uint16_t fields, char out[], size_t length);
+
+/**
+ * @brief Fixed-capacity ring of readings ordered by time
+ *
+ * Records are addressed by sequence numbers: begin() is the oldest record
+ * still stored, end() the next one to be written.
+ */
+class ReadingHistory {
+public:
+    /**
+     * @brief Removes all records (not safe against concurrent readers)
+     */
+    void clear();
+
+    /**
+     * @brief Appends a record (writer side)
+     *
+     * A timestamp before the last record is raised to the last timestamp,
+     * so the ring stays sorted when the clock is set back.
+     * @param record Record (see historyRecordFrom)
+     */
+    void append(const historyRecord_t& record);
+
+    /**
+     * @brief Appends a reading (writer side)
+     * @param sensor Sensor index
+     * @param readings Readings with timestamp
+     * @return false if the reading is invalid or its clock was not set
+     */
+    bool append(uint8_t sensor, const sensorReadings_t& readings);
+
+    /**
+     * @brief Gets the sequence number of the oldest stored record
+     */
+    uint32_t begin() const;
+
+    /**
+     * @brief Gets the sequence number following the newest record
+     */
+    uint32_t end() const { return head.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Gets the number of stored records
+     */
+    size_t size() const { return end() - begin(); }
+
+    /**
+     * @brief Finds the first record at or after a timestamp (binary search)
+     * @param time Timestamp
+     * @return Sequence number, end() if all records are older
+     */
+    uint32_t lowerBound(uint32_t time) const;
+
+    /**
+     * @brief Copies a record
+     * @param seq Sequence number
+     * @param record Output record
+     * @return false if the record is not stored (not written yet or overwritten)
+     */
+    bool get(uint32_t seq, historyRecord_t& record) const;
+
+protected:
+    historyRecord_t records[HISTORY_CAPACITY];
+    std::atomic<uint32_t> head{0};  /**< Sequence number of the next record, owned by the writer */
+    uint32_t lastTime = 0;          /**< Timestamp of the newest record (writer side) */
+};
+
+/**
+ * @brief Streams the records of a time range as JSON array, one chunk at a time
+ *
+ * Keeps only a cursor and one formatted record, so the response never has to
+ * be built in memory. Records overwritten while the response is sent are
+ * skipped.
+ */
+class HistoryQuery {
+public:
+    /**
+     * @brief Prepares a query
+     * @param history Ring to read
+     * @param from First timestamp (inclusive)
+     * @param to Last timestamp (inclusive)
+     * @param fields Field mask (historyField_t)
+     * @param sensor Sensor index, -1 for all sensors
+     */
+    HistoryQuery(const ReadingHistory& history, uint32_t from, uint32_t to, uint16_t fields, int sensor);
+
+    /**
+     * @brief Writes the next part of the response
+     * @param buffer Output buffer
+     * @param maxLength Size of the buffer
+     * @return Bytes written, 0 when the response is complete
+     */
+    size_t read(uint8_t buffer[], size_t maxLength);
+
+protected:
+    /**
+     * @brief Formats the next matching record (or the closing bracket) into line
+     * @return false if the response is complete
+     */
+    bool next();
+
+    const ReadingHistory& history;
+    uint32_t seq;               /**< Next record to look at */
+    uint32_t to;
+    uint16_t fields;
+    int sensor;
+    bool first = true;          /**< No record written yet */
+    bool closed = false;        /**< Closing bracket formatted */
+    char line[HISTORY_LINE_LENGTH];
+    size_t lineLength = 0;
+    size_t linePos = 0;         /**< Bytes of line already sent */
+};
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "readingLog.h"
+
+
+uint32_t logCrc32(const void* data, size_t length, uint32_t crc) {
+    // half-byte table: 64 bytes instead of 1 KiB, fast enough for a batch per write
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t* bytes = (const uint8_t*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = (crc >> 4) ^ table[(crc ^ bytes[i]) & 0x0F];
+        crc = (crc >> 4) ^ table[(crc ^ (bytes[i] >> 4)) & 0x0F];
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Checks the CRC of a stored record
+ */
+static inline bool recordValid(const logRecord_t& entry) {
+    return logCrc32(&entry.record, sizeof(entry.record)) == entry.crc;
+}
+
+const char* ReadingLog::segmentPath(uint32_t sequence, char path[LOG_PATH_LENGTH]) {
+    snprintf(path, LOG_PATH_LENGTH, LOG_DIR "/seg%u.bin", (unsigned)(sequence % LOG_SEGMENTS));
+    return path;
+}
+
+bool ReadingLog::readHeader(const char* path, logSegmentHeader_t& header) {
+    return files->read(path, 0, (uint8_t*)&header, sizeof(header)) == sizeof(header) && header.magic == LOG_MAGIC &&
+        header.crc == logCrc32(&header, offsetof(logSegmentHeader_t, crc));
+}
+
+void ReadingLog::setExtent(uint32_t first, uint32_t tail, uint32_t records) {
+    version.fetch_add(1, std::memory_order_relaxed); // odd: writing
+    std::atomic_thread_fence(std::memory_order_release);
+    firstSeq = first;
+    tailSeq = tail;
+    tailRecords = records;
+    version.fetch_add(1, std::memory_order_release); // even: consistent
+}
+
+logExtent_t ReadingLog::extent() const {
+    logExtent_t view;
+    for (;;) {
+        uint32_t before = version.load(std::memory_order_acquire);
+        view.firstSeq = firstSeq;
+        view.tailSeq = tailSeq;
+        view.tailRecords = tailRecords;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!(before & 1) && version.load(std::memory_order_relaxed) == before) break;
+    }
+    return view;
+}
+
+bool ReadingLog::startSegment(uint32_t sequence) {
+    char path[LOG_PATH_LENGTH];
+    segmentPath(sequence, path);
+    logSegmentHeader_t header;
+    header.magic = LOG_MAGIC;
+    header.sequence = sequence;
+    header.crc = logCrc32(&header, offsetof(logSegmentHeader_t, crc));
+    // the oldest segment is dropped before its slot is reused, readers learn it first
+    uint32_t oldest = sequence >= LOG_SEGMENTS ? sequence - (LOG_SEGMENTS - 1) : 1;
+    uint32_t first = firstSeq < oldest ? oldest : firstSeq;
+    setExtent(first, tailSeq, tailRecords);
+    if (!files->remove(path) || !files->append(path, (const uint8_t*)&header, sizeof(header))) {
+        return false;
+    }
+    setExtent(first, sequence, 0);
+    return true;
+}
+
+bool ReadingLog::begin(LogFiles& logFiles, void (*onRecord)(const historyRecord_t& record)) {
+    files = &logFiles;
+    recovered = {};
+    batchCount = 0;
+    setExtent(0, 0, 0);
+
+    // the headers tell which segment is the tail
+    char path[LOG_PATH_LENGTH];
+    uint32_t first = 0, tail = 0;
+    for (uint32_t slot = 0; slot < LOG_SEGMENTS; slot++) {
+        logSegmentHeader_t header;
+        segmentPath(slot, path);
+        if (!files->size(path)) continue;
+        recovered.bytesRead += sizeof(header);
+        if (!readHeader(path, header) || header.sequence % LOG_SEGMENTS != slot) continue;
+        if (!first || header.sequence < first) first = header.sequence;
+        if (header.sequence > tail) tail = header.sequence;
+    }
+    if (!tail) {
+        setExtent(1, 0, 0);
+        return startSegment(1); // empty log
+    }
+
+    // scan the tail segment up to the first invalid record
+    segmentPath(tail, path);
+    size_t size = files->size(path);
+    size_t stored = (size - sizeof(logSegmentHeader_t)) / sizeof(logRecord_t);
+    bool partial = (size - sizeof(logSegmentHeader_t)) % sizeof(logRecord_t) != 0;
+    uint32_t valid = 0;
+    bool corrupted = false;
+    while (valid < stored && !corrupted) {
+        size_t count = stored - valid < LOG_BATCH_RECORDS ? stored - valid : LOG_BATCH_RECORDS;
+        size_t offset = sizeof(logSegmentHeader_t) + valid * sizeof(logRecord_t);
+        size_t length = files->read(path, offset, (uint8_t*)batch, count * sizeof(logRecord_t));
+        recovered.bytesRead += length;
+        for (size_t i = 0; i < count; i++) {
+            if (length < (i + 1) * sizeof(logRecord_t) || !recordValid(batch[i])) {
+                corrupted = true;
+                break;
+            }
+            if (onRecord) onRecord(batch[i].record);
+            valid++;
+        }
+    }
+    setExtent(first, tail, valid);
+    recovered.sequence = tailSeq;
+    recovered.records = valid;
+    recovered.torn = partial || corrupted;
+    if (recovered.torn) {
+        // appending behind garbage would hide the new records, seal the segment instead
+        return startSegment(tailSeq + 1);
+    }
+    return true;
+}
+
+bool ReadingLog::flush() {
+    if (!files) return false;
+    char path[LOG_PATH_LENGTH];
+    size_t done = 0;
+    while (done < batchCount) {
+        if (tailRecords >= LOG_SEGMENT_RECORDS && !startSegment(tailSeq + 1)) break;
+        size_t count = batchCount - done;
+        if (count > LOG_SEGMENT_RECORDS - tailRecords) count = LOG_SEGMENT_RECORDS - tailRecords;
+        if (!files->append(segmentPath(tailSeq, path), (const uint8_t*)&batch[done], count * sizeof(logRecord_t))) {
+            // the segment may end in a partial record now, continue in a new one
+            startSegment(tailSeq + 1);
+            break;
+        }
+        writeCount++;
+        recordCount += count;
+        setExtent(firstSeq, tailSeq, tailRecords + count);
+        done += count;
+    }
+    if (done) {
+        memmove(batch, &batch[done], (batchCount - done) * sizeof(logRecord_t));
+        batchCount -= done;
+    }
+    return batchCount == 0;
+}
+
+bool ReadingLog::append(const historyRecord_t& record, uint32_t nowMs) {
+    if (batchCount >= LOG_BATCH_RECORDS && !flush()) {
+        return false; // writes keep failing, drop the new record
+    }
+    if (batchCount == 0) batchSinceMs = nowMs;
+    batch[batchCount].record = record;
+    batch[batchCount].crc = logCrc32(&record, sizeof(record));
+    batchCount++;
+    return batchCount < LOG_BATCH_RECORDS || flush();
+}
+
+bool ReadingLog::flushDue(uint32_t nowMs) {
+    if (batchCount == 0 || nowMs - batchSinceMs < LOG_BATCH_MAX_AGE_MS) return true;
+    return flush();
+}
+
+bool ReadingLog::read(uint32_t sequence, uint32_t index, historyRecord_t& record) {
+    logRecord_t entry;
+    if (read(sequence, index, &entry, 1) != 1) return false;
+    record = entry.record;
+    return true;
+}
+
+size_t ReadingLog::read(uint32_t sequence, uint32_t index, logRecord_t entries[], size_t count) {
+    logExtent_t view = extent();
+    if (!files || sequence < view.firstSeq || sequence > view.tailSeq || index >= LOG_SEGMENT_RECORDS) return 0;
+    uint32_t stored = sequence == view.tailSeq ? view.tailRecords : LOG_SEGMENT_RECORDS;
+    if (index >= stored) return 0;
+    if (count > stored - index) count = stored - index;
+
+    char path[LOG_PATH_LENGTH];
+    segmentPath(sequence, path);
+    logSegmentHeader_t header;
+    if (!readHeader(path, header) || header.sequence != sequence) return 0;
+    size_t offset = sizeof(logSegmentHeader_t) + index * sizeof(logRecord_t);
+    size_t length = files->read(path, offset, (uint8_t*)entries, count * sizeof(logRecord_t));
+    size_t valid = 0;
+    while (valid < length / sizeof(logRecord_t) && recordValid(entries[valid])) valid++;
+    // the writer publishes a rotation before it removes the file: the records may be of the new segment
+    if (extent().firstSeq > sequence) return 0;
+    return valid;
+}
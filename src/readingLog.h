@@ -0,0 +1,246 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "readingHistory.h"
+
+/*
+ * Crash-safe append-only log of readings on flash.
+ *
+ * The log is a ring of LOG_SEGMENTS segment files. Each segment starts with
+ * a header holding its sequence number and is followed by fixed-size
+ * records, each protected by a CRC32. Records are collected in RAM and
+ * written in batches, so the filesystem commits (and rewrites the last flash
+ * block) once per batch instead of once per reading. At boot only the
+ * headers and the newest segment are read; a torn or corrupted tail is
+ * sealed by starting a new segment.
+ * One task writes (begin(), append(), flush*()), on the device the loop.
+ * read() and extent() may run at the same time on another task (the web
+ * server's export): they see a consistent extent, and a read that overlaps
+ * the rotation of its segment returns nothing.
+ * This module is plain C++ (no Arduino / NimBLE dependencies), the files are
+ * accessed through LogFiles (see readingLogFs.h for LittleFS and
+ * test/native/memoryFiles.h for a host stand-in).
+ */
+
+#define LOG_DIR "/log"                  /**< Directory of the segment files */
+#define LOG_SEGMENTS 4                  /**< Segment files in the ring */
+#define LOG_SEGMENT_RECORDS 584         /**< Records per segment (16 KiB files) */
+#define LOG_BATCH_RECORDS 16            /**< Records collected before a write */
+#define LOG_BATCH_MAX_AGE_MS 900000     /**< Longest time a record waits in RAM (15 min) */
+#define LOG_MAGIC 0x324C4359            /**< "YCL2", segment header magic and layout version */
+#define LOG_PATH_LENGTH 24              /**< Buffer size of a segment path */
+
+/**
+ * @brief Header at the start of every segment file
+ */
+struct logSegmentHeader_t
+{
+    uint32_t magic;         /**< LOG_MAGIC */
+    uint32_t sequence;      /**< Running number of the segment, the highest is the tail */
+    uint32_t crc;           /**< CRC32 of magic and sequence */
+};
+
+/**
+ * @brief One record as stored on flash
+ */
+struct logRecord_t
+{
+    historyRecord_t record; /**< Reading */
+    uint32_t crc;           /**< CRC32 of record */
+};
+
+static_assert(sizeof(logSegmentHeader_t) + LOG_SEGMENT_RECORDS * sizeof(logRecord_t) <= 16384, "segment exceeds 16 KiB");
+
+/**
+ * @brief Computes a CRC32 (IEEE 802.3, as zlib)
+ * @param data Data
+ * @param length Length of the data
+ * @param crc CRC of the preceding data, 0 to start
+ * @return CRC
+ */
+uint32_t logCrc32(const void* data, size_t length, uint32_t crc = 0);
+
+/**
+ * @brief File access of the log
+ *
+ * append() must only return once the data is committed (file closed or
+ * synced), so a power loss keeps either the old or the new file length.
+ */
+class LogFiles {
+public:
+    virtual ~LogFiles() {}
+
+    /**
+     * @brief Gets the size of a file
+     * @return Size in bytes, 0 if it does not exist
+     */
+    virtual size_t size(const char* path) = 0;
+
+    /**
+     * @brief Reads from a file
+     * @return Bytes read
+     */
+    virtual size_t read(const char* path, size_t offset, uint8_t data[], size_t length) = 0;
+
+    /**
+     * @brief Appends to a file (created if missing) and commits it
+     * @return true if all bytes were written
+     */
+    virtual bool append(const char* path, const uint8_t data[], size_t length) = 0;
+
+    /**
+     * @brief Deletes a file
+     * @return true if the file does not exist afterwards
+     */
+    virtual bool remove(const char* path) = 0;
+};
+
+/**
+ * @brief Outcome of the recovery at boot
+ */
+struct logRecovery_t
+{
+    uint32_t sequence;      /**< Tail segment */
+    uint32_t records;       /**< Valid records in the tail segment */
+    bool torn;              /**< The tail ended in a partial or corrupted record, a new segment was started */
+    size_t bytesRead;       /**< Bytes read during recovery */
+};
+
+/**
+ * @brief Segments stored in the log, as published to readers
+ */
+struct logExtent_t
+{
+    uint32_t firstSeq;      /**< Oldest segment */
+    uint32_t tailSeq;       /**< Tail segment */
+    uint32_t tailRecords;   /**< Records written to the tail segment */
+};
+
+/**
+ * @brief Segment-rotated append-only log of readings
+ */
+class ReadingLog {
+public:
+    /**
+     * @brief Finds the tail segment and validates its records
+     * @param files File access
+     * @param onRecord Called for every valid record of the tail segment (optional)
+     * @return false if the log cannot be written
+     */
+    bool begin(LogFiles& files, void (*onRecord)(const historyRecord_t& record) = nullptr);
+
+    /**
+     * @brief Adds a record, writes the batch when it is full
+     * @param record Record
+     * @param nowMs Current timestamp (millis)
+     * @return false if a write failed (the batch is kept and retried)
+     */
+    bool append(const historyRecord_t& record, uint32_t nowMs);
+
+    /**
+     * @brief Writes the batch if its oldest record waited LOG_BATCH_MAX_AGE_MS
+     * @param nowMs Current timestamp (millis)
+     * @return false if a write failed
+     */
+    bool flushDue(uint32_t nowMs);
+
+    /**
+     * @brief Writes the batch now (e.g. before a reboot)
+     * @return false if a write failed
+     */
+    bool flush();
+
+    /**
+     * @brief Gets the number of records waiting in RAM
+     */
+    size_t pending() const { return batchCount; }
+
+    /**
+     * @brief Gets the stored segments (any task)
+     * @return Consistent snapshot of oldest segment, tail segment and tail records
+     */
+    logExtent_t extent() const;
+
+    /**
+     * @brief Gets the sequence number of the oldest segment (any task)
+     */
+    uint32_t firstSequence() const { return extent().firstSeq; }
+
+    /**
+     * @brief Gets the sequence number of the tail segment (any task)
+     */
+    uint32_t lastSequence() const { return extent().tailSeq; }
+
+    /**
+     * @brief Reads a stored record (any task)
+     * @param sequence Segment (firstSequence() .. lastSequence())
+     * @param index Record index in the segment
+     * @param record Output record
+     * @return false at the end of the segment, on a CRC error or if the segment was replaced
+     */
+    bool read(uint32_t sequence, uint32_t index, historyRecord_t& record);
+
+    /**
+     * @brief Reads consecutive stored records of a segment with one file read (any task)
+     *
+     * The segment is checked again after the file read: if the writer started
+     * to replace its file meanwhile, nothing is returned.
+     * @param sequence Segment (firstSequence() .. lastSequence())
+     * @param index Index of the first record in the segment
+     * @param entries Output records, CRC checked
+     * @param count Records to read
+     * @return Records read, less than count at the end of the segment or at a CRC error
+     */
+    size_t read(uint32_t sequence, uint32_t index, logRecord_t entries[], size_t count);
+
+    /**
+     * @brief Gets the outcome of the recovery at boot
+     */
+    const logRecovery_t& recovery() const { return recovered; }
+
+    /**
+     * @brief Gets the number of batch writes since boot
+     */
+    uint32_t writes() const { return writeCount; }
+
+    /**
+     * @brief Gets the number of records written since boot
+     */
+    uint32_t written() const { return recordCount; }
+
+    /**
+     * @brief Builds the path of the file holding a segment
+     */
+    static const char* segmentPath(uint32_t sequence, char path[LOG_PATH_LENGTH]);
+
+protected:
+    /**
+     * @brief Reads the header of a segment file
+     * @return true if the header is valid
+     */
+    bool readHeader(const char* path, logSegmentHeader_t& header);
+
+    /**
+     * @brief Replaces the oldest segment file by a new tail segment
+     */
+    bool startSegment(uint32_t sequence);
+
+    /**
+     * @brief Publishes the extent to readers (writer task)
+     */
+    void setExtent(uint32_t first, uint32_t tail, uint32_t records);
+
+    LogFiles* files = nullptr;
+    uint32_t firstSeq = 0;
+    uint32_t tailSeq = 0;
+    uint32_t tailRecords = 0;       /**< Records in the tail segment */
+    std::atomic<uint32_t> version{0};   /**< Odd while setExtent() writes (seqlock for readers) */
+    logRecord_t batch[LOG_BATCH_RECORDS];
+    size_t batchCount = 0;
+    uint32_t batchSinceMs = 0;      /**< Arrival of the oldest record of the batch */
+    uint32_t writeCount = 0;
+    uint32_t recordCount = 0;
+    logRecovery_t recovered = {};
+};
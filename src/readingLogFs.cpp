@@ -0,0 +1,33 @@
+#include <Arduino.h>
+#include <FS.h>
+
+#include "readingLogFs.h"
+
+
+size_t FSLogFiles::size(const char* path) {
+    if (!filesystem.exists(path)) return 0;
+    File file = filesystem.open(path, "r");
+    size_t length = file ? file.size() : 0;
+    file.close();
+    return length;
+}
+
+size_t FSLogFiles::read(const char* path, size_t offset, uint8_t data[], size_t length) {
+    File file = filesystem.open(path, "r");
+    if (!file) return 0;
+    size_t done = file.seek(offset) ? file.read(data, length) : 0;
+    file.close();
+    return done;
+}
+
+bool FSLogFiles::append(const char* path, const uint8_t data[], size_t length) {
+    File file = filesystem.open(path, "a", true); // creates LOG_DIR
+    if (!file) return false;
+    size_t done = file.write(data, length);
+    file.close(); // commits the write
+    return done == length;
+}
+
+bool FSLogFiles::remove(const char* path) {
+    return !filesystem.exists(path) || filesystem.remove(path);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+
+#include "readingLog.h"
+
+/**
+ * @brief LogFiles on an Arduino filesystem (LittleFS)
+ *
+ * Every append opens the file, writes and closes it; closing commits the
+ * data (LittleFS is copy-on-write, a power loss keeps the old file).
+ */
+class FSLogFiles : public LogFiles {
+public:
+    /**
+     * @param filesystem Filesystem, mounted before the first access
+     */
+    explicit FSLogFiles(fs::FS& filesystem) : filesystem(filesystem) {}
+
+    size_t size(const char* path) override;
+    size_t read(const char* path, size_t offset, uint8_t data[], size_t length) override;
+    bool append(const char* path, const uint8_t data[], size_t length) override;
+    bool remove(const char* path) override;
+
+protected:
+    fs::FS& filesystem;
+};
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "responseCache.h"
+
+
+uint32_t responseHash(const char* body, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)body[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool responseEtagMatch(const char* ifNoneMatch, const char* etag) {
+    size_t length = strlen(etag);
+    if (!length) return false;
+
+    // "*", or a list of (weak) ETags; If-None-Match compares weakly (RFC 9110 13.1.2)
+    const char* p = ifNoneMatch;
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        if (*p == '*') return true;
+        if (p[0] == 'W' && p[1] == '/') p += 2;
+        size_t n = strcspn(p, ", ");
+        if (n == length && strncmp(p, etag, n) == 0) return true;
+        p += n;
+    }
+    return false;
+}
+
+bool ResponseCache::fresh(size_t slot, uint32_t nowMs, uint32_t maxAgeMs) const {
+    if (slot >= RESPONSE_CACHE_SLOTS) return false;
+    const slot_t& s = slots[slot];
+    return s.valid && s.version == version && (!maxAgeMs || nowMs - s.builtMs < maxAgeMs);
+}
+
+void ResponseCache::store(size_t slot, const char* body, size_t length, uint32_t nowMs) {
+    if (slot >= RESPONSE_CACHE_SLOTS) return;
+    slot_t& s = slots[slot];
+    s.valid = true;
+    s.version = version;
+    s.builtMs = nowMs;
+    snprintf(s.etag, sizeof(s.etag), "\"%08x\"", (unsigned)responseHash(body, length));
+    buildCount++;
+}
+
+bool ResponseCache::notModified(size_t slot, const char* ifNoneMatch) {
+    requestCount++;
+    if (slot >= RESPONSE_CACHE_SLOTS || !slots[slot].valid || !responseEtagMatch(ifNoneMatch, slots[slot].etag)) return false;
+    hitCount++;
+    return true;
+}
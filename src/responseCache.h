@@ -0,0 +1,97 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Bookkeeping of the cached HTTP responses (/status per sensor, /config.json).
+ *
+ * A slot remembers when its body was built, against which version of the
+ * state and the ETag of the bytes (FNV-1a hash). A body is rebuilt only if
+ * the state changed since (invalidate) or it is older than the maximum age
+ * of its slot, which bounds how old fast-changing fields such as the WiFi
+ * RSSI may get. A request that already holds the current ETag
+ * (If-None-Match) is answered 304 without a body. Since the ETag is taken
+ * from the bytes, a rebuild to the same content keeps it.
+ * The bodies themselves are kept by the caller, this class holds no locks.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define RESPONSE_CACHE_SLOTS 9          /**< Cached responses (MAX_SENSORS + 1) */
+#define RESPONSE_ETAG_LENGTH 11         /**< Buffer size of an ETag, quoted 8 hex digits */
+
+/**
+ * @brief Gets the hash of a body (32-bit FNV-1a)
+ */
+uint32_t responseHash(const char* body, size_t length);
+
+/**
+ * @brief Checks an If-None-Match header against an ETag
+ * @param ifNoneMatch Header value: "*" or a comma separated list of ETags, weak ones ("W/") included
+ * @param etag Current ETag, quoted
+ * @return true if the client holds the current body (answer 304)
+ */
+bool responseEtagMatch(const char* ifNoneMatch, const char* etag);
+
+/**
+ * @brief Versions, build times and ETags of the cached responses
+ */
+class ResponseCache {
+public:
+    /**
+     * @brief Marks all slots as out of date (state changed)
+     */
+    void invalidate() { version++; }
+
+    /**
+     * @brief Checks if a slot can be served as it is
+     * @param slot Slot
+     * @param nowMs Current time in ms (millis())
+     * @param maxAgeMs Maximum age of the body, 0: no limit
+     * @return false if the slot was never built, the state changed or the body is too old
+     */
+    bool fresh(size_t slot, uint32_t nowMs, uint32_t maxAgeMs) const;
+
+    /**
+     * @brief Records a rebuilt body
+     * @param slot Slot
+     * @param body Body
+     * @param length Length of the body
+     * @param nowMs Current time in ms (millis())
+     */
+    void store(size_t slot, const char* body, size_t length, uint32_t nowMs);
+
+    /**
+     * @brief Counts a request and checks its If-None-Match header
+     * @param slot Slot
+     * @param ifNoneMatch Header value, empty if none
+     * @return true if the answer is 304
+     */
+    bool notModified(size_t slot, const char* ifNoneMatch);
+
+    /**
+     * @brief Gets the ETag of a slot ("" if never built)
+     */
+    const char* etag(size_t slot) const { return slot < RESPONSE_CACHE_SLOTS ? slots[slot].etag : ""; }
+
+    uint32_t requests() const { return requestCount; }        /**< Requests served from the cache */
+    uint32_t hits() const { return hitCount; }                /**< Requests answered 304 */
+    uint32_t builds() const { return buildCount; }            /**< Bodies rebuilt */
+
+protected:
+    /**
+     * @brief State of one cached response
+     */
+    struct slot_t
+    {
+        bool valid;                         /**< Built at least once */
+        uint32_t version;                   /**< State version the body was built from */
+        uint32_t builtMs;                   /**< Time of the build */
+        char etag[RESPONSE_ETAG_LENGTH];
+    };
+
+    slot_t slots[RESPONSE_CACHE_SLOTS] = {};
+    uint32_t version = 0;
+    uint32_t requestCount = 0;
+    uint32_t hitCount = 0;
+    uint32_t buildCount = 0;
+};
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "rollups.h"
+
+
+/**
+ * @brief Name, raw value and output precision of the quantities
+ */
+static const struct {
+    const char* name;
+    yc01Quantity_t quantity;
+    int decimals;
+} quantities[ROLLUP_QUANTITIES] = {
+    {"pH",   YC01_PH,   2},
+    {"orp",  YC01_ORP,  0},
+    {"cl",   YC01_CL,   2},
+    {"temp", YC01_TEMP, 1},
+};
+
+/**
+ * @brief Gets the fixed-point divisor of a quantity
+ */
+static inline double scale(size_t quantity) {
+    return YC01_FIELDS[quantities[quantity].quantity].scale;
+}
+
+float rollupBucket_t::avg(size_t quantity) const {
+    return count ? (float)(stats[quantity].sum / scale(quantity) / count) : 0;
+}
+
+float rollupBucket_t::min(size_t quantity) const {
+    return (float)(stats[quantity].min / scale(quantity));
+}
+
+float rollupBucket_t::max(size_t quantity) const {
+    return (float)(stats[quantity].max / scale(quantity));
+}
+
+bool rollupParseTier(const char* name, rollupTier_t& tier) {
+    for (uint8_t t = 0; t < ROLLUP_TIERS; t++) {
+        if (strcmp(name, rollupTierName((rollupTier_t)t)) == 0) {
+            tier = (rollupTier_t)t;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* rollupTierName(rollupTier_t tier) {
+    return tier == ROLLUP_HOUR ? "hour" : "day";
+}
+
+size_t rollupFormat(const rollupBucket_t& bucket, char out[], size_t length) {
+    int used = snprintf(out, length, "{\"start\":%u,\"count\":%u", (unsigned)bucket.start, (unsigned)bucket.count);
+    for (size_t q = 0; q < ROLLUP_QUANTITIES && (size_t)used < length; q++) {
+        int d = quantities[q].decimals;
+        used += snprintf(out + used, length - used, ",\"%s\":{\"min\":%.*f,\"max\":%.*f,\"avg\":%.*f}",
+            quantities[q].name, d, bucket.min(q), d, bucket.max(q), d, bucket.avg(q));
+    }
+    if ((size_t)used < length) {
+        used += snprintf(out + used, length - used, "}");
+    }
+    return (size_t)used < length ? used : length - 1;
+}
+
+
+void Rollups::begin(size_t sensors) {
+    sensorCount = sensors > ROLLUP_MAX_SENSORS ? ROLLUP_MAX_SENSORS : sensors;
+    memset(hours, 0, sizeof(hours));
+    memset(days, 0, sizeof(days));
+    memset(newestStart, 0, sizeof(newestStart));
+    memset(closedStart, 0, sizeof(closedStart));
+    newestTime = 0;
+}
+
+rollupBucket_t& Rollups::slot(size_t sensor, rollupTier_t tier, uint32_t start) {
+    size_t index = (start / period(tier)) % slots(tier);
+    return tier == ROLLUP_HOUR ? hours[sensor][index] : days[sensor][index];
+}
+
+const rollupBucket_t& Rollups::slot(size_t sensor, rollupTier_t tier, uint32_t start) const {
+    size_t index = (start / period(tier)) % slots(tier);
+    return tier == ROLLUP_HOUR ? hours[sensor][index] : days[sensor][index];
+}
+
+uint8_t Rollups::add(const historyRecord_t& record) {
+    if (record.sensor >= sensorCount) return 0;
+
+    uint8_t closedTiers = 0;
+    version.fetch_add(1, std::memory_order_relaxed); // odd: writing
+    std::atomic_thread_fence(std::memory_order_release);
+    for (uint8_t t = 0; t < ROLLUP_TIERS; t++) {
+        rollupTier_t tier = (rollupTier_t)t;
+        uint32_t start = record.time - record.time % period(tier);
+        rollupBucket_t& bucket = slot(record.sensor, tier, start);
+        if (bucket.start != start) {
+            if (bucket.start > start) continue; // older than the kept buckets
+            memset(&bucket, 0, sizeof(bucket));
+            bucket.start = start;
+        }
+        uint32_t& newest = newestStart[record.sensor][t];
+        if (start > newest) {
+            if (newest) {
+                closedStart[record.sensor][t] = newest;
+                closedTiers |= 1 << t;
+            }
+            newest = start;
+        }
+        for (size_t q = 0; q < ROLLUP_QUANTITIES; q++) {
+            int16_t value = record.raw[quantities[q].quantity];
+            rollupStats_t& stats = bucket.stats[q];
+            if (bucket.count == 0 || value < stats.min) stats.min = value;
+            if (bucket.count == 0 || value > stats.max) stats.max = value;
+            stats.sum += value;
+        }
+        if (bucket.count < UINT16_MAX) bucket.count++;
+    }
+    if (record.time > newestTime) newestTime = record.time;
+    version.fetch_add(1, std::memory_order_release); // even: consistent
+    return closedTiers;
+}
+
+bool Rollups::get(size_t sensor, rollupTier_t tier, uint32_t start, rollupBucket_t& bucket) const {
+    if (sensor >= sensorCount || tier >= ROLLUP_TIERS) return false;
+    for (;;) {
+        uint32_t before = version.load(std::memory_order_acquire);
+        bucket = slot(sensor, tier, start);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!(before & 1) && version.load(std::memory_order_relaxed) == before) break;
+    }
+    return bucket.start == start && bucket.count > 0;
+}
+
+uint32_t Rollups::newest(size_t sensor, rollupTier_t tier) const {
+    return sensor < sensorCount && tier < ROLLUP_TIERS ? newestStart[sensor][tier] : 0;
+}
+
+uint32_t Rollups::closed(size_t sensor, rollupTier_t tier) const {
+    return sensor < sensorCount && tier < ROLLUP_TIERS ? closedStart[sensor][tier] : 0;
+}
+
+bool Rollups::save(LogFiles& files) {
+    fileHeader_t header;
+    header.magic = ROLLUP_MAGIC;
+    header.sequence = ++saveSequence;
+    header.sensors = sensorCount;
+    header.lastTime = newestTime;
+    uint32_t crc = logCrc32(&header, offsetof(fileHeader_t, crc));
+    crc = logCrc32(hours, sensorCount * sizeof(hours[0]), crc);
+    header.crc = logCrc32(days, sensorCount * sizeof(days[0]), crc);
+
+    // overwrite the older file, the newer one stays valid until this is complete
+    const char* path = (header.sequence & 1) ? ROLLUP_FILE_B : ROLLUP_FILE_A;
+    return files.remove(path) &&
+        files.append(path, (const uint8_t*)&header, sizeof(header)) &&
+        files.append(path, (const uint8_t*)hours, sensorCount * sizeof(hours[0])) &&
+        files.append(path, (const uint8_t*)days, sensorCount * sizeof(days[0]));
+}
+
+bool Rollups::load(LogFiles& files) {
+    const char* paths[] = {ROLLUP_FILE_A, ROLLUP_FILE_B};
+    const char* best = nullptr;
+    fileHeader_t bestHeader = {};
+    for (const char* path : paths) {
+        fileHeader_t header;
+        size_t expected = sizeof(header) + sensorCount * (sizeof(hours[0]) + sizeof(days[0]));
+        if (files.size(path) != expected || files.read(path, 0, (uint8_t*)&header, sizeof(header)) != sizeof(header)) continue;
+        if (header.magic != ROLLUP_MAGIC || header.sensors != sensorCount) continue;
+        if (best && header.sequence < bestHeader.sequence) continue;
+
+        // read into the tiers and check the CRC
+        size_t offset = sizeof(header);
+        offset += files.read(path, offset, (uint8_t*)hours, sensorCount * sizeof(hours[0]));
+        files.read(path, offset, (uint8_t*)days, sensorCount * sizeof(days[0]));
+        uint32_t crc = logCrc32(&header, offsetof(fileHeader_t, crc));
+        crc = logCrc32(hours, sensorCount * sizeof(hours[0]), crc);
+        crc = logCrc32(days, sensorCount * sizeof(days[0]), crc);
+        if (crc != header.crc) continue;
+        best = path;
+        bestHeader = header;
+    }
+    if (!best) {
+        begin(sensorCount);
+        return false;
+    }
+    if (files.read(best, sizeof(bestHeader), (uint8_t*)hours, sensorCount * sizeof(hours[0])) != sensorCount * sizeof(hours[0]) ||
+        files.read(best, sizeof(bestHeader) + sensorCount * sizeof(hours[0]), (uint8_t*)days, sensorCount * sizeof(days[0])) != sensorCount * sizeof(days[0])) {
+        begin(sensorCount);
+        return false;
+    }
+    saveSequence = bestHeader.sequence;
+    newestTime = bestHeader.lastTime;
+    // the newest buckets follow from the stored starts
+    memset(newestStart, 0, sizeof(newestStart));
+    memset(closedStart, 0, sizeof(closedStart));
+    for (size_t s = 0; s < sensorCount; s++) {
+        for (size_t h = 0; h < ROLLUP_HOURS; h++) {
+            if (hours[s][h].start > newestStart[s][ROLLUP_HOUR]) newestStart[s][ROLLUP_HOUR] = hours[s][h].start;
+        }
+        for (size_t d = 0; d < ROLLUP_DAYS; d++) {
+            if (days[s][d].start > newestStart[s][ROLLUP_DAY]) newestStart[s][ROLLUP_DAY] = days[s][d].start;
+        }
+    }
+    return true;
+}
+
+
+RollupQuery::RollupQuery(const Rollups& rollups, size_t sensor, rollupTier_t tier)
+    : rollups(rollups), sensor(sensor), tier(tier) {
+    end = rollups.newest(sensor, tier);
+    end = end ? end + Rollups::period(tier) : 0;
+    uint32_t span = Rollups::slots(tier) * Rollups::period(tier);
+    start = end > span ? end - span : 0;
+}
+
+bool RollupQuery::next() {
+    if (closed) return false;
+    while (end && start < end) {
+        rollupBucket_t bucket;
+        uint32_t current = start;
+        start += Rollups::period(tier);
+        if (!rollups.get(sensor, tier, current, bucket)) continue;
+        size_t prefix = snprintf(line, sizeof(line), "%s", first ? "[\n" : ",\n");
+        lineLength = prefix + rollupFormat(bucket, line + prefix, sizeof(line) - prefix);
+        linePos = 0;
+        first = false;
+        return true;
+    }
+    lineLength = snprintf(line, sizeof(line), "%s]\n", first ? "[" : "\n");
+    linePos = 0;
+    closed = true;
+    return true;
+}
+
+size_t RollupQuery::read(uint8_t buffer[], size_t maxLength) {
+    size_t written = 0;
+    while (written < maxLength) {
+        if (linePos >= lineLength && !next()) break;
+        size_t length = lineLength - linePos;
+        if (length > maxLength - written) length = maxLength - written;
+        memcpy(buffer + written, line + linePos, length);
+        linePos += length;
+        written += length;
+    }
+    return written;
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "readingHistory.h"
+#include "readingLog.h"
+
+/*
+ * Hourly and daily statistics (min/max/avg/count) of pH, ORP, chlorine and
+ * temperature per sensor.
+ *
+ * Buckets are direct-mapped rings indexed by hour (day) number, so adding a
+ * reading touches exactly one bucket per tier, O(1). Values are kept as the
+ * 16-bit fixed point of the sensor (sums as 32-bit), a bucket takes 40
+ * bytes. The state is saved to two alternating files, each with sequence
+ * number and CRC, so a power loss during a save keeps the previous one.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define ROLLUP_MAX_SENSORS 8        /**< Sensors with rollups (MAX_SENSORS) */
+#define ROLLUP_QUANTITIES 4         /**< pH, ORP, chlorine, temperature */
+#define ROLLUP_HOURS 24             /**< Hourly buckets kept */
+#define ROLLUP_DAYS 14              /**< Daily buckets kept */
+#define ROLLUP_MAGIC 0x32524359     /**< "YCR2", file magic and layout version */
+#define ROLLUP_FILE_A "/rollups0.bin"
+#define ROLLUP_FILE_B "/rollups1.bin"
+#define ROLLUP_LINE_LENGTH 256      /**< Buffer size of one formatted bucket */
+
+/**
+ * @brief Rollup tier
+ */
+enum rollupTier_t : uint8_t
+{
+    ROLLUP_HOUR = 0,
+    ROLLUP_DAY,
+    ROLLUP_TIERS
+};
+
+/**
+ * @brief Statistics of one quantity, fixed point as received (see YC01_FIELDS)
+ */
+struct rollupStats_t
+{
+    int16_t min;
+    int16_t max;
+    int32_t sum;
+};
+
+/**
+ * @brief Statistics of one sensor over one hour or day
+ */
+struct rollupBucket_t
+{
+    uint32_t start;         /**< Start of the hour/day (UTC seconds), 0 if empty */
+    uint16_t count;         /**< Readings in the bucket */
+    uint16_t reserved;
+    rollupStats_t stats[ROLLUP_QUANTITIES];
+
+    /**
+     * @brief Gets the mean of a quantity
+     */
+    float avg(size_t quantity) const;
+    /**
+     * @brief Gets the minimum of a quantity
+     */
+    float min(size_t quantity) const;
+    /**
+     * @brief Gets the maximum of a quantity
+     */
+    float max(size_t quantity) const;
+};
+
+static_assert(sizeof(rollupBucket_t) == 40, "unexpected rollup bucket size");
+
+/**
+ * @brief Parses a tier name ("hour", "day")
+ * @return true if known
+ */
+bool rollupParseTier(const char* name, rollupTier_t& tier);
+
+/**
+ * @brief Gets the name of a tier
+ */
+const char* rollupTierName(rollupTier_t tier);
+
+/**
+ * @brief Formats a bucket as JSON object
+ * @param bucket Bucket
+ * @param out Output buffer
+ * @param length Size of the buffer
+ * @return Length of the text
+ */
+size_t rollupFormat(const rollupBucket_t& bucket, char out[], size_t length);
+
+/**
+ * @brief Rollup tiers of all sensors
+ */
+class Rollups {
+public:
+    /**
+     * @brief Clears all buckets
+     * @param sensors Number of sensors (clamped to ROLLUP_MAX_SENSORS)
+     */
+    void begin(size_t sensors);
+
+    /**
+     * @brief Adds a reading to the hourly and daily bucket of its sensor (loop side)
+     * @param record Reading
+     * @return Bit mask of the tiers (1 << rollupTier_t) whose previous bucket was closed by this reading
+     */
+    uint8_t add(const historyRecord_t& record);
+
+    /**
+     * @brief Copies a bucket (safe against a concurrent add)
+     * @param sensor Sensor index
+     * @param tier Tier
+     * @param start Start of the hour/day
+     * @param bucket Output bucket
+     * @return false if the bucket is not kept
+     */
+    bool get(size_t sensor, rollupTier_t tier, uint32_t start, rollupBucket_t& bucket) const;
+
+    /**
+     * @brief Gets the start of the newest bucket of a sensor
+     * @return Start, 0 if the sensor has no readings
+     */
+    uint32_t newest(size_t sensor, rollupTier_t tier) const;
+
+    /**
+     * @brief Gets the start of the bucket closed last
+     * @return Start, 0 if none was closed
+     */
+    uint32_t closed(size_t sensor, rollupTier_t tier) const;
+
+    /**
+     * @brief Gets the timestamp of the newest reading added
+     */
+    uint32_t lastTime() const { return newestTime; }
+
+    /**
+     * @brief Saves all buckets, alternating between two files
+     * @return true if written
+     */
+    bool save(LogFiles& files);
+
+    /**
+     * @brief Loads the newest valid save
+     * @return true if a save for the same number of sensors was found
+     */
+    bool load(LogFiles& files);
+
+    /**
+     * @brief Gets the length of a tier in seconds
+     */
+    static uint32_t period(rollupTier_t tier) { return tier == ROLLUP_HOUR ? 3600 : 86400; }
+
+    /**
+     * @brief Gets the number of buckets of a tier
+     */
+    static size_t slots(rollupTier_t tier) { return tier == ROLLUP_HOUR ? ROLLUP_HOURS : ROLLUP_DAYS; }
+
+protected:
+    /**
+     * @brief Gets the bucket a start time maps to
+     */
+    rollupBucket_t& slot(size_t sensor, rollupTier_t tier, uint32_t start);
+    const rollupBucket_t& slot(size_t sensor, rollupTier_t tier, uint32_t start) const;
+
+    /**
+     * @brief File header of a save
+     */
+    struct fileHeader_t
+    {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t sensors;
+        uint32_t lastTime;
+        uint32_t crc;       /**< CRC32 of the header fields above and the buckets */
+    };
+
+    rollupBucket_t hours[ROLLUP_MAX_SENSORS][ROLLUP_HOURS];
+    rollupBucket_t days[ROLLUP_MAX_SENSORS][ROLLUP_DAYS];
+    uint32_t newestStart[ROLLUP_MAX_SENSORS][ROLLUP_TIERS];
+    uint32_t closedStart[ROLLUP_MAX_SENSORS][ROLLUP_TIERS];
+    size_t sensorCount = 0;
+    uint32_t newestTime = 0;
+    uint32_t saveSequence = 0;
+    std::atomic<uint32_t> version{0};   /**< Odd while add() writes (seqlock for readers) */
+};
+
+/**
+ * @brief Streams the buckets of one sensor and tier as JSON array, oldest first
+ */
+class RollupQuery {
+public:
+    /**
+     * @param rollups Rollups to read
+     * @param sensor Sensor index
+     * @param tier Tier
+     */
+    RollupQuery(const Rollups& rollups, size_t sensor, rollupTier_t tier);
+
+    /**
+     * @brief Writes the next part of the response
+     * @param buffer Output buffer
+     * @param maxLength Size of the buffer
+     * @return Bytes written, 0 when the response is complete
+     */
+    size_t read(uint8_t buffer[], size_t maxLength);
+
+protected:
+    /**
+     * @brief Formats the next bucket (or the closing bracket) into line
+     * @return false if the response is complete
+     */
+    bool next();
+
+    const Rollups& rollups;
+    size_t sensor;
+    rollupTier_t tier;
+    uint32_t start;             /**< Next bucket to look at */
+    uint32_t end;               /**< Start following the newest bucket */
+    bool first = true;
+    bool closed = false;
+    char line[ROLLUP_LINE_LENGTH];
+    size_t lineLength = 0;
+    size_t linePos = 0;
+};
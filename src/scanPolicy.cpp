@@ -0,0 +1,104 @@
+#include <string.h>
+
+#include "scanPolicy.h"
+
+
+/**
+ * @brief Converts scan time into listening time
+ */
+static inline uint32_t listening(uint32_t timeMs, const scanParams_t& scan) {
+    return scan.intervalMs ? (uint32_t)((uint64_t)timeMs * scan.windowMs / scan.intervalMs) : timeMs;
+}
+
+/**
+ * @brief Converts listening time into scan time
+ */
+static inline uint32_t scanTime(uint32_t listenMs, uint16_t intervalMs, uint16_t windowMs) {
+    return (uint32_t)(((uint64_t)listenMs * intervalMs + windowMs - 1) / windowMs);
+}
+
+static inline uint32_t clampDuration(uint32_t durationMs, uint32_t minMs, uint32_t maxMs) {
+    return durationMs < minMs ? minMs : (durationMs > maxMs ? maxMs : durationMs);
+}
+
+void ScanPolicy::begin(size_t count) {
+    slotCount = count > SCAN_POLICY_MAX_SLOTS ? SCAN_POLICY_MAX_SLOTS : count;
+    memset(slots, 0, sizeof(slots));
+}
+
+void ScanPolicy::reset(size_t idx) {
+    if (idx >= slotCount) return;
+    memset(&slots[idx], 0, sizeof(slots[idx]));
+}
+
+bool ScanPolicy::reliable(size_t idx) const {
+    if (idx >= slotCount) return false;
+    return slots[idx].hits >= SCAN_RELIABLE_HITS;
+}
+
+uint32_t ScanPolicy::estimateMs(size_t idx) const {
+    if (idx >= slotCount) return 0;
+    return slots[idx].meanMs + 4 * slots[idx].devMs;
+}
+
+void ScanPolicy::sample(discoveryStats_t& slot, uint32_t listenMs) {
+    if (slot.samples++ == 0) {
+        slot.meanMs = listenMs;
+        slot.devMs = listenMs / 2;
+        return;
+    }
+    // gains 1/8 and 1/4 as in RFC 6298
+    int32_t err = (int32_t)listenMs - (int32_t)slot.meanMs;
+    slot.meanMs = (uint32_t)((int32_t)slot.meanMs + err / 8);
+    uint32_t absErr = err < 0 ? -err : err;
+    slot.devMs = (uint32_t)((int32_t)slot.devMs + ((int32_t)absErr - (int32_t)slot.devMs) / 4);
+}
+
+void ScanPolicy::discovered(size_t idx, uint32_t delayMs, const scanParams_t& scan) {
+    if (idx >= slotCount) return;
+    discoveryStats_t& slot = slots[idx];
+    sample(slot, listening(delayMs, scan));
+    if (slot.hits < UINT16_MAX) slot.hits++;
+    slot.misses = 0;
+}
+
+void ScanPolicy::missed(size_t idx, const scanParams_t& scan) {
+    if (idx >= slotCount) return;
+    discoveryStats_t& slot = slots[idx];
+    sample(slot, listening(scan.durationMs, scan)); // the sensor needs at least this long
+    slot.hits = 0;
+    if (slot.misses < UINT16_MAX) slot.misses++;
+}
+
+scanParams_t ScanPolicy::plan(const uint8_t batch[], size_t count) const {
+    // relaxed unless one of the sensors is new or missing
+    bool aggressive = false;
+    for (size_t b = 0; b < count; b++) {
+        if (!reliable(batch[b])) aggressive = true;
+    }
+
+    scanParams_t params;
+    params.intervalMs = aggressive ? SCAN_AGGRESSIVE_INTERVAL_MS : SCAN_RELAXED_INTERVAL_MS;
+    params.windowMs = aggressive ? SCAN_AGGRESSIVE_WINDOW_MS : SCAN_RELAXED_WINDOW_MS;
+    params.active = aggressive;
+    params.acceptListOnly = false;
+    params.durationMs = count ? SCAN_MIN_DURATION_MS : SCAN_FULL_DURATION_MS;
+
+    for (size_t b = 0; b < count; b++) {
+        size_t idx = batch[b];
+        if (idx >= slotCount) continue;
+        const discoveryStats_t& slot = slots[idx];
+        uint32_t durationMs = scanTime(estimateMs(idx), params.intervalMs, params.windowMs);
+        if (slot.misses) {
+            // the aggressive duty cycle listens longer than the scan that missed the sensor;
+            // a sensor that stays missing is most likely out of range, do not keep the radio busy
+            durationMs = SCAN_FULL_DURATION_MS;
+        } else if (!reliable(idx)) {
+            durationMs = clampDuration(durationMs, SCAN_FULL_DURATION_MS, SCAN_MAX_DURATION_MS);
+        } else {
+            durationMs = clampDuration(durationMs, SCAN_MIN_DURATION_MS, SCAN_MAX_DURATION_MS);
+        }
+        if (durationMs > params.durationMs) params.durationMs = durationMs;
+    }
+    return params;
+}
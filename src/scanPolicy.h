@@ -0,0 +1,130 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Adaptive BLE scan parameters driven by the discovery history of each sensor.
+ *
+ * Sensors that are new or were missed by the last scan get an aggressive
+ * active scan (high duty cycle, at least the full duration). Sensors that showed up in
+ * several scans in a row get a short passive scan with a low duty cycle,
+ * sized from the observed discovery delay, which leaves the shared 2.4 GHz
+ * radio to WiFi most of the time.
+ * This module is plain C++ (no Arduino / NimBLE dependencies) so it can be
+ * replayed against recorded discovery timings on the host
+ * (see test/native/test_scan_policy).
+ */
+
+#define SCAN_POLICY_MAX_SLOTS 8         /**< Maximum number of tracked sensors */
+#define SCAN_MIN_DURATION_MS 500        /**< Shortest scan */
+#define SCAN_FULL_DURATION_MS 3000      /**< Scan for new sensors */
+#define SCAN_MAX_DURATION_MS 8000       /**< Longest planned scan */
+#define SCAN_RELIABLE_HITS 3            /**< Consecutive discoveries before a sensor counts as reliable */
+
+#define SCAN_AGGRESSIVE_INTERVAL_MS 40  /**< Scan interval for new or missing sensors */
+#define SCAN_AGGRESSIVE_WINDOW_MS 30    /**< Scan window for new or missing sensors (75 % duty) */
+#define SCAN_RELAXED_INTERVAL_MS 60     /**< Scan interval for reliable sensors */
+#define SCAN_RELAXED_WINDOW_MS 15       /**< Scan window for reliable sensors (25 % duty) */
+
+/**
+ * @brief Parameters of one scan
+ */
+struct scanParams_t
+{
+    uint32_t durationMs;    /**< Scan duration in ms */
+    uint16_t intervalMs;    /**< Scan interval in ms */
+    uint16_t windowMs;      /**< Scan window in ms (radio listening time per interval) */
+    bool active;            /**< Request scan responses */
+    bool acceptListOnly;    /**< Report accept list devices only (set by the caller) */
+};
+
+/**
+ * @brief Discovery history of one sensor
+ */
+struct discoveryStats_t
+{
+    uint32_t meanMs;        /**< Smoothed listening time until the first advertisement */
+    uint32_t devMs;         /**< Smoothed mean deviation of the listening time */
+    uint16_t hits;          /**< Consecutive scans that found the sensor */
+    uint16_t misses;        /**< Consecutive scans that missed the sensor */
+    uint32_t samples;       /**< Number of scans that looked for the sensor */
+};
+
+/**
+ * @brief Chooses duty cycle and duration of the next scan from the discovery
+ *        history of the sensors it looks for.
+ *
+ * Delays are kept as listening time (delay times window / interval), so
+ * samples of aggressive and relaxed scans are comparable. The estimate
+ * follows the TCP retransmission timer (RFC 6298): a smoothed mean plus four
+ * times the smoothed deviation. A miss counts as a sample at the listening
+ * time of the whole scan, so the estimate grows until the sensor is found
+ * again.
+ */
+class ScanPolicy {
+public:
+    /**
+     * @brief Resets the history of all sensors
+     * @param count Number of sensors (clamped to SCAN_POLICY_MAX_SLOTS)
+     */
+    void begin(size_t count);
+
+    /**
+     * @brief Forgets the history of one sensor, it is treated as new
+     * @param idx Sensor index
+     */
+    void reset(size_t idx);
+
+    /**
+     * @brief Plans a scan for a set of sensors
+     * @param batch Indices of the sensors the scan looks for
+     * @param count Number of indices
+     * @return Scan parameters (acceptListOnly is false)
+     */
+    scanParams_t plan(const uint8_t batch[], size_t count) const;
+
+    /**
+     * @brief Records that a scan found a sensor
+     * @param idx Sensor index
+     * @param delayMs Time from scan start to the first advertisement
+     * @param scan Parameters of the scan
+     */
+    void discovered(size_t idx, uint32_t delayMs, const scanParams_t& scan);
+
+    /**
+     * @brief Records that a scan missed a sensor
+     * @param idx Sensor index
+     * @param scan Parameters of the scan
+     */
+    void missed(size_t idx, const scanParams_t& scan);
+
+    /**
+     * @brief Checks if a sensor showed up reliably in the last scans
+     * @param idx Sensor index
+     * @return true if reliable
+     */
+    bool reliable(size_t idx) const;
+
+    /**
+     * @brief Gets the listening time that should discover a sensor
+     * @param idx Sensor index
+     * @return Estimated listening time in ms
+     */
+    uint32_t estimateMs(size_t idx) const;
+
+    /**
+     * @brief Gets the discovery history of a sensor
+     * @param idx Sensor index
+     * @return History
+     */
+    const discoveryStats_t& stats(size_t idx) const { return slots[idx < slotCount ? idx : 0]; }
+
+protected:
+    /**
+     * @brief Adds a listening time sample to the smoothed mean and deviation
+     */
+    void sample(discoveryStats_t& slot, uint32_t listenMs);
+
+    discoveryStats_t slots[SCAN_POLICY_MAX_SLOTS];
+    size_t slotCount = 0;
+};
@@ -0,0 +1,123 @@
+#include <string.h>
+
+#include "scanTable.h"
+
+
+bool ScanEventRing::push(const scanEvent_t& event) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= SCAN_RING_SIZE) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    events[h & (SCAN_RING_SIZE - 1)] = event;
+    head.store(h + 1, std::memory_order_release); // publish the event
+    return true;
+}
+
+bool ScanEventRing::pop(scanEvent_t& event) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    event = events[t & (SCAN_RING_SIZE - 1)];
+    tail.store(t + 1, std::memory_order_release); // release the slot to the producer
+    return true;
+}
+
+void ScanEventRing::discard() {
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+
+void ScanDeviceSet::clear() {
+    memset(slots, -1, sizeof(slots));
+    deviceNum = 0;
+    foundNum = 0;
+    scanId = 0;
+}
+
+void ScanDeviceSet::beginScan() {
+    scanId++;
+    foundNum = 0;
+}
+
+size_t ScanDeviceSet::hashSlot(uint64_t address) {
+    // Fibonacci hashing of the address value only, so lookups of any type land on the same slot
+    return (size_t)((bleAddressValue(address) * 0x9E3779B97F4A7C15ull) >> 32) & (SCAN_SET_SIZE - 1);
+}
+
+size_t ScanDeviceSet::probe(uint64_t address) const {
+    size_t slot = hashSlot(address);
+    // linear probing, terminates because the set is at most half full
+    while (slots[slot] >= 0 && !bleAddressMatch(devices[slots[slot]].address, address)) {
+        slot = (slot + 1) & (SCAN_SET_SIZE - 1);
+    }
+    return slot;
+}
+
+void ScanDeviceSet::rehash() {
+    memset(slots, -1, sizeof(slots));
+    for (size_t i = 0; i < deviceNum; i++) {
+        slots[probe(devices[i].address)] = i;
+    }
+}
+
+const scanDevice_t* ScanDeviceSet::find(uint64_t address) const {
+    size_t slot = probe(address);
+    return slots[slot] >= 0 ? &devices[slots[slot]] : nullptr;
+}
+
+scanDevice_t* ScanDeviceSet::update(const scanEvent_t& event) {
+    size_t slot = probe(event.address);
+    scanDevice_t* device;
+    if (slots[slot] >= 0) {
+        device = &devices[slots[slot]];
+    } else {
+        size_t idx;
+        if (deviceNum < SCAN_MAX_DEVICES) {
+            idx = deviceNum++;
+            slots[slot] = idx;
+        } else {
+            // replace the device seen least recently, unless all were seen in this scan
+            idx = SCAN_MAX_DEVICES;
+            for (size_t i = 0; i < deviceNum; i++) {
+                if (devices[i].scanId == scanId) continue;
+                if (idx == SCAN_MAX_DEVICES || (int32_t)(devices[i].lastSeenMs - devices[idx].lastSeenMs) < 0) {
+                    idx = i;
+                }
+            }
+            if (idx == SCAN_MAX_DEVICES) {
+                return nullptr;
+            }
+            devices[idx].address = event.address;
+            rehash();
+        }
+        device = &devices[idx];
+        memset(device, 0, sizeof(*device));
+        device->address = event.address;
+        device->scanId = scanId - 1; // not seen in this scan yet
+        device->rssiMin = event.rssi;
+        device->rssiMax = event.rssi;
+    }
+
+    if (device->scanId != scanId) {
+        // first advertisement in this scan
+        device->scanId = scanId;
+        device->firstSeenMs = event.timeMs;
+        device->broadcast = false;
+        foundOrder[foundNum++] = device - devices;
+    }
+    device->lastSeenMs = event.timeMs;
+    if (event.rssi < device->rssiMin) device->rssiMin = event.rssi;
+    if (event.rssi > device->rssiMax) device->rssiMax = event.rssi;
+    device->rssiSum += event.rssi;
+    device->advCount++;
+    if (event.model[0]) {
+        memcpy(device->model, event.model, sizeof(device->model));
+    }
+    if (event.broadcast) {
+        device->broadcast = true;
+        device->readings = event.readings;
+    }
+    return device;
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "yc01Codec.h"
+#include "bleAddress.h"
+
+/*
+ * Scan result bookkeeping between the NimBLE host task and the loop.
+ *
+ * The scan callback (producer) pushes one event per relevant advertisement
+ * into a single-producer/single-consumer ring, the loop (consumer) drains it
+ * into a device set. Neither side takes a lock, every operation is O(1).
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ * Addresses are keys of bleAddress.h; lookups with BLE_ADDRESS_TYPE_ANY match
+ * a device of any address type.
+ */
+
+#define SCAN_RING_SIZE 32   /**< Events buffered between host task and loop (power of two) */
+#define SCAN_SET_SIZE 32    /**< Slots of the device set (power of two) */
+#define SCAN_MAX_DEVICES 16 /**< Devices tracked at once (at most half of SCAN_SET_SIZE) */
+
+static_assert((SCAN_RING_SIZE & (SCAN_RING_SIZE - 1)) == 0, "SCAN_RING_SIZE must be a power of two");
+static_assert((SCAN_SET_SIZE & (SCAN_SET_SIZE - 1)) == 0, "SCAN_SET_SIZE must be a power of two");
+static_assert(SCAN_MAX_DEVICES * 2 <= SCAN_SET_SIZE, "device set too dense");
+
+/**
+ * @brief One advertisement of a sensor, as seen by the scan callback
+ */
+struct scanEvent_t
+{
+    uint64_t address;               /**< Address key */
+    uint32_t timeMs;                /**< Reception timestamp (millis) */
+    int8_t rssi;                    /**< Signal strength */
+    bool broadcast;                 /**< readings hold a valid broadcast frame */
+    sensorReadings_t readings;      /**< Broadcast readings */
+    char model[YC01_MODEL_LENGTH];  /**< Advertised name, empty if not included */
+};
+
+/**
+ * @brief Bookkeeping of one sensor seen during scans
+ */
+struct scanDevice_t
+{
+    uint64_t address;               /**< Address key */
+    uint32_t scanId;                /**< Scan in which the device was seen last */
+    uint32_t firstSeenMs;           /**< First advertisement of the current scan */
+    uint32_t lastSeenMs;            /**< Last advertisement */
+    int8_t rssiMin;                 /**< Weakest signal since the device was first seen */
+    int8_t rssiMax;                 /**< Strongest signal since the device was first seen */
+    int32_t rssiSum;                /**< Sum of all signal strengths (for the mean) */
+    uint32_t advCount;              /**< Number of advertisements */
+    bool broadcast;                 /**< readings hold a broadcast frame of the current scan */
+    sensorReadings_t readings;      /**< Last broadcast readings */
+    char model[YC01_MODEL_LENGTH];  /**< Advertised name */
+
+    /**
+     * @brief Gets the mean signal strength
+     * @return Mean RSSI in dBm
+     */
+    int8_t rssiMean() const { return advCount ? (int8_t)(rssiSum / (int32_t)advCount) : 0; }
+};
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring of scan events
+ */
+class ScanEventRing {
+public:
+    /**
+     * @brief Appends an event (producer side)
+     * @param event Event to copy
+     * @return false if the ring is full, the event is dropped and counted
+     */
+    bool push(const scanEvent_t& event);
+
+    /**
+     * @brief Takes the oldest event (consumer side)
+     * @param event Output event
+     * @return false if the ring is empty
+     */
+    bool pop(scanEvent_t& event);
+
+    /**
+     * @brief Discards all pending events (consumer side)
+     */
+    void discard();
+
+    /**
+     * @brief Gets the number of events dropped because the ring was full
+     * @return Dropped event count
+     */
+    uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+protected:
+    scanEvent_t events[SCAN_RING_SIZE];
+    std::atomic<uint32_t> head{0};          /**< Next write position, owned by the producer */
+    std::atomic<uint32_t> tail{0};          /**< Next read position, owned by the consumer */
+    std::atomic<uint32_t> droppedCount{0};
+};
+
+/**
+ * @brief Open-addressing set of the sensors seen, keyed by address
+ *
+ * Owned by the consumer. Devices keep their statistics across scans; when the
+ * set is full the device seen least recently (and not in the current scan)
+ * is replaced.
+ */
+class ScanDeviceSet {
+public:
+    ScanDeviceSet() { clear(); }
+
+    /**
+     * @brief Removes all devices
+     */
+    void clear();
+
+    /**
+     * @brief Starts a new scan, the found list becomes empty
+     */
+    void beginScan();
+
+    /**
+     * @brief Records an advertisement
+     * @param event Scan event
+     * @return Updated device, nullptr if the set is full with devices of the current scan
+     */
+    scanDevice_t* update(const scanEvent_t& event);
+
+    /**
+     * @brief Looks up a device
+     * @param address Address key (see bleAddressMatch)
+     * @return Device or nullptr if unknown
+     */
+    const scanDevice_t* find(uint64_t address) const;
+
+    /**
+     * @brief Gets the number of devices seen in the current scan
+     * @return Device count
+     */
+    size_t foundCount() const { return foundNum; }
+
+    /**
+     * @brief Gets a device of the current scan, in the order they were first seen
+     * @param idx Index (0 .. foundCount()-1)
+     * @return Device
+     */
+    const scanDevice_t& found(size_t idx) const { return devices[foundOrder[idx]]; }
+
+    /**
+     * @brief Checks if a device was seen in the current scan
+     * @param device Device of this set
+     * @return true if seen
+     */
+    bool seenInScan(const scanDevice_t& device) const { return device.scanId == scanId; }
+
+protected:
+    /**
+     * @brief Gets the home slot of an address
+     */
+    static size_t hashSlot(uint64_t address);
+
+    /**
+     * @brief Finds the slot holding an address or the empty slot where it belongs
+     */
+    size_t probe(uint64_t address) const;
+
+    /**
+     * @brief Rebuilds the slot table after a device was replaced
+     */
+    void rehash();
+
+    scanDevice_t devices[SCAN_MAX_DEVICES];
+    int8_t slots[SCAN_SET_SIZE];            /**< Index into devices, -1 if empty */
+    uint8_t foundOrder[SCAN_MAX_DEVICES];   /**< Devices of the current scan */
+    size_t deviceNum = 0;
+    size_t foundNum = 0;
+    uint32_t scanId = 0;
+};
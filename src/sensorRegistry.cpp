@@ -0,0 +1,165 @@
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+#include "config.h"
+#include "sensorRegistry.h"
+
+static_assert(MAX_SENSORS <= SCHEDULER_MAX_SLOTS, "scheduler too small for MAX_SENSORS");
+
+
+static sensorSlot_t slots[MAX_SENSORS];
+static size_t slotCount = 0;
+static ReadScheduler scheduler;
+static ScanPolicy scanPolicy;
+
+void sensorRegistryInit(uint32_t nowMs) {
+    slotCount = config.sensorCount;
+    if (slotCount < 1) slotCount = 1;
+    if (slotCount > MAX_SENSORS) slotCount = MAX_SENSORS;
+
+    scheduler.begin(slotCount, nowMs);
+    scanPolicy.begin(slotCount);
+    for (size_t i = 0; i < slotCount; i++) {
+        sensorSlot_t& slot = slots[i];
+        slot.configKey = config.sensors[i].addressKey;
+        slot.addressKey = slot.configKey;
+        slot.name = config.sensors[i].name;
+        strlcpy(slot.sensorType, "unknown", sizeof(slot.sensorType));
+        slot.status = "init";
+        memset(&slot.readings, 0, sizeof(slot.readings));
+        slot.device.setName(slot.name);
+        slot.device.setPersistent(config.blePersistent);
+
+        // a configured address has no type yet, direct connects assume public until a read tells otherwise
+        slot.discovery = slot.addressKey ? DISCOVERY_NONE : DISCOVERY_FULL;
+        slot.direct = false;
+        slot.cycleMs = 0;
+        slot.radioMs = 0;
+        memset(&slot.link, 0, sizeof(slot.link));
+        slot.hasScanStats = false;
+
+        uint16_t interval = config.sensors[i].interval ? config.sensors[i].interval : config.interval;
+        if (interval < 1) interval = 1;
+        scheduler.setInterval(i, (uint32_t)interval * 1000);
+    }
+}
+
+size_t sensorRegistryCount() {
+    return slotCount;
+}
+
+sensorSlot_t& sensorRegistryGet(size_t idx) {
+    return slots[idx < slotCount ? idx : 0];
+}
+
+ReadScheduler& sensorScheduler() {
+    return scheduler;
+}
+
+ScanPolicy& sensorScanPolicy() {
+    return scanPolicy;
+}
+
+/**
+ * @brief Checks if a scanned device is bound to a sensor other than idx
+ */
+static bool isClaimed(size_t idx, uint64_t addr) {
+    for (size_t i = 0; i < slotCount; i++) {
+        if (i != idx && bleAddressMatch(addr, slots[i].addressKey)) return true;
+    }
+    return false;
+}
+
+bool sensorRegistryLinked() {
+    for (size_t i = 0; i < slotCount; i++) {
+        if (!slots[i].device.isConnected()) return false;
+    }
+    return true;
+}
+
+int sensorRegistryMatch(size_t idx, const uint64_t found[], size_t count) {
+    if (idx >= slotCount) return -1;
+    const sensorSlot_t& slot = slots[idx];
+
+    for (size_t i = 0; i < count; i++) {
+        if (!slot.addressKey) {
+            if (!isClaimed(idx, found[i])) return i;
+        } else if (bleAddressMatch(found[i], slot.addressKey)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool sensorRegistryDirect(size_t idx) {
+    if (idx >= slotCount) return false;
+    return slots[idx].addressKey && slots[idx].discovery == DISCOVERY_NONE;
+}
+
+bool sensorRegistryPlanScan(const uint8_t batch[], size_t count, scanParams_t& params) {
+    uint8_t scanBatch[MAX_SENSORS];
+    uint64_t expected[MAX_SENSORS];
+    size_t scanCount = 0;
+    bool allKnown = true;
+    bool acceptListOnly = true;
+
+    for (size_t b = 0; b < count; b++) {
+        const sensorSlot_t& slot = slots[batch[b]];
+        if (slot.device.isConnected() || sensorRegistryDirect(batch[b])) continue;
+        if (slot.addressKey) {
+            expected[scanCount] = slot.addressKey;
+        } else {
+            allKnown = false;
+        }
+        if (!slot.addressKey || slot.discovery != DISCOVERY_ACCEPT_LIST) acceptListOnly = false;
+        scanBatch[scanCount++] = batch[b];
+    }
+    if (scanCount == 0) return false;
+
+    params = scanPolicy.plan(scanBatch, scanCount);
+    params.acceptListOnly = acceptListOnly && BLE_YC01::setAcceptList(expected, scanCount);
+    // an entry without address adopts the first free sensor, it is not known when that was seen
+    BLE_YC01::setExpectedDevices(expected, allKnown ? scanCount : 0);
+    return true;
+}
+
+void sensorRegistryScanned(size_t idx, const uint64_t* found, const scanParams_t& params) {
+    uint32_t delayMs;
+    if (found && BLE_YC01::getDiscoveryDelay(*found, delayMs)) {
+        scanPolicy.discovered(idx, delayMs, params);
+    } else {
+        scanPolicy.missed(idx, params);
+    }
+}
+
+void sensorRegistryResolved(size_t idx, uint64_t address) {
+    if (idx >= slotCount) return;
+    sensorSlot_t& slot = slots[idx];
+    slot.addressKey = address; // adopted, or the type is known now
+    slot.discovery = DISCOVERY_NONE;
+}
+
+void sensorRegistryFailed(size_t idx) {
+    if (idx >= slotCount) return;
+    sensorSlot_t& slot = slots[idx];
+    if (slot.discovery == DISCOVERY_NONE && slot.addressKey) {
+        slot.discovery = DISCOVERY_ACCEPT_LIST;
+        return;
+    }
+    slot.discovery = DISCOVERY_FULL;
+    if (slot.addressKey != slot.configKey && !bleAddressMatch(slot.addressKey, slot.configKey)) {
+        slot.addressKey = slot.configKey; // release an adopted address
+        scanPolicy.reset(idx);
+    }
+}
+
+void sensorRegistryForget() {
+    for (size_t i = 0; i < slotCount; i++) {
+        // keep the type learned for the configured address
+        bool configured = bleAddressMatch(slots[i].addressKey, slots[i].configKey);
+        slots[i].addressKey = (slotCount == 1) ? 0 : (configured ? slots[i].addressKey : slots[i].configKey);
+        slots[i].discovery = DISCOVERY_FULL;
+        scanPolicy.reset(i);
+        slots[i].device.disconnect();
+    }
+}
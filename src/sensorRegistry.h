@@ -0,0 +1,144 @@
+#pragma once
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+#include "BLE-YC01.h"
+#include "readScheduler.h"
+#include "scanPolicy.h"
+
+/**
+ * @brief How a sensor has to be found before the next read
+ */
+enum sensorDiscovery_t : uint8_t
+{
+    DISCOVERY_NONE = 0,     /**< Address known, connect directly without scanning */
+    DISCOVERY_ACCEPT_LIST,  /**< Direct connect failed, scan for the known address only */
+    DISCOVERY_FULL          /**< Full discovery scan (no address, or filtered scan failed) */
+};
+
+/**
+ * @brief Configuration and runtime state of one registered sensor
+ */
+struct sensorSlot_t
+{
+    uint64_t configKey;         /**< Address key from config (0: adopt the first unclaimed sensor) */
+    uint64_t addressKey;        /**< Address key bound to the slot, incl. the type once read (0: none) */
+    String name;                /**< Custom name of the sensor */
+    char sensorType[YC01_MODEL_LENGTH]; /**< Model name/type of the sensor */
+    const char* status;         /**< Result of the last read attempt (static string) */
+    sensorReadings_t readings;  /**< Last read sensor data */
+    BLE_YC01 device;            /**< Sensor handler, keeps the link in persistent mode */
+    sensorDiscovery_t discovery; /**< Discovery needed before the next read */
+    bool direct;                /**< Last read connected without a scan */
+    uint32_t cycleMs;           /**< Last read: time from cycle start to data in ms */
+    uint32_t radioMs;           /**< Last read: radio on time (share of the scan plus connect/read) in ms */
+    bleLinkStatus_t link;       /**< Link state after the last read (reported while the BLE worker runs) */
+    scanDevice_t scanStats;     /**< Advertisement statistics after the last read (valid if hasScanStats) */
+    bool hasScanStats;          /**< scanStats is set */
+};
+
+/**
+ * @brief Builds the sensor registry and the read schedule from config.sensors.
+ * @param nowMs Current timestamp (millis), all sensors are due immediately
+ */
+void sensorRegistryInit(uint32_t nowMs);
+
+/**
+ * @brief Gets the number of registered sensors
+ * @return Sensor count (at least 1)
+ */
+size_t sensorRegistryCount();
+
+/**
+ * @brief Gets a registered sensor
+ * @param idx Sensor index (0 .. sensorRegistryCount()-1)
+ * @return Reference to the sensor slot
+ */
+sensorSlot_t& sensorRegistryGet(size_t idx);
+
+/**
+ * @brief Gets the read scheduler of the registry
+ * @return Reference to the scheduler
+ */
+ReadScheduler& sensorScheduler();
+
+/**
+ * @brief Gets the scan policy of the registry (discovery history per sensor)
+ * @return Reference to the policy
+ */
+ScanPolicy& sensorScanPolicy();
+
+/**
+ * @brief Checks if every registered sensor has an open persistent link,
+ *        so a read cycle needs no discovery scan.
+ * @return true if all sensors are linked
+ */
+bool sensorRegistryLinked();
+
+/**
+ * @brief Finds the scanned device to read for a sensor.
+ *
+ * A sensor with a bound address only matches that address. A sensor without
+ * address adopts the first scanned device that is not bound to another sensor.
+ * @param idx Sensor index
+ * @param found Address keys of the scanned devices
+ * @param count Number of scanned devices
+ * @return Index into found or -1 if no device matches
+ */
+int sensorRegistryMatch(size_t idx, const uint64_t found[], size_t count);
+
+/**
+ * @brief Checks if a sensor can be read by connecting to its known address
+ * @param idx Sensor index
+ * @return true if no scan is needed
+ */
+bool sensorRegistryDirect(size_t idx);
+
+/**
+ * @brief Checks if a batch needs a discovery scan and prepares it.
+ *
+ * The scan parameters follow the discovery history of the sensors that need
+ * the scan (see ScanPolicy). If every one of them has a known address, the
+ * scan stops once all were seen, and if all are in accept list discovery the
+ * controller accept list is set to these addresses and the scan is filtered.
+ * @param batch Sensor indices of the batch
+ * @param count Number of sensors in the batch
+ * @param params Output scan parameters
+ * @return true if a scan is needed
+ */
+bool sensorRegistryPlanScan(const uint8_t batch[], size_t count, scanParams_t& params);
+
+/**
+ * @brief Records the outcome of a discovery scan for a sensor
+ * @param idx Sensor index
+ * @param found Address key of the sensor found by the scan, nullptr if missed
+ * @param params Parameters of the scan
+ */
+void sensorRegistryScanned(size_t idx, const uint64_t* found, const scanParams_t& params);
+
+/**
+ * @brief Records a successful read; the address is used for direct connects from now on
+ * @param idx Sensor index
+ * @param address Address key (incl. type) the data was read from
+ */
+void sensorRegistryResolved(size_t idx, uint64_t address);
+
+/**
+ * @brief Records a failed read and escalates the discovery for the next attempt
+ *
+ * direct connect -> scan with accept list -> full scan. An adopted address
+ * is released after a failed full scan.
+ * @param idx Sensor index
+ */
+void sensorRegistryFailed(size_t idx);
+
+/**
+ * @brief Releases addresses that were adopted during discovery (SCAN command).
+ *
+ * Open persistent links are closed and every sensor needs a full discovery
+ * scan, so the next cycle starts with a scan.
+ * Sensors fall back to their configured address. With a single registered
+ * sensor the configured address is released as well, so the next scan reads
+ * the first sensor found.
+ */
+void sensorRegistryForget();
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "summary.h"
+
+
+uint32_t summaryNextTime(uint32_t now, uint8_t hour, int16_t utcOffset) {
+    int64_t local = (int64_t)now + utcOffset * 60;
+    int64_t target = local - local % 86400 + hour * 3600;
+    if (target <= local) target += 86400;
+    return (uint32_t)(target - utcOffset * 60);
+}
+
+summaryStatus_t summaryStatus(const summaryReport_t& report, size_t sensor) {
+    const summarySensor_t& s = report.sensors[sensor];
+    if (!s.lastTime || (report.heartbeat && report.to > s.lastTime + report.heartbeat)) return SUMMARY_OFFLINE;
+    if (s.active) return SUMMARY_CRITICAL;
+    if (s.alerts || s.gaps) return SUMMARY_WARNING;
+    return SUMMARY_NORMAL;
+}
+
+summaryStatus_t summaryOverall(const summaryReport_t& report) {
+    summaryStatus_t overall = SUMMARY_NORMAL;
+    for (size_t i = 0; i < report.sensorCount; i++) {
+        summaryStatus_t status = summaryStatus(report, i);
+        if (status > overall) overall = status;
+    }
+    return overall;
+}
+
+const char* summaryStatusName(summaryStatus_t status) {
+    switch (status) {
+        case SUMMARY_WARNING:  return "warning";
+        case SUMMARY_CRITICAL: return "critical";
+        case SUMMARY_OFFLINE:  return "offline";
+        default:               return "normal";
+    }
+}
+
+/**
+ * @brief Appends formatted text, stops at the end of the buffer
+ */
+static void append(char out[], size_t length, size_t& used, const char* format, ...) {
+    if (used + 1 >= length) return;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(out + used, length - used, format, args);
+    va_end(args);
+    if (n > 0) used += (size_t)n < length - used ? (size_t)n : length - used - 1;
+}
+
+/**
+ * @brief Appends a JSON string, quotes and backslashes escaped
+ */
+static void appendString(char out[], size_t length, size_t& used, const char* text) {
+    append(out, length, used, "\"");
+    for (; *text && used + 2 < length; text++) {
+        if (*text == '"' || *text == '\\') out[used++] = '\\';
+        if ((unsigned char)*text >= ' ') out[used++] = *text;
+    }
+    out[used] = 0;
+    append(out, length, used, "\"");
+}
+
+size_t summaryFormatTime(uint32_t time, int16_t utcOffset, char out[], size_t length) {
+    time_t local = (time_t)time + utcOffset * 60;
+    struct tm tm;
+    gmtime_r(&local, &tm);
+    int used = snprintf(out, length, "%04d-%02d-%02d %02d:%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min);
+    return (size_t)used < length ? used : length - 1;
+}
+
+/**
+ * @brief Appends a local date and time
+ */
+static void appendTime(char out[], size_t length, size_t& used, uint32_t time, int16_t utcOffset) {
+    if (used + 1 < length) used += summaryFormatTime(time, utcOffset, out + used, length - used);
+}
+
+/**
+ * @brief Gets the decimals of a quantity from its scale
+ */
+static int decimals(size_t quantity) {
+    int d = 0;
+    for (int32_t scale = YC01_FIELDS[quantity].scale; scale > 1; scale /= 10) d++;
+    return d;
+}
+
+size_t summaryFormatText(const summaryReport_t& report, const char* const names[], char out[], size_t length) {
+    size_t used = 0;
+    out[0] = 0;
+    append(out, length, used, "Daily summary ");
+    appendTime(out, length, used, report.from, report.utcOffset);
+    append(out, length, used, " - ");
+    appendTime(out, length, used, report.to, report.utcOffset);
+    int16_t offset = report.utcOffset < 0 ? -report.utcOffset : report.utcOffset;
+    append(out, length, used, " (UTC%c%02d:%02d): %s\r\n", report.utcOffset < 0 ? '-' : '+', offset / 60, offset % 60,
+        summaryStatusName(summaryOverall(report)));
+
+    for (size_t i = 0; i < report.sensorCount; i++) {
+        const summarySensor_t& s = report.sensors[i];
+        append(out, length, used, "\r\n%s: %s\r\n", names[i], summaryStatusName(summaryStatus(report, i)));
+        append(out, length, used, "  readings: %u, last: ", (unsigned)s.count);
+        if (s.lastTime) appendTime(out, length, used, s.lastTime, report.utcOffset);
+        else append(out, length, used, "never");
+        append(out, length, used, "\r\n  alerts: %u, active: %u, missed heartbeats: %u\r\n",
+            (unsigned)s.alerts, (unsigned)s.active, (unsigned)s.gaps);
+        for (size_t q = 0; s.count && q < YC01_QUANTITIES; q++) {
+            yc01Quantity_t quantity = (yc01Quantity_t)q;
+            int d = decimals(q);
+            append(out, length, used, "  %-5s %.*f .. %.*f, trend %+.*f\r\n", alertQuantityName(quantity),
+                d, yc01Value(quantity, s.min[q]), d, yc01Value(quantity, s.max[q]),
+                d, yc01Value(quantity, s.last[q]) - yc01Value(quantity, s.first[q]));
+        }
+    }
+    return used;
+}
+
+size_t summaryFormatJson(const summaryReport_t& report, const char* const names[], char out[], size_t length) {
+    size_t used = 0;
+    out[0] = 0;
+    append(out, length, used, "{\"summary\":true,\"from\":%u,\"to\":%u,\"status\":\"%s\",\"sensors\":[",
+        (unsigned)report.from, (unsigned)report.to, summaryStatusName(summaryOverall(report)));
+    for (size_t i = 0; i < report.sensorCount; i++) {
+        const summarySensor_t& s = report.sensors[i];
+        append(out, length, used, "%s{\"sensor\":%u,\"name\":", i ? "," : "", (unsigned)i);
+        appendString(out, length, used, names[i]);
+        append(out, length, used, ",\"status\":\"%s\",\"count\":%u,\"lastTime\":%u,\"alerts\":%u,\"active\":%u,\"gaps\":%u,\"values\":{",
+            summaryStatusName(summaryStatus(report, i)), (unsigned)s.count, (unsigned)s.lastTime,
+            (unsigned)s.alerts, (unsigned)s.active, (unsigned)s.gaps);
+        for (size_t q = 0; s.count && q < YC01_QUANTITIES; q++) {
+            yc01Quantity_t quantity = (yc01Quantity_t)q;
+            int d = decimals(q);
+            append(out, length, used, "%s\"%s\":{\"min\":%.*f,\"max\":%.*f,\"trend\":%.*f}", q ? "," : "",
+                alertQuantityName(quantity), d, yc01Value(quantity, s.min[q]), d, yc01Value(quantity, s.max[q]),
+                d, yc01Value(quantity, s.last[q]) - yc01Value(quantity, s.first[q]));
+        }
+        append(out, length, used, "}}");
+    }
+    append(out, length, used, "]}");
+    return used;
+}
+
+
+void DailySummary::begin(size_t sensors, uint8_t triggerHour, int16_t utcOffset, uint32_t heartbeat) {
+    memset(&current, 0, sizeof(current));
+    current.sensorCount = sensors < SUMMARY_MAX_SENSORS ? sensors : SUMMARY_MAX_SENSORS;
+    current.utcOffset = utcOffset;
+    current.heartbeat = heartbeat;
+    hour = triggerHour < 24 ? triggerHour : SUMMARY_DISABLED;
+    nextTime = 0;
+}
+
+void DailySummary::add(const historyRecord_t& record) {
+    if (record.sensor >= current.sensorCount) return;
+    summarySensor_t& s = current.sensors[record.sensor];
+    if (s.count == 0) {
+        memcpy(s.min, record.raw, sizeof(s.min));
+        memcpy(s.max, record.raw, sizeof(s.max));
+        memcpy(s.first, record.raw, sizeof(s.first));
+    } else {
+        for (size_t q = 0; q < YC01_QUANTITIES; q++) {
+            if (record.raw[q] < s.min[q]) s.min[q] = record.raw[q];
+            if (record.raw[q] > s.max[q]) s.max[q] = record.raw[q];
+        }
+    }
+    memcpy(s.last, record.raw, sizeof(s.last));
+    if (s.lastTime && current.heartbeat && record.time > s.lastTime + current.heartbeat) s.gaps++;
+    if (record.time > s.lastTime) s.lastTime = record.time;
+    s.count++;
+}
+
+void DailySummary::addAlert(const alertEvent_t& event) {
+    if (event.sensor >= current.sensorCount) return;
+    summarySensor_t& s = current.sensors[event.sensor];
+    if (event.level != ALERT_NORMAL) {
+        s.alerts++;
+        if (event.previous == ALERT_NORMAL) s.active++;
+    } else if (s.active) {
+        s.active--;
+    }
+}
+
+bool DailySummary::due(uint32_t now) {
+    if (hour == SUMMARY_DISABLED || now < SUMMARY_VALID_TIME) return false;
+    if (!nextTime) {
+        // first valid clock: the period starts now
+        nextTime = summaryNextTime(now, hour, current.utcOffset);
+        if (!current.from) current.from = now;
+        return false;
+    }
+    return now >= nextTime;
+}
+
+void DailySummary::take(uint32_t now, summaryReport_t& report) {
+    if (!current.from) current.from = now;
+    report = current;
+    report.to = now;
+
+    // next period, the heartbeat and the active alerts carry over
+    current.from = now;
+    for (size_t i = 0; i < current.sensorCount; i++) {
+        summarySensor_t& s = current.sensors[i];
+        s.count = 0;
+        s.alerts = 0;
+        s.gaps = 0;
+    }
+    nextTime = hour != SUMMARY_DISABLED && now >= SUMMARY_VALID_TIME ? summaryNextTime(now, hour, current.utcOffset) : 0;
+}
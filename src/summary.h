@@ -0,0 +1,173 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "readingHistory.h"
+#include "alerts.h"
+
+/*
+ * Daily summary of all sensors.
+ *
+ * The summary of the running period (since the last one was sent) is filled
+ * in as the readings arrive: per sensor and quantity min, max, first and
+ * last value, plus the reading count, alert events and missed heartbeats.
+ * Each reading costs one pass over the seven quantities, and taking the
+ * summary at the daily trigger is a copy of the counters; nothing is
+ * recomputed from the history. The trigger fires once a day at a local
+ * hour, driven by the caller's clock (UTC seconds).
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define SUMMARY_MAX_SENSORS 8           /**< Sensors in a summary (MAX_SENSORS) */
+#define SUMMARY_VALID_TIME 1600000000   /**< Clock values below are taken as not synchronised yet */
+#define SUMMARY_DISABLED 0xFF           /**< Summary hour that disables the daily trigger */
+
+/**
+ * @brief State of a sensor in a summary, worst first
+ */
+enum summaryStatus_t : uint8_t
+{
+    SUMMARY_NORMAL = 0,     /**< Readings arrive, no alert in the period */
+    SUMMARY_WARNING,        /**< Alerts raised and recovered, or heartbeats missed in the period */
+    SUMMARY_CRITICAL,       /**< An alert is active */
+    SUMMARY_OFFLINE         /**< No reading within the heartbeat timeout */
+};
+
+/**
+ * @brief Counters of one sensor since the last summary, values raw (see YC01_FIELDS)
+ */
+struct summarySensor_t
+{
+    uint32_t count;                     /**< Readings in the period */
+    uint32_t lastTime;                  /**< Time of the newest reading, kept across periods (0: never) */
+    uint16_t alerts;                    /**< Alert events (not recoveries) in the period */
+    uint16_t gaps;                      /**< Heartbeats missed in the period (readings more than the timeout apart) */
+    uint8_t active;                     /**< Rules at an alert level */
+    uint8_t reserved[3];
+    int16_t min[YC01_QUANTITIES];
+    int16_t max[YC01_QUANTITIES];
+    int16_t first[YC01_QUANTITIES];     /**< First value of the period, the trend is last - first */
+    int16_t last[YC01_QUANTITIES];
+};
+
+/**
+ * @brief A summary as taken at the trigger
+ */
+struct summaryReport_t
+{
+    uint32_t from;                      /**< Start of the period (UTC seconds) */
+    uint32_t to;                        /**< End of the period (UTC seconds) */
+    uint32_t heartbeat;                 /**< Heartbeat timeout in seconds */
+    int16_t utcOffset;                  /**< Offset of the local time in minutes */
+    uint8_t sensorCount;
+    summarySensor_t sensors[SUMMARY_MAX_SENSORS];
+};
+
+/**
+ * @brief Gets the next time a local hour starts
+ * @param now Current time (UTC seconds)
+ * @param hour Local hour (0 .. 23)
+ * @param utcOffset Offset of the local time in minutes
+ * @return First time after now at hour:00 local time
+ */
+uint32_t summaryNextTime(uint32_t now, uint8_t hour, int16_t utcOffset);
+
+/**
+ * @brief Formats a local date and time ("2026-10-17 09:00")
+ * @param time Time (UTC seconds)
+ * @param utcOffset Offset of the local time in minutes
+ * @param out Output buffer
+ * @param length Size of the buffer
+ * @return Length of the text
+ */
+size_t summaryFormatTime(uint32_t time, int16_t utcOffset, char out[], size_t length);
+
+/**
+ * @brief Gets the state of a sensor at the end of a report
+ */
+summaryStatus_t summaryStatus(const summaryReport_t& report, size_t sensor);
+
+/**
+ * @brief Gets the worst state of all sensors of a report
+ */
+summaryStatus_t summaryOverall(const summaryReport_t& report);
+
+/**
+ * @brief Gets the name of a state ("normal", "warning", "critical", "offline")
+ */
+const char* summaryStatusName(summaryStatus_t status);
+
+/**
+ * @brief Formats a report as plain text (email body)
+ * @param report Report
+ * @param names Sensor names, indexed by sensor
+ * @param out Output buffer
+ * @param length Size of the buffer
+ * @return Length of the text, cut at the buffer size
+ */
+size_t summaryFormatText(const summaryReport_t& report, const char* const names[], char out[], size_t length);
+
+/**
+ * @brief Formats a report as JSON object (webhook payload)
+ * @param report Report
+ * @param names Sensor names, indexed by sensor
+ * @param out Output buffer
+ * @param length Size of the buffer
+ * @return Length of the text, cut at the buffer size
+ */
+size_t summaryFormatJson(const summaryReport_t& report, const char* const names[], char out[], size_t length);
+
+/**
+ * @brief Summary of the running period and its daily trigger
+ */
+class DailySummary {
+public:
+    /**
+     * @brief Clears the counters, the period starts with the first valid clock
+     * @param sensors Number of sensors (clamped to SUMMARY_MAX_SENSORS)
+     * @param hour Local hour of the trigger (SUMMARY_DISABLED: no trigger)
+     * @param utcOffset Offset of the local time in minutes
+     * @param heartbeat Heartbeat timeout in seconds
+     */
+    void begin(size_t sensors, uint8_t hour, int16_t utcOffset, uint32_t heartbeat);
+
+    /**
+     * @brief Adds a reading, O(1)
+     * @param record Reading
+     */
+    void add(const historyRecord_t& record);
+
+    /**
+     * @brief Counts an alert event (level change) of a sensor
+     */
+    void addAlert(const alertEvent_t& event);
+
+    /**
+     * @brief Checks the trigger
+     * @param now Current time (UTC seconds)
+     * @return true once the trigger hour has passed since the period started
+     */
+    bool due(uint32_t now);
+
+    /**
+     * @brief Takes the summary of the running period and starts the next one
+     * @param now End of the period (UTC seconds)
+     * @param report Output
+     */
+    void take(uint32_t now, summaryReport_t& report);
+
+    /**
+     * @brief Gets the time the next summary is due (0: clock not valid yet or disabled)
+     */
+    uint32_t next() const { return nextTime; }
+
+    /**
+     * @brief Gets the counters of a sensor in the running period
+     */
+    const summarySensor_t& sensor(size_t index) const { return current.sensors[index]; }
+
+protected:
+    summaryReport_t current;        /**< Running period (to is not set) */
+    uint8_t hour = SUMMARY_DISABLED;
+    uint32_t nextTime = 0;
+};
@@ -0,0 +1,85 @@
+#include <string.h>
+#include <math.h>
+
+#include "trends.h"
+
+
+void Trends::begin() {
+    version.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memset(sensors, 0, sizeof(sensors));
+    version.fetch_add(1, std::memory_order_release);
+}
+
+void Trends::add(const historyRecord_t& record) {
+    if (record.sensor >= TREND_MAX_SENSORS) return;
+    sensorTrend_t& s = sensors[record.sensor];
+
+    version.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    bool first = s.count == 0;
+    if (first) s.base = record.time;
+    int64_t t = (int64_t)record.time - s.base;
+
+    // the reading leaving the window
+    if (s.count == TREND_WINDOW) {
+        int64_t old = s.times[s.pos];
+        s.sumT -= old;
+        s.sumTT -= old * old;
+        for (size_t q = 0; q < YC01_QUANTITIES; q++) {
+            s.sumX[q] -= s.values[q][s.pos];
+            s.sumTX[q] -= old * s.values[q][s.pos];
+        }
+    } else {
+        s.count++;
+    }
+    s.times[s.pos] = (int32_t)t;
+    s.sumT += t;
+    s.sumTT += t * t;
+
+    // EWMA weighted by the time since the previous reading
+    float alpha = 1;
+    if (!first) {
+        float dt = record.time > s.lastTime ? (float)(record.time - s.lastTime) : 1.0f;
+        alpha = 1 - expf(-dt / TREND_TAU);
+    }
+    for (size_t q = 0; q < YC01_QUANTITIES; q++) {
+        int16_t x = record.raw[q];
+        s.values[q][s.pos] = x;
+        s.sumX[q] += x;
+        s.sumTX[q] += t * x;
+        float diff = x - s.mean[q];
+        float increment = alpha * diff;
+        s.mean[q] += increment;
+        s.var[q] = (1 - alpha) * (s.var[q] + diff * increment);
+    }
+    s.pos = (s.pos + 1) % TREND_WINDOW;
+    s.lastTime = record.time;
+
+    version.fetch_add(1, std::memory_order_release);
+}
+
+bool Trends::get(size_t sensor, trendStats_t stats[YC01_QUANTITIES]) const {
+    if (sensor >= TREND_MAX_SENSORS) return false;
+    const sensorTrend_t& s = sensors[sensor];
+    uint16_t count;
+    for (;;) {
+        uint32_t before = version.load(std::memory_order_acquire);
+        count = s.count;
+        int64_t n = count;
+        int64_t denominator = n * s.sumTT - s.sumT * s.sumT;
+        for (size_t q = 0; q < YC01_QUANTITIES; q++) {
+            double scale = YC01_FIELDS[q].scale;
+            stats[q].mean = (float)(s.mean[q] / scale);
+            stats[q].sd = (float)(sqrt(s.var[q] > 0 ? s.var[q] : 0) / scale);
+            // slope in raw per second, exact up to the division
+            int64_t numerator = n * s.sumTX[q] - s.sumT * s.sumX[q];
+            stats[q].slope = denominator > 0 ? (float)((double)numerator / denominator * 3600 / scale) : 0;
+            stats[q].samples = count;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!(before & 1) && version.load(std::memory_order_relaxed) == before) break;
+    }
+    return count > 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "readingHistory.h"
+
+/*
+ * Streaming trend estimators of every measurement per sensor.
+ *
+ * For each quantity an exponentially weighted mean and variance (time
+ * constant TREND_TAU, weighted by the time between readings) and the
+ * least-squares slope over the last TREND_WINDOW readings are kept. Both
+ * are updated in constant time and memory per reading: the EWMA by the
+ * usual incremental update, the slope by running sums over a ring of the
+ * window, where the reading leaving the window is subtracted again. The
+ * sums are 64-bit integers over the raw fixed point and the seconds since
+ * the first reading, so they are exact and do not drift.
+ * This module is plain C++ (no Arduino / NimBLE dependencies).
+ */
+
+#define TREND_MAX_SENSORS 8         /**< Sensors with trends (MAX_SENSORS) */
+#define TREND_WINDOW 16             /**< Readings of the slope window */
+#define TREND_TAU 3600              /**< Time constant of the EWMA in seconds */
+
+/**
+ * @brief Trend of one quantity, in the units of /status
+ */
+struct trendStats_t
+{
+    float mean;         /**< Exponentially weighted mean */
+    float sd;           /**< Exponentially weighted standard deviation */
+    float slope;        /**< Least-squares slope over the window, per hour */
+    uint16_t samples;   /**< Readings in the slope window */
+};
+
+/**
+ * @brief Trend estimators of all sensors
+ */
+class Trends {
+public:
+    /**
+     * @brief Clears all estimators
+     */
+    void begin();
+
+    /**
+     * @brief Adds a reading (loop side), O(1)
+     * @param record Reading
+     */
+    void add(const historyRecord_t& record);
+
+    /**
+     * @brief Gets the trends of a sensor (safe against a concurrent add)
+     * @param sensor Sensor index
+     * @param stats Output, indexed by yc01Quantity_t
+     * @return false if the sensor has no readings
+     */
+    bool get(size_t sensor, trendStats_t stats[YC01_QUANTITIES]) const;
+
+protected:
+    /**
+     * @brief Estimators of one sensor
+     */
+    struct sensorTrend_t
+    {
+        uint32_t base;                          /**< Time of the first reading, origin of the window times */
+        uint32_t lastTime;                      /**< Time of the newest reading */
+        uint16_t count;                         /**< Readings in the window */
+        uint16_t pos;                           /**< Next slot of the window */
+        int32_t times[TREND_WINDOW];            /**< Window times, seconds since base */
+        int16_t values[YC01_QUANTITIES][TREND_WINDOW];   /**< Window values, raw */
+        int64_t sumT;                           /**< Sum of the window times */
+        int64_t sumTT;                          /**< Sum of the squared window times */
+        int64_t sumX[YC01_QUANTITIES];          /**< Sum of the window values */
+        int64_t sumTX[YC01_QUANTITIES];         /**< Sum of time x value */
+        float mean[YC01_QUANTITIES];            /**< EWMA, raw */
+        float var[YC01_QUANTITIES];             /**< Exponentially weighted variance, raw */
+    };
+
+    sensorTrend_t sensors[TREND_MAX_SENSORS];
+    std::atomic<uint32_t> version{0};   /**< Odd while add() writes (seqlock for readers) */
+};
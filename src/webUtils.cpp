@@ -262,6 +262,65 @@ struct WifiEntry
     uint8_t channel;
 };
 
+// cached /status and /config.json bodies, the lock guards them between the loop and the web server task
+static ResponseCache responseCache;
+static String responseBodies[RESPONSE_CACHE_SLOTS];
+static SemaphoreHandle_t responseLock = xSemaphoreCreateMutex();
+
+bool responseCacheFresh(size_t slot, uint32_t maxAgeMs)
+{
+    xSemaphoreTake(responseLock, portMAX_DELAY);
+    bool fresh = responseCache.fresh(slot, millis(), maxAgeMs);
+    xSemaphoreGive(responseLock);
+    return fresh;
+}
+
+void responseCacheStore(size_t slot, const char *body, size_t length)
+{
+    if (slot >= RESPONSE_CACHE_SLOTS)
+        return;
+    xSemaphoreTake(responseLock, portMAX_DELAY);
+    responseBodies[slot] = body; // keeps the capacity of the previous body, no new allocation once grown
+    responseCache.store(slot, body, length, millis());
+    xSemaphoreGive(responseLock);
+}
+
+void responseCacheInvalidate()
+{
+    xSemaphoreTake(responseLock, portMAX_DELAY);
+    responseCache.invalidate();
+    xSemaphoreGive(responseLock);
+}
+
+const ResponseCache &responseCacheStats()
+{
+    return responseCache;
+}
+
+void sendCachedResponse(AsyncWebServerRequest *request, size_t slot, const char *contentType)
+{
+    const AsyncWebHeader *ifNoneMatch = request->getHeader("If-None-Match");
+    AsyncWebServerResponse *response;
+    xSemaphoreTake(responseLock, portMAX_DELAY);
+    if (!responseCache.etag(slot)[0])
+    {
+        // never built, /status is built by the loop only
+        xSemaphoreGive(responseLock);
+        request->send(503, "text/plain", "Not built yet");
+        return;
+    }
+    if (responseCache.notModified(slot, ifNoneMatch ? ifNoneMatch->value().c_str() : ""))
+        response = request->beginResponse(304);
+    else
+        response = request->beginResponse(200, contentType, responseBodies[slot]);
+    response->addHeader("ETag", responseCache.etag(slot));
+    xSemaphoreGive(responseLock);
+
+    // the browser revalidates every poll, unchanged bodies cost a 304 without payload
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+}
+
 bool scanWifi = false;
 String wifiListJson = "[]";
 void scanWifiNetworks()
@@ -322,11 +381,15 @@ void webServerInit(AsyncWebServer &webServer, bool isCaptive)
 
     webServer.on("/config.json", HTTP_GET, [](AsyncWebServerRequest *request)
         {
-            DEBUG_println("send config.json");
-            String response;
-            serializeConfig(response);
-
-            request->send(200, "application/json", response);
+            // the config changes with a reboot only, built once
+            if (!responseCacheFresh(RESPONSE_SLOT_CONFIG, 0))
+            {
+                DEBUG_println("build config.json");
+                String response;
+                serializeConfig(response);
+                responseCacheStore(RESPONSE_SLOT_CONFIG, response.c_str(), response.length());
+            }
+            sendCachedResponse(request, RESPONSE_SLOT_CONFIG, "application/json");
 
         });
 
@@ -346,6 +409,7 @@ void webServerInit(AsyncWebServer &webServer, bool isCaptive)
                         // Only update if not masked
                         if (doc["wifiPassword"] == "***") doc["wifiPassword"] = config.wifiPassword;
                         if (doc["mqttPassword"] == "***") doc["mqttPassword"] = config.mqttPassword;
+                        if (doc["notifyPassword"] == "***") doc["notifyPassword"] = config.notifyPassword;
 
                         serializeJson(doc, file);
                         file.close();
@@ -1,5 +1,6 @@
 #pragma once
 #include <ESPAsyncWebServer.h>
+#include "responseCache.h"
 
 /**
  * @brief Helper function to format a byte count into a human readable string.
@@ -27,6 +28,46 @@ void scanWifiNetworks();
  */
 void webServerInit(AsyncWebServer &webServer, bool isCaptive = false);
 
+/**
+ * @brief Slot of /config.json in the response cache, the slots below are /status of each sensor.
+ */
+#define RESPONSE_SLOT_CONFIG (RESPONSE_CACHE_SLOTS - 1)
+
+/**
+ * @brief Checks if a cached response can be served without a rebuild (see responseCache.h).
+ * @param slot Response cache slot
+ * @param maxAgeMs Maximum age of the body in ms, 0: until invalidated
+ * @return bool
+ */
+bool responseCacheFresh(size_t slot, uint32_t maxAgeMs);
+
+/**
+ * @brief Stores a rebuilt response body and its ETag.
+ * @param slot Response cache slot
+ * @param body Body
+ * @param length Length of the body
+ */
+void responseCacheStore(size_t slot, const char *body, size_t length);
+
+/**
+ * @brief Marks all cached responses as out of date.
+ */
+void responseCacheInvalidate();
+
+/**
+ * @brief Gets the response cache counters (requests, 304 answers, builds).
+ * @return const ResponseCache&
+ */
+const ResponseCache &responseCacheStats();
+
+/**
+ * @brief Sends a cached response with its ETag, 304 if the client sent the current ETag in If-None-Match, 503 if never built.
+ * @param request Pointer to AsyncWebServerRequest
+ * @param slot Response cache slot
+ * @param contentType MIME type
+ */
+void sendCachedResponse(AsyncWebServerRequest *request, size_t slot, const char *contentType);
+
 /**
  * @brief Handles background tasks for the web server and utilities.
  */
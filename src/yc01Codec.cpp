@@ -0,0 +1,107 @@
+#include <string.h>
+
+#include "yc01Codec.h"
+
+
+/*
+ * The original decoder walks the frame backwards and chains every byte
+ * through a temporary. Unrolling the chain shows that each decoded byte only
+ * depends on its two neighbours:
+ *
+ *   out[i] = ~(hi(in[i+1]) | lo(in[i-1]))      for 1 <= i <= length-3
+ *
+ * with hi(x) = (x & 0x55) << 1 and lo(x) = (x & 0xAA) >> 1. Only the first
+ * and the last two bytes differ, because the chain starts and ends there.
+ * The masks never move a bit across a byte boundary, so the middle part can
+ * be computed on 32-bit words.
+ */
+
+static inline uint8_t hi(uint8_t x) { return (x & 0x55) << 1; }
+static inline uint8_t lo(uint8_t x) { return (x & 0xAA) >> 1; }
+
+static inline uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v)); // unaligned safe, compiles to a single load
+    return v;
+}
+
+static inline void store32(uint8_t* p, uint32_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+yc01Error_t yc01Decode(const uint8_t in[], size_t length, uint8_t out[]) {
+    if (length < 2 || length > YC01_MAX_FRAME_LENGTH) {
+        return YC01_ERR_LENGTH;
+    }
+    const size_t last = length - 1;
+
+    // first byte, the chain ends with the inverted odd bits of in[1]
+    uint8_t low = (length == 2) ? lo(in[1]) : (uint8_t)(~in[1] & 0x55);
+    out[0] = ~(hi(in[0]) | low);
+    uint8_t chk = out[0];
+
+    // middle bytes, four at a time
+    uint32_t chkWord = 0;
+    size_t i = 1;
+    for (; i + 4 < last; i += 4) {
+        uint32_t w = ~(((load32(&in[i + 1]) & 0x55555555u) << 1) |
+                       ((load32(&in[i - 1]) & 0xAAAAAAAAu) >> 1));
+        store32(&out[i], w);
+        chkWord ^= w;
+    }
+    for (; i + 2 <= last; i++) {
+        out[i] = ~(hi(in[i + 1]) | lo(in[i - 1]));
+        chk ^= out[i];
+    }
+
+    // last two bytes, the chain starts with the inverted even bits of in[last]
+    if (length > 2) {
+        out[last - 1] = ~((uint8_t)(~in[last] & 0xAA) | lo(in[last - 2]));
+        chk ^= out[last - 1];
+    }
+    out[last] = ~(hi(in[last]) | lo(in[last - 1]));
+    chk ^= out[last];
+
+    // fold the word checksum; the last byte is the XOR of all others,
+    // so the XOR over the whole frame is zero for a valid frame
+    chkWord ^= chkWord >> 16;
+    chkWord ^= chkWord >> 8;
+    chk ^= (uint8_t)chkWord;
+    return chk == 0 ? YC01_OK : YC01_ERR_CHECKSUM;
+}
+
+/**
+ * @brief Helper function to convert 2 bytes to int16 (big endian)
+ * @param data Data array
+ * @param idx Starting index
+ * @return 16-bit integer
+ */
+static inline int16_t toInt16(uint8_t const data[], int idx) {
+    return ((uint16_t)data[idx] << 8) | (uint16_t)data[idx + 1];
+}
+
+yc01Error_t yc01Parse(yc01Span_t value, sensorReadings_t& readings) {
+    if (value.length < YC01_FRAME_LENGTH) {
+        return YC01_ERR_LENGTH;
+    }
+    uint8_t data[YC01_MAX_FRAME_LENGTH];
+    yc01Error_t error = yc01Decode(value.data, value.length, data);
+    if (error != YC01_OK) {
+        return error;
+    }
+
+    readings.type = data[YC01_TYPE_OFFSET];
+    for (size_t q = 0; q < YC01_QUANTITIES; q++) {
+        readings.raw[q] = toInt16(data, YC01_FIELDS[q].offset);
+    }
+    return YC01_OK;
+}
+
+const char* yc01ErrorName(yc01Error_t error) {
+    switch (error) {
+        case YC01_OK:           return "ok";
+        case YC01_ERR_LENGTH:   return "invalid frame length";
+        case YC01_ERR_CHECKSUM: return "checksum mismatch";
+    }
+    return "unknown error";
+}
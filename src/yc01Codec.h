@@ -0,0 +1,159 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+/*
+ * Decoder for the proprietary frame format of the BLE-YC01 sensor.
+ *
+ * This module is plain C++ (no Arduino / NimBLE dependencies) so it can be
+ * tested and benchmarked on the host (see test/native/test_yc01_codec).
+ * The decoder keeps no state and writes into a caller provided buffer, so it
+ * is reentrant and may run on the NimBLE host task and the loop concurrently.
+ * Decoding and parsing never allocate.
+ */
+
+/**
+ * @brief Measurements of a frame, index into the raw values
+ */
+enum yc01Quantity_t : uint8_t
+{
+    YC01_PH = 0,        /**< pH x100 */
+    YC01_EC,            /**< Electrical Conductivity in mV */
+    YC01_TDS,           /**< Total Dissolved Solids in mg/L */
+    YC01_ORP,           /**< Oxidation-Reduction Potential in mV */
+    YC01_CL,            /**< Residual Chlorine in mg/L x10 */
+    YC01_TEMP,          /**< Temperature in °C x10 */
+    YC01_BAT,           /**< Battery voltage in mV */
+    YC01_QUANTITIES
+};
+
+/**
+ * @brief Position and fixed-point scale of one measurement in a decoded frame
+ *
+ * The raw value is the big endian int16 at offset, the physical value is
+ * raw / scale.
+ */
+struct yc01Field_t
+{
+    uint8_t offset;     /**< Offset of the int16 in the decoded frame */
+    int16_t scale;      /**< Fixed-point divisor */
+};
+
+/**
+ * @brief Field layout of a decoded frame, indexed by yc01Quantity_t
+ */
+constexpr yc01Field_t YC01_FIELDS[YC01_QUANTITIES] = {
+    {  3, 100 },    // pH
+    {  5, 1 },      // EC in mV
+    {  7, 1 },      // TDS in mg/L
+    {  9, 1 },      // ORP in mV
+    { 11, 10 },     // chlorine in mg/L
+    { 13, 10 },     // temperature in °C
+    { 15, 1 },      // battery in mV (low byte is the checksum)
+};
+
+#define YC01_SALT_FACTOR 0.55   /**< Salinity in g/L per mV of EC */
+
+/**
+ * @brief Converts a raw measurement into its physical value
+ *
+ * Only for presentation (JSON, UI); storage and transport keep the raw
+ * integers. The division runs in double to reproduce the original rounding.
+ */
+constexpr float yc01Value(yc01Quantity_t quantity, int16_t raw) {
+    return (float)(raw / (double)YC01_FIELDS[quantity].scale);
+}
+
+/**
+ * @brief Derives the salinity in g/L from the raw EC
+ */
+constexpr float yc01Salt(int16_t rawEc) {
+    return (float)(rawEc * YC01_SALT_FACTOR);
+}
+
+/**
+ * @brief Structure to hold sensor readings from BLE-YC01
+ *
+ * The measurements are kept as the fixed-point integers of the frame (see
+ * YC01_FIELDS), the accessors convert them to float.
+ */
+struct sensorReadings_t
+{
+    uint8_t type;       /**< Sensor type identifier */
+    time_t time;        /**< Timestamp of the reading */
+    int16_t rssi;       /**< BLE signal strength (RSSI) */
+    int16_t raw[YC01_QUANTITIES];   /**< Measurements, fixed point (yc01Quantity_t) */
+
+    float pH() const { return yc01Value(YC01_PH, raw[YC01_PH]); }          /**< pH value (0-14) */
+    float ec() const { return yc01Value(YC01_EC, raw[YC01_EC]); }          /**< Electrical Conductivity in mV */
+    float salt() const { return yc01Salt(raw[YC01_EC]); }                   /**< Salinity in g/L */
+    float tds() const { return yc01Value(YC01_TDS, raw[YC01_TDS]); }       /**< Total Dissolved Solids in mg/L */
+    float orp() const { return yc01Value(YC01_ORP, raw[YC01_ORP]); }       /**< Oxidation-Reduction Potential in mV */
+    float cl() const { return yc01Value(YC01_CL, raw[YC01_CL]); }          /**< Residual Chlorine in mg/L */
+    float temp() const { return yc01Value(YC01_TEMP, raw[YC01_TEMP]); }    /**< Temperature in °C */
+    float bat() const { return yc01Value(YC01_BAT, raw[YC01_BAT]); }       /**< Battery voltage in mV */
+};
+
+#define YC01_FRAME_LENGTH 17        /**< Length of an encoded sensor frame */
+#define YC01_MAX_FRAME_LENGTH 60    /**< Maximum length accepted by the decoder */
+#define YC01_MODEL_LENGTH 24        /**< Buffer size of a model name incl. terminator */
+
+/**
+ * @brief Result of yc01Decode()
+ */
+enum yc01Error_t
+{
+    YC01_OK = 0,        /**< Frame decoded, checksum valid */
+    YC01_ERR_LENGTH,    /**< Frame too short or too long */
+    YC01_ERR_CHECKSUM   /**< Frame decoded, but the XOR checksum does not match */
+};
+
+/**
+ * @brief Decodes a raw sensor frame and verifies its XOR checksum.
+ *
+ * The bit swapping runs on 32-bit words (four bytes per step) and the
+ * checksum is accumulated in the same pass. On YC01_ERR_CHECKSUM the decoded
+ * bytes are still written to out.
+ * @param in Raw frame
+ * @param length Length of the frame (2 .. YC01_MAX_FRAME_LENGTH)
+ * @param out Output buffer with at least length bytes, must not overlap in
+ * @return YC01_OK or the reason the frame was rejected
+ */
+yc01Error_t yc01Decode(const uint8_t in[], size_t length, uint8_t out[]);
+
+/**
+ * @brief Gets a readable description of a decoder result
+ * @param error Decoder result
+ * @return Static string
+ */
+const char* yc01ErrorName(yc01Error_t error);
+
+/**
+ * @brief Non-owning view over a raw characteristic or advertisement value
+ */
+struct yc01Span_t
+{
+    const uint8_t* data;    /**< First byte, not owned */
+    size_t length;          /**< Number of bytes */
+};
+
+#define YC01_TYPE_OFFSET 2  /**< Offset of the sensor type byte in the decoded frame */
+
+constexpr bool yc01FieldsFit() {
+    for (const yc01Field_t& field : YC01_FIELDS) {
+        if (field.offset + 2 > YC01_FRAME_LENGTH || field.scale <= 0) return false;
+    }
+    return true;
+}
+static_assert(yc01FieldsFit(), "YC01_FIELDS exceed the frame");
+
+/**
+ * @brief Decodes a raw sensor frame and maps it to readings.
+ *
+ * Fills type and the measurements; time and rssi are left to the caller.
+ * @param value Raw frame (at least YC01_FRAME_LENGTH bytes)
+ * @param readings Output readings, unchanged on error
+ * @return YC01_OK or the reason the frame was rejected
+ */
+yc01Error_t yc01Parse(yc01Span_t value, sensorReadings_t& readings);
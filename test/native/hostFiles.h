@@ -0,0 +1,93 @@
+#pragma once
+/*
+ * LogFiles stand-in on host files, for the storage benchmarks.
+ *
+ * Every path is one file in a temporary directory. Each append opens the
+ * file, writes, fsyncs and closes it, as a LittleFS commit; each read opens
+ * the file as well. Append and recovery timings therefore include real file
+ * I/O, unlike the in-memory stand-in (memoryFiles.h) used by the other tests.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <set>
+#include <string>
+
+#include "readingLog.h"
+
+/**
+ * @brief LogFiles stand-in on host files
+ */
+class HostFiles : public LogFiles {
+public:
+    HostFiles() {
+        strcpy(dir, "/tmp/logfilesXXXXXX");
+        TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    }
+
+    ~HostFiles() {
+        for (const std::string& path : paths) {
+            ::remove(path.c_str());
+        }
+        rmdir(dir);
+    }
+
+    size_t size(const char* path) override {
+        FILE* file = fopen(hostPath(path), "rb");
+        if (!file) return 0;
+        fseek(file, 0, SEEK_END);
+        size_t length = ftell(file);
+        fclose(file);
+        return length;
+    }
+
+    size_t read(const char* path, size_t offset, uint8_t data[], size_t length) override {
+        reads++;
+        FILE* file = fopen(hostPath(path), "rb");
+        if (!file) return 0;
+        size_t done = fseek(file, offset, SEEK_SET) == 0 ? fread(data, 1, length, file) : 0;
+        fclose(file);
+        bytesRead += done;
+        return done;
+    }
+
+    bool append(const char* path, const uint8_t data[], size_t length) override {
+        FILE* file = fopen(hostPath(path), "ab");
+        if (!file) return false;
+        size_t done = fwrite(data, 1, length, file);
+        fflush(file);
+        fsync(fileno(file));
+        fclose(file);
+        writes++;
+        return done == length;
+    }
+
+    bool remove(const char* path) override {
+        ::remove(hostPath(path));
+        return true;
+    }
+
+    uint32_t reads = 0;
+    size_t bytesRead = 0;
+    uint32_t writes = 0;            /**< Appends, each a commit on LittleFS */
+
+protected:
+    /**
+     * @brief Maps "/log/seg0.bin" to "<dir>/_log_seg0.bin"
+     */
+    const char* hostPath(const char* path) {
+        std::string name = path;
+        for (char& c : name) {
+            if (c == '/') c = '_';
+        }
+        buffer = std::string(dir) + "/" + name;
+        paths.insert(buffer);
+        return buffer.c_str();
+    }
+
+    char dir[32];
+    std::string buffer;
+    std::set<std::string> paths;    /**< Files to delete at the end */
+};
@@ -0,0 +1,76 @@
+#pragma once
+/*
+ * LogFiles stand-in in memory, shared by the host tests of the modules on
+ * LittleFS (reading log, rollups, export, MQTT queue).
+ *
+ * A power loss is simulated by cutting the file written last (cut(),
+ * lastPath), a flash bit error by corrupt(), a full or failing flash by
+ * failWrites. The counters give the file accesses of a test. Timings taken
+ * on this stand-in are RAM figures; the benchmarks use hostFiles.h.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "readingLog.h"
+
+/**
+ * @brief LogFiles stand-in in memory
+ */
+class MemoryFiles : public LogFiles {
+public:
+    size_t size(const char* path) override {
+        return files.count(path) ? files[path].size() : 0;
+    }
+
+    size_t read(const char* path, size_t offset, uint8_t data[], size_t length) override {
+        reads++;
+        if (!files.count(path) || offset > files[path].size()) return 0;
+        const std::vector<uint8_t>& file = files[path];
+        if (length > file.size() - offset) length = file.size() - offset;
+        memcpy(data, file.data() + offset, length);
+        bytesRead += length;
+        return length;
+    }
+
+    bool append(const char* path, const uint8_t data[], size_t length) override {
+        if (failWrites) return false;
+        files[path].insert(files[path].end(), data, data + length);
+        lastPath = path;
+        writes++;
+        return true;
+    }
+
+    bool remove(const char* path) override {
+        files.erase(path);
+        return true;
+    }
+
+    /**
+     * @brief Cuts a file, as a write interrupted by a power loss
+     */
+    void cut(const char* path, size_t bytes) {
+        std::vector<uint8_t>& file = files[path];
+        TEST_ASSERT_TRUE(bytes <= file.size());
+        file.resize(file.size() - bytes);
+    }
+
+    /**
+     * @brief Flips a byte of a file, as a flash bit error
+     */
+    void corrupt(const char* path, size_t offset) {
+        std::vector<uint8_t>& file = files[path];
+        TEST_ASSERT_TRUE(offset < file.size());
+        file[offset] ^= 0x5A;
+    }
+
+    std::map<std::string, std::vector<uint8_t>> files;
+    std::string lastPath;           /**< File of the last append */
+    bool failWrites = false;        /**< Appends fail */
+    uint32_t reads = 0;
+    size_t bytesRead = 0;
+    uint32_t writes = 0;            /**< Appends, each a commit on LittleFS */
+};
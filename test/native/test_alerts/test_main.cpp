@@ -0,0 +1,184 @@
+/*
+ * Host-side tests of the threshold alert engine.
+ *
+ * Run with: pio test -e native -f native/test_alerts -v
+ * Covers min, max, normal and recovery for every quantity of the ROADMAP
+ * (pH, chlorine, ORP, temperature, battery), hysteresis and debounce. The
+ * verbose output prints the cost of one evaluation of a full rule table.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "alerts.h"
+
+#define T0 1700000000
+
+static sensorReadings_t makeReadings(yc01Quantity_t quantity, float value) {
+    sensorReadings_t readings;
+    memset(&readings, 0, sizeof(readings));
+    readings.type = 1;
+    readings.time = T0;
+    // all quantities in range, then the one under test
+    readings.raw[YC01_PH] = 720;
+    readings.raw[YC01_ORP] = 700;
+    readings.raw[YC01_CL] = 6;
+    readings.raw[YC01_TEMP] = 250;
+    readings.raw[YC01_BAT] = 3000;
+    readings.raw[quantity] = alertToRaw(quantity, value);
+    return readings;
+}
+
+static alertRule_t makeRule(yc01Quantity_t quantity, float min, float max, float hysteresis, uint8_t debounce) {
+    alertRule_t rule;
+    rule.quantity = quantity;
+    rule.min = alertToRaw(quantity, min);
+    rule.max = alertToRaw(quantity, max);
+    rule.hysteresis = alertToRaw(quantity, hysteresis);
+    rule.debounce = debounce;
+    return rule;
+}
+
+static AlertEngine engine;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_min_max_normal_recovery(void) {
+    const alertRule_t rules[] = {
+        makeRule(YC01_PH, 7.0f, 7.8f, 0.1f, 1),
+        makeRule(YC01_CL, 0.3f, 1.5f, 0.1f, 1),
+        makeRule(YC01_ORP, 650, 800, 10, 1),
+        makeRule(YC01_TEMP, 10, 35, 0.5f, 1),
+        makeRule(YC01_BAT, 2600, 3600, 50, 1),
+    };
+    engine.begin(rules, 5);
+    const struct {
+        yc01Quantity_t quantity;
+        float low, high, normal;
+    } cases[] = {
+        { YC01_PH, 6.8f, 8.0f, 7.4f },
+        { YC01_CL, 0.1f, 2.0f, 0.8f },
+        { YC01_ORP, 600, 850, 720 },
+        { YC01_TEMP, 5, 36, 25 },
+        { YC01_BAT, 2400, 3700, 3000 },
+    };
+    alertEvent_t events[ALERT_MAX_RULES];
+    for (size_t r = 0; r < 5; r++) {
+        TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(cases[r].quantity, cases[r].normal), events, ALERT_MAX_RULES));
+
+        // min
+        TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(cases[r].quantity, cases[r].low), events, ALERT_MAX_RULES));
+        TEST_ASSERT_EQUAL(r, events[0].rule);
+        TEST_ASSERT_EQUAL(ALERT_LOW, events[0].level);
+        TEST_ASSERT_EQUAL(ALERT_NORMAL, events[0].previous);
+        TEST_ASSERT_EQUAL(1, engine.active(0));
+        TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(cases[r].quantity, cases[r].low), events, ALERT_MAX_RULES));
+        // recovery from min
+        TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(cases[r].quantity, cases[r].normal), events, ALERT_MAX_RULES));
+        TEST_ASSERT_EQUAL(ALERT_NORMAL, events[0].level);
+        TEST_ASSERT_EQUAL(ALERT_LOW, events[0].previous);
+
+        // max and recovery from max
+        TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(cases[r].quantity, cases[r].high), events, ALERT_MAX_RULES));
+        TEST_ASSERT_EQUAL(ALERT_HIGH, events[0].level);
+        TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(cases[r].quantity, cases[r].normal), events, ALERT_MAX_RULES));
+        TEST_ASSERT_EQUAL(ALERT_NORMAL, events[0].level);
+        TEST_ASSERT_EQUAL(0, engine.active(0));
+    }
+    // the state is kept per sensor
+    TEST_ASSERT_EQUAL(1, engine.evaluate(1, makeReadings(YC01_PH, 6.0f), events, ALERT_MAX_RULES));
+    TEST_ASSERT_EQUAL(0, engine.active(0));
+    TEST_ASSERT_EQUAL(1, engine.active(1));
+}
+
+void test_hysteresis(void) {
+    const alertRule_t rules[] = { makeRule(YC01_TEMP, 10, 35, 1.0f, 1) };
+    engine.begin(rules, 1);
+    alertEvent_t events[1];
+    TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(YC01_TEMP, 35.2f), events, 1));
+    // back below the limit, but not by the hysteresis
+    TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_TEMP, 34.5f), events, 1));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_TEMP, 35.1f), events, 1));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_TEMP, 34.1f), events, 1));
+    TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(YC01_TEMP, 34.0f), events, 1));
+    TEST_ASSERT_EQUAL(ALERT_NORMAL, events[0].level);
+    // the limit itself is still normal
+    TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_TEMP, 35.0f), events, 1));
+}
+
+void test_debounce(void) {
+    const alertRule_t rules[] = { makeRule(YC01_PH, 7.0f, 7.8f, 0, 3) };
+    engine.begin(rules, 1);
+    alertEvent_t events[1];
+    // a noisy sensor flipping around the limit raises nothing
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_PH, i % 2 ? 7.7f : 7.9f), events, 1));
+    }
+    TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_PH, 7.9f), events, 1));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_PH, 7.9f), events, 1));
+    TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(YC01_PH, 7.9f), events, 1));
+    TEST_ASSERT_EQUAL(ALERT_HIGH, events[0].level);
+    // a jump to the other limit needs the same count
+    TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_PH, 6.5f), events, 1));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_PH, 6.5f), events, 1));
+    TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(YC01_PH, 6.5f), events, 1));
+    TEST_ASSERT_EQUAL(ALERT_LOW, events[0].level);
+    TEST_ASSERT_EQUAL(ALERT_HIGH, events[0].previous);
+}
+
+void test_one_sided_rule_and_payload(void) {
+    alertRule_t rule = makeRule(YC01_TEMP, 10, 0, 0.5f, 1);
+    rule.max = ALERT_NO_MAX;
+    engine.begin(&rule, 1);
+    alertEvent_t events[1];
+    TEST_ASSERT_EQUAL(0, engine.evaluate(0, makeReadings(YC01_TEMP, 60), events, 1));
+    TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(YC01_TEMP, 5), events, 1));
+
+    char payload[ALERT_LINE_LENGTH];
+    alertFormat(events[0], rule, payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_STRING("{\"alert\":true,\"type\":\"temp\",\"level\":\"low\",\"value\":5,\"min\":10,\"max\":null,"
+        "\"time\":1700000000,\"sensor\":0,\"text\":\"Alert: Temperature too low\"}", payload);
+    TEST_ASSERT_EQUAL(1, engine.evaluate(0, makeReadings(YC01_TEMP, 20), events, 1));
+    alertFormat(events[0], rule, payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_STRING("{\"alert\":false,\"type\":\"temp\",\"level\":\"normal\",\"value\":20,\"min\":10,\"max\":null,"
+        "\"time\":1700000000,\"sensor\":0,\"text\":\"Recovered: Temperature back in range\"}", payload);
+
+    yc01Quantity_t quantity;
+    TEST_ASSERT_TRUE(alertParseQuantity("cl", quantity));
+    TEST_ASSERT_EQUAL(YC01_CL, quantity);
+    TEST_ASSERT_FALSE(alertParseQuantity("salt", quantity));
+}
+
+void test_benchmark_evaluate(void) {
+    typedef std::chrono::steady_clock clock;
+    alertRule_t rules[ALERT_MAX_RULES];
+    for (size_t r = 0; r < ALERT_MAX_RULES; r++) {
+        rules[r] = makeRule((yc01Quantity_t)(r % YC01_QUANTITIES), 0, 100, 1, 3);
+    }
+    engine.begin(rules, ALERT_MAX_RULES);
+    alertEvent_t events[ALERT_MAX_RULES];
+    const uint32_t total = 1000000;
+    size_t changes = 0;
+    auto start = clock::now();
+    for (uint32_t n = 0; n < total; n++) {
+        sensorReadings_t readings = makeReadings(YC01_PH, (n / 5) % 2 ? 120.0f : 50.0f);
+        changes += engine.evaluate(n % ALERT_MAX_SENSORS, readings, events, ALERT_MAX_RULES);
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / total;
+    printf("evaluate: %.1f ns per reading with %u rules, %u bytes of state\n", ns, (unsigned)ALERT_MAX_RULES,
+        (unsigned)sizeof(AlertEngine));
+    TEST_ASSERT_TRUE(changes > 0);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_min_max_normal_recovery);
+    RUN_TEST(test_hysteresis);
+    RUN_TEST(test_debounce);
+    RUN_TEST(test_one_sided_rule_and_payload);
+    RUN_TEST(test_benchmark_evaluate);
+    return UNITY_END();
+}
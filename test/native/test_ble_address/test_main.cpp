@@ -0,0 +1,157 @@
+/*
+ * Host-side tests of the packed BLE address keys and a benchmark of matching
+ * advertisers against the configured sensors.
+ *
+ * Run with: pio test -e native -f native/test_ble_address -v
+ * The benchmark matches a crowd of advertisers (phones, beacons, a few
+ * sensors) against MAX_SENSORS configured addresses, once with the original
+ * string compare (address formatted into a std::string, both sides lowered
+ * with std::transform) and once with the keys parsed at config load. The
+ * verbose output prints the time per advertisement.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+#include "bleAddress.h"
+
+#define MAX_SENSORS 8           // as in config.h
+#define BENCH_ADVERTISERS 256   // distinct advertisers in range
+#define BENCH_ROUNDS 200        // advertisements per advertiser
+
+/**
+ * @brief Original compareBLEAddress(): NimBLEAddress::toString() against the configured string
+ */
+static bool compareStrings(uint64_t address, const std::string& target) {
+    char buffer[BLE_ADDRESS_STR_LENGTH];
+    std::string addr1 = bleAddressFormat(address, buffer); // stands in for NimBLEAddress::toString()
+    std::string addr2 = target;
+    std::transform(addr1.begin(), addr1.end(), addr1.begin(), ::tolower);
+    std::transform(addr2.begin(), addr2.end(), addr2.begin(), ::tolower);
+    return addr1 == addr2;
+}
+
+/**
+ * @brief Pseudo random address (xorshift, reproducible)
+ */
+static uint64_t nextAddress(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return bleAddressValue(state) | 1;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_parse_and_format(void) {
+    uint64_t key;
+    TEST_ASSERT_TRUE(bleAddressParse("A4:C1:38:0b:2C:7f", 0, key));
+    TEST_ASSERT_TRUE(bleAddressValue(key) == 0xA4C1380B2C7Full);
+    TEST_ASSERT_EQUAL(0, bleAddressType(key));
+    char out[BLE_ADDRESS_STR_LENGTH];
+    TEST_ASSERT_EQUAL_STRING("a4:c1:38:0b:2c:7f", bleAddressFormat(key, out));
+
+    TEST_ASSERT_TRUE(bleAddressParse("a4-c1-38-0b-2c-7f", 1, key));
+    TEST_ASSERT_EQUAL(1, bleAddressType(key));
+    TEST_ASSERT_EQUAL_STRING("", bleAddressFormat(BLE_ADDRESS_NONE, out));
+}
+
+void test_parse_rejects_invalid(void) {
+    const char* invalid[] = {"", "a4:c1:38:0b:2c", "a4:c1:38:0b:2c:7f:00", "a4:c1:38:0b:2c:7g",
+        "a4c1380b2c7f", "a4:c1:38:0b:2c:7", "00:00:00:00:00:00", " a4:c1:38:0b:2c:7f"};
+    for (const char* str : invalid) {
+        uint64_t key = 1;
+        TEST_ASSERT_FALSE_MESSAGE(bleAddressParse(str, 0, key), str);
+        TEST_ASSERT_EQUAL(BLE_ADDRESS_NONE, key);
+    }
+    uint64_t key = 1;
+    TEST_ASSERT_FALSE(bleAddressParse(nullptr, 0, key));
+    TEST_ASSERT_EQUAL(BLE_ADDRESS_NONE, key);
+}
+
+void test_match_types(void) {
+    uint64_t configured, publicKey, randomKey;
+    bleAddressParse("a4:c1:38:0b:2c:7f", BLE_ADDRESS_TYPE_ANY, configured);
+    bleAddressParse("a4:c1:38:0b:2c:7f", 0, publicKey);
+    bleAddressParse("a4:c1:38:0b:2c:7f", 1, randomKey);
+
+    // a configured address matches either type, a typed one only its own
+    TEST_ASSERT_TRUE(bleAddressMatch(configured, publicKey));
+    TEST_ASSERT_TRUE(bleAddressMatch(randomKey, configured));
+    TEST_ASSERT_FALSE(bleAddressMatch(publicKey, randomKey));
+    TEST_ASSERT_FALSE(bleAddressMatch(BLE_ADDRESS_NONE, BLE_ADDRESS_NONE));
+    TEST_ASSERT_FALSE(bleAddressMatch(configured, bleAddressKey(0xA4C1380B2C7Eull, 0)));
+
+    uint64_t list[] = {bleAddressKey(1, 0), publicKey, bleAddressKey(2, 0)};
+    TEST_ASSERT_EQUAL(1, bleAddressFind(list, 3, configured));
+    TEST_ASSERT_EQUAL(-1, bleAddressFind(list, 3, randomKey));
+    TEST_ASSERT_EQUAL(-1, bleAddressFind(list, 0, publicKey));
+}
+
+void test_benchmark_matching(void) {
+    uint64_t state = 0x2545F4914F6CDD1Dull;
+    uint64_t advertisers[BENCH_ADVERTISERS];
+    for (int i = 0; i < BENCH_ADVERTISERS; i++) {
+        advertisers[i] = bleAddressKey(nextAddress(state), i & 1);
+    }
+    // configured in upper case, as users copy them from apps; every 32nd advertiser is a sensor
+    std::string configStrings[MAX_SENSORS];
+    uint64_t configKeys[MAX_SENSORS];
+    for (int s = 0; s < MAX_SENSORS; s++) {
+        char buffer[BLE_ADDRESS_STR_LENGTH];
+        configStrings[s] = bleAddressFormat(advertisers[s * 32 + 5], buffer);
+        std::transform(configStrings[s].begin(), configStrings[s].end(), configStrings[s].begin(), ::toupper);
+        TEST_ASSERT_TRUE(bleAddressParse(configStrings[s].c_str(), BLE_ADDRESS_TYPE_ANY, configKeys[s]));
+    }
+
+    using clock = std::chrono::steady_clock;
+    size_t stringHits = 0;
+    auto start = clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_ADVERTISERS; i++) {
+            for (int s = 0; s < MAX_SENSORS; s++) {
+                if (compareStrings(advertisers[i], configStrings[s])) {
+                    stringHits++;
+                    break;
+                }
+            }
+        }
+    }
+    double stringNs = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+    volatile size_t keyHits = 0;
+    start = clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_ADVERTISERS; i++) {
+            if (bleAddressFind(configKeys, MAX_SENSORS, advertisers[i]) >= 0) keyHits = keyHits + 1;
+        }
+    }
+    double keyNs = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+    size_t adverts = (size_t)BENCH_ROUNDS * BENCH_ADVERTISERS;
+    printf("%u advertisements against %d sensors\n", (unsigned)adverts, MAX_SENSORS);
+    printf("string compare: %8.1f ns per advertisement\n", stringNs / adverts);
+    printf("address keys:   %8.1f ns per advertisement (%.0fx)\n", keyNs / adverts, stringNs / keyNs);
+
+    // same matches, an order of magnitude less work
+    TEST_ASSERT_EQUAL((size_t)BENCH_ROUNDS * MAX_SENSORS, stringHits);
+    TEST_ASSERT_EQUAL(stringHits, (size_t)keyHits);
+    TEST_ASSERT_LESS_THAN(stringNs / 10, keyNs);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_and_format);
+    RUN_TEST(test_parse_rejects_invalid);
+    RUN_TEST(test_match_types);
+    RUN_TEST(test_benchmark_matching);
+    return UNITY_END();
+}
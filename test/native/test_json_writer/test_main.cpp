@@ -0,0 +1,271 @@
+/*
+ * Host-side tests of the bounded JSON writer.
+ *
+ * Run with: pio test -e native -f native/test_json_writer -v
+ * Compares the output with the text serializeJson() of ArduinoJson 7 gives
+ * for the status schema and for the number formats (floats, doubles,
+ * exponents, 64-bit integers), checks the escapes, the overflow detection
+ * with the exact length, the compile-time bounds against the longest
+ * values, and that writing does not touch the heap. The verbose output
+ * prints the cost of a status-sized object.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <float.h>
+#include <new>
+#include <chrono>
+
+#include "jsonWriter.h"
+
+static volatile size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static char buffer[2048];
+
+void setUp(void) {
+    memset(buffer, 0x55, sizeof(buffer));
+}
+
+void tearDown(void) {}
+
+static const char* floatText(float value) {
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject();
+    json.member("v", value);
+    json.endObject();
+    return json.c_str();
+}
+
+static const char* doubleText(double value) {
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject();
+    json.member("v", value);
+    json.endObject();
+    return json.c_str();
+}
+
+/**
+ * @brief Writes a status of one sensor as updateStatusJson() does
+ */
+static size_t writeStatus(char out[], size_t size, bool* overflowed = nullptr) {
+    JsonWriter json(out, size);
+    json.beginObject();
+    json.member("time", (long long)1678886400);
+    json.member("name", "PoolSensor1");
+    json.member("status", "data read successfully");
+    json.member("bleAddress", "aa:bb:cc:dd:ee:ff");
+    json.member("sensorType", "BLE-YC01");
+    json.member("type", (uint8_t)1);
+    json.member("pH", 720 / 100.0f);
+    json.member("ec", 1500 / 1.0f);
+    json.member("salt", 0.825f);
+    json.member("tds", 750 / 1.0f);
+    json.member("orp", 300 / 1.0f);
+    json.member("cl", 5 / 10.0f);
+    json.member("temp", 255 / 10.0f);
+    json.member("bat", 3800 / 1.0f);
+    json.member("bleRSSI", (int16_t)-75);
+    json.member("bleConnectToData", (uint32_t)180);
+    json.member("bleCachedRead", true);
+    json.member("bleRssiMean", (int8_t)-76);
+    json.beginArray("alerts");
+    json.beginObject();
+    json.member("type", "temp");
+    json.member("level", "low");
+    json.member("value", 85 / 10.0f);
+    json.member("since", (uint32_t)1678880000);
+    json.member("text", "Alert: Temperature too low");
+    json.endObject();
+    json.endArray();
+    json.beginObject("trends");
+    json.beginObject("pH");
+    json.member("mean", roundf(7.2143f / 0.0001f) * 0.0001f);
+    json.member("sd", 0.0123f);
+    json.member("slope", -0.0041f);
+    json.endObject();
+    json.endObject();
+    json.member("trendSamples", (uint16_t)16);
+    json.member("wifiSSID", "MyWiFi");
+    json.member("wifiRSSI", -60);
+    json.member("mqttConnected", false);
+    json.member("mqttDrainRate", 78.4f);
+    json.member("resetReason", "Power-on");
+    json.member("heapFree", (uint32_t)112000);
+    json.member("historyCount", (size_t)96);
+    json.endObject();
+    if (overflowed) *overflowed = json.overflowed();
+    return json.length();
+}
+
+void test_status_schema(void) {
+    size_t length = writeStatus(buffer, sizeof(buffer));
+    // as serializeJson() writes the JsonDocument of the same members
+    const char* expected =
+        "{\"time\":1678886400,\"name\":\"PoolSensor1\",\"status\":\"data read successfully\","
+        "\"bleAddress\":\"aa:bb:cc:dd:ee:ff\",\"sensorType\":\"BLE-YC01\",\"type\":1,"
+        "\"pH\":7.2,\"ec\":1500,\"salt\":0.825,\"tds\":750,\"orp\":300,\"cl\":0.5,\"temp\":25.5,\"bat\":3800,"
+        "\"bleRSSI\":-75,\"bleConnectToData\":180,\"bleCachedRead\":true,\"bleRssiMean\":-76,"
+        "\"alerts\":[{\"type\":\"temp\",\"level\":\"low\",\"value\":8.5,\"since\":1678880000,\"text\":\"Alert: Temperature too low\"}],"
+        "\"trends\":{\"pH\":{\"mean\":7.2143,\"sd\":0.0123,\"slope\":-0.0041}},\"trendSamples\":16,"
+        "\"wifiSSID\":\"MyWiFi\",\"wifiRSSI\":-60,\"mqttConnected\":false,\"mqttDrainRate\":78.4,"
+        "\"resetReason\":\"Power-on\",\"heapFree\":112000,\"historyCount\":96}";
+    TEST_ASSERT_EQUAL_STRING(expected, buffer);
+    TEST_ASSERT_EQUAL(strlen(expected), length);
+
+    // empty containers, arrays of values and nesting
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject();
+    json.beginArray("alerts");
+    json.endArray();
+    json.beginObject("trends");
+    json.endObject();
+    json.member("name", (const char*)nullptr);
+    json.beginArray("list");
+    json.beginArray();
+    json.endArray();
+    json.beginObject();
+    json.endObject();
+    json.endArray();
+    json.endObject();
+    TEST_ASSERT_EQUAL_STRING("{\"alerts\":[],\"trends\":{},\"name\":null,\"list\":[[],{}]}", json.c_str());
+}
+
+void test_number_formats(void) {
+    // floats: 7 significant digits, 6 decimals less the further integral digits
+    TEST_ASSERT_EQUAL_STRING("{\"v\":0}", floatText(0.0f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":0}", floatText(-0.0f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":-0.5}", floatText(-0.5f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":0.1}", floatText(0.1f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":3.14159}", floatText(3.14159f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":0.333333}", floatText(1.0f / 3));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":1234.568}", floatText(1234.5678f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":9999999}", floatText(9999999.0f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":1e7}", floatText(1e7f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":1e10}", floatText(1e10f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":1.234568e8}", floatText(123456789.0f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":0.0001}", floatText(0.0001f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":1e-5}", floatText(0.00001f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":-2.5e-8}", floatText(-2.5e-8f));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":null}", floatText(NAN));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":null}", floatText(-INFINITY));
+
+    // doubles: 10 significant digits, unless the value is exactly a float
+    TEST_ASSERT_EQUAL_STRING("{\"v\":7.2}", doubleText(7.2));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":0.3}", doubleText(0.1 + 0.2));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":0.666666667}", doubleText(2.0 / 3));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":3.14159265}", doubleText(3.14159265));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":0.333333}", doubleText((double)(1.0f / 3)));
+    TEST_ASSERT_EQUAL_STRING("{\"v\":1.5e300}", doubleText(1.5e300));
+
+    // integers of every width
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject();
+    json.member("a", INT_MIN);
+    json.member("b", UINT_MAX);
+    json.member("c", LLONG_MIN);
+    json.member("d", ULLONG_MAX);
+    json.member("e", 4000000000000000007ull);
+    json.member("f", (int8_t)-128);
+    json.endObject();
+    TEST_ASSERT_EQUAL_STRING("{\"a\":-2147483648,\"b\":4294967295,\"c\":-9223372036854775808,"
+        "\"d\":18446744073709551615,\"e\":4000000000000000007,\"f\":-128}", json.c_str());
+}
+
+void test_string_escapes(void) {
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject();
+    json.member("name", "Pool \"Süd\" \\ A/B\b\f\n\r\t\x01");
+    json.endObject();
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"Pool \\\"Süd\\\" \\\\ A/B\\b\\f\\n\\r\\t\x01\"}", json.c_str());
+}
+
+void test_overflow(void) {
+    char full[1024];
+    size_t length = writeStatus(full, sizeof(full));
+    TEST_ASSERT_EQUAL(strlen(full), length);
+
+    // exact fit, one byte short, far too short, no buffer
+    bool overflowed = true;
+    char exact[1024];
+    TEST_ASSERT_EQUAL(length, writeStatus(exact, length + 1, &overflowed));
+    TEST_ASSERT_FALSE(overflowed);
+    TEST_ASSERT_EQUAL_STRING(full, exact);
+
+    memset(exact, 0x55, sizeof(exact));
+    TEST_ASSERT_EQUAL(length, writeStatus(exact, length, &overflowed));
+    TEST_ASSERT_TRUE(overflowed);
+    TEST_ASSERT_EQUAL(length - 1, strlen(exact));
+    TEST_ASSERT_EQUAL_MEMORY(full, exact, length - 1);
+    TEST_ASSERT_EQUAL(0x55, (uint8_t)exact[length]);
+
+    TEST_ASSERT_EQUAL(length, writeStatus(exact, 16, &overflowed));
+    TEST_ASSERT_TRUE(overflowed);
+    TEST_ASSERT_EQUAL(15, strlen(exact));
+    TEST_ASSERT_EQUAL(length, writeStatus(exact, 0, &overflowed));
+    TEST_ASSERT_TRUE(overflowed);
+}
+
+void test_bounds(void) {
+    static_assert(jsonTextLength("time") == 4, "literal length");
+    static_assert(jsonMemberLength("time", JSON_UINT_LENGTH) == 18, ",\"time\":4294967295");
+    static_assert(jsonStringLength(3) == 8, "\"\\\"\\\"\\\"\"");
+
+    // the longest texts of each type stay within their bound ({"v": and } are 6 more)
+    TEST_ASSERT_LESS_OR_EQUAL(JSON_FLOAT_LENGTH + 6, strlen(floatText(-1.2345678e-38f)));
+    TEST_ASSERT_LESS_OR_EQUAL(JSON_FLOAT_LENGTH + 6, strlen(floatText(-0.12345678f)));
+    TEST_ASSERT_LESS_OR_EQUAL(JSON_FLOAT_LENGTH + 6, strlen(floatText(-FLT_MAX)));
+    TEST_ASSERT_LESS_OR_EQUAL(JSON_DOUBLE_LENGTH + 6, strlen(doubleText(-1.23456789123e-300)));
+    TEST_ASSERT_LESS_OR_EQUAL(JSON_DOUBLE_LENGTH + 6, strlen(doubleText(-0.123456789123)));
+    TEST_ASSERT_LESS_OR_EQUAL(JSON_DOUBLE_LENGTH + 6, strlen(doubleText(-DBL_MAX)));
+
+    // random values of every magnitude
+    srand(1);
+    for (int i = 0; i < 100000; i++) {
+        double mantissa = (double)rand() / RAND_MAX * 2 - 1;
+        int exp10 = rand() % 600 - 300;
+        double d = mantissa * pow(10, exp10);
+        TEST_ASSERT_LESS_OR_EQUAL(JSON_DOUBLE_LENGTH + 6, strlen(doubleText(d)));
+        float f = (float)(mantissa * pow(10, exp10 % 38));
+        TEST_ASSERT_LESS_OR_EQUAL(JSON_FLOAT_LENGTH + 6, strlen(floatText(f)));
+    }
+}
+
+void test_heap_free_benchmark(void) {
+    char out[1024];
+    writeStatus(out, sizeof(out));
+    size_t before = allocations;
+    const int rounds = 100000;
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        total += writeStatus(out, sizeof(out));
+    }
+    auto end = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(0, allocations - before);
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+    printf("status object (%u bytes): %.0f ns, no allocation\n", (unsigned)(total / rounds), ns);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_status_schema);
+    RUN_TEST(test_number_formats);
+    RUN_TEST(test_string_escapes);
+    RUN_TEST(test_overflow);
+    RUN_TEST(test_bounds);
+    RUN_TEST(test_heap_free_benchmark);
+    return UNITY_END();
+}
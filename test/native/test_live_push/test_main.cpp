@@ -0,0 +1,217 @@
+/*
+ * Host-side tests of the live status push scheduling.
+ *
+ * Run with: pio test -e native -f native/test_live_push -v
+ * Covers coalescing of changes within the minimum gap, the heartbeat (also
+ * across the millis() wrap), dropping changes without subscribers, the
+ * round robin over the sensors, and 1 and 10 dashboards on a simulated
+ * clock, pushed against polled through the response cache. The verbose
+ * output prints builds, messages and latency of both and the cost of the
+ * scheduling per loop.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "livePush.h"
+#include "responseCache.h"
+
+static LivePush push;
+
+void setUp(void) {
+    push = LivePush();
+}
+
+void tearDown(void) {}
+
+void test_coalesce_and_gap(void) {
+    // a new subscriber gets every slot at once
+    push.changedAll(0);
+    TEST_ASSERT_EQUAL(0, push.next(2, 1, 0, 1000, 30000));
+    push.sent(0, 1, 100, 0);
+    TEST_ASSERT_EQUAL(1, push.next(2, 1, 0, 1000, 30000));
+    push.sent(1, 1, 100, 0);
+    TEST_ASSERT_EQUAL(-1, push.next(2, 1, 0, 1000, 30000));
+
+    // a burst within the gap is one push, the latency counts from its first change
+    push.changed(0, 200);
+    push.changed(0, 400);
+    push.changed(0, 900);
+    TEST_ASSERT_TRUE(push.pending(0));
+    TEST_ASSERT_EQUAL(-1, push.next(2, 1, 999, 1000, 30000));
+    TEST_ASSERT_EQUAL(0, push.next(2, 1, 1000, 1000, 30000));
+    push.sent(0, 1, 100, 1000);
+    TEST_ASSERT_FALSE(push.pending(0));
+    TEST_ASSERT_EQUAL(800, push.latencyMs());
+    TEST_ASSERT_EQUAL(3, push.pushes());
+
+    // after a quiet time a change is pushed at once
+    push.changed(1, 5000);
+    TEST_ASSERT_EQUAL(1, push.next(2, 1, 5000, 1000, 30000));
+    push.sent(1, 1, 100, 5000);
+    TEST_ASSERT_EQUAL(0, push.latencyMs());
+    TEST_ASSERT_EQUAL(800, push.latencyMaxMs());
+
+    // slots beyond the range are ignored
+    push.changed(LIVE_PUSH_SLOTS, 5000);
+    push.changed(3, 5000);
+    TEST_ASSERT_EQUAL(-1, push.next(2, 1, 5000, 1000, 30000));
+}
+
+void test_heartbeat(void) {
+    push.changedAll(0);
+    TEST_ASSERT_EQUAL(0, push.next(1, 1, 0, 1000, 30000));
+    push.sent(0, 1, 100, 0);
+    TEST_ASSERT_EQUAL(-1, push.next(1, 1, 29999, 1000, 30000));
+    TEST_ASSERT_EQUAL(0, push.next(1, 1, 30000, 1000, 30000));
+    push.sent(0, 1, 100, 30000);
+    // a heartbeat has no change, the latency stays
+    TEST_ASSERT_EQUAL(0, push.latencyMs());
+    TEST_ASSERT_EQUAL(-1, push.next(1, 1, 1000000, 1000, 0));
+
+    // millis() wraps after 49 days
+    push.sent(0, 1, 100, 0xFFFFF000u);
+    TEST_ASSERT_EQUAL(-1, push.next(1, 1, 0x00001000u, 1000, 30000));
+    TEST_ASSERT_EQUAL(0, push.next(1, 1, 0x00007000u, 1000, 30000));
+    push.changed(0, 0xFFFFFF00u);
+    push.sent(0, 1, 100, 0x00000100u);
+    TEST_ASSERT_EQUAL(0x200, push.latencyMs());
+}
+
+void test_no_subscribers(void) {
+    push.changedAll(0);
+    TEST_ASSERT_EQUAL(-1, push.next(LIVE_PUSH_SLOTS, 0, 0, 1000, 30000));
+    for (size_t i = 0; i < LIVE_PUSH_SLOTS; i++) {
+        TEST_ASSERT_FALSE(push.pending(i));
+    }
+    TEST_ASSERT_EQUAL(0, push.pushes());
+
+    // counters of the fan-out
+    push.sent(0, 10, 700, 0);
+    push.dropped(2);
+    TEST_ASSERT_EQUAL(1, push.pushes());
+    TEST_ASSERT_EQUAL(10, push.messages());
+    TEST_ASSERT_EQUAL(7000, push.bytes());
+    TEST_ASSERT_EQUAL(2, push.drops());
+}
+
+void test_round_robin(void) {
+    // every sensor changes all the time, each gets its turn
+    uint32_t counts[4] = {};
+    for (uint32_t nowMs = 0; nowMs < 40000; nowMs += 100) {
+        push.changedAll(nowMs);
+        int slot = push.next(4, 1, nowMs, 1000, 30000);
+        if (slot >= 0) {
+            push.sent(slot, 1, 100, nowMs);
+            counts[slot]++;
+        }
+    }
+    for (size_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(counts[i] >= 39 && counts[i] <= 40);
+    }
+    TEST_ASSERT_TRUE(push.latencyMaxMs() <= 1000);
+}
+
+/**
+ * @brief Dashboards watching one sensor for 10 minutes, pushed or polled every 2 s
+ * @return Status texts built
+ */
+static uint32_t simulate(size_t dashboards, bool pushed, uint32_t& messages, uint32_t& latencyMaxMs) {
+    ResponseCache cache;
+    LivePush live;
+    const uint32_t maxAge = 5000;
+    uint32_t changedMs = 0;
+    bool seen[10] = {};
+    messages = 0;
+    latencyMaxMs = 0;
+
+    live.changedAll(0);
+    for (uint32_t nowMs = 0; nowMs < 600000; nowMs += 100) {
+        // a reading per minute, the MQTT connection drops and comes back once, not in step with the polls
+        bool change = nowMs % 60000 == 700 || nowMs == 310700 || nowMs == 320700;
+        if (change) {
+            cache.invalidate();
+            live.changed(0, nowMs);
+            changedMs = nowMs;
+            memset(seen, 0, sizeof(seen));
+        }
+        if (pushed) {
+            int slot = live.next(1, dashboards, nowMs, 1000, 30000);
+            if (slot >= 0) live.sent(slot, dashboards, 700, nowMs);
+            continue;
+        }
+        for (size_t d = 0; d < dashboards; d++) {
+            if ((nowMs + d * 200) % 2000) continue;
+            if (!cache.fresh(0, nowMs, maxAge)) {
+                cache.store(0, "{}", 2, nowMs);
+            }
+            // each dashboard sees a change with its next poll
+            if (!seen[d] && nowMs - changedMs > latencyMaxMs) {
+                latencyMaxMs = nowMs - changedMs;
+            }
+            seen[d] = true;
+            messages++;
+        }
+    }
+    if (pushed) {
+        messages = live.messages();
+        latencyMaxMs = live.latencyMaxMs();
+        return live.pushes();
+    }
+    return cache.builds();
+}
+
+void test_dashboards(void) {
+    const size_t counts[] = { 1, 10 };
+    for (size_t dashboards : counts) {
+        uint32_t pushMessages, pushLatency, pollMessages, pollLatency;
+        uint32_t pushBuilds = simulate(dashboards, true, pushMessages, pushLatency);
+        uint32_t pollBuilds = simulate(dashboards, false, pollMessages, pollLatency);
+
+        // the push builds once per change or heartbeat, whatever the number of dashboards:
+        // the first status on connect, 10 readings, 2 connectivity changes, a heartbeat 30 s after each reading
+        TEST_ASSERT_EQUAL(1 + 10 + 2 + 10, pushBuilds);
+        TEST_ASSERT_EQUAL(pushBuilds * dashboards, pushMessages);
+        // the first reading waits for the minimum gap after the connect
+        TEST_ASSERT_EQUAL(300, pushLatency);
+        TEST_ASSERT_TRUE(pushBuilds < pollBuilds);
+        TEST_ASSERT_EQUAL(300 * dashboards, pollMessages);
+        TEST_ASSERT_TRUE(pollLatency > 1000 && pollLatency < 2000);
+        printf("%u dashboards, 10 min: push %u builds, %u messages, latency %u ms; "
+            "poll %u builds, %u requests, latency up to %u ms\n",
+            (unsigned)dashboards, (unsigned)pushBuilds, (unsigned)pushMessages, (unsigned)pushLatency,
+            (unsigned)pollBuilds, (unsigned)pollMessages, (unsigned)pollLatency);
+    }
+}
+
+void test_benchmark(void) {
+    const int rounds = 1000000;
+    volatile int sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        // one loop pass: mostly nothing due, a reading every 1000 passes
+        uint32_t nowMs = (uint32_t)i;
+        if (i % 1000 == 0) push.changed(i % LIVE_PUSH_SLOTS, nowMs);
+        int slot = push.next(LIVE_PUSH_SLOTS, 10, nowMs, 1000, 30000);
+        if (slot >= 0) push.sent(slot, 10, 700, nowMs);
+        sink += slot;
+    }
+    auto end = std::chrono::steady_clock::now();
+    double loopNs = std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+
+    TEST_ASSERT_TRUE(push.pushes() > 0);
+    printf("scheduling per loop pass: %.1f ns, %u pushes, state %u bytes\n",
+        loopNs, (unsigned)push.pushes(), (unsigned)sizeof(LivePush));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_coalesce_and_gap);
+    RUN_TEST(test_heartbeat);
+    RUN_TEST(test_no_subscribers);
+    RUN_TEST(test_round_robin);
+    RUN_TEST(test_dashboards);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
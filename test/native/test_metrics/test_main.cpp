@@ -0,0 +1,200 @@
+/*
+ * Host-side tests of the /metrics telemetry.
+ *
+ * Run with: pio test -e native -f native/test_metrics -v
+ * Covers the bucket of a sample, the scaling of values to seconds, the
+ * exposition of counters, gauges and labelled histograms against the
+ * expected text, chunked reads down to one byte, and concurrent recording
+ * from several threads without lost samples. The verbose output prints the
+ * cost of recording a sample and of a scrape.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <new>
+#include <chrono>
+
+#include "metrics.h"
+
+static const uint32_t BOUNDS[] = { 100, 250, 1000 };
+static MetricsHistogram routes[2] = { { BOUNDS, 3 }, { BOUNDS, 3 } };
+static MetricsCounter reads[2];
+static uint32_t heap = 0;
+static const char* const ROUTE_NAMES[] = { "status", "cmd" };
+static const char* const RESULT_NAMES[] = { "ok", "failed" };
+
+static const metricFamily_t FAMILIES[] = {
+    { "test_reads_total", "Reads by result.", METRIC_COUNTER, 1, "result", RESULT_NAMES, 2,
+        [](size_t s) { return reads[s].value(); }, nullptr },
+    { "test_heap_free_bytes", "Free heap.", METRIC_GAUGE, 1, nullptr, nullptr, 1,
+        [](size_t) { return heap; }, nullptr },
+    { "test_request_duration_seconds", "Handler duration.", METRIC_HISTOGRAM, 1000000, "route", ROUTE_NAMES, 2,
+        nullptr, routes },
+};
+
+static void scrape(size_t chunk, std::string& text) {
+    MetricsQuery query(FAMILIES, sizeof(FAMILIES) / sizeof(FAMILIES[0]));
+    uint8_t buffer[1024];
+    text.clear();
+    while (size_t n = query.read(buffer, chunk)) text.append((const char*)buffer, n);
+    TEST_ASSERT_TRUE(query.done());
+    TEST_ASSERT_EQUAL(text.size(), query.bytes());
+}
+
+void setUp(void) {
+    for (size_t i = 0; i < 2; i++) {
+        routes[i].~MetricsHistogram();
+        new (&routes[i]) MetricsHistogram(BOUNDS, 3);
+        reads[i].~MetricsCounter();
+        new (&reads[i]) MetricsCounter();
+    }
+    heap = 0;
+}
+
+void tearDown(void) {}
+
+void test_buckets(void) {
+    MetricsHistogram h(BOUNDS, 3);
+    const uint32_t samples[] = { 0, 100, 101, 250, 999, 1000, 1001, 4000000000u };
+    for (uint32_t s : samples) h.record(s);
+    // le is inclusive
+    TEST_ASSERT_EQUAL(2, h.bucket(0));
+    TEST_ASSERT_EQUAL(2, h.bucket(1));
+    TEST_ASSERT_EQUAL(2, h.bucket(2));
+    TEST_ASSERT_EQUAL(2, h.bucket(3));
+    TEST_ASSERT_EQUAL(8, h.samples());
+    TEST_ASSERT_EQUAL(3451u + 4000000000u, h.sum());
+
+    // more bounds than buckets are cut
+    static const uint32_t many[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+    MetricsHistogram cut(many, 12);
+    TEST_ASSERT_EQUAL(METRICS_MAX_BUCKETS, cut.size());
+    cut.record(12);
+    TEST_ASSERT_EQUAL(1, cut.bucket(METRICS_MAX_BUCKETS));
+}
+
+void test_format_value(void) {
+    char text[16];
+    metricsFormatValue(1234, 1, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("1234", text);
+    metricsFormatValue(1234, 1000, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("1.234", text);
+    metricsFormatValue(250, 1000, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("0.25", text);
+    metricsFormatValue(15000, 1000, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("15", text);
+    metricsFormatValue(100, 1000000, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("0.0001", text);
+    metricsFormatValue(4294967295u, 1000000, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("4294.967295", text);
+    TEST_ASSERT_EQUAL(3, metricsFormatValue(4294967295u, 1, text, 4));
+    TEST_ASSERT_EQUAL_STRING("429", text);
+}
+
+void test_exposition(void) {
+    reads[0].add(41);
+    reads[0].add();
+    reads[1].add(3);
+    heap = 112000;
+    routes[0].record(80);
+    routes[0].record(240);
+    routes[0].record(5000);
+    const char* expected =
+        "# HELP test_reads_total Reads by result.\n"
+        "# TYPE test_reads_total counter\n"
+        "test_reads_total{result=\"ok\"} 42\n"
+        "test_reads_total{result=\"failed\"} 3\n"
+        "# HELP test_heap_free_bytes Free heap.\n"
+        "# TYPE test_heap_free_bytes gauge\n"
+        "test_heap_free_bytes 112000\n"
+        "# HELP test_request_duration_seconds Handler duration.\n"
+        "# TYPE test_request_duration_seconds histogram\n"
+        "test_request_duration_seconds_bucket{route=\"status\",le=\"0.0001\"} 1\n"
+        "test_request_duration_seconds_bucket{route=\"status\",le=\"0.00025\"} 2\n"
+        "test_request_duration_seconds_bucket{route=\"status\",le=\"0.001\"} 2\n"
+        "test_request_duration_seconds_bucket{route=\"status\",le=\"+Inf\"} 3\n"
+        "test_request_duration_seconds_sum{route=\"status\"} 0.00532\n"
+        "test_request_duration_seconds_count{route=\"status\"} 3\n"
+        "test_request_duration_seconds_bucket{route=\"cmd\",le=\"0.0001\"} 0\n"
+        "test_request_duration_seconds_bucket{route=\"cmd\",le=\"0.00025\"} 0\n"
+        "test_request_duration_seconds_bucket{route=\"cmd\",le=\"0.001\"} 0\n"
+        "test_request_duration_seconds_bucket{route=\"cmd\",le=\"+Inf\"} 0\n"
+        "test_request_duration_seconds_sum{route=\"cmd\"} 0\n"
+        "test_request_duration_seconds_count{route=\"cmd\"} 0\n";
+    std::string text;
+    scrape(1024, text);
+    TEST_ASSERT_EQUAL_STRING(expected, text.c_str());
+
+    // any chunk size gives the same text
+    const size_t chunks[] = { 1, 7, 64, 191, 192, 193 };
+    for (size_t chunk : chunks) {
+        scrape(chunk, text);
+        TEST_ASSERT_EQUAL_STRING(expected, text.c_str());
+    }
+
+    // no families: empty, done at once
+    MetricsQuery empty(FAMILIES, 0);
+    uint8_t buffer[16];
+    TEST_ASSERT_EQUAL(0, empty.read(buffer, sizeof(buffer)));
+    TEST_ASSERT_TRUE(empty.done());
+}
+
+void test_concurrent_recording(void) {
+    // the web server, the loop and the BLE worker record at the same time
+    const int threads = 4;
+    const uint32_t samples = 200000;
+    std::thread workers[threads];
+    for (int t = 0; t < threads; t++) {
+        workers[t] = std::thread([t, samples]() {
+            for (uint32_t i = 0; i < samples; i++) {
+                routes[0].record((i + t) % 1200);
+                reads[0].add();
+            }
+        });
+    }
+    for (std::thread& w : workers) w.join();
+
+    uint32_t total = 0;
+    for (size_t i = 0; i <= routes[0].size(); i++) total += routes[0].bucket(i);
+    TEST_ASSERT_EQUAL(threads * samples, routes[0].samples());
+    TEST_ASSERT_EQUAL(threads * samples, total);
+    TEST_ASSERT_EQUAL(threads * samples, reads[0].value());
+    TEST_ASSERT_TRUE(std::atomic<uint32_t>().is_lock_free());
+}
+
+void test_benchmark(void) {
+    const int rounds = 10000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        routes[0].record((uint32_t)i % 2000);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double recordNs = std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+
+    const int scrapes = 10000;
+    size_t bytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < scrapes; i++) {
+        MetricsQuery query(FAMILIES, sizeof(FAMILIES) / sizeof(FAMILIES[0]));
+        uint8_t buffer[1436];
+        while (size_t n = query.read(buffer, sizeof(buffer))) bytes += n;
+    }
+    end = std::chrono::steady_clock::now();
+    double scrapeUs = std::chrono::duration<double, std::micro>(end - start).count() / scrapes;
+
+    TEST_ASSERT_EQUAL(rounds, routes[0].samples());
+    printf("record a sample: %.1f ns, scrape of %u bytes: %.1f us, histogram %u bytes, query %u bytes\n",
+        recordNs, (unsigned)(bytes / scrapes), scrapeUs, (unsigned)sizeof(MetricsHistogram), (unsigned)sizeof(MetricsQuery));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_buckets);
+    RUN_TEST(test_format_value);
+    RUN_TEST(test_exposition);
+    RUN_TEST(test_concurrent_recording);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
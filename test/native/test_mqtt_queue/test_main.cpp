@@ -0,0 +1,204 @@
+/*
+ * Host-side tests of the persistent MQTT store-and-forward queue.
+ *
+ * Run with: pio test -e native -f native/test_mqtt_queue -v
+ * The files are kept in memory, a reboot is simulated by a new MqttQueue on
+ * the same files, a power loss by cutting the file written last. The
+ * verbose output prints the file accesses of a full replay.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "mqttQueue.h"
+#include "../memoryFiles.h"
+
+static historyRecord_t makeRecord(uint32_t n) {
+    historyRecord_t record;
+    memset(&record, 0, sizeof(record));
+    record.time = 1700000000 + n * 60;
+    record.sensor = n % 2;
+    record.type = 1;
+    record.rssi = -70;
+    record.raw[YC01_PH] = 700 + n % 50;
+    return record;
+}
+
+/**
+ * @brief Replays the queue in batches as the loop does
+ * @return Timestamps of the replayed readings
+ */
+static std::vector<uint32_t> drain(MqttQueue& queue) {
+    std::vector<uint32_t> times;
+    historyRecord_t records[MQTT_QUEUE_BATCH];
+    size_t count;
+    while ((count = queue.peek(records, MQTT_QUEUE_BATCH)) > 0) {
+        for (size_t i = 0; i < count; i++) times.push_back(records[i].time);
+        queue.pop(count);
+        queue.commit();
+    }
+    return times;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_fifo_with_original_time(void) {
+    MemoryFiles files;
+    MqttQueue queue;
+    TEST_ASSERT_TRUE(queue.begin(files));
+    TEST_ASSERT_TRUE(queue.empty());
+    for (uint32_t n = 0; n < 20; n++) TEST_ASSERT_TRUE(queue.push(makeRecord(n)));
+    TEST_ASSERT_EQUAL(20, queue.size());
+
+    historyRecord_t records[MQTT_QUEUE_BATCH];
+    TEST_ASSERT_EQUAL(MQTT_QUEUE_BATCH, queue.peek(records, 100));
+    historyRecord_t first = makeRecord(0);
+    TEST_ASSERT_EQUAL_MEMORY(&first, &records[0], sizeof(first));
+    // a publish failed after three readings
+    queue.pop(3);
+    TEST_ASSERT_EQUAL(17, queue.size());
+    TEST_ASSERT_EQUAL(MQTT_QUEUE_BATCH, queue.peek(records, MQTT_QUEUE_BATCH));
+    TEST_ASSERT_EQUAL(makeRecord(3).time, records[0].time);
+
+    std::vector<uint32_t> times = drain(queue);
+    TEST_ASSERT_EQUAL(17, times.size());
+    for (uint32_t n = 0; n < times.size(); n++) TEST_ASSERT_EQUAL(makeRecord(n + 3).time, times[n]);
+    TEST_ASSERT_EQUAL(20, queue.sent());
+    TEST_ASSERT_EQUAL(0, queue.dropped());
+
+    // a drained queue keeps only its cursor
+    for (auto& file : files.files) TEST_ASSERT_TRUE(file.first.find("/head") != std::string::npos);
+}
+
+void test_survives_reboot(void) {
+    MemoryFiles files;
+    {
+        MqttQueue queue;
+        TEST_ASSERT_TRUE(queue.begin(files));
+        for (uint32_t n = 0; n < 300; n++) queue.push(makeRecord(n));
+        historyRecord_t records[MQTT_QUEUE_BATCH];
+        size_t count = queue.peek(records, MQTT_QUEUE_BATCH);
+        queue.pop(count);
+        queue.commit();
+        // sent but not committed: replayed again after the reboot
+        count = queue.peek(records, MQTT_QUEUE_BATCH);
+        queue.pop(count);
+    }
+    MqttQueue queue;
+    TEST_ASSERT_TRUE(queue.begin(files));
+    TEST_ASSERT_EQUAL(300 - MQTT_QUEUE_BATCH, queue.size());
+    std::vector<uint32_t> times = drain(queue);
+    TEST_ASSERT_EQUAL(300 - MQTT_QUEUE_BATCH, times.size());
+    TEST_ASSERT_EQUAL(makeRecord(MQTT_QUEUE_BATCH).time, times.front());
+    TEST_ASSERT_EQUAL(makeRecord(299).time, times.back());
+
+    // new readings after the drain continue with new segments
+    queue.push(makeRecord(1000));
+    MqttQueue rebooted;
+    TEST_ASSERT_TRUE(rebooted.begin(files));
+    TEST_ASSERT_EQUAL(1, rebooted.size());
+    times = drain(rebooted);
+    TEST_ASSERT_EQUAL(1, times.size());
+    TEST_ASSERT_EQUAL(makeRecord(1000).time, times[0]);
+}
+
+void test_full_queue_drops_oldest(void) {
+    MemoryFiles files;
+    MqttQueue queue;
+    TEST_ASSERT_TRUE(queue.begin(files));
+    const uint32_t capacity = MQTT_QUEUE_SEGMENTS * MQTT_QUEUE_SEGMENT_RECORDS;
+    const uint32_t total = capacity + 2 * MQTT_QUEUE_SEGMENT_RECORDS + 5;
+    for (uint32_t n = 0; n < total; n++) TEST_ASSERT_TRUE(queue.push(makeRecord(n)));
+
+    // whole segments are dropped, the newest readings are kept
+    uint32_t dropped = 3 * MQTT_QUEUE_SEGMENT_RECORDS;
+    TEST_ASSERT_EQUAL(dropped, queue.dropped());
+    TEST_ASSERT_EQUAL(total - dropped, queue.size());
+    TEST_ASSERT_TRUE(queue.size() <= capacity);
+
+    // the drop count is kept across a reboot
+    MqttQueue rebooted;
+    TEST_ASSERT_TRUE(rebooted.begin(files));
+    TEST_ASSERT_EQUAL(dropped, rebooted.dropped());
+    std::vector<uint32_t> times = drain(rebooted);
+    TEST_ASSERT_EQUAL(total - dropped, times.size());
+    TEST_ASSERT_EQUAL(makeRecord(dropped).time, times.front());
+    TEST_ASSERT_EQUAL(makeRecord(total - 1).time, times.back());
+}
+
+void test_power_loss(void) {
+    MemoryFiles files;
+    {
+        MqttQueue queue;
+        TEST_ASSERT_TRUE(queue.begin(files));
+        for (uint32_t n = 0; n < 10; n++) queue.push(makeRecord(n));
+    }
+    // the last append was cut
+    files.cut(files.lastPath.c_str(), 5);
+    MqttQueue queue;
+    TEST_ASSERT_TRUE(queue.begin(files));
+    TEST_ASSERT_EQUAL(9, queue.size());
+    // new readings are not hidden behind the torn record
+    queue.push(makeRecord(10));
+    std::vector<uint32_t> times = drain(queue);
+    TEST_ASSERT_EQUAL(10, times.size());
+    TEST_ASSERT_EQUAL(makeRecord(8).time, times[8]);
+    TEST_ASSERT_EQUAL(makeRecord(10).time, times[9]);
+
+    // a corrupted record drops the rest of its segment
+    for (uint32_t n = 0; n < 10; n++) queue.push(makeRecord(n));
+    files.corrupt(files.lastPath.c_str(), sizeof(logSegmentHeader_t) + 4 * sizeof(logRecord_t) + 2);
+    times = drain(queue);
+    TEST_ASSERT_EQUAL(4, times.size());
+    TEST_ASSERT_EQUAL(6, queue.dropped());
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_write_errors(void) {
+    MemoryFiles files;
+    MqttQueue queue;
+    TEST_ASSERT_TRUE(queue.begin(files));
+    queue.push(makeRecord(0));
+    files.failWrites = true;
+    TEST_ASSERT_FALSE(queue.push(makeRecord(1)));
+    TEST_ASSERT_EQUAL(1, queue.dropped());
+    files.failWrites = false;
+    TEST_ASSERT_TRUE(queue.push(makeRecord(2)));
+    std::vector<uint32_t> times = drain(queue);
+    TEST_ASSERT_EQUAL(2, times.size());
+    TEST_ASSERT_EQUAL(makeRecord(2).time, times[1]);
+}
+
+void test_replay_cost(void) {
+    MemoryFiles files;
+    MqttQueue queue;
+    TEST_ASSERT_TRUE(queue.begin(files));
+    const uint32_t total = MQTT_QUEUE_SEGMENTS * MQTT_QUEUE_SEGMENT_RECORDS;
+    for (uint32_t n = 0; n < total; n++) queue.push(makeRecord(n));
+    TEST_ASSERT_EQUAL(total + MQTT_QUEUE_SEGMENTS, files.writes); // one commit per reading plus the headers
+
+    files.reads = 0;
+    files.writes = 0;
+    std::vector<uint32_t> times = drain(queue);
+    printf("replay: %u readings, %u batches, %u file reads, %u file writes\n", (unsigned)times.size(),
+        (unsigned)(total / MQTT_QUEUE_BATCH), (unsigned)files.reads, (unsigned)files.writes);
+    TEST_ASSERT_EQUAL(total, times.size());
+    // one read and one cursor write per batch
+    TEST_ASSERT_EQUAL(total / MQTT_QUEUE_BATCH, files.reads);
+    TEST_ASSERT_EQUAL(total / MQTT_QUEUE_BATCH, files.writes);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_with_original_time);
+    RUN_TEST(test_survives_reboot);
+    RUN_TEST(test_full_queue_drops_oldest);
+    RUN_TEST(test_power_loss);
+    RUN_TEST(test_write_errors);
+    RUN_TEST(test_replay_cost);
+    return UNITY_END();
+}
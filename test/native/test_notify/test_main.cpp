@@ -0,0 +1,485 @@
+/*
+ * Host-side tests of the daily summary and its delivery.
+ *
+ * Run with: pio test -e native -f native/test_notify -v
+ * A simulated clock drives the daily trigger over several days. The
+ * deliveries go to in-memory stand-ins of an SMTP server and of a webhook,
+ * which check the protocol and record what they received; failures of the
+ * stand-ins exercise batching and the retry backoff. A batch in flight on
+ * another task (take/finish) must keep what is queued meanwhile. The verbose
+ * output prints the cost of adding a reading to the summary and the share
+ * of a delivery left to the loop.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "notify.h"
+
+#define DAY0 1792108800     // 2026-10-16 00:00 UTC
+
+static const char* const names[SUMMARY_MAX_SENSORS] = { "Pool", "Spa", "s2", "s3", "s4", "s5", "s6", "s7" };
+
+static historyRecord_t makeRecord(uint8_t sensor, uint32_t time, int16_t ph, int16_t temp) {
+    historyRecord_t record;
+    memset(&record, 0, sizeof(record));
+    record.time = time;
+    record.sensor = sensor;
+    record.type = 1;
+    record.raw[YC01_PH] = ph;
+    record.raw[YC01_ORP] = 700;
+    record.raw[YC01_CL] = 6;
+    record.raw[YC01_TEMP] = temp;
+    record.raw[YC01_BAT] = 3000;
+    return record;
+}
+
+static alertEvent_t makeEvent(uint8_t sensor, uint32_t time, alertLevel_t level, alertLevel_t previous, int16_t value) {
+    alertEvent_t event;
+    memset(&event, 0, sizeof(event));
+    event.time = time;
+    event.sensor = sensor;
+    event.level = level;
+    event.previous = previous;
+    event.value = value;
+    return event;
+}
+
+static alertRule_t makeRule(yc01Quantity_t quantity, int16_t min, int16_t max) {
+    alertRule_t rule;
+    memset(&rule, 0, sizeof(rule));
+    rule.quantity = quantity;
+    rule.min = min;
+    rule.max = max;
+    rule.debounce = 1;
+    return rule;
+}
+
+/**
+ * @brief In-memory stand-in of an SMTP server or a webhook
+ */
+class StandIn : public NotifyStream {
+public:
+    bool smtp = true;
+    bool refuse = false;                // connect fails
+    int httpStatus = 200;               // status of the webhook
+    std::vector<std::string> commands;  // SMTP commands received
+    std::vector<std::string> messages;  // SMTP DATA or HTTP requests received
+    int connects = 0;
+
+    bool connect(const char* host, uint16_t port, bool tls) override {
+        connects++;
+        if (refuse) return false;
+        input.clear();
+        replies.clear();
+        state = 0;
+        if (smtp) replies.push_back("220 standin ESMTP");
+        return true;
+    }
+
+    bool write(const char* data, size_t length) override {
+        input.append(data, length);
+        if (!smtp) {
+            // complete request: headers plus Content-Length bytes
+            size_t end = input.find("\r\n\r\n");
+            size_t pos = input.find("Content-Length: ");
+            if (end != std::string::npos && pos != std::string::npos
+                && input.size() >= end + 4 + (size_t)atoi(input.c_str() + pos + 16)) {
+                messages.push_back(input);
+                input.clear();
+                replies.push_back("HTTP/1.1 " + std::to_string(httpStatus) + (httpStatus == 200 ? " OK" : " Error"));
+            }
+            return true;
+        }
+        size_t eol;
+        while ((eol = input.find("\r\n")) != std::string::npos) {
+            std::string line = input.substr(0, eol);
+            input.erase(0, eol + 2);
+            smtpLine(line);
+        }
+        return true;
+    }
+
+    int readLine(char line[], size_t length) override {
+        if (replies.empty()) return -1;
+        snprintf(line, length, "%s", replies.front().c_str());
+        replies.erase(replies.begin());
+        return strlen(line);
+    }
+
+    void stop() override {}
+
+protected:
+    void smtpLine(const std::string& line) {
+        if (state == 1) {
+            // DATA until the single dot
+            if (line == ".") {
+                messages.push_back(data);
+                data.clear();
+                state = 0;
+                replies.push_back("250 queued");
+            } else {
+                data += line + "\n";
+            }
+            return;
+        }
+        commands.push_back(line);
+        if (state == 2) {
+            state = 3;
+            replies.push_back("334 UGFzc3dvcmQ6");
+        } else if (state == 3) {
+            state = 0;
+            replies.push_back("235 accepted");
+        } else if (line.rfind("EHLO", 0) == 0) {
+            replies.push_back("250-standin");
+            replies.push_back("250 AUTH LOGIN");
+        } else if (line == "AUTH LOGIN") {
+            state = 2;
+            replies.push_back("334 VXNlcm5hbWU6");
+        } else if (line == "DATA") {
+            state = 1;
+            replies.push_back("354 go ahead");
+        } else if (line == "QUIT") {
+            replies.push_back("221 bye");
+        } else {
+            replies.push_back("250 ok");
+        }
+    }
+
+    std::string input, data;
+    std::vector<std::string> replies;
+    int state = 0;  // 0: commands, 1: DATA, 2/3: AUTH LOGIN user/password
+};
+
+static DailySummary summary;
+static NotifyQueue queue;
+
+void setUp(void) {
+    summary.begin(2, 9, 120, 3600);
+    queue.begin(120);
+}
+
+void tearDown(void) {}
+
+void test_daily_trigger(void) {
+    // no trigger before the clock is set
+    TEST_ASSERT_FALSE(summary.due(0));
+    TEST_ASSERT_FALSE(summary.due(1000));
+    TEST_ASSERT_EQUAL_UINT32(0, summary.next());
+
+    // simulated clock, a minute per step over three days from 05:00 UTC (07:00 local)
+    std::vector<uint32_t> fired;
+    for (uint32_t now = DAY0 + 5 * 3600; now < DAY0 + 3 * 86400 + 5 * 3600; now += 60) {
+        if (now % 300 == 0) summary.add(makeRecord(0, now, 720, 250));
+        if (summary.due(now)) {
+            summaryReport_t report;
+            summary.take(now, report);
+            fired.push_back(now);
+            TEST_ASSERT_EQUAL_UINT32(fired.size() == 1 ? DAY0 + 5 * 3600 : fired[fired.size() - 2], report.from);
+            TEST_ASSERT_EQUAL_UINT32(now, report.to);
+        }
+    }
+    // 09:00 local is 07:00 UTC, once per day
+    TEST_ASSERT_EQUAL(3, fired.size());
+    for (size_t i = 0; i < fired.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(DAY0 + i * 86400 + 7 * 3600, fired[i]);
+    }
+
+    // offsets across midnight, and a disabled trigger
+    TEST_ASSERT_EQUAL_UINT32(DAY0 + 86400 + 9 * 3600 + 5 * 3600, summaryNextTime(DAY0 + 20 * 3600, 9, -300));
+    TEST_ASSERT_EQUAL_UINT32(DAY0 + 23 * 3600, summaryNextTime(DAY0 + 22 * 3600, 1, 120));
+    summary.begin(1, SUMMARY_DISABLED, 0, 3600);
+    TEST_ASSERT_FALSE(summary.due(DAY0));
+    TEST_ASSERT_FALSE(summary.due(DAY0 + 86400));
+}
+
+void test_summary_counters(void) {
+    TEST_ASSERT_FALSE(summary.due(DAY0));
+    // pH drifts up, temperature up and down, one alert raised and recovered
+    summary.add(makeRecord(0, DAY0 + 600, 718, 250));
+    summary.add(makeRecord(0, DAY0 + 1200, 735, 262));
+    summary.add(makeRecord(0, DAY0 + 9000, 741, 244));     // more than the heartbeat after the last
+    summary.add(makeRecord(0, DAY0 + 9600, 730, 251));
+    summary.addAlert(makeEvent(0, DAY0 + 1200, ALERT_HIGH, ALERT_NORMAL, 735));
+    summary.addAlert(makeEvent(0, DAY0 + 9600, ALERT_NORMAL, ALERT_HIGH, 730));
+    // the second sensor has an alert still active
+    summary.add(makeRecord(1, DAY0 + 9000, 700, 300));
+    summary.addAlert(makeEvent(1, DAY0 + 9000, ALERT_LOW, ALERT_NORMAL, 6));
+
+    summaryReport_t report;
+    summary.take(DAY0 + 10000, report);
+    const summarySensor_t& s = report.sensors[0];
+    TEST_ASSERT_EQUAL_UINT32(4, s.count);
+    TEST_ASSERT_EQUAL_INT16(718, s.min[YC01_PH]);
+    TEST_ASSERT_EQUAL_INT16(741, s.max[YC01_PH]);
+    TEST_ASSERT_EQUAL_INT16(244, s.min[YC01_TEMP]);
+    TEST_ASSERT_EQUAL_INT16(262, s.max[YC01_TEMP]);
+    TEST_ASSERT_EQUAL(1, s.alerts);
+    TEST_ASSERT_EQUAL(0, s.active);
+    TEST_ASSERT_EQUAL(1, s.gaps);
+    TEST_ASSERT_EQUAL(SUMMARY_WARNING, summaryStatus(report, 0));
+    TEST_ASSERT_EQUAL(SUMMARY_CRITICAL, summaryStatus(report, 1));
+    TEST_ASSERT_EQUAL(SUMMARY_CRITICAL, summaryOverall(report));
+
+    char text[NOTIFY_BODY_LENGTH];
+    summaryFormatText(report, names, text, sizeof(text));
+    TEST_ASSERT_NOT_NULL(strstr(text, "Daily summary 2026-10-16 02:00 - 2026-10-16 04:46 (UTC+02:00): critical"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "Pool: warning\r\n  readings: 4, last: 2026-10-16 04:40\r\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "  alerts: 1, active: 0, missed heartbeats: 1\r\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "  pH    7.18 .. 7.41, trend +0.12\r\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "  temp  24.4 .. 26.2, trend +0.1\r\n"));
+    summaryFormatJson(report, names, text, sizeof(text));
+    TEST_ASSERT_NOT_NULL(strstr(text, "{\"summary\":true,\"from\":1792108800,\"to\":1792118800,\"status\":\"critical\",\"sensors\":["
+        "{\"sensor\":0,\"name\":\"Pool\",\"status\":\"warning\",\"count\":4,\"lastTime\":1792118400,\"alerts\":1,\"active\":0,\"gaps\":1,"
+        "\"values\":{\"pH\":{\"min\":7.18,\"max\":7.41,\"trend\":0.12},"));
+
+    // the next period starts empty, active alerts and the heartbeat carry over
+    summary.take(DAY0 + 20000, report);
+    TEST_ASSERT_EQUAL_UINT32(0, report.sensors[0].count);
+    TEST_ASSERT_EQUAL(1, report.sensors[1].active);
+    TEST_ASSERT_EQUAL(SUMMARY_OFFLINE, summaryStatus(report, 0));
+    summaryFormatText(report, names, text, sizeof(text));
+    TEST_ASSERT_NOT_NULL(strstr(text, "Pool: offline\r\n  readings: 0"));
+    TEST_ASSERT_NULL(strstr(text, "  pH "));
+}
+
+void test_parse_target(void) {
+    notifyTarget_t target;
+    TEST_ASSERT_TRUE(notifyParseTarget("smtp://mail.example.com:587", "me", "secret", "pool@example.com", "a@example.com", target));
+    TEST_ASSERT_EQUAL(NOTIFY_SMTP, target.scheme);
+    TEST_ASSERT_FALSE(target.tls);
+    TEST_ASSERT_EQUAL_STRING("mail.example.com", target.host);
+    TEST_ASSERT_EQUAL(587, target.port);
+    TEST_ASSERT_TRUE(notifyParseTarget("smtps://mail.example.com", "", "", "pool@example.com", "a@example.com", target));
+    TEST_ASSERT_TRUE(target.tls);
+    TEST_ASSERT_EQUAL(465, target.port);
+    TEST_ASSERT_TRUE(notifyParseTarget("https://hooks.example.com/pool/alert", "", "", "", "", target));
+    TEST_ASSERT_EQUAL(NOTIFY_HTTP, target.scheme);
+    TEST_ASSERT_EQUAL(443, target.port);
+    TEST_ASSERT_EQUAL_STRING("hooks.example.com", target.host);
+    TEST_ASSERT_EQUAL_STRING("/pool/alert", target.path);
+    TEST_ASSERT_TRUE(notifyParseTarget("http://192.168.1.5:8080", "", "", "", "", target));
+    TEST_ASSERT_EQUAL_STRING("/", target.path);
+    TEST_ASSERT_EQUAL(8080, target.port);
+
+    TEST_ASSERT_FALSE(notifyParseTarget("", "", "", "", "", target));
+    TEST_ASSERT_FALSE(notifyParseTarget("ftp://example.com", "", "", "", "", target));
+    TEST_ASSERT_FALSE(notifyParseTarget("smtp://mail.example.com", "", "", "", "", target));   // no sender
+    TEST_ASSERT_FALSE(notifyParseTarget("http://example.com:0/", "", "", "", "", target));
+
+    char out[16];
+    TEST_ASSERT_EQUAL(8, notifyBase64("user", 4, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("dXNlcg==", out);
+    TEST_ASSERT_EQUAL(12, notifyBase64("secret!!", 8, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("c2VjcmV0ISE=", out);
+    TEST_ASSERT_EQUAL(0, notifyBase64("too long for the buffer", 23, out, sizeof(out)));
+}
+
+void test_smtp_delivery(void) {
+    StandIn server;
+    notifyTarget_t target;
+    notifyParseTarget("smtp://mail.example.com:587", "user", "secret", "pool@example.com", "a@example.com, b@example.com", target);
+    SmtpSink sink(server, target);
+
+    summary.due(DAY0);
+    summary.add(makeRecord(0, DAY0 + 600, 720, 250));
+    summaryReport_t report;
+    summary.take(DAY0 + 3600, report);
+    const alertRule_t rule = makeRule(YC01_TEMP, 100, 350);
+    queue.pushAlert(makeEvent(0, DAY0 + 1800, ALERT_HIGH, ALERT_NORMAL, 361), rule, 1000);
+    queue.pushSummary(report, 2000);
+    TEST_ASSERT_EQUAL(2, queue.size());
+
+    // the summary goes out at once, with the alert of the batch
+    TEST_ASSERT_TRUE(queue.process(2000, sink, "PoolGateway", names));
+    TEST_ASSERT_EQUAL(1, queue.sent());
+    TEST_ASSERT_TRUE(queue.empty());
+    TEST_ASSERT_EQUAL(1, server.messages.size());
+
+    const char* expected[] = { "EHLO example.com", "AUTH LOGIN", "dXNlcg==", "c2VjcmV0", "MAIL FROM:<pool@example.com>",
+        "RCPT TO:<a@example.com>", "RCPT TO:<b@example.com>", "DATA", "QUIT" };
+    TEST_ASSERT_EQUAL(sizeof(expected) / sizeof(expected[0]), server.commands.size());
+    for (size_t i = 0; i < server.commands.size(); i++) {
+        TEST_ASSERT_EQUAL_STRING(expected[i], server.commands[i].c_str());
+    }
+    const std::string& message = server.messages[0];
+    TEST_ASSERT_TRUE(message.find("Subject: PoolGateway: daily summary, offline\n") != std::string::npos);
+    TEST_ASSERT_TRUE(message.find("Pool: normal\n  readings: 1") != std::string::npos);
+    TEST_ASSERT_TRUE(message.find("Alert events:\n  2026-10-16 02:30 Pool: Alert: Temperature too high (36.1)\n") != std::string::npos);
+
+    // a body line starting with a dot must not end the message
+    const char body[] = "first\r\n.\r\n..two\r\nlast";
+    TEST_ASSERT_TRUE(sink.send("dots", body, strlen(body)));
+    TEST_ASSERT_EQUAL(2, server.messages.size());
+    TEST_ASSERT_TRUE(server.messages[1].find("\n\nfirst\n..\n...two\nlast\n") != std::string::npos);
+}
+
+void test_webhook_batching_and_retry(void) {
+    StandIn server;
+    server.smtp = false;
+    notifyTarget_t target;
+    notifyParseTarget("http://192.168.1.5:8080/hook", "", "", "", "", target);
+    WebhookSink sink(server, target);
+
+    // a burst of alerts waits for the batch delay and goes out as one POST
+    const alertRule_t rule = makeRule(YC01_PH, 700, 780);
+    uint32_t nowMs = 5000;
+    queue.pushAlert(makeEvent(0, DAY0 + 10, ALERT_HIGH, ALERT_NORMAL, 790), rule, nowMs);
+    queue.pushAlert(makeEvent(1, DAY0 + 20, ALERT_LOW, ALERT_NORMAL, 690), rule, nowMs + 10000);
+    queue.pushAlert(makeEvent(0, DAY0 + 30, ALERT_NORMAL, ALERT_HIGH, 760), rule, nowMs + 20000);
+    for (uint32_t t = nowMs; t < nowMs + NOTIFY_BATCH_DELAY; t += 1000) {
+        TEST_ASSERT_FALSE(queue.process(t, sink, "PoolGateway", names));
+    }
+    // the stand-in fails: retry with a doubling backoff
+    server.httpStatus = 500;
+    uint32_t attempt = nowMs + NOTIFY_BATCH_DELAY;
+    TEST_ASSERT_TRUE(queue.process(attempt, sink, "PoolGateway", names));
+    TEST_ASSERT_EQUAL(1, queue.failed());
+    TEST_ASSERT_EQUAL_UINT32(NOTIFY_RETRY_MIN, queue.retryMs());
+    TEST_ASSERT_FALSE(queue.process(attempt + NOTIFY_RETRY_MIN - 1, sink, "PoolGateway", names));
+    attempt += NOTIFY_RETRY_MIN;
+    TEST_ASSERT_TRUE(queue.process(attempt, sink, "PoolGateway", names));
+    TEST_ASSERT_EQUAL_UINT32(2 * NOTIFY_RETRY_MIN, queue.retryMs());
+    server.refuse = true;
+    attempt += 2 * NOTIFY_RETRY_MIN;
+    TEST_ASSERT_TRUE(queue.process(attempt, sink, "PoolGateway", names));
+    TEST_ASSERT_EQUAL(3, queue.failed());
+    TEST_ASSERT_EQUAL(3, queue.size());
+
+    server.refuse = false;
+    server.httpStatus = 200;
+    attempt += 4 * NOTIFY_RETRY_MIN;
+    TEST_ASSERT_TRUE(queue.process(attempt, sink, "PoolGateway", names));
+    TEST_ASSERT_EQUAL(1, queue.sent());
+    TEST_ASSERT_TRUE(queue.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, queue.retryMs());
+    TEST_ASSERT_EQUAL(4, server.connects);
+    TEST_ASSERT_EQUAL(3, server.messages.size());
+
+    const std::string& request = server.messages.back();
+    TEST_ASSERT_EQUAL(0, request.find("POST /hook HTTP/1.1\r\nHost: 192.168.1.5\r\nContent-Type: application/json\r\n"));
+    TEST_ASSERT_TRUE(request.find("\r\nX-Subject: PoolGateway: 3 alert events\r\n") != std::string::npos);
+    std::string json = request.substr(request.find("\r\n\r\n") + 4);
+    TEST_ASSERT_EQUAL(0, json.find("{\"device\":\"PoolGateway\",\"alerts\":[{\"alert\":true,\"type\":\"pH\",\"level\":\"high\",\"value\":7.9,"));
+    TEST_ASSERT_TRUE(json.find("\"sensor\":1,\"text\":\"Alert: pH too low\"},{\"alert\":false") != std::string::npos);
+    TEST_ASSERT_EQUAL('}', json.back());
+
+    // a full ring drops the oldest alerts, counted
+    for (int i = 0; i < NOTIFY_MAX_ALERTS + 3; i++) {
+        queue.pushAlert(makeEvent(0, DAY0 + i, ALERT_HIGH, ALERT_NORMAL, 790), rule, attempt);
+    }
+    TEST_ASSERT_EQUAL(NOTIFY_MAX_ALERTS, queue.size());
+    TEST_ASSERT_EQUAL(3, queue.dropped());
+}
+
+void test_delivery_in_flight(void) {
+    const alertRule_t rule = makeRule(YC01_PH, 700, 780);
+    queue.pushAlert(makeEvent(0, DAY0 + 10, ALERT_HIGH, ALERT_NORMAL, 790), rule, 1000);
+    queue.pushAlert(makeEvent(1, DAY0 + 20, ALERT_LOW, ALERT_NORMAL, 690), rule, 2000);
+    uint32_t nowMs = 1000 + NOTIFY_BATCH_DELAY;
+
+    // the taken batch is not due again and its buffers stay as they are
+    TEST_ASSERT_TRUE(queue.take(nowMs, true, "PoolGateway", names) > 0);
+    TEST_ASSERT_TRUE(queue.inFlight());
+    TEST_ASSERT_FALSE(queue.due(nowMs));
+    TEST_ASSERT_EQUAL(0, queue.take(nowMs, true, "PoolGateway", names));
+    TEST_ASSERT_EQUAL_STRING("PoolGateway: 2 alert events", queue.batchSubject());
+    std::string body = queue.batchBody();
+
+    // queued during the delivery: not part of the batch, kept after it
+    summaryReport_t report;
+    summary.take(DAY0 + 3600, report);
+    queue.pushAlert(makeEvent(0, DAY0 + 30, ALERT_NORMAL, ALERT_HIGH, 760), rule, nowMs + 100);
+    queue.pushSummary(report, nowMs + 200);
+    TEST_ASSERT_EQUAL(4, queue.size());
+    TEST_ASSERT_EQUAL_STRING(body.c_str(), queue.batchBody());
+    queue.finish(nowMs + 5000, true);
+    TEST_ASSERT_FALSE(queue.inFlight());
+    TEST_ASSERT_EQUAL(1, queue.sent());
+    TEST_ASSERT_EQUAL(2, queue.size());
+    TEST_ASSERT_EQUAL(0, queue.dropped());
+
+    // the summary queued meanwhile goes out at once, a failure keeps both
+    TEST_ASSERT_TRUE(queue.due(nowMs + 5000));
+    TEST_ASSERT_TRUE(queue.take(nowMs + 5000, false, "PoolGateway", names) > 0);
+    TEST_ASSERT_EQUAL_STRING("PoolGateway: daily summary, offline", queue.batchSubject());
+    TEST_ASSERT_TRUE(strstr(queue.batchBody(), "Alert events:") != nullptr);
+    queue.finish(nowMs + 8000, false);
+    TEST_ASSERT_EQUAL(1, queue.failed());
+    TEST_ASSERT_EQUAL(2, queue.size());
+    TEST_ASSERT_FALSE(queue.due(nowMs + 8000 + NOTIFY_RETRY_MIN - 1));
+
+    // the next summary replaces the one in flight without counting it as dropped
+    nowMs += 8000 + NOTIFY_RETRY_MIN;
+    TEST_ASSERT_TRUE(queue.take(nowMs, false, "PoolGateway", names) > 0);
+    queue.pushSummary(report, nowMs + 100);
+    TEST_ASSERT_EQUAL(0, queue.dropped());
+    queue.finish(nowMs + 1000, true);
+    TEST_ASSERT_EQUAL(1, queue.size());
+    TEST_ASSERT_TRUE(queue.due(nowMs + 1000));
+
+    // a full ring drops alerts of the batch in flight, the new ones are kept
+    TEST_ASSERT_TRUE(queue.take(nowMs + 1000, false, "PoolGateway", names) > 0);
+    queue.finish(nowMs + 1000, true);
+    TEST_ASSERT_TRUE(queue.empty());
+    queue.pushAlert(makeEvent(0, DAY0 + 40, ALERT_HIGH, ALERT_NORMAL, 790), rule, nowMs);
+    queue.pushAlert(makeEvent(0, DAY0 + 50, ALERT_HIGH, ALERT_NORMAL, 790), rule, nowMs);
+    nowMs += NOTIFY_BATCH_DELAY;
+    TEST_ASSERT_TRUE(queue.take(nowMs, true, "PoolGateway", names) > 0);
+    for (int i = 0; i < NOTIFY_MAX_ALERTS; i++) {
+        queue.pushAlert(makeEvent(1, DAY0 + 100 + i, ALERT_LOW, ALERT_NORMAL, 690), rule, nowMs);
+    }
+    TEST_ASSERT_EQUAL(2, queue.dropped());
+    queue.finish(nowMs + 1000, true);
+    TEST_ASSERT_EQUAL(NOTIFY_MAX_ALERTS, queue.size());
+    TEST_ASSERT_FALSE(queue.due(nowMs + 1000));
+    TEST_ASSERT_TRUE(queue.due(nowMs + 1000 + NOTIFY_BATCH_DELAY));
+}
+
+void test_benchmark_add(void) {
+    typedef std::chrono::steady_clock clock;
+    summary.begin(SUMMARY_MAX_SENSORS, 9, 0, 3600);
+    const uint32_t total = 1000000;
+    auto start = clock::now();
+    for (uint32_t n = 0; n < total; n++) {
+        summary.add(makeRecord(n % SUMMARY_MAX_SENSORS, DAY0 + n * 30, 700 + n % 50, 250 + n % 7));
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / total;
+    printf("summary add: %.1f ns per reading, %u bytes of state, queue %u bytes\n", ns, (unsigned)sizeof(DailySummary),
+        (unsigned)sizeof(NotifyQueue));
+    TEST_ASSERT_EQUAL_UINT32(total / SUMMARY_MAX_SENSORS, summary.sensor(0).count);
+
+    // the share of a delivery left to the loop: taking a full batch and finishing it
+    summaryReport_t report;
+    summary.take(DAY0 + 86400, report);
+    const alertRule_t rule = makeRule(YC01_PH, 700, 780);
+    const uint32_t rounds = 10000;
+    size_t length = 0;
+    start = clock::now();
+    for (uint32_t n = 0; n < rounds; n++) {
+        queue.pushSummary(report, n);
+        for (int i = 0; i < NOTIFY_MAX_ALERTS; i++) {
+            queue.pushAlert(makeEvent(i % 2, DAY0 + i, ALERT_HIGH, ALERT_NORMAL, 790), rule, n);
+        }
+        length = queue.take(n, true, "PoolGateway", names);
+        queue.finish(n, true);
+    }
+    double us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / rounds;
+    printf("loop share of a delivery: %.1f us to queue, take and finish a batch of %u bytes\n", us, (unsigned)length);
+    TEST_ASSERT_EQUAL(rounds, queue.sent());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_daily_trigger);
+    RUN_TEST(test_summary_counters);
+    RUN_TEST(test_parse_target);
+    RUN_TEST(test_smtp_delivery);
+    RUN_TEST(test_webhook_batching_and_retry);
+    RUN_TEST(test_delivery_in_flight);
+    RUN_TEST(test_benchmark_add);
+    return UNITY_END();
+}
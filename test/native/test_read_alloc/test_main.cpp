@@ -0,0 +1,130 @@
+/*
+ * Host-side check that the sensor read path does not touch the heap.
+ *
+ * Run with: pio test -e native -f native/test_read_alloc -v
+ * Global operator new/delete are replaced by counting versions. After a
+ * warm-up, a steady-state read (raw value copied into a fixed buffer, viewed
+ * as a span, decoded and mapped through the field table) must not allocate.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <string>
+
+#include "yc01Codec.h"
+
+#define STEADY_STATE_READS 10000
+#define MAX_VALUE_LENGTH 64 // buffer size for a characteristic value (as in BLE-YC01.cpp)
+
+static volatile size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// golden frame: pH 7.23, EC 1500 mV, TDS 750 mg/L, ORP 680 mV, Cl 0.5 mg/L, 26.5 °C, 3088 mV
+static const uint8_t goldenRaw[YC01_FRAME_LENGTH] = {
+    0xA8, 0xFD, 0xAF, 0x5D, 0xF4, 0x16, 0xFF, 0x33, 0xFE,
+    0xAA, 0xFE, 0xA1, 0xFD, 0xFD, 0xF7, 0xDB, 0x5D
+};
+
+/**
+ * @brief Stand-in for readByHandle(): copies the value into the caller buffer
+ */
+static size_t readValue(uint8_t value[], size_t maxLength) {
+    size_t length = sizeof(goldenRaw) < maxLength ? sizeof(goldenRaw) : maxLength;
+    memcpy(value, goldenRaw, length);
+    return length;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_counter_detects_allocations(void) {
+    size_t before = allocations;
+    std::string copy(64, 'x'); // too long for the small string buffer
+    TEST_ASSERT_GREATER_THAN(before, allocations);
+    TEST_ASSERT_EQUAL(64, copy.length());
+}
+
+void test_field_table_matches_original(void) {
+    sensorReadings_t readings;
+    memset(&readings, 0, sizeof(readings));
+    TEST_ASSERT_EQUAL(YC01_OK, yc01Parse({goldenRaw, sizeof(goldenRaw)}, readings));
+
+    // mapping of the original decodeReadings()
+    uint8_t data[YC01_MAX_FRAME_LENGTH];
+    TEST_ASSERT_EQUAL(YC01_OK, yc01Decode(goldenRaw, sizeof(goldenRaw), data));
+    auto toInt16 = [&](int idx) { return (int16_t)(((uint16_t)data[idx] << 8) | (uint16_t)data[idx + 1]); };
+    TEST_ASSERT_EQUAL(data[2], readings.type);
+    TEST_ASSERT_TRUE((float)(toInt16(3) / 100.0) == readings.pH());
+    TEST_ASSERT_TRUE((float)toInt16(5) == readings.ec());
+    TEST_ASSERT_TRUE((float)(toInt16(5) * 0.55) == readings.salt());
+    TEST_ASSERT_TRUE((float)toInt16(7) == readings.tds());
+    TEST_ASSERT_TRUE((float)toInt16(9) == readings.orp());
+    TEST_ASSERT_TRUE((float)(toInt16(11) / 10.0) == readings.cl());
+    TEST_ASSERT_TRUE((float)(toInt16(13) / 10.0) == readings.temp());
+    TEST_ASSERT_TRUE((float)toInt16(15) == readings.bat());
+
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 7.23, readings.pH());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 26.5, readings.temp());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 3088, readings.bat());
+}
+
+void test_short_value_rejected(void) {
+    sensorReadings_t readings;
+    memset(&readings, 0, sizeof(readings));
+    TEST_ASSERT_EQUAL(YC01_ERR_LENGTH, yc01Parse({goldenRaw, YC01_FRAME_LENGTH - 1}, readings));
+    TEST_ASSERT_EQUAL(0, readings.type);
+}
+
+void test_steady_state_read_does_not_allocate(void) {
+    uint8_t value[MAX_VALUE_LENGTH];
+    sensorReadings_t readings;
+    sensorReadings_t last;
+
+    // warm-up
+    size_t length = readValue(value, sizeof(value));
+    TEST_ASSERT_EQUAL(YC01_OK, yc01Parse({value, length}, last));
+
+    size_t before = allocations;
+    for (int n = 0; n < STEADY_STATE_READS; n++) {
+        length = readValue(value, sizeof(value));
+        TEST_ASSERT_EQUAL(YC01_OK, yc01Parse({value, length}, readings));
+        last = readings;
+    }
+    size_t perRead = (allocations - before) / STEADY_STATE_READS;
+    printf("allocations in %d steady-state reads: %u\n", STEADY_STATE_READS, (unsigned)(allocations - before));
+    TEST_ASSERT_EQUAL(0, allocations - before);
+    TEST_ASSERT_EQUAL(0, perRead);
+    TEST_ASSERT_EQUAL(readings.type, last.type);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_counter_detects_allocations);
+    RUN_TEST(test_field_table_matches_original);
+    RUN_TEST(test_short_value_rejected);
+    RUN_TEST(test_steady_state_read_does_not_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,164 @@
+/*
+ * Host-side simulation of the sensor read scheduler.
+ *
+ * Run with: pio test -e native -f native/test_read_scheduler -v
+ * The verbose output prints per-sensor latency and total cycle time for
+ * growing fleet sizes, comparing deadline batching (one scan shared by all
+ * sensors due) against one scan per sensor read.
+ */
+#include <unity.h>
+#include <stdio.h>
+
+#include "readScheduler.h"
+
+#define SIM_SCAN_MS 3000        // discovery scan duration
+#define SIM_READ_MS 2500        // connect + discovery + read of one sensor
+#define SIM_INTERVAL_MS 60000   // read interval of each sensor
+#define SIM_DURATION_MS 3600000 // simulated time span
+
+struct simResult_t
+{
+    uint32_t maxLatencyMs;  // worst delay between deadline and completed read
+    uint32_t avgLatencyMs;  // mean delay between deadline and completed read
+    uint32_t cycleMs;       // time until every sensor has been read once
+    uint32_t radioMs;       // total time spent scanning and reading
+    uint32_t reads;         // number of completed reads
+};
+
+/**
+ * @brief Runs the gateway state machine against a virtual clock
+ * @param sensors Number of sensors
+ * @param batching true: serve the whole batch per scan, false: one scan per read
+ */
+static simResult_t simulate(size_t sensors, bool batching) {
+    ReadScheduler scheduler;
+    simResult_t result = {0, 0, 0, 0, 0};
+    uint64_t latencySum = 0;
+    bool served[SCHEDULER_MAX_SLOTS] = {false};
+    size_t servedCount = 0;
+
+    scheduler.begin(sensors, 0);
+    for (size_t i = 0; i < sensors; i++) {
+        scheduler.setInterval(i, SIM_INTERVAL_MS);
+    }
+
+    uint32_t now = 0;
+    while (now < SIM_DURATION_MS) {
+        if (scheduler.nextDue(now) < 0) {
+            now += 10; // idle loop iteration
+            continue;
+        }
+
+        now += SIM_SCAN_MS;
+        result.radioMs += SIM_SCAN_MS;
+
+        uint8_t batch[SCHEDULER_MAX_SLOTS];
+        size_t batchSize = scheduler.collectBatch(now, 0, batch, SCHEDULER_MAX_SLOTS);
+        if (!batching && batchSize > 1) batchSize = 1;
+
+        for (size_t b = 0; b < batchSize; b++) {
+            uint8_t idx = batch[b];
+            uint32_t deadline = scheduler.slot(idx).deadlineMs;
+            now += SIM_READ_MS;
+            result.radioMs += SIM_READ_MS;
+
+            uint32_t latency = now - deadline;
+            latencySum += latency;
+            if (latency > result.maxLatencyMs) result.maxLatencyMs = latency;
+            result.reads++;
+
+            scheduler.complete(idx, now, SIM_READ_MS);
+            if (!served[idx]) {
+                served[idx] = true;
+                if (++servedCount == sensors) result.cycleMs = now;
+            }
+        }
+    }
+    result.avgLatencyMs = result.reads ? latencySum / result.reads : 0;
+    return result;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_earliest_deadline_first(void) {
+    ReadScheduler scheduler;
+    scheduler.begin(3, 0);
+    scheduler.setInterval(0, 10000);
+    scheduler.setInterval(1, 10000);
+    scheduler.setInterval(2, 10000);
+    scheduler.defer(0, 5000);
+    scheduler.defer(1, 3000);
+    scheduler.defer(2, 20000);
+
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.nextDue(2000));
+    TEST_ASSERT_EQUAL_INT(1, scheduler.nextDue(4000));
+    TEST_ASSERT_EQUAL_INT(1, scheduler.nextDue(6000));
+
+    // slot 0 falls due while slot 1 is read -> same batch, slot 2 is too far away
+    uint8_t batch[SCHEDULER_MAX_SLOTS];
+    size_t n = scheduler.collectBatch(3000, 0, batch, SCHEDULER_MAX_SLOTS);
+    TEST_ASSERT_EQUAL(2, n);
+    TEST_ASSERT_EQUAL_UINT8(1, batch[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, batch[1]);
+}
+
+void test_complete_keeps_phase(void) {
+    ReadScheduler scheduler;
+    scheduler.begin(1, 0);
+    scheduler.setInterval(0, 10000);
+
+    scheduler.complete(0, 2500, 2500);
+    TEST_ASSERT_EQUAL_UINT32(10000, scheduler.slot(0).deadlineMs);
+    TEST_ASSERT_EQUAL_UINT32(2500, scheduler.slot(0).lastLatencyMs);
+
+    // more than one interval behind -> phase restarts at completion time
+    scheduler.complete(0, 25000, 2500);
+    TEST_ASSERT_EQUAL_UINT32(35000, scheduler.slot(0).deadlineMs);
+}
+
+void test_millis_wraparound(void) {
+    ReadScheduler scheduler;
+    uint32_t start = 0xFFFFF000;
+    scheduler.begin(1, start);
+    scheduler.setInterval(0, 10000);
+    scheduler.complete(0, start + 100, 100);
+
+    TEST_ASSERT_EQUAL_INT(-1, scheduler.nextDue(start + 5000));
+    TEST_ASSERT_EQUAL_INT(0, scheduler.nextDue(start + 10000));
+}
+
+void test_fleet_simulation(void) {
+    printf("\nsensors | batched: avg / max latency, cycle, radio | per-sensor scan: avg / max latency, cycle, radio\n");
+    for (size_t n = 1; n <= SCHEDULER_MAX_SLOTS; n++) {
+        simResult_t batched = simulate(n, true);
+        simResult_t single = simulate(n, false);
+
+        printf("%7u | %6u / %6u ms, %6u ms, %3u%% | %6u / %6u ms, %6u ms, %3u%%\n",
+            (unsigned)n,
+            (unsigned)batched.avgLatencyMs, (unsigned)batched.maxLatencyMs, (unsigned)batched.cycleMs,
+            (unsigned)(100ULL * batched.radioMs / SIM_DURATION_MS),
+            (unsigned)single.avgLatencyMs, (unsigned)single.maxLatencyMs, (unsigned)single.cycleMs,
+            (unsigned)(100ULL * single.radioMs / SIM_DURATION_MS));
+
+        // every sensor is served well within its interval
+        TEST_ASSERT_LESS_THAN(SIM_INTERVAL_MS / 2, batched.maxLatencyMs);
+        TEST_ASSERT_EQUAL_UINT32(SIM_SCAN_MS + n * SIM_READ_MS, batched.cycleMs);
+        if (n > 1) {
+            TEST_ASSERT_LESS_THAN(single.cycleMs, batched.cycleMs);
+            TEST_ASSERT_LESS_THAN(single.radioMs, batched.radioMs);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_earliest_deadline_first);
+    RUN_TEST(test_complete_keeps_phase);
+    RUN_TEST(test_millis_wraparound);
+    RUN_TEST(test_fleet_simulation);
+    return UNITY_END();
+}
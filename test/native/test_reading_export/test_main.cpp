@@ -0,0 +1,178 @@
+/*
+ * Host-side tests of the CSV/NDJSON export of the reading log.
+ *
+ * Run with: pio test -e native -f native/test_reading_export -v
+ * The log files are kept in memory. The export is pulled in 1436-byte chunks
+ * (one TCP segment, as the web server asks for). The verbose output prints
+ * the export throughput of a full log and the memory an export holds, which
+ * does not depend on the number of records. Timings are host figures; on the
+ * ESP32 the flash reads dominate.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+
+#include "readingExport.h"
+#include "../memoryFiles.h"
+
+#define CHUNK_SIZE 1436
+
+static historyRecord_t makeRecord(uint32_t n) {
+    historyRecord_t record;
+    memset(&record, 0, sizeof(record));
+    record.time = 1700000000 + n * 60;
+    record.sensor = n % 2;
+    record.type = 1;
+    record.rssi = -70;
+    record.raw[YC01_PH] = 700 + n % 50;
+    record.raw[YC01_ORP] = 650;
+    record.raw[YC01_TEMP] = 255;
+    return record;
+}
+
+static void appendRecords(ReadingLog& log, uint32_t first, uint32_t count) {
+    for (uint32_t n = first; n < first + count; n++) {
+        log.append(makeRecord(n), n * 1000);
+    }
+    log.flush();
+}
+
+/**
+ * @brief Pulls a whole export as the web server does
+ */
+static std::string pull(ExportQuery& query, size_t* chunks = nullptr) {
+    std::string text;
+    uint8_t buffer[CHUNK_SIZE];
+    size_t count = 0;
+    while (!query.done()) {
+        size_t length = query.read(buffer, sizeof(buffer));
+        text.append((const char*)buffer, length);
+        count++;
+    }
+    if (chunks) *chunks = count;
+    return text;
+}
+
+static size_t countLines(const std::string& text) {
+    size_t lines = 0;
+    for (char c : text) lines += c == '\n';
+    return lines;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_csv_rows(void) {
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    appendRecords(log, 0, 3);
+
+    ExportQuery query(log, EXPORT_CSV, 0, UINT32_MAX, historyParseFields("pH,orp,temp,bleRSSI"), -1);
+    TEST_ASSERT_EQUAL_STRING(
+        "time,sensor,pH,orp,temp,bleRSSI\n"
+        "1700000000,0,7.00,650,25.5,-70\n"
+        "1700000060,1,7.01,650,25.5,-70\n"
+        "1700000120,0,7.02,650,25.5,-70\n", pull(query).c_str());
+    TEST_ASSERT_EQUAL(3, query.records());
+}
+
+void test_ndjson_filters(void) {
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    uint32_t first = 2 * LOG_SEGMENT_RECORDS; // first record of the third segment
+    appendRecords(log, 0, first + 256);
+
+    // a range in the third segment, one sensor
+    ExportQuery query(log, EXPORT_NDJSON, makeRecord(first + 56).time, makeRecord(first + 65).time, historyParseFields("pH"), 1);
+    std::string expected;
+    for (uint32_t n = first + 57; n <= first + 65; n += 2) {
+        char line[64];
+        snprintf(line, sizeof(line), "{\"time\":%u,\"sensor\":1,\"pH\":7.%02u}\n", (unsigned)makeRecord(n).time, (unsigned)(n % 50));
+        expected += line;
+    }
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), pull(query).c_str());
+    TEST_ASSERT_EQUAL(5, query.records());
+
+    // from skips the older segments without reading them
+    TEST_ASSERT_EQUAL(3, log.lastSequence());
+    files.reads = 0;
+    ExportQuery late(log, EXPORT_NDJSON, makeRecord(first + 246).time, UINT32_MAX, HISTORY_FIELD_ALL, -1);
+    TEST_ASSERT_EQUAL(10, countLines(pull(late)));
+    // header and block reads of the tail segment only, two file reads each
+    TEST_ASSERT_LESS_OR_EQUAL(2 * (1 + 256 / LOG_BATCH_RECORDS + 1), files.reads);
+}
+
+void test_empty_log(void) {
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    ExportQuery csv(log, EXPORT_CSV, 0, UINT32_MAX, historyParseFields("pH"), -1);
+    TEST_ASSERT_EQUAL_STRING("time,sensor,pH\n", pull(csv).c_str());
+    ExportQuery ndjson(log, EXPORT_NDJSON, 0, UINT32_MAX, HISTORY_FIELD_ALL, -1);
+    TEST_ASSERT_EQUAL_STRING("", pull(ndjson).c_str());
+}
+
+void test_rotation_during_export(void) {
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    appendRecords(log, 0, LOG_SEGMENTS * LOG_SEGMENT_RECORDS);
+
+    ExportQuery query(log, EXPORT_CSV, 0, UINT32_MAX, historyParseFields("pH"), -1);
+    uint8_t buffer[CHUNK_SIZE];
+    TEST_ASSERT_TRUE(query.read(buffer, sizeof(buffer)) > 0);
+    // two segments are replaced while the client is slow
+    uint32_t total = LOG_SEGMENTS * LOG_SEGMENT_RECORDS;
+    appendRecords(log, total, 2 * LOG_SEGMENT_RECORDS);
+    std::string rest = pull(query);
+
+    // the export jumps to the oldest kept segment and continues up to the tail
+    char last[64];
+    snprintf(last, sizeof(last), "%u,", (unsigned)makeRecord(total + 2 * LOG_SEGMENT_RECORDS - 1).time);
+    TEST_ASSERT_TRUE(rest.find(last) != std::string::npos);
+    TEST_ASSERT_TRUE(query.records() < total + 2 * LOG_SEGMENT_RECORDS);
+    TEST_ASSERT_TRUE(query.records() >= LOG_SEGMENTS * LOG_SEGMENT_RECORDS);
+}
+
+void test_benchmark_export(void) {
+    typedef std::chrono::steady_clock clock;
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    uint32_t total = LOG_SEGMENTS * LOG_SEGMENT_RECORDS;
+    appendRecords(log, 0, total);
+
+    const exportFormat_t formats[] = {EXPORT_CSV, EXPORT_NDJSON};
+    for (exportFormat_t format : formats) {
+        files.reads = 0;
+        size_t chunks;
+        ExportQuery query(log, format, 0, UINT32_MAX, HISTORY_FIELD_ALL, -1);
+        auto start = clock::now();
+        std::string text = pull(query, &chunks);
+        double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        printf("%-6s %u records, %u bytes, %u chunks, %u file reads, %.2f ms, %.1f MB/s\n",
+            format == EXPORT_CSV ? "csv:" : "ndjson:", (unsigned)query.records(), (unsigned)text.size(),
+            (unsigned)chunks, (unsigned)files.reads, ms, text.size() / ms / 1000);
+        TEST_ASSERT_EQUAL(total, query.records());
+        TEST_ASSERT_EQUAL(text.size(), query.bytes());
+        TEST_ASSERT_EQUAL(total + (format == EXPORT_CSV), countLines(text));
+    }
+    // the state of an export is the same for one record or a full log
+    printf("export state: %u bytes (plus the chunk buffer of the web server)\n", (unsigned)sizeof(ExportQuery));
+    TEST_ASSERT_LESS_OR_EQUAL(LOG_BATCH_RECORDS * sizeof(logRecord_t) + HISTORY_LINE_LENGTH + 128, sizeof(ExportQuery));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_csv_rows);
+    RUN_TEST(test_ndjson_filters);
+    RUN_TEST(test_empty_log);
+    RUN_TEST(test_rotation_during_export);
+    RUN_TEST(test_benchmark_export);
+    return UNITY_END();
+}
@@ -0,0 +1,311 @@
+/*
+ * Host-side tests of the RAM reading history and the /history query.
+ *
+ * Run with: pio test -e native -f native/test_reading_history -v
+ * Covers the ring across several wraps, the binary search on the
+ * timestamp, the from/to/fields/sensor filters of a query with inclusive
+ * bounds and empty ranges, records split across small chunks, a query
+ * that falls behind the writer, and a reader racing the writer on another
+ * thread, which must reject records overwritten before or during its copy
+ * and never accept a torn one. The verbose output prints the cost of a lookup and of streaming the ring.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "readingHistory.h"
+
+#define T0 1700000000
+
+static ReadingHistory history;
+
+/**
+ * @brief Record n: a reading per minute, sensors 0..2 in turn, every field derived from n
+ */
+static historyRecord_t makeRecord(uint32_t n) {
+    historyRecord_t record;
+    memset(&record, 0, sizeof(record));
+    record.time = T0 + n * 60;
+    record.sensor = n % 3;
+    record.type = 1;
+    record.rssi = -60 - (int16_t)(n % 20);
+    for (size_t q = 0; q < YC01_QUANTITIES; q++) {
+        record.raw[q] = (int16_t)(n * 7 + q);
+    }
+    record.raw[YC01_PH] = 700 + n % 50;
+    return record;
+}
+
+static void appendRecords(uint32_t first, uint32_t count) {
+    for (uint32_t n = first; n < first + count; n++) {
+        history.append(makeRecord(n));
+    }
+}
+
+/**
+ * @brief Pulls a whole query in chunks of a size, as the web server does
+ */
+static std::string pull(HistoryQuery& query, size_t chunk) {
+    std::string text;
+    uint8_t buffer[1436];
+    while (size_t length = query.read(buffer, chunk)) {
+        text.append((const char*)buffer, length);
+    }
+    return text;
+}
+
+static std::string query(uint32_t from, uint32_t to, uint16_t fields, int sensor, size_t chunk = 1436) {
+    HistoryQuery q(history, from, to, fields, sensor);
+    return pull(q, chunk);
+}
+
+void setUp(void) {
+    history.clear();
+}
+
+void tearDown(void) {}
+
+void test_record_from_reading(void) {
+    sensorReadings_t readings;
+    memset(&readings, 0, sizeof(readings));
+    readings.type = 1;
+    readings.time = T0;
+    readings.rssi = -70;
+    readings.raw[YC01_PH] = 712;
+    historyRecord_t record;
+    TEST_ASSERT_TRUE(historyRecordFrom(2, readings, record));
+    TEST_ASSERT_EQUAL(T0, record.time);
+    TEST_ASSERT_EQUAL(2, record.sensor);
+    TEST_ASSERT_EQUAL(712, record.raw[YC01_PH]);
+    TEST_ASSERT_EQUAL(0, record.reserved);
+
+    // clock not set, or no reading
+    readings.time = HISTORY_MIN_TIME - 1;
+    TEST_ASSERT_FALSE(history.append(0, readings));
+    readings.time = T0;
+    readings.type = 0;
+    TEST_ASSERT_FALSE(history.append(0, readings));
+    TEST_ASSERT_EQUAL(0, history.size());
+}
+
+void test_wrap_around(void) {
+    TEST_ASSERT_EQUAL(0, history.begin());
+    TEST_ASSERT_EQUAL(0, history.end());
+    historyRecord_t record;
+    TEST_ASSERT_FALSE(history.get(0, record));
+
+    // below the capacity everything is readable
+    appendRecords(0, 100);
+    TEST_ASSERT_EQUAL(0, history.begin());
+    TEST_ASSERT_EQUAL(100, history.size());
+    TEST_ASSERT_TRUE(history.get(0, record));
+    TEST_ASSERT_EQUAL(T0, record.time);
+
+    // three times round the ring: the oldest slot is the next to be overwritten
+    uint32_t total = 3 * HISTORY_CAPACITY + 5;
+    appendRecords(100, total - 100);
+    TEST_ASSERT_EQUAL(total, history.end());
+    TEST_ASSERT_EQUAL(HISTORY_CAPACITY - 1, history.size());
+    TEST_ASSERT_EQUAL(total - (HISTORY_CAPACITY - 1), history.begin());
+    TEST_ASSERT_FALSE(history.get(history.begin() - 1, record));
+    TEST_ASSERT_FALSE(history.get(history.end(), record));
+    TEST_ASSERT_FALSE(history.get(0, record));
+    for (uint32_t seq = history.begin(); seq != history.end(); seq++) {
+        TEST_ASSERT_TRUE(history.get(seq, record));
+        historyRecord_t expected = makeRecord(seq);
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &record, sizeof(record));
+    }
+
+    // binary search across the wrap of the slots
+    TEST_ASSERT_EQUAL(history.begin(), history.lowerBound(0));
+    TEST_ASSERT_EQUAL(history.begin(), history.lowerBound(T0));
+    TEST_ASSERT_EQUAL(1200, history.lowerBound(T0 + 1200 * 60));
+    TEST_ASSERT_EQUAL(1201, history.lowerBound(T0 + 1200 * 60 + 1));
+    TEST_ASSERT_EQUAL(history.end() - 1, history.lowerBound(T0 + (total - 1) * 60));
+    TEST_ASSERT_EQUAL(history.end(), history.lowerBound(T0 + (total - 1) * 60 + 1));
+}
+
+void test_clock_set_back(void) {
+    appendRecords(10, 1);
+    history.append(makeRecord(5)); // an older timestamp is raised to the newest
+    historyRecord_t record;
+    TEST_ASSERT_TRUE(history.get(1, record));
+    TEST_ASSERT_EQUAL(makeRecord(10).time, record.time);
+    TEST_ASSERT_EQUAL(makeRecord(5).sensor, record.sensor);
+    TEST_ASSERT_EQUAL(0, history.lowerBound(makeRecord(10).time));
+}
+
+void test_range_boundaries(void) {
+    appendRecords(0, 10);
+    const uint16_t pH = HISTORY_FIELD_PH;
+
+    // from and to are inclusive
+    TEST_ASSERT_EQUAL_STRING(
+        "[\n"
+        "{\"time\":1700000060,\"sensor\":1,\"pH\":7.01},\n"
+        "{\"time\":1700000120,\"sensor\":2,\"pH\":7.02},\n"
+        "{\"time\":1700000180,\"sensor\":0,\"pH\":7.03}\n"
+        "]\n",
+        query(T0 + 60, T0 + 180, pH, -1).c_str());
+    // bounds between two records
+    TEST_ASSERT_EQUAL_STRING(
+        "[\n"
+        "{\"time\":1700000120,\"sensor\":2,\"pH\":7.02}\n"
+        "]\n",
+        query(T0 + 61, T0 + 179, pH, -1).c_str());
+    // a single second
+    TEST_ASSERT_EQUAL_STRING(
+        "[\n"
+        "{\"time\":1700000540,\"sensor\":0,\"pH\":7.09}\n"
+        "]\n",
+        query(T0 + 540, T0 + 540, pH, -1).c_str());
+
+    // empty: between two records, after the newest, before the oldest, reversed, empty ring
+    TEST_ASSERT_EQUAL_STRING("[]\n", query(T0 + 61, T0 + 119, pH, -1).c_str());
+    TEST_ASSERT_EQUAL_STRING("[]\n", query(T0 + 541, UINT32_MAX, pH, -1).c_str());
+    TEST_ASSERT_EQUAL_STRING("[]\n", query(0, T0 - 1, pH, -1).c_str());
+    TEST_ASSERT_EQUAL_STRING("[]\n", query(T0 + 300, T0 + 200, pH, -1).c_str());
+    history.clear();
+    TEST_ASSERT_EQUAL_STRING("[]\n", query(0, UINT32_MAX, pH, -1).c_str());
+}
+
+void test_fields_and_sensor(void) {
+    appendRecords(0, 7);
+    uint16_t fields = historyParseFields("pH,bleRSSI");
+    TEST_ASSERT_EQUAL(HISTORY_FIELD_PH | HISTORY_FIELD_RSSI, fields);
+    TEST_ASSERT_EQUAL(HISTORY_FIELD_ALL, historyParseFields(""));
+    TEST_ASSERT_EQUAL(0, historyParseFields("pH,foo"));
+
+    TEST_ASSERT_EQUAL_STRING(
+        "[\n"
+        "{\"time\":1700000060,\"sensor\":1,\"pH\":7.01,\"bleRSSI\":-61},\n"
+        "{\"time\":1700000240,\"sensor\":1,\"pH\":7.04,\"bleRSSI\":-64}\n"
+        "]\n",
+        query(0, UINT32_MAX, fields, 1).c_str());
+    // an unknown sensor matches nothing
+    TEST_ASSERT_EQUAL_STRING("[]\n", query(0, UINT32_MAX, fields, 5).c_str());
+
+    // all fields, salt derived from EC
+    historyRecord_t record = makeRecord(0);
+    char line[HISTORY_LINE_LENGTH];
+    historyFormat(record, HISTORY_FIELD_ALL, HISTORY_FORMAT_JSON, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("{\"time\":1700000000,\"sensor\":0,\"pH\":7.00,\"ec\":1,\"salt\":0.55,\"tds\":2,"
+        "\"orp\":3,\"cl\":0.40,\"temp\":0.5,\"bat\":6,\"bleRSSI\":-60}", line);
+}
+
+void test_split_chunks(void) {
+    appendRecords(0, 40);
+    std::string whole = query(0, UINT32_MAX, HISTORY_FIELD_ALL, -1);
+    TEST_ASSERT_EQUAL(40 + 2, std::count(whole.begin(), whole.end(), '\n'));
+
+    // lines split across chunks of any size, down to one byte
+    const size_t chunks[] = { 1, 2, 7, 64, 113, 256, 257 };
+    for (size_t chunk : chunks) {
+        TEST_ASSERT_EQUAL_STRING(whole.c_str(), query(0, UINT32_MAX, HISTORY_FIELD_ALL, -1, chunk).c_str());
+    }
+
+    // every chunk is full but the last, once complete the query returns 0
+    HistoryQuery q(history, 0, UINT32_MAX, HISTORY_FIELD_ALL, -1);
+    uint8_t buffer[100];
+    size_t total = 0;
+    size_t length;
+    while ((length = q.read(buffer, sizeof(buffer))) == sizeof(buffer)) total += length;
+    total += length;
+    TEST_ASSERT_EQUAL(whole.size(), total);
+    TEST_ASSERT_EQUAL(0, q.read(buffer, sizeof(buffer)));
+}
+
+void test_query_behind_the_writer(void) {
+    appendRecords(0, HISTORY_CAPACITY);
+    HistoryQuery q(history, 0, UINT32_MAX, HISTORY_FIELD_PH, -1);
+    uint8_t buffer[64];
+    TEST_ASSERT_EQUAL(sizeof(buffer), q.read(buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(0, memcmp(buffer, "[\n{\"time\":1700000060,", 21));
+
+    // the ring turns over while the response is sent: the overwritten records are skipped
+    appendRecords(HISTORY_CAPACITY, HISTORY_CAPACITY);
+    std::string rest = pull(q, sizeof(buffer));
+    size_t next = rest.find("\n{");
+    TEST_ASSERT_TRUE(next != std::string::npos);
+    char expected[32];
+    snprintf(expected, sizeof(expected), "\n{\"time\":%u,", (unsigned)makeRecord(history.begin()).time);
+    TEST_ASSERT_EQUAL(next, rest.find(expected));
+    TEST_ASSERT_EQUAL(HISTORY_CAPACITY - 1, std::count(rest.begin() + next, rest.end(), '{'));
+    TEST_ASSERT_EQUAL_STRING("\n]\n", rest.c_str() + rest.size() - 3);
+}
+
+void test_reader_races_writer(void) {
+    // the reader copies the slot that is overwritten next, most copies race the writer
+    const uint32_t total = 2000000;
+    std::atomic<bool> started{false};
+    std::atomic<bool> done{false};
+    uint32_t accepted = 0, rejected = 0, torn = 0;
+    std::thread reader([&]() {
+        started.store(true);
+        while (!done.load(std::memory_order_relaxed)) {
+            historyRecord_t record;
+            uint32_t seq = history.begin();
+            if (!history.get(seq, record)) {
+                rejected++;
+                continue;
+            }
+            accepted++;
+            historyRecord_t expected = makeRecord(seq);
+            if (memcmp(&expected, &record, sizeof(record)) != 0) torn++;
+        }
+    });
+    while (!started.load()) {}
+    for (uint32_t n = 0; n < total; n++) {
+        history.append(makeRecord(n));
+    }
+    done.store(true);
+    reader.join();
+
+    printf("reader racing the writer: %u copies accepted, %u rejected, %u torn\n",
+        (unsigned)accepted, (unsigned)rejected, (unsigned)torn);
+    TEST_ASSERT_EQUAL(0, torn);
+    TEST_ASSERT_TRUE(accepted + rejected > 0);
+    TEST_ASSERT_EQUAL(total, history.end());
+}
+
+void test_benchmark(void) {
+    appendRecords(0, 3 * HISTORY_CAPACITY);
+    const int lookups = 1000000;
+    volatile uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++) {
+        sink += history.lowerBound(T0 + (uint32_t)(i % (3 * HISTORY_CAPACITY)) * 60);
+    }
+    double lookupNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / lookups;
+
+    const int queries = 1000;
+    size_t bytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queries; i++) {
+        bytes += query(0, UINT32_MAX, HISTORY_FIELD_ALL, -1).size();
+    }
+    double queryUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / queries;
+
+    TEST_ASSERT_TRUE(bytes > 0);
+    printf("lowerBound over %u records: %.1f ns, full query of %u bytes: %.1f us, query %u bytes\n",
+        (unsigned)history.size(), lookupNs, (unsigned)(bytes / queries), queryUs, (unsigned)sizeof(HistoryQuery));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_record_from_reading);
+    RUN_TEST(test_wrap_around);
+    RUN_TEST(test_clock_set_back);
+    RUN_TEST(test_range_boundaries);
+    RUN_TEST(test_fields_and_sensor);
+    RUN_TEST(test_split_chunks);
+    RUN_TEST(test_query_behind_the_writer);
+    RUN_TEST(test_reader_races_writer);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,278 @@
+/*
+ * Host-side tests of the crash-safe reading log.
+ *
+ * Run with: pio test -e native -f native/test_reading_log -v
+ * LittleFS is replaced by the in-memory stand-in (memoryFiles.h); the
+ * benchmark runs on host files (hostFiles.h), every append closed and
+ * fsync'ed like a LittleFS commit, every read opening the file. Power loss is simulated by cutting or corrupting the tail
+ * segment before the log is opened again. The verbose output prints append
+ * throughput with and without batching and the recovery time of a full log.
+ * Timings are host figures; on the ESP32 flash writes dominate.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+
+#include "readingLog.h"
+#include "../memoryFiles.h"
+#include "../hostFiles.h"
+
+/**
+ * @brief In-memory files that let the writer run once between two reads, as the loop between two file reads of the web task
+ */
+class InterleavedFiles : public MemoryFiles {
+public:
+    size_t read(const char* path, size_t offset, uint8_t data[], size_t length) override {
+        size_t done = MemoryFiles::read(path, offset, data, length);
+        if (writer) {
+            std::function<void()> run = writer;
+            writer = nullptr;
+            run();
+        }
+        return done;
+    }
+
+    std::function<void()> writer;
+};
+
+static historyRecord_t makeRecord(uint32_t n) {
+    historyRecord_t record;
+    memset(&record, 0, sizeof(record));
+    record.time = 1700000000 + n * 60;
+    record.sensor = n % 3;
+    record.type = 1;
+    record.rssi = -60 - (int16_t)(n % 20);
+    record.raw[YC01_PH] = 700 + n % 50;
+    record.raw[YC01_ORP] = 650 + n % 30;
+    record.raw[YC01_TEMP] = 250 + n % 10;
+    return record;
+}
+
+static uint32_t replayed = 0;
+static uint32_t replayedLastTime = 0;
+
+static void countRecord(const historyRecord_t& record) {
+    replayed++;
+    replayedLastTime = record.time;
+}
+
+static void appendRecords(ReadingLog& log, uint32_t first, uint32_t count) {
+    for (uint32_t n = first; n < first + count; n++) {
+        TEST_ASSERT_TRUE(log.append(makeRecord(n), n * 1000) || log.pending());
+    }
+}
+
+void setUp(void) {
+    replayed = 0;
+    replayedLastTime = 0;
+}
+
+void tearDown(void) {
+}
+
+void test_crc32_matches_zlib(void) {
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, logCrc32("123456789", 9));
+    // incremental
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, logCrc32("6789", 4, logCrc32("12345", 5)));
+}
+
+void test_recover_after_reboot(void) {
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    appendRecords(log, 0, 100);
+    TEST_ASSERT_EQUAL(100 % LOG_BATCH_RECORDS, log.pending());
+    TEST_ASSERT_EQUAL(100 / LOG_BATCH_RECORDS, log.writes());
+
+    // reboot without flush: the batch in RAM is lost, everything written is back
+    ReadingLog rebooted;
+    TEST_ASSERT_TRUE(rebooted.begin(files, countRecord));
+    uint32_t stored = 100 / LOG_BATCH_RECORDS * LOG_BATCH_RECORDS;
+    TEST_ASSERT_EQUAL(stored, rebooted.recovery().records);
+    TEST_ASSERT_FALSE(rebooted.recovery().torn);
+    TEST_ASSERT_EQUAL(stored, replayed);
+    TEST_ASSERT_EQUAL(makeRecord(stored - 1).time, replayedLastTime);
+
+    // appends continue in the same segment
+    appendRecords(rebooted, stored, LOG_BATCH_RECORDS);
+    historyRecord_t record;
+    TEST_ASSERT_TRUE(rebooted.read(rebooted.lastSequence(), stored, record));
+    TEST_ASSERT_EQUAL(makeRecord(stored).time, record.time);
+    TEST_ASSERT_EQUAL(1, rebooted.lastSequence());
+}
+
+void test_torn_tail_is_sealed(void) {
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    appendRecords(log, 0, 64);
+    char path[LOG_PATH_LENGTH];
+    files.cut(ReadingLog::segmentPath(log.lastSequence(), path), 10); // last record incomplete
+
+    ReadingLog rebooted;
+    TEST_ASSERT_TRUE(rebooted.begin(files, countRecord));
+    TEST_ASSERT_TRUE(rebooted.recovery().torn);
+    TEST_ASSERT_EQUAL(63, rebooted.recovery().records);
+    TEST_ASSERT_EQUAL(63, replayed);
+    TEST_ASSERT_EQUAL(2, rebooted.lastSequence());
+
+    // new records go to the new segment, the old one stays readable up to the tear
+    appendRecords(rebooted, 100, LOG_BATCH_RECORDS);
+    historyRecord_t record;
+    TEST_ASSERT_TRUE(rebooted.read(1, 62, record));
+    TEST_ASSERT_EQUAL(makeRecord(62).time, record.time);
+    TEST_ASSERT_FALSE(rebooted.read(1, 63, record));
+    TEST_ASSERT_TRUE(rebooted.read(2, 0, record));
+    TEST_ASSERT_EQUAL(makeRecord(100).time, record.time);
+
+    ReadingLog again;
+    TEST_ASSERT_TRUE(again.begin(files));
+    TEST_ASSERT_FALSE(again.recovery().torn);
+    TEST_ASSERT_EQUAL(LOG_BATCH_RECORDS, again.recovery().records);
+}
+
+void test_corrupted_record_ends_recovery(void) {
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    appendRecords(log, 0, 64);
+    char path[LOG_PATH_LENGTH];
+    files.corrupt(ReadingLog::segmentPath(1, path), sizeof(logSegmentHeader_t) + 40 * sizeof(logRecord_t) + 6);
+
+    ReadingLog rebooted;
+    TEST_ASSERT_TRUE(rebooted.begin(files, countRecord));
+    TEST_ASSERT_TRUE(rebooted.recovery().torn);
+    TEST_ASSERT_EQUAL(40, replayed);
+    historyRecord_t record;
+    TEST_ASSERT_FALSE(rebooted.read(1, 40, record));
+}
+
+void test_rotation_keeps_newest_segments(void) {
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    uint32_t total = (LOG_SEGMENTS + 2) * LOG_SEGMENT_RECORDS + 100;
+    appendRecords(log, 0, total);
+    TEST_ASSERT_TRUE(log.flush());
+    TEST_ASSERT_EQUAL(LOG_SEGMENTS + 3, log.lastSequence());
+    TEST_ASSERT_EQUAL(log.lastSequence() - (LOG_SEGMENTS - 1), log.firstSequence());
+
+    // the oldest readable record is the first of the oldest segment
+    historyRecord_t record;
+    TEST_ASSERT_TRUE(log.read(log.firstSequence(), 0, record));
+    TEST_ASSERT_EQUAL(makeRecord((log.firstSequence() - 1) * LOG_SEGMENT_RECORDS).time, record.time);
+    TEST_ASSERT_FALSE(log.read(log.firstSequence() - 1, 0, record));
+
+    ReadingLog rebooted;
+    TEST_ASSERT_TRUE(rebooted.begin(files, countRecord));
+    TEST_ASSERT_EQUAL(log.lastSequence(), rebooted.lastSequence());
+    TEST_ASSERT_EQUAL(log.firstSequence(), rebooted.firstSequence());
+    TEST_ASSERT_EQUAL(100, replayed);
+    TEST_ASSERT_EQUAL(makeRecord(total - 1).time, replayedLastTime);
+}
+
+void test_read_overlapping_the_writer(void) {
+    InterleavedFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    uint32_t total = LOG_SEGMENTS * LOG_SEGMENT_RECORDS; // full log, the next batch replaces segment 1
+    appendRecords(log, 0, total);
+    TEST_ASSERT_TRUE(log.flush());
+    logRecord_t entries[4];
+    TEST_ASSERT_EQUAL(4, log.read(1, 0, entries, 4));
+
+    // segment 1 is replaced between the header and the record read: its records must not be returned
+    files.writer = [&]() { appendRecords(log, total, LOG_BATCH_RECORDS); };
+    TEST_ASSERT_EQUAL(0, log.read(1, 0, entries, 4));
+    TEST_ASSERT_NULL(files.writer);
+    logExtent_t extent = log.extent();
+    TEST_ASSERT_EQUAL(2, extent.firstSeq);
+    TEST_ASSERT_EQUAL(LOG_SEGMENTS + 1, extent.tailSeq);
+    TEST_ASSERT_EQUAL(LOG_BATCH_RECORDS, extent.tailRecords);
+    historyRecord_t record;
+    TEST_ASSERT_TRUE(log.read(LOG_SEGMENTS + 1, 0, record));
+    TEST_ASSERT_EQUAL(makeRecord(total).time, record.time);
+
+    // a batch appended to the tail during a read leaves the records read valid
+    files.writer = [&]() { appendRecords(log, total + LOG_BATCH_RECORDS, LOG_BATCH_RECORDS); };
+    TEST_ASSERT_EQUAL(4, log.read(LOG_SEGMENTS + 1, 0, entries, 4));
+    TEST_ASSERT_EQUAL(makeRecord(total).time, entries[0].record.time);
+    TEST_ASSERT_EQUAL(2 * LOG_BATCH_RECORDS, log.extent().tailRecords);
+}
+
+void test_flush_due_after_max_age(void) {
+    MemoryFiles files;
+    ReadingLog log;
+    TEST_ASSERT_TRUE(log.begin(files));
+    TEST_ASSERT_TRUE(log.append(makeRecord(0), 1000));
+    TEST_ASSERT_TRUE(log.flushDue(1000 + LOG_BATCH_MAX_AGE_MS - 1));
+    TEST_ASSERT_EQUAL(1, log.pending());
+    TEST_ASSERT_TRUE(log.flushDue(1000 + LOG_BATCH_MAX_AGE_MS));
+    TEST_ASSERT_EQUAL(0, log.pending());
+    TEST_ASSERT_EQUAL(1, log.written());
+}
+
+void test_benchmark_append_and_recovery(void) {
+    using clock = std::chrono::steady_clock;
+    uint32_t total = LOG_SEGMENTS * LOG_SEGMENT_RECORDS; // full log, tail segment full
+
+    // one commit per reading
+    HostFiles single;
+    ReadingLog unbatched;
+    TEST_ASSERT_TRUE(unbatched.begin(single));
+    uint32_t commitsBefore = single.writes;
+    auto start = clock::now();
+    for (uint32_t n = 0; n < total; n++) {
+        unbatched.append(makeRecord(n), 0);
+        TEST_ASSERT_TRUE(unbatched.flush());
+    }
+    double singleMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    uint32_t singleCommits = single.writes - commitsBefore;
+
+    // batched
+    HostFiles batchedFiles;
+    ReadingLog batched;
+    TEST_ASSERT_TRUE(batched.begin(batchedFiles));
+    commitsBefore = batchedFiles.writes;
+    start = clock::now();
+    appendRecords(batched, 0, total);
+    TEST_ASSERT_TRUE(batched.flush());
+    double batchMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    uint32_t batchCommits = batchedFiles.writes - commitsBefore;
+
+    // recovery reads the headers and the tail segment only
+    batchedFiles.bytesRead = 0;
+    batchedFiles.reads = 0;
+    ReadingLog rebooted;
+    start = clock::now();
+    TEST_ASSERT_TRUE(rebooted.begin(batchedFiles, countRecord));
+    double recoveryMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+    printf("log of %u records (%u segments of %u records, %u bytes each)\n", (unsigned)total, LOG_SEGMENTS,
+        LOG_SEGMENT_RECORDS, (unsigned)(sizeof(logSegmentHeader_t) + LOG_SEGMENT_RECORDS * sizeof(logRecord_t)));
+    printf("unbatched: %5u commits, %8.1f ms, %8.0f records/s\n", (unsigned)singleCommits, singleMs, total / singleMs * 1000);
+    printf("batched:   %5u commits, %8.1f ms, %8.0f records/s\n", (unsigned)batchCommits, batchMs, total / batchMs * 1000);
+    printf("recovery:  %5u records, %8.2f ms, %u bytes in %u file reads\n", (unsigned)replayed, recoveryMs,
+        (unsigned)batchedFiles.bytesRead, (unsigned)batchedFiles.reads);
+
+    TEST_ASSERT_EQUAL(LOG_SEGMENT_RECORDS, replayed);
+    // commits (flash block rewrites) per reading drop by the batch size
+    TEST_ASSERT_LESS_OR_EQUAL(singleCommits / LOG_BATCH_RECORDS + LOG_SEGMENTS * 2, batchCommits);
+    TEST_ASSERT_LESS_OR_EQUAL(LOG_SEGMENTS * sizeof(logSegmentHeader_t) + LOG_SEGMENT_RECORDS * sizeof(logRecord_t),
+        batchedFiles.bytesRead);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_matches_zlib);
+    RUN_TEST(test_recover_after_reboot);
+    RUN_TEST(test_torn_tail_is_sealed);
+    RUN_TEST(test_corrupted_record_ends_recovery);
+    RUN_TEST(test_rotation_keeps_newest_segments);
+    RUN_TEST(test_read_overlapping_the_writer);
+    RUN_TEST(test_flush_due_after_max_age);
+    RUN_TEST(test_benchmark_append_and_recovery);
+    return UNITY_END();
+}
@@ -0,0 +1,179 @@
+/*
+ * Host-side tests of the response cache bookkeeping.
+ *
+ * Run with: pio test -e native -f native/test_response_cache -v
+ * Covers rebuilds on a state change and on the maximum age (also across
+ * the millis() wrap), ETags that follow the content, If-None-Match
+ * parsing, and several dashboards polling /status on a simulated clock.
+ * The verbose output prints the builds per request of the simulation and
+ * the cost of a cached request.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "responseCache.h"
+
+static ResponseCache cache;
+
+void setUp(void) {
+    cache = ResponseCache();
+}
+
+void tearDown(void) {}
+
+static void build(size_t slot, const char* body, uint32_t nowMs) {
+    cache.store(slot, body, strlen(body), nowMs);
+}
+
+void test_fresh_version_and_age(void) {
+    TEST_ASSERT_FALSE(cache.fresh(0, 0, 0));
+    TEST_ASSERT_EQUAL_STRING("", cache.etag(0));
+
+    build(0, "{\"pH\":7.2}", 1000);
+    TEST_ASSERT_TRUE(cache.fresh(0, 1000, 5000));
+    TEST_ASSERT_TRUE(cache.fresh(0, 5999, 5000));
+    TEST_ASSERT_FALSE(cache.fresh(0, 6000, 5000));
+    TEST_ASSERT_TRUE(cache.fresh(0, 1000000, 0));
+    // other slots are independent
+    TEST_ASSERT_FALSE(cache.fresh(1, 1000, 5000));
+    TEST_ASSERT_FALSE(cache.fresh(RESPONSE_CACHE_SLOTS, 1000, 0));
+
+    // a state change makes every slot out of date, without an age limit too
+    build(1, "{}", 1000);
+    cache.invalidate();
+    TEST_ASSERT_FALSE(cache.fresh(0, 1001, 5000));
+    TEST_ASSERT_FALSE(cache.fresh(1, 1001, 0));
+    build(0, "{\"pH\":7.3}", 1001);
+    TEST_ASSERT_TRUE(cache.fresh(0, 1001, 5000));
+    TEST_ASSERT_FALSE(cache.fresh(1, 1001, 0));
+
+    // millis() wraps after 49 days
+    build(2, "{}", 0xFFFFF000u);
+    TEST_ASSERT_TRUE(cache.fresh(2, 0x00000100u, 5000));
+    TEST_ASSERT_FALSE(cache.fresh(2, 0x00001000u, 5000));
+    TEST_ASSERT_EQUAL(4, cache.builds());
+}
+
+void test_etag_follows_content(void) {
+    build(0, "{\"pH\":7.2}", 0);
+    char first[RESPONSE_ETAG_LENGTH];
+    strcpy(first, cache.etag(0));
+    TEST_ASSERT_EQUAL(RESPONSE_ETAG_LENGTH - 1, strlen(first));
+    TEST_ASSERT_EQUAL('"', first[0]);
+    TEST_ASSERT_EQUAL('"', first[RESPONSE_ETAG_LENGTH - 2]);
+
+    // same bytes, same ETag: the client keeps its copy across a rebuild
+    cache.invalidate();
+    build(0, "{\"pH\":7.2}", 10000);
+    TEST_ASSERT_EQUAL_STRING(first, cache.etag(0));
+    build(0, "{\"pH\":7.3}", 20000);
+    TEST_ASSERT_TRUE(strcmp(first, cache.etag(0)) != 0);
+
+    // FNV-1a reference values
+    TEST_ASSERT_EQUAL_HEX32(0x811c9dc5u, responseHash("", 0));
+    TEST_ASSERT_EQUAL_HEX32(0xe40c292cu, responseHash("a", 1));
+}
+
+void test_if_none_match(void) {
+    const char* etag = "\"0123abcd\"";
+    TEST_ASSERT_TRUE(responseEtagMatch("\"0123abcd\"", etag));
+    TEST_ASSERT_TRUE(responseEtagMatch("W/\"0123abcd\"", etag));
+    TEST_ASSERT_TRUE(responseEtagMatch("\"ffffffff\", \"0123abcd\"", etag));
+    TEST_ASSERT_TRUE(responseEtagMatch("\"ffffffff\",W/\"0123abcd\"", etag));
+    TEST_ASSERT_TRUE(responseEtagMatch("*", etag));
+    TEST_ASSERT_FALSE(responseEtagMatch("", etag));
+    TEST_ASSERT_FALSE(responseEtagMatch("\"0123abc\"", etag));
+    TEST_ASSERT_FALSE(responseEtagMatch("\"0123abcd", etag));
+    TEST_ASSERT_FALSE(responseEtagMatch("0123abcd", etag));
+    TEST_ASSERT_FALSE(responseEtagMatch("*", ""));
+
+    // a slot never built is never 304
+    TEST_ASSERT_FALSE(cache.notModified(0, "*"));
+    build(0, "{}", 0);
+    TEST_ASSERT_TRUE(cache.notModified(0, cache.etag(0)));
+    TEST_ASSERT_FALSE(cache.notModified(0, ""));
+    TEST_ASSERT_EQUAL(3, cache.requests());
+    TEST_ASSERT_EQUAL(1, cache.hits());
+}
+
+void test_dashboards_polling(void) {
+    // four dashboards poll /status every 2 s (index.html), one sensor is read every 60 s
+    const uint32_t maxAge = 5000;
+    const size_t dashboards = 4;
+    char etags[dashboards][RESPONSE_ETAG_LENGTH] = {};
+    char body[64];
+    uint32_t reading = 0;
+    uint32_t notModified = 0;
+
+    for (uint32_t nowMs = 0; nowMs < 600000; nowMs += 100) {
+        if (nowMs % 60000 == 0) {
+            // a new reading changes the status of its sensor
+            reading++;
+            cache.invalidate();
+        }
+        for (size_t d = 0; d < dashboards; d++) {
+            if ((nowMs + d * 500) % 2000) continue;
+            if (!cache.fresh(0, nowMs, maxAge)) {
+                // the time field changes with every build
+                snprintf(body, sizeof(body), "{\"time\":%u,\"reading\":%u}", (unsigned)(nowMs / 1000), (unsigned)reading);
+                build(0, body, nowMs);
+            }
+            if (cache.notModified(0, etags[d])) {
+                notModified++;
+            } else {
+                strcpy(etags[d], cache.etag(0));
+            }
+        }
+    }
+
+    // 1200 requests, one build per max age plus one per reading at most
+    TEST_ASSERT_EQUAL(1200, cache.requests());
+    TEST_ASSERT_EQUAL(notModified, cache.hits());
+    TEST_ASSERT_TRUE(cache.builds() <= 600000 / maxAge + 10);
+    TEST_ASSERT_TRUE(cache.hits() >= cache.requests() / 2);
+    printf("4 dashboards, 10 min: %u requests, %u builds, %u answered 304\n",
+        (unsigned)cache.requests(), (unsigned)cache.builds(), (unsigned)cache.hits());
+}
+
+void test_benchmark(void) {
+    char body[1200];
+    memset(body, 'x', sizeof(body) - 1);
+    body[sizeof(body) - 1] = 0;
+    build(0, body, 0);
+    char etag[RESPONSE_ETAG_LENGTH];
+    strcpy(etag, cache.etag(0));
+
+    const int rounds = 1000000;
+    volatile uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sink += cache.fresh(0, i, 5000) && cache.notModified(0, etag);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double requestNs = std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+
+    const int builds = 10000;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < builds; i++) {
+        body[0] = 'a' + i % 26;
+        build(0, body, i);
+    }
+    end = std::chrono::steady_clock::now();
+    double buildNs = std::chrono::duration<double, std::nano>(end - start).count() / builds;
+
+    TEST_ASSERT_TRUE(sink > 0);
+    printf("cached request: %.1f ns, ETag of a %u byte body: %.0f ns, state %u bytes\n",
+        requestNs, (unsigned)strlen(body), buildNs, (unsigned)sizeof(ResponseCache));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fresh_version_and_age);
+    RUN_TEST(test_etag_follows_content);
+    RUN_TEST(test_if_none_match);
+    RUN_TEST(test_dashboards_polling);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
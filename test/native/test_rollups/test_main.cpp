@@ -0,0 +1,172 @@
+/*
+ * Host-side tests of the hourly/daily rollups.
+ *
+ * Run with: pio test -e native -f native/test_rollups -v
+ * The files are kept in memory, a power loss during a save is simulated by
+ * cutting the file written last. The verbose output prints the cost of one
+ * update, which must not grow with the number of readings.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#include "rollups.h"
+#include "../memoryFiles.h"
+
+#define T0 1700006400 // 2023-11-15 00:00 UTC
+
+static historyRecord_t makeRecord(uint32_t time, uint8_t sensor, float pH, float orp, float cl, float temp) {
+    historyRecord_t record;
+    memset(&record, 0, sizeof(record));
+    record.time = time;
+    record.sensor = sensor;
+    record.type = 1;
+    record.raw[YC01_PH] = lroundf(pH * 100);
+    record.raw[YC01_ORP] = lroundf(orp);
+    record.raw[YC01_CL] = lroundf(cl * 10);
+    record.raw[YC01_TEMP] = lroundf(temp * 10);
+    return record;
+}
+
+static Rollups rollups;
+
+void setUp(void) {
+    rollups.begin(2);
+}
+
+void tearDown(void) {}
+
+void test_min_max_avg_count(void) {
+    TEST_ASSERT_EQUAL(0, rollups.add(makeRecord(T0 + 60, 0, 7.10f, 650, 0.50f, 24.0f)));
+    TEST_ASSERT_EQUAL(0, rollups.add(makeRecord(T0 + 120, 0, 7.30f, 700, 0.70f, 26.0f)));
+    TEST_ASSERT_EQUAL(0, rollups.add(makeRecord(T0 + 180, 0, 7.20f, 690, 0.60f, 25.0f)));
+
+    rollupBucket_t bucket;
+    TEST_ASSERT_TRUE(rollups.get(0, ROLLUP_HOUR, T0, bucket));
+    TEST_ASSERT_EQUAL(3, bucket.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 7.10f, bucket.min(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 7.30f, bucket.max(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 7.20f, bucket.avg(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 680.0f, bucket.avg(1));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.70f, bucket.max(2));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 24.0f, bucket.min(3));
+    TEST_ASSERT_TRUE(rollups.get(0, ROLLUP_DAY, T0, bucket));
+    TEST_ASSERT_EQUAL(3, bucket.count);
+    // the other sensor is kept apart
+    TEST_ASSERT_FALSE(rollups.get(1, ROLLUP_HOUR, T0, bucket));
+}
+
+void test_rollover_closes_buckets(void) {
+    rollups.add(makeRecord(T0 + 3000, 0, 7.0f, 650, 0.5f, 25.0f));
+    TEST_ASSERT_EQUAL(1 << ROLLUP_HOUR, rollups.add(makeRecord(T0 + 3700, 0, 7.2f, 650, 0.5f, 25.0f)));
+    TEST_ASSERT_EQUAL(T0, rollups.closed(0, ROLLUP_HOUR));
+    TEST_ASSERT_EQUAL(T0 + 3600, rollups.newest(0, ROLLUP_HOUR));
+    TEST_ASSERT_EQUAL((1 << ROLLUP_HOUR) | (1 << ROLLUP_DAY), rollups.add(makeRecord(T0 + 86400 + 10, 0, 7.4f, 650, 0.5f, 25.0f)));
+    TEST_ASSERT_EQUAL(T0, rollups.closed(0, ROLLUP_DAY));
+
+    rollupBucket_t bucket;
+    TEST_ASSERT_TRUE(rollups.get(0, ROLLUP_DAY, T0, bucket));
+    TEST_ASSERT_EQUAL(2, bucket.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 7.1f, bucket.avg(0));
+
+    // a day later the hour slot of T0 is reused, the old hour is gone
+    TEST_ASSERT_FALSE(rollups.get(0, ROLLUP_HOUR, T0, bucket));
+    TEST_ASSERT_TRUE(rollups.get(0, ROLLUP_HOUR, T0 + 86400, bucket));
+    TEST_ASSERT_EQUAL(1, bucket.count);
+    // a late reading of a replaced hour is dropped, the day still counts it
+    rollups.add(makeRecord(T0 + 100, 0, 9.0f, 650, 0.5f, 25.0f));
+    TEST_ASSERT_TRUE(rollups.get(0, ROLLUP_HOUR, T0 + 86400, bucket));
+    TEST_ASSERT_EQUAL(1, bucket.count);
+    TEST_ASSERT_TRUE(rollups.get(0, ROLLUP_DAY, T0, bucket));
+    TEST_ASSERT_EQUAL(3, bucket.count);
+}
+
+void test_query_streams_oldest_first(void) {
+    rollups.add(makeRecord(T0 + 60, 1, 7.0f, 650, 0.5f, 25.0f));
+    rollups.add(makeRecord(T0 + 7260, 1, 7.5f, 700, 0.8f, 26.0f));
+
+    RollupQuery query(rollups, 1, ROLLUP_HOUR);
+    char text[1024];
+    size_t length = 0, part;
+    // small chunks as the web server may ask for
+    while ((part = query.read((uint8_t*)text + length, 7)) > 0) length += part;
+    text[length] = 0;
+    TEST_ASSERT_EQUAL_STRING(
+        "[\n"
+        "{\"start\":1700006400,\"count\":1,\"pH\":{\"min\":7.00,\"max\":7.00,\"avg\":7.00},"
+        "\"orp\":{\"min\":650,\"max\":650,\"avg\":650},\"cl\":{\"min\":0.50,\"max\":0.50,\"avg\":0.50},"
+        "\"temp\":{\"min\":25.0,\"max\":25.0,\"avg\":25.0}},\n"
+        "{\"start\":1700013600,\"count\":1,\"pH\":{\"min\":7.50,\"max\":7.50,\"avg\":7.50},"
+        "\"orp\":{\"min\":700,\"max\":700,\"avg\":700},\"cl\":{\"min\":0.80,\"max\":0.80,\"avg\":0.80},"
+        "\"temp\":{\"min\":26.0,\"max\":26.0,\"avg\":26.0}}\n"
+        "]\n", text);
+
+    RollupQuery empty(rollups, 0, ROLLUP_DAY);
+    length = empty.read((uint8_t*)text, sizeof(text) - 1);
+    text[length] = 0;
+    TEST_ASSERT_EQUAL_STRING("[]\n", text);
+}
+
+void test_save_and_load(void) {
+    MemoryFiles files;
+    for (uint32_t n = 0; n < 100; n++) {
+        rollups.add(makeRecord(T0 + n * 600, n % 2, 7.0f + (n % 10) / 100.0f, 650, 0.5f, 25.0f));
+    }
+    TEST_ASSERT_TRUE(rollups.save(files));
+    rollups.add(makeRecord(T0 + 100 * 600, 0, 7.5f, 650, 0.5f, 25.0f));
+    TEST_ASSERT_TRUE(rollups.save(files));
+    TEST_ASSERT_EQUAL(2, files.files.size());
+
+    Rollups loaded;
+    loaded.begin(2);
+    TEST_ASSERT_TRUE(loaded.load(files));
+    TEST_ASSERT_EQUAL(T0 + 100 * 600, loaded.lastTime());
+    TEST_ASSERT_EQUAL(rollups.newest(0, ROLLUP_HOUR), loaded.newest(0, ROLLUP_HOUR));
+    rollupBucket_t expected, bucket;
+    TEST_ASSERT_TRUE(rollups.get(1, ROLLUP_DAY, T0, expected));
+    TEST_ASSERT_TRUE(loaded.get(1, ROLLUP_DAY, T0, bucket));
+    TEST_ASSERT_EQUAL_MEMORY(&expected, &bucket, sizeof(bucket));
+
+    // a save cut by a power loss falls back to the previous one
+    files.files[files.lastPath].resize(100);
+    TEST_ASSERT_TRUE(loaded.load(files));
+    TEST_ASSERT_EQUAL(T0 + 99 * 600, loaded.lastTime());
+
+    // a changed sensor count discards the saves
+    Rollups other;
+    other.begin(3);
+    TEST_ASSERT_FALSE(other.load(files));
+    TEST_ASSERT_EQUAL(0, other.lastTime());
+}
+
+void test_benchmark_update(void) {
+    typedef std::chrono::steady_clock clock;
+    const uint32_t total = 200000;
+    rollups.begin(ROLLUP_MAX_SENSORS);
+    auto start = clock::now();
+    for (uint32_t n = 0; n < total; n++) {
+        rollups.add(makeRecord(T0 + n * 30, n % ROLLUP_MAX_SENSORS, 7.0f + (n % 50) / 100.0f, 650 + n % 30, 0.5f, 25.0f));
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / total;
+    printf("update: %.1f ns per reading over %u readings (%u days), %u bytes of buckets\n", ns, (unsigned)total,
+        (unsigned)(total * 30 / 86400), (unsigned)(ROLLUP_MAX_SENSORS * (ROLLUP_HOURS + ROLLUP_DAYS) * sizeof(rollupBucket_t)));
+
+    rollupBucket_t bucket;
+    uint32_t lastDay = rollups.newest(0, ROLLUP_DAY);
+    TEST_ASSERT_TRUE(rollups.get(0, ROLLUP_DAY, lastDay - 86400, bucket));
+    // 30 s readings, every 8th for sensor 0
+    TEST_ASSERT_EQUAL(86400 / 30 / ROLLUP_MAX_SENSORS, bucket.count);
+    TEST_ASSERT_FALSE(rollups.get(0, ROLLUP_DAY, lastDay - ROLLUP_DAYS * 86400, bucket));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_min_max_avg_count);
+    RUN_TEST(test_rollover_closes_buckets);
+    RUN_TEST(test_query_streams_oldest_first);
+    RUN_TEST(test_save_and_load);
+    RUN_TEST(test_benchmark_update);
+    return UNITY_END();
+}
@@ -0,0 +1,234 @@
+/*
+ * Host-side replay of the adaptive scan policy against discovery timings.
+ *
+ * Run with: pio test -e native -f native/test_scan_policy -v
+ * The trace holds, per scan and sensor, the listening time until the first
+ * advertisement of the sensor arrived (ms of open scan window, 0 = sensor
+ * absent), in the pattern of gateway logs: three sensors advertising every
+ * ~0.6 s, ~1 s and ~0.4 s, one outage of the third sensor and one late
+ * advertisement of the second. A sensor is discovered if the scan listens at
+ * least that long; the adaptive scan stops as soon as all sensors were seen.
+ * The verbose output compares scan time and radio listening time with the
+ * fixed scan (3 s, 45 ms interval, 15 ms window) used before.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "scanPolicy.h"
+
+#define TRACE_SENSORS 3
+#define TRACE_SCANS 30
+
+#define FIXED_DURATION_MS 3000
+#define FIXED_INTERVAL_MS 45
+#define FIXED_WINDOW_MS 15
+
+static const uint16_t trace[TRACE_SCANS][TRACE_SENSORS] = {
+    { 351,  194,  212}, {  69,  114,  284}, { 116,  414,  308}, {  79,  559,  119}, {  58,  128,  232},
+    { 448,  111,  133}, { 112,  604,  227}, {  80,  886,  299}, { 146,  268,  332}, {  83,  630,  309},
+    { 426,   90,  123}, {  67,  610,   78}, { 316,  469,    0}, { 573,  160,    0}, { 335,  613,    0},
+    { 205,  145,  307}, { 212,  421,   59}, { 580,  769,   42}, { 597,  101,  326}, { 230,  548,  358},
+    { 564,  477,  170}, { 496, 1400,  242}, { 390,  346,  137}, { 204,  755,  134}, { 103,  628,  163},
+    { 557,  546,  185}, { 479,  334,  321}, {  94,  160,  272}, { 448,  208,  397}, { 370,  195,  260},
+};
+
+static const uint8_t allSensors[TRACE_SENSORS] = {0, 1, 2};
+
+/**
+ * @brief Scan time until the given listening time has passed
+ */
+static uint32_t scanTimeFor(uint32_t listenMs, const scanParams_t& scan) {
+    return (uint32_t)(((uint64_t)listenMs * scan.intervalMs + scan.windowMs - 1) / scan.windowMs);
+}
+
+/**
+ * @brief Result of replaying the trace
+ */
+struct replay_t
+{
+    uint32_t scanMs;        /**< Total scan time */
+    uint32_t listenMs;      /**< Total radio listening time */
+    uint32_t found;         /**< Discoveries of present sensors */
+    uint32_t present;       /**< Present sensors over all scans */
+};
+
+/**
+ * @brief Simulates one scan
+ * @param row Trace row
+ * @param scan Scan parameters
+ * @param earlyStop Stop once all sensors were seen
+ * @param delays Output scan time until each sensor was seen, 0 if missed
+ * @return Scan time
+ */
+static uint32_t simulateScan(const uint16_t row[], const scanParams_t& scan, bool earlyStop, uint32_t delays[]) {
+    uint32_t last = 0;
+    bool all = true;
+    for (int s = 0; s < TRACE_SENSORS; s++) {
+        uint32_t delay = row[s] ? scanTimeFor(row[s], scan) : 0;
+        if (!row[s] || delay > scan.durationMs) {
+            delays[s] = 0;
+            all = false;
+            continue;
+        }
+        delays[s] = delay;
+        if (delay > last) last = delay;
+    }
+    return earlyStop && all ? last : scan.durationMs;
+}
+
+static replay_t replayFixed() {
+    replay_t result = {0};
+    scanParams_t scan = {FIXED_DURATION_MS, FIXED_INTERVAL_MS, FIXED_WINDOW_MS, true, false};
+    for (int n = 0; n < TRACE_SCANS; n++) {
+        uint32_t delays[TRACE_SENSORS];
+        uint32_t scanMs = simulateScan(trace[n], scan, false, delays);
+        result.scanMs += scanMs;
+        result.listenMs += scanMs * scan.windowMs / scan.intervalMs;
+        for (int s = 0; s < TRACE_SENSORS; s++) {
+            result.present += trace[n][s] ? 1 : 0;
+            result.found += delays[s] ? 1 : 0;
+        }
+    }
+    return result;
+}
+
+static replay_t replayAdaptive(ScanPolicy& policy, bool verbose) {
+    replay_t result = {0};
+    policy.begin(TRACE_SENSORS);
+    for (int n = 0; n < TRACE_SCANS; n++) {
+        scanParams_t scan = policy.plan(allSensors, TRACE_SENSORS);
+        uint32_t delays[TRACE_SENSORS];
+        uint32_t scanMs = simulateScan(trace[n], scan, true, delays);
+        result.scanMs += scanMs;
+        result.listenMs += scanMs * scan.windowMs / scan.intervalMs;
+        for (int s = 0; s < TRACE_SENSORS; s++) {
+            result.present += trace[n][s] ? 1 : 0;
+            result.found += delays[s] ? 1 : 0;
+            if (delays[s]) {
+                policy.discovered(s, delays[s], scan);
+            } else {
+                policy.missed(s, scan);
+            }
+        }
+        if (verbose) {
+            printf("scan %2d: %s %2u/%2u ms, planned %4u ms, took %4u ms, found %c%c%c\n", n,
+                scan.active ? "active " : "passive", scan.windowMs, scan.intervalMs,
+                (unsigned)scan.durationMs, (unsigned)scanMs,
+                delays[0] ? 'A' : '-', delays[1] ? 'B' : '-', delays[2] ? 'C' : '-');
+        }
+    }
+    return result;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_new_sensor_scans_aggressively(void) {
+    ScanPolicy policy;
+    policy.begin(2);
+    uint8_t batch[] = {0};
+    scanParams_t scan = policy.plan(batch, 1);
+    TEST_ASSERT_TRUE(scan.active);
+    TEST_ASSERT_EQUAL(SCAN_AGGRESSIVE_WINDOW_MS, scan.windowMs);
+    TEST_ASSERT_EQUAL(SCAN_AGGRESSIVE_INTERVAL_MS, scan.intervalMs);
+    TEST_ASSERT_EQUAL(SCAN_FULL_DURATION_MS, scan.durationMs);
+    TEST_ASSERT_FALSE(scan.acceptListOnly);
+}
+
+void test_reliable_sensor_scans_briefly(void) {
+    ScanPolicy policy;
+    policy.begin(1);
+    uint8_t batch[] = {0};
+    for (int n = 0; n < SCAN_RELIABLE_HITS; n++) {
+        scanParams_t scan = policy.plan(batch, 1);
+        policy.discovered(0, 400, scan);
+    }
+    TEST_ASSERT_TRUE(policy.reliable(0));
+
+    scanParams_t scan = policy.plan(batch, 1);
+    TEST_ASSERT_FALSE(scan.active);
+    TEST_ASSERT_EQUAL(SCAN_RELAXED_WINDOW_MS, scan.windowMs);
+    TEST_ASSERT_EQUAL(SCAN_RELAXED_INTERVAL_MS, scan.intervalMs);
+    TEST_ASSERT_LESS_THAN(SCAN_FULL_DURATION_MS, scan.durationMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(SCAN_MIN_DURATION_MS, scan.durationMs);
+    // long enough for the listening time seen so far
+    TEST_ASSERT_GREATER_OR_EQUAL(scanTimeFor(policy.stats(0).meanMs, scan), scan.durationMs);
+}
+
+void test_missing_sensor_scans_aggressively(void) {
+    ScanPolicy policy;
+    policy.begin(1);
+    uint8_t batch[] = {0};
+    for (int n = 0; n < SCAN_RELIABLE_HITS; n++) {
+        policy.discovered(0, 300, policy.plan(batch, 1));
+    }
+    scanParams_t relaxed = policy.plan(batch, 1);
+    TEST_ASSERT_FALSE(relaxed.active);
+    for (int n = 0; n < 4; n++) {
+        scanParams_t scan = policy.plan(batch, 1);
+        policy.missed(0, scan);
+        // aggressive, listening longer than the relaxed scan, but not unbounded
+        scanParams_t next = policy.plan(batch, 1);
+        TEST_ASSERT_TRUE(next.active);
+        TEST_ASSERT_EQUAL(SCAN_FULL_DURATION_MS, next.durationMs);
+        TEST_ASSERT_GREATER_THAN(relaxed.durationMs * relaxed.windowMs / relaxed.intervalMs,
+            next.durationMs * next.windowMs / next.intervalMs);
+    }
+    TEST_ASSERT_FALSE(policy.reliable(0));
+
+    // found again: reliable after SCAN_RELIABLE_HITS scans
+    for (int n = 0; n < SCAN_RELIABLE_HITS; n++) {
+        TEST_ASSERT_FALSE(policy.reliable(0));
+        policy.discovered(0, 300, policy.plan(batch, 1));
+    }
+    TEST_ASSERT_TRUE(policy.reliable(0));
+}
+
+void test_batch_uses_slowest_sensor(void) {
+    ScanPolicy policy;
+    policy.begin(2);
+    uint8_t both[] = {0, 1};
+    uint8_t first[] = {0};
+    for (int n = 0; n < SCAN_RELIABLE_HITS; n++) {
+        scanParams_t scan = policy.plan(both, 2);
+        policy.discovered(0, 200, scan);
+        policy.discovered(1, 2000, scan);
+    }
+    TEST_ASSERT_GREATER_THAN(policy.plan(first, 1).durationMs, policy.plan(both, 2).durationMs);
+
+    // one new sensor makes the whole scan aggressive
+    policy.reset(1);
+    TEST_ASSERT_TRUE(policy.plan(both, 2).active);
+    TEST_ASSERT_FALSE(policy.plan(first, 1).active);
+}
+
+void test_replay_trace(void) {
+    ScanPolicy policy;
+    replay_t fixed = replayFixed();
+    replay_t adaptive = replayAdaptive(policy, true);
+
+    printf("fixed:    scan %6u ms, listening %6u ms, found %u/%u\n",
+        (unsigned)fixed.scanMs, (unsigned)fixed.listenMs, (unsigned)fixed.found, (unsigned)fixed.present);
+    printf("adaptive: scan %6u ms, listening %6u ms, found %u/%u\n",
+        (unsigned)adaptive.scanMs, (unsigned)adaptive.listenMs, (unsigned)adaptive.found, (unsigned)adaptive.present);
+
+    // no more missed discoveries than the fixed scan
+    TEST_ASSERT_GREATER_OR_EQUAL(fixed.found, adaptive.found);
+    // shorter cycles and less radio time
+    TEST_ASSERT_LESS_THAN(fixed.scanMs * 3 / 4, adaptive.scanMs);
+    TEST_ASSERT_LESS_THAN(fixed.listenMs * 3 / 4, adaptive.listenMs);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_new_sensor_scans_aggressively);
+    RUN_TEST(test_reliable_sensor_scans_briefly);
+    RUN_TEST(test_missing_sensor_scans_aggressively);
+    RUN_TEST(test_batch_uses_slowest_sensor);
+    RUN_TEST(test_replay_trace);
+    return UNITY_END();
+}
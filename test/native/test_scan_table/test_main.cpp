@@ -0,0 +1,281 @@
+/*
+ * Host-side tests of the scan result bookkeeping.
+ *
+ * Run with: pio test -e native -f native/test_scan_table -v
+ * Covers the event ring (order, full ring dropping and counting events,
+ * discard, a producer thread racing the consumer), the device set (dedup
+ * within and across scans, RSSI min/max/mean, lookups with
+ * BLE_ADDRESS_TYPE_ANY) and the replacement of the device seen least
+ * recently once SCAN_MAX_DEVICES are tracked. The verbose output prints the
+ * cost of an event through the ring and the set.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include "scanTable.h"
+
+#define RANDOM 1    // BLE_ADDR_RANDOM
+
+static ScanDeviceSet set;
+
+/**
+ * @brief Address key of sensor n, random addresses as the YC01 advertises them
+ */
+static uint64_t sensorAddress(uint32_t n) {
+    return bleAddressKey(0xC00000000000ull + n * 0x010203ull, RANDOM);
+}
+
+static scanEvent_t makeEvent(uint64_t address, uint32_t timeMs, int8_t rssi) {
+    scanEvent_t event;
+    memset(&event, 0, sizeof(event));
+    event.address = address;
+    event.timeMs = timeMs;
+    event.rssi = rssi;
+    return event;
+}
+
+void setUp(void) {
+    set.clear();
+    set.beginScan();
+}
+
+void tearDown(void) {}
+
+void test_ring_order_and_drop(void) {
+    static ScanEventRing ring;
+    scanEvent_t event;
+    TEST_ASSERT_FALSE(ring.pop(event));
+
+    // a full ring drops and counts, nothing already queued is lost
+    for (uint32_t i = 0; i < SCAN_RING_SIZE; i++) {
+        TEST_ASSERT_TRUE(ring.push(makeEvent(sensorAddress(0), i, -60)));
+    }
+    TEST_ASSERT_FALSE(ring.push(makeEvent(sensorAddress(0), 1000, -60)));
+    TEST_ASSERT_FALSE(ring.push(makeEvent(sensorAddress(0), 1001, -60)));
+    TEST_ASSERT_EQUAL(2, ring.dropped());
+
+    // a popped slot takes the next event
+    TEST_ASSERT_TRUE(ring.pop(event));
+    TEST_ASSERT_EQUAL(0, event.timeMs);
+    TEST_ASSERT_TRUE(ring.push(makeEvent(sensorAddress(0), SCAN_RING_SIZE, -60)));
+    for (uint32_t i = 1; i <= SCAN_RING_SIZE; i++) {
+        TEST_ASSERT_TRUE(ring.pop(event));
+        TEST_ASSERT_EQUAL(i, event.timeMs);
+    }
+    TEST_ASSERT_FALSE(ring.pop(event));
+
+    // discard empties the ring, the drop count stays
+    ring.push(makeEvent(sensorAddress(0), 1, -60));
+    ring.push(makeEvent(sensorAddress(0), 2, -60));
+    ring.discard();
+    TEST_ASSERT_FALSE(ring.pop(event));
+    TEST_ASSERT_EQUAL(2, ring.dropped());
+}
+
+void test_ring_producer_thread(void) {
+    // the producer never waits: every event is either delivered in order or counted as dropped
+    static ScanEventRing ring;
+    const uint32_t total = 100000;
+    uint32_t received = 0, last = 0;
+    bool ordered = true;
+    std::atomic<bool> started{false};
+    std::thread producer([&]() {
+        while (!started.load()) {}
+        for (uint32_t i = 1; i <= total; i++) {
+            ring.push(makeEvent(sensorAddress(i % 4), i, -60));
+            if (i % 16 == 0) std::this_thread::yield();  // bursts of advertisements, also on one core
+        }
+    });
+    scanEvent_t event;
+    started.store(true);
+    while (received + ring.dropped() < total) {
+        if (!ring.pop(event)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (event.timeMs <= last || bleAddressValue(event.address) != bleAddressValue(sensorAddress(event.timeMs % 4))) {
+            ordered = false;
+        }
+        last = event.timeMs;
+        received++;
+    }
+    producer.join();
+
+    printf("producer thread: %u events received, %u dropped\n", (unsigned)received, (unsigned)ring.dropped());
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL(total, received + ring.dropped());
+    TEST_ASSERT_FALSE(ring.pop(event));
+}
+
+void test_dedup_across_scans(void) {
+    uint64_t a = sensorAddress(1), b = sensorAddress(2);
+    scanEvent_t named = makeEvent(b, 20, -70);
+    strcpy(named.model, "BLE-YC01");
+    set.update(makeEvent(a, 10, -60));
+    set.update(named);
+    set.update(makeEvent(a, 30, -62));
+    scanEvent_t broadcast = makeEvent(a, 40, -61);
+    broadcast.broadcast = true;
+    broadcast.readings.type = 1;
+    set.update(broadcast);
+
+    // one entry per device, in the order first seen
+    TEST_ASSERT_EQUAL(2, set.foundCount());
+    TEST_ASSERT_EQUAL_UINT64(a, set.found(0).address);
+    TEST_ASSERT_EQUAL_UINT64(b, set.found(1).address);
+    TEST_ASSERT_EQUAL(3, set.found(0).advCount);
+    TEST_ASSERT_EQUAL(10, set.found(0).firstSeenMs);
+    TEST_ASSERT_EQUAL(40, set.found(0).lastSeenMs);
+    TEST_ASSERT_TRUE(set.found(0).broadcast);
+
+    // a new scan starts an empty list, the devices and their statistics stay
+    set.beginScan();
+    TEST_ASSERT_EQUAL(0, set.foundCount());
+    const scanDevice_t* device = set.find(a);
+    TEST_ASSERT_NOT_NULL(device);
+    TEST_ASSERT_FALSE(set.seenInScan(*device));
+
+    // the first advertisement of the scan lists the device again, the broadcast of the last scan is stale
+    set.update(makeEvent(b, 1000, -72));
+    set.update(makeEvent(a, 1010, -60));
+    set.update(makeEvent(b, 1020, -74));
+    TEST_ASSERT_EQUAL(2, set.foundCount());
+    TEST_ASSERT_EQUAL_UINT64(b, set.found(0).address);
+    TEST_ASSERT_EQUAL_UINT64(a, set.found(1).address);
+    TEST_ASSERT_TRUE(set.seenInScan(*device));
+    TEST_ASSERT_EQUAL(4, device->advCount);
+    TEST_ASSERT_EQUAL(1010, device->firstSeenMs);
+    TEST_ASSERT_FALSE(device->broadcast);
+    TEST_ASSERT_EQUAL(3, set.found(0).advCount);
+    TEST_ASSERT_EQUAL_STRING("BLE-YC01", set.found(0).model);   // an advertisement without name keeps it
+}
+
+void test_rssi_statistics(void) {
+    uint64_t a = sensorAddress(1);
+    const int8_t rssi[] = {-70, -50, -90, -61};
+    for (size_t i = 0; i < sizeof(rssi); i++) {
+        set.update(makeEvent(a, i, rssi[i]));
+    }
+    const scanDevice_t* device = set.find(a);
+    TEST_ASSERT_NOT_NULL(device);
+    TEST_ASSERT_EQUAL(-90, device->rssiMin);
+    TEST_ASSERT_EQUAL(-50, device->rssiMax);
+    TEST_ASSERT_EQUAL(-271, device->rssiSum);
+    TEST_ASSERT_EQUAL(-67, device->rssiMean());     // -67.75, truncated
+
+    // the statistics span scans
+    set.beginScan();
+    set.update(makeEvent(a, 100, -40));
+    TEST_ASSERT_EQUAL(-90, device->rssiMin);
+    TEST_ASSERT_EQUAL(-40, device->rssiMax);
+    TEST_ASSERT_EQUAL(-62, device->rssiMean());     // -311 / 5
+
+    // a new device starts from its first advertisement
+    TEST_ASSERT_NULL(set.find(sensorAddress(2)));
+    const scanDevice_t* other = set.update(makeEvent(sensorAddress(2), 110, -80));
+    TEST_ASSERT_EQUAL(-80, other->rssiMin);
+    TEST_ASSERT_EQUAL(-80, other->rssiMax);
+    TEST_ASSERT_EQUAL(-80, other->rssiMean());
+}
+
+void test_address_type_any(void) {
+    uint64_t random = sensorAddress(1);
+    uint64_t configured = bleAddressKey(bleAddressValue(random), BLE_ADDRESS_TYPE_ANY);
+    uint64_t publicKey = bleAddressKey(bleAddressValue(random), 0);
+    set.update(makeEvent(random, 10, -60));
+    for (uint32_t n = 2; n < SCAN_MAX_DEVICES; n++) {
+        set.update(makeEvent(sensorAddress(n), 10 + n, -60));
+    }
+
+    // a configured address without type finds the device, a public address of the same value does not
+    const scanDevice_t* device = set.find(configured);
+    TEST_ASSERT_NOT_NULL(device);
+    TEST_ASSERT_EQUAL_UINT64(random, device->address);
+    TEST_ASSERT_NULL(set.find(publicKey));
+    TEST_ASSERT_NULL(set.find(bleAddressKey(bleAddressValue(sensorAddress(SCAN_MAX_DEVICES)), BLE_ADDRESS_TYPE_ANY)));
+
+    // an event addressed with BLE_ADDRESS_TYPE_ANY updates the same device
+    set.update(makeEvent(configured, 50, -58));
+    TEST_ASSERT_EQUAL(2, device->advCount);
+    TEST_ASSERT_EQUAL(SCAN_MAX_DEVICES - 1, set.foundCount());
+}
+
+void test_eviction(void) {
+    // scan 1 fills the set, device n last seen at 100 + n
+    for (uint32_t n = 0; n < SCAN_MAX_DEVICES; n++) {
+        TEST_ASSERT_NOT_NULL(set.update(makeEvent(sensorAddress(n), 100 + n, -60)));
+    }
+
+    // scan 2: device 0 is seen again, so devices 1 and 2 are the least recently seen
+    set.beginScan();
+    set.update(makeEvent(sensorAddress(0), 500, -60));
+    const scanDevice_t* added = set.update(makeEvent(sensorAddress(SCAN_MAX_DEVICES), 510, -55));
+    TEST_ASSERT_NOT_NULL(added);
+    TEST_ASSERT_EQUAL_UINT64(sensorAddress(SCAN_MAX_DEVICES), added->address);
+    TEST_ASSERT_EQUAL(1, added->advCount);
+    TEST_ASSERT_EQUAL(-55, added->rssiMin);
+    TEST_ASSERT_NULL(set.find(sensorAddress(1)));
+    set.update(makeEvent(sensorAddress(SCAN_MAX_DEVICES + 1), 520, -55));
+    TEST_ASSERT_NULL(set.find(sensorAddress(2)));
+
+    // after the rehash every remaining device is found, also by address type ANY
+    for (uint32_t n = 0; n < SCAN_MAX_DEVICES + 2; n++) {
+        if (n == 1 || n == 2) continue;
+        const scanDevice_t* device = set.find(bleAddressKey(bleAddressValue(sensorAddress(n)), BLE_ADDRESS_TYPE_ANY));
+        TEST_ASSERT_NOT_NULL(device);
+        TEST_ASSERT_EQUAL_UINT64(sensorAddress(n), device->address);
+    }
+    TEST_ASSERT_EQUAL(3, set.foundCount());
+    TEST_ASSERT_EQUAL_UINT64(sensorAddress(SCAN_MAX_DEVICES + 1), set.found(2).address);
+
+    // a device that comes back is a new entry and replaces the next least recently seen
+    set.update(makeEvent(sensorAddress(1), 530, -70));
+    TEST_ASSERT_NULL(set.find(sensorAddress(3)));
+    TEST_ASSERT_EQUAL(1, set.find(sensorAddress(1))->advCount);
+
+    // with every device seen in this scan nothing is replaced
+    for (uint32_t n = 4; n < SCAN_MAX_DEVICES; n++) {
+        set.update(makeEvent(sensorAddress(n), 600 + n, -60));
+    }
+    TEST_ASSERT_EQUAL(SCAN_MAX_DEVICES, set.foundCount());
+    TEST_ASSERT_NULL(set.update(makeEvent(sensorAddress(100), 700, -60)));
+    TEST_ASSERT_NULL(set.find(sensorAddress(100)));
+    TEST_ASSERT_EQUAL(SCAN_MAX_DEVICES, set.foundCount());
+}
+
+void test_benchmark(void) {
+    // a crowded scan: every device of a full set advertising in turn
+    static ScanEventRing ring;
+    const uint32_t rounds = 1000000;
+    scanEvent_t event;
+    volatile uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++) {
+        ring.push(makeEvent(sensorAddress(i % SCAN_MAX_DEVICES), i, -60 - (int8_t)(i % 20)));
+        ring.pop(event);
+        sink += set.update(event)->advCount;
+    }
+    auto end = std::chrono::steady_clock::now();
+    double eventNs = std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+
+    TEST_ASSERT_EQUAL(0, ring.dropped());
+    TEST_ASSERT_EQUAL(SCAN_MAX_DEVICES, set.foundCount());
+    printf("event through ring and set: %.1f ns, ring %u bytes, set %u bytes\n",
+        eventNs, (unsigned)sizeof(ScanEventRing), (unsigned)sizeof(ScanDeviceSet));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ring_order_and_drop);
+    RUN_TEST(test_ring_producer_thread);
+    RUN_TEST(test_dedup_across_scans);
+    RUN_TEST(test_rssi_statistics);
+    RUN_TEST(test_address_type_any);
+    RUN_TEST(test_eviction);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
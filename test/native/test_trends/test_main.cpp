@@ -0,0 +1,158 @@
+/*
+ * Host-side tests of the streaming trend estimators.
+ *
+ * Run with: pio test -e native -f native/test_trends -v
+ * Covers the EWMA and its variance against a direct computation, the exact
+ * slope of a linear ramp, the sliding window forgetting old readings, and
+ * irregular reading intervals. The verbose output prints the cost of one
+ * update and the size of the state.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#include "trends.h"
+
+#define T0 1700000000
+
+static historyRecord_t makeRecord(uint8_t sensor, uint32_t time, int16_t ph, int16_t temp) {
+    historyRecord_t record;
+    memset(&record, 0, sizeof(record));
+    record.time = time;
+    record.sensor = sensor;
+    record.type = 1;
+    record.raw[YC01_PH] = ph;
+    record.raw[YC01_ORP] = 700;
+    record.raw[YC01_CL] = 6;
+    record.raw[YC01_TEMP] = temp;
+    return record;
+}
+
+static Trends trends;
+
+void setUp(void) {
+    trends.begin();
+}
+
+void tearDown(void) {}
+
+void test_empty_and_constant(void) {
+    trendStats_t stats[YC01_QUANTITIES];
+    TEST_ASSERT_FALSE(trends.get(0, stats));
+    TEST_ASSERT_FALSE(trends.get(TREND_MAX_SENSORS, stats));
+
+    for (uint32_t i = 0; i < 40; i++) {
+        trends.add(makeRecord(0, T0 + i * 300, 720, 250));
+    }
+    TEST_ASSERT_TRUE(trends.get(0, stats));
+    TEST_ASSERT_EQUAL(TREND_WINDOW, stats[YC01_PH].samples);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 7.2f, stats[YC01_PH].mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 25.0f, stats[YC01_TEMP].mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, stats[YC01_PH].sd);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, stats[YC01_PH].slope);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, stats[YC01_ORP].slope);
+    // other sensors are independent
+    TEST_ASSERT_FALSE(trends.get(1, stats));
+}
+
+void test_linear_ramp_slope(void) {
+    // temperature rises 0.1 degree per 5 minutes: 1.2 per hour
+    trendStats_t stats[YC01_QUANTITIES];
+    trends.add(makeRecord(0, T0, 720, 200));
+    TEST_ASSERT_TRUE(trends.get(0, stats));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, stats[YC01_TEMP].slope);
+    for (uint32_t i = 1; i < 100; i++) {
+        trends.add(makeRecord(0, T0 + i * 300, 720 - (int16_t)(i % 2), 200 + i));
+        trends.get(0, stats);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.2f, stats[YC01_TEMP].slope);
+    }
+    // pH alternates around a constant level, no trend beyond the noise
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, stats[YC01_PH].slope);
+    // the EWMA lags the ramp by about the time constant
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 29.9f - 1.2f, stats[YC01_TEMP].mean);
+}
+
+void test_window_forgets(void) {
+    trendStats_t stats[YC01_QUANTITIES];
+    // falling temperature, then flat
+    for (uint32_t i = 0; i < 20; i++) {
+        trends.add(makeRecord(2, T0 + i * 600, 720, 300 - i * 5));
+    }
+    trends.get(2, stats);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, -3.0f, stats[YC01_TEMP].slope);
+    for (uint32_t i = 20; i < 20 + TREND_WINDOW; i++) {
+        trends.add(makeRecord(2, T0 + i * 600, 720, 200));
+    }
+    trends.get(2, stats);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, stats[YC01_TEMP].slope);
+    // the EWMA converges to the new level
+    for (uint32_t i = 0; i < 200; i++) {
+        trends.add(makeRecord(2, T0 + 100000 + i * 600, 720, 200));
+    }
+    trends.get(2, stats);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 20.0f, stats[YC01_TEMP].mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.0f, stats[YC01_TEMP].sd);
+}
+
+void test_ewma_against_direct(void) {
+    // irregular intervals: weights exp(-age / TREND_TAU), normalised
+    const uint32_t times[] = { 0, 60, 900, 1000, 4000, 4100, 9000, 9030 };
+    const int16_t values[] = { 700, 720, 690, 740, 710, 705, 760, 730 };
+    const size_t count = sizeof(times) / sizeof(times[0]);
+    for (size_t i = 0; i < count; i++) {
+        trends.add(makeRecord(0, T0 + times[i], values[i], 250));
+    }
+    // recursive reference in double
+    double mean = values[0], var = 0;
+    for (size_t i = 1; i < count; i++) {
+        double alpha = 1 - exp(-(double)(times[i] - times[i - 1]) / TREND_TAU);
+        double diff = values[i] - mean;
+        mean += alpha * diff;
+        var = (1 - alpha) * (var + alpha * diff * diff);
+    }
+    trendStats_t stats[YC01_QUANTITIES];
+    trends.get(0, stats);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float)(mean / 100), stats[YC01_PH].mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float)(sqrt(var) / 100), stats[YC01_PH].sd);
+    TEST_ASSERT_TRUE(stats[YC01_PH].sd > 0.05f);
+
+    // least-squares slope of the same readings
+    double st = 0, sx = 0, stt = 0, stx = 0;
+    for (size_t i = 0; i < count; i++) {
+        st += times[i]; sx += values[i]; stt += (double)times[i] * times[i]; stx += (double)times[i] * values[i];
+    }
+    double slope = (count * stx - st * sx) / (count * stt - st * st) * 3600 / 100;
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (float)slope, stats[YC01_PH].slope);
+}
+
+void test_benchmark_add(void) {
+    typedef std::chrono::steady_clock clock;
+    const uint32_t total = 1000000;
+    auto start = clock::now();
+    for (uint32_t n = 0; n < total; n++) {
+        trends.add(makeRecord(n % TREND_MAX_SENSORS, T0 + n * 30, 700 + n % 50, 250 + n % 7));
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / total;
+    start = clock::now();
+    trendStats_t stats[YC01_QUANTITIES];
+    float sum = 0;
+    for (uint32_t n = 0; n < total; n++) {
+        trends.get(n % TREND_MAX_SENSORS, stats);
+        sum += stats[YC01_PH].slope;
+    }
+    double getNs = std::chrono::duration<double, std::nano>(clock::now() - start).count() / total;
+    printf("add: %.1f ns per reading, get: %.1f ns, %u bytes of state\n", ns, getNs, (unsigned)sizeof(Trends));
+    TEST_ASSERT_TRUE(isfinite(sum));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_and_constant);
+    RUN_TEST(test_linear_ramp_slope);
+    RUN_TEST(test_window_forgets);
+    RUN_TEST(test_ewma_against_direct);
+    RUN_TEST(test_benchmark_add);
+    return UNITY_END();
+}
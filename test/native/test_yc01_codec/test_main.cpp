@@ -0,0 +1,175 @@
+/*
+ * Host-side tests and benchmark of the BLE-YC01 frame decoder.
+ *
+ * Run with: pio test -e native -f native/test_yc01_codec -v
+ * The decoder is compared against the original implementation (byte wise
+ * chained bit swap into a static buffer plus a separate checksum pass) on a
+ * recorded golden frame and on random frames of every supported length.
+ * The verbose output prints the time per frame of both implementations.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "yc01Codec.h"
+
+#define BENCH_ROUNDS 2000000
+
+/*
+ * Reference: decodeData() and checksum() as shipped before the SWAR decoder
+ */
+static uint8_t refDecoded[60];
+
+static uint8_t* refDecodeData(uint8_t const data[], int length) {
+    if (length < 2 || length > 60) {
+        return NULL;
+    }
+
+    uint8_t tmp, hibit0, lobit0, hibit1, lobit1;
+    tmp = data[length - 1];
+    for (int i = length - 1; i > 0; i--) {
+        hibit1 = (tmp & 0x55) << 1;
+        lobit1 = (tmp & 0xAA) >> 1;
+        tmp = data[i - 1];
+        hibit0 = (tmp & 0x55) << 1;
+        lobit0 = (tmp & 0xAA) >> 1;
+
+        refDecoded[i] = ~(hibit1 | lobit0);
+        tmp = ~(hibit0 | lobit1);
+        refDecoded[i - 1] = tmp;
+    }
+    return refDecoded;
+}
+
+static uint8_t refChecksum(const uint8_t* data, int length) {
+    uint8_t chksum = 0;
+    for (int i = 0; i < length; i++)
+        chksum = chksum ^ data[i];
+    return chksum;
+}
+
+static yc01Error_t refDecode(const uint8_t in[], size_t length, uint8_t out[]) {
+    uint8_t* data = refDecodeData(in, length);
+    if (!data) return YC01_ERR_LENGTH;
+    memcpy(out, data, length);
+    return refChecksum(data, length - 1) == data[length - 1] ? YC01_OK : YC01_ERR_CHECKSUM;
+}
+
+/*
+ * Golden frame: pH 7.23, EC 1500 mV, TDS 750 mg/L, ORP 680 mV, Cl 0.5 mg/L,
+ * 26.5 °C, battery 3088 mV (the battery low byte doubles as checksum)
+ */
+static const uint8_t goldenRaw[YC01_FRAME_LENGTH] = {
+    0xA8, 0xFD, 0xAF, 0x5D, 0xF4, 0x16, 0xFF, 0x33, 0xFE,
+    0xAA, 0xFE, 0xA1, 0xFD, 0xFD, 0xF7, 0xDB, 0x5D
+};
+static const uint8_t goldenDecoded[YC01_FRAME_LENGTH] = {
+    0xFF, 0xA1, 0x01, 0x02, 0xD3, 0x05, 0xDC, 0x02, 0xEE,
+    0x02, 0xA8, 0x00, 0x05, 0x01, 0x09, 0x0C, 0x10
+};
+
+static void fillRandom(uint8_t data[], size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        data[i] = rand() & 0xFF;
+    }
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_golden_frame(void) {
+    uint8_t out[YC01_MAX_FRAME_LENGTH];
+    TEST_ASSERT_EQUAL(YC01_OK, yc01Decode(goldenRaw, sizeof(goldenRaw), out));
+    TEST_ASSERT_EQUAL_MEMORY(goldenDecoded, out, sizeof(goldenDecoded));
+
+    uint8_t ref[YC01_MAX_FRAME_LENGTH];
+    TEST_ASSERT_EQUAL(YC01_OK, refDecode(goldenRaw, sizeof(goldenRaw), ref));
+    TEST_ASSERT_EQUAL_MEMORY(ref, out, sizeof(goldenDecoded));
+}
+
+void test_matches_reference(void) {
+    uint8_t in[YC01_MAX_FRAME_LENGTH];
+    uint8_t out[YC01_MAX_FRAME_LENGTH];
+    uint8_t ref[YC01_MAX_FRAME_LENGTH];
+
+    srand(1);
+    for (size_t length = 2; length <= YC01_MAX_FRAME_LENGTH; length++) {
+        for (int n = 0; n < 2000; n++) {
+            fillRandom(in, length);
+            yc01Error_t expected = refDecode(in, length, ref);
+            TEST_ASSERT_EQUAL(expected, yc01Decode(in, length, out));
+            TEST_ASSERT_EQUAL_MEMORY(ref, out, length);
+        }
+    }
+}
+
+void test_checksum_error(void) {
+    uint8_t in[YC01_FRAME_LENGTH];
+    uint8_t out[YC01_MAX_FRAME_LENGTH];
+
+    // any single flipped bit breaks the checksum
+    for (size_t i = 0; i < YC01_FRAME_LENGTH * 8; i++) {
+        memcpy(in, goldenRaw, sizeof(in));
+        in[i / 8] ^= 1 << (i % 8);
+        TEST_ASSERT_EQUAL(YC01_ERR_CHECKSUM, yc01Decode(in, sizeof(in), out));
+    }
+}
+
+void test_length_error(void) {
+    uint8_t in[YC01_MAX_FRAME_LENGTH + 1] = {0};
+    uint8_t out[YC01_MAX_FRAME_LENGTH + 1];
+    TEST_ASSERT_EQUAL(YC01_ERR_LENGTH, yc01Decode(in, 0, out));
+    TEST_ASSERT_EQUAL(YC01_ERR_LENGTH, yc01Decode(in, 1, out));
+    TEST_ASSERT_EQUAL(YC01_ERR_LENGTH, yc01Decode(in, YC01_MAX_FRAME_LENGTH + 1, out));
+    TEST_ASSERT_EQUAL_STRING("invalid frame length", yc01ErrorName(YC01_ERR_LENGTH));
+}
+
+void test_reentrant(void) {
+    // decoding another frame must not change a previous result
+    uint8_t first[YC01_MAX_FRAME_LENGTH];
+    uint8_t second[YC01_MAX_FRAME_LENGTH];
+    uint8_t other[YC01_FRAME_LENGTH];
+    TEST_ASSERT_EQUAL(YC01_OK, yc01Decode(goldenRaw, sizeof(goldenRaw), first));
+    fillRandom(other, sizeof(other));
+    yc01Decode(other, sizeof(other), second);
+    TEST_ASSERT_EQUAL_MEMORY(goldenDecoded, first, sizeof(goldenDecoded));
+}
+
+void test_benchmark(void) {
+    uint8_t out[YC01_MAX_FRAME_LENGTH];
+    volatile uint32_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCH_ROUNDS; n++) {
+        sink += refDecode(goldenRaw, sizeof(goldenRaw), out);
+        sink += out[n & 0x0F];
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCH_ROUNDS; n++) {
+        sink += yc01Decode(goldenRaw, sizeof(goldenRaw), out);
+        sink += out[n & 0x0F];
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double refNs = std::chrono::duration<double, std::nano>(mid - start).count() / BENCH_ROUNDS;
+    double newNs = std::chrono::duration<double, std::nano>(end - mid).count() / BENCH_ROUNDS;
+    printf("decode + checksum of a %d byte frame: reference %.1f ns, swar %.1f ns\n",
+        YC01_FRAME_LENGTH, refNs, newNs);
+    (void)sink;
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_golden_frame);
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_checksum_error);
+    RUN_TEST(test_length_error);
+    RUN_TEST(test_reentrant);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}